@@ -74,6 +74,7 @@
 #include "pbd/file_archive.h"
 #include "pbd/enumwriter.h"
 #include "pbd/memento_command.h"
+#include "pbd/memory_account.h"
 #include "pbd/openuri.h"
 #include "pbd/stl_delete.h"
 #include "pbd/types_convert.h"
@@ -103,6 +104,7 @@
 #include "ardour/audioengine.h"
 #include "ardour/audiofilesource.h"
 #include "ardour/automation_watch.h"
+#include "ardour/capture_encoder.h"
 #include "ardour/disk_reader.h"
 #include "ardour/disk_writer.h"
 #include "ardour/filename_extensions.h"
@@ -309,6 +311,7 @@ ARDOUR_UI::ARDOUR_UI (int *argcp, char **argvp[], const char* localedir)
 	, trigger_page (0)
 	, nsm (0)
 	, _was_dirty (false)
+	, _memory_report_cnt (0)
 	, _mixer_on_top (false)
 	, _shared_popup_menu (0)
 	, startup_fsm (0)
@@ -435,6 +438,9 @@ ARDOUR_UI::ARDOUR_UI (int *argcp, char **argvp[], const char* localedir)
 	ARDOUR::DiskWriter::Overrun.connect (forever_connections, MISSING_INVALIDATOR, boost::bind (&ARDOUR_UI::disk_overrun_handler, this), gui_context());
 	ARDOUR::DiskReader::Underrun.connect (forever_connections, MISSING_INVALIDATOR, boost::bind (&ARDOUR_UI::disk_underrun_handler, this), gui_context());
 
+	/* switch captures over to their encoded file in the GUI thread, which also saves the session */
+	ARDOUR::CaptureEncoder::Encoded.connect (forever_connections, MISSING_INVALIDATOR, boost::bind (&ARDOUR::CaptureEncoder::use_encoded_file, _1, _2), gui_context());
+
 	ARDOUR::Session::VersionMismatch.connect (forever_connections, MISSING_INVALIDATOR, boost::bind (&ARDOUR_UI::session_format_mismatch, this, _1, _2), gui_context());
 
 	/* handle dialog requests */
@@ -1150,6 +1156,7 @@ ARDOUR_UI::every_second ()
 	update_disk_space ();
 	update_timecode_format ();
 	update_peak_thread_work ();
+	update_memory_accounts ();
 
 	if (nsm && nsm->is_active ()) {
 		nsm->check ();
@@ -1385,6 +1392,22 @@ ARDOUR_UI::update_peak_thread_work ()
 	}
 }
 
+void
+ARDOUR_UI::update_memory_accounts ()
+{
+	/* caches are trimmed by the owner of each account, in this thread */
+	PBD::MemoryAccount::check_budgets ();
+
+	uint32_t const interval = Config->get_memory_report_interval ();
+
+	if (interval == 0 || ++_memory_report_cnt < interval) {
+		return;
+	}
+
+	_memory_report_cnt = 0;
+	info << string_compose (_("Memory usage:\n%1"), PBD::MemoryAccount::report ()) << endmsg;
+}
+
 void
 ARDOUR_UI::count_recenabled_streams (Route& route)
 {
@@ -426,6 +426,7 @@ private:
 	Gtk::Tooltips _tooltips;
 	NSM_Client*    nsm;
 	bool          _was_dirty;
+	uint32_t      _memory_report_cnt;
 	bool          _mixer_on_top;
 
 	Gtk::Menu*    _shared_popup_menu;
@@ -625,6 +626,8 @@ private:
 	Gtk::Label   peak_thread_work_label;
 	void update_peak_thread_work ();
 
+	void update_memory_accounts ();
+
 	Gtk::Label   sample_rate_label;
 	void update_sample_rate (ARDOUR::samplecnt_t);
 
@@ -623,6 +623,16 @@ ExportFormatDialog::init_format_table ()
 	row[src_quality_cols.id]    = ExportFormatBase::SRC_SincBest;
 	row[src_quality_cols.label] = _("Best (sinc)");
 
+	iter                        = src_quality_list->append ();
+	row                         = *iter;
+	row[src_quality_cols.id]    = ExportFormatBase::SRC_PolyphaseBest;
+	row[src_quality_cols.label] = _("Best (polyphase)");
+
+	iter                        = src_quality_list->append ();
+	row                         = *iter;
+	row[src_quality_cols.id]    = ExportFormatBase::SRC_PolyphaseGood;
+	row[src_quality_cols.label] = _("Good (polyphase)");
+
 	iter                        = src_quality_list->append ();
 	row                         = *iter;
 	row[src_quality_cols.id]    = ExportFormatBase::SRC_SincMedium;
@@ -285,7 +285,7 @@ GainMeterBase::set_controls (boost::shared_ptr<Route> r,
 		gain_automation_state_changed ();
 	}
 
-	_control->Changed.connect (model_connections, invalidator (*this), boost::bind (&GainMeterBase::gain_changed, this), gui_context());
+	_control->Changed.connect_coalesced (model_connections, invalidator (*this), boost::bind (&GainMeterBase::gain_changed, this), gui_context());
 
 	gain_changed ();
 	show_gain ();
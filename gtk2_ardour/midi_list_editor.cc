@@ -147,8 +147,8 @@ MidiListEditor::MidiListEditor (Session* s, boost::shared_ptr<MidiRegion> r, boo
 
 	redisplay_model ();
 
-	region->midi_source(0)->model()->ContentsChanged.connect (content_connections, invalidator (*this),
-	                                                          boost::bind (&MidiListEditor::redisplay_model, this), gui_context());
+	region->midi_source(0)->ensure_model()->ContentsChanged.connect (content_connections, invalidator (*this),
+	                                                                 boost::bind (&MidiListEditor::redisplay_model, this), gui_context());
 	region->PropertyChanged.connect (content_connections, invalidator (*this),
 	                                 boost::bind (&MidiListEditor::redisplay_model, this), gui_context());
 
@@ -270,7 +270,7 @@ MidiListEditor::scroll_event (GdkEventScroll* ev)
 
 	if (apply) {
 
-		boost::shared_ptr<MidiModel> m (region->midi_source(0)->model());
+		boost::shared_ptr<MidiModel> m (region->midi_source(0)->ensure_model());
 		MidiModel::NoteDiffCommand* cmd = m->new_note_diff_command (opname);
 		vector<TreeModel::Path> previous_selection;
 
@@ -450,7 +450,7 @@ MidiListEditor::key_release (GdkEventKey* ev)
 	TreeViewColumn* col;
 	TreeModel::iterator iter;
 	MidiModel::NoteDiffCommand* cmd;
-	boost::shared_ptr<MidiModel> m (region->midi_source(0)->model());
+	boost::shared_ptr<MidiModel> m (region->midi_source(0)->ensure_model());
 	boost::shared_ptr<NoteType> note;
 	boost::shared_ptr<NoteType> copy;
 
@@ -524,7 +524,7 @@ MidiListEditor::delete_selected_note ()
 		}
 	}
 
-	boost::shared_ptr<MidiModel> m (region->midi_source(0)->model());
+	boost::shared_ptr<MidiModel> m (region->midi_source(0)->ensure_model());
 	MidiModel::NoteDiffCommand* cmd = m->new_note_diff_command (_("delete notes (from list)"));
 
 	for (Notes::iterator i = to_delete.begin(); i != to_delete.end(); ++i) {
@@ -700,7 +700,7 @@ MidiListEditor::edited (const std::string& path, const std::string& text)
 
 	if (apply) {
 
-		boost::shared_ptr<MidiModel> m (region->midi_source(0)->model());
+		boost::shared_ptr<MidiModel> m (region->midi_source(0)->ensure_model());
 		MidiModel::NoteDiffCommand* cmd = m->new_note_diff_command (opname);
 
 		TreeView::Selection::ListHandle_Path rows = view.get_selection()->get_selected_rows ();
@@ -754,7 +754,7 @@ MidiListEditor::redisplay_model ()
 
 	if (_session) {
 
-		boost::shared_ptr<MidiModel> m (region->midi_source(0)->model());
+		boost::shared_ptr<MidiModel> m (region->midi_source(0)->ensure_model());
 		TreeModel::Row row;
 		stringstream ss;
 
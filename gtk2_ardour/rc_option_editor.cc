@@ -2402,6 +2402,16 @@ RCOptionEditor::RCOptionEditor ()
 
 	add_option (_("General"), new UndoOptions (_rc_config));
 
+	bo = new BoolOption (
+		     "incremental-history",
+		     _("Save undo history incrementally"),
+		     sigc::mem_fun (*_rc_config, &RCConfiguration::get_incremental_history),
+		     sigc::mem_fun (*_rc_config, &RCConfiguration::set_incremental_history)
+		     );
+	add_option (_("General"), bo);
+	Gtkmm2ext::UI::instance()->set_tip (bo->tip_widget(),
+			_("<b>When enabled</b> only the changes since the last save are appended to the session's undo history, and a saved history is only loaded once it is needed. Older versions of Ardour do not know about these changes and may show a truncated or outdated undo history."));
+
 	add_option (_("General"),
 	     new BoolOption (
 		     "verify-remove-last-capture",
@@ -2420,6 +2430,24 @@ RCOptionEditor::RCOptionEditor ()
 		     sigc::mem_fun (*_rc_config, &RCConfiguration::set_periodic_safety_backups)
 		     ));
 
+	add_option (_("General"),
+	     new BoolOption (
+		     "save-pending-state-in-background",
+		     _("Write backups of the session file in the background"),
+		     sigc::mem_fun (*_rc_config, &RCConfiguration::get_save_pending_state_in_background),
+		     sigc::mem_fun (*_rc_config, &RCConfiguration::set_save_pending_state_in_background)
+		     ));
+
+	bo = new BoolOption (
+		     "binary-automation-data",
+		     _("Store automation data in compact binary form"),
+		     sigc::mem_fun (*_rc_config, &RCConfiguration::get_binary_automation_data),
+		     sigc::mem_fun (*_rc_config, &RCConfiguration::set_binary_automation_data)
+		     );
+	add_option (_("General"), bo);
+	Gtkmm2ext::UI::instance()->set_tip (bo->tip_widget(),
+			_("<b>When enabled</b> automation is saved in a binary encoding, which makes session files smaller and faster to load, but sessions saved this way lose all automation when opened with older versions of Ardour."));
+
 	add_option (_("General"), new DirectoryOption (
 			    X_("default-session-parent-dir"),
 			    _("Default folder for new sessions:"),
@@ -2464,6 +2492,37 @@ RCOptionEditor::RCOptionEditor ()
 		     sigc::mem_fun (UIConfiguration::instance(), &UIConfiguration::set_save_export_mixer_screenshot)
 		     ));
 
+	bo = new BoolOption (
+		     "export-reuse-analysis",
+		     _("Normalize using the analysis of a previous export"),
+		     sigc::mem_fun (*_rc_config, &RCConfiguration::get_export_reuse_analysis),
+		     sigc::mem_fun (*_rc_config, &RCConfiguration::set_export_reuse_analysis)
+		     );
+	Gtkmm2ext::UI::instance()->set_tip (bo->tip_widget(),
+			_("When the same material was exported or analyzed before, and the session has not been modified since, normalized formats are encoded in a single pass, without writing and reading back a temporary file."));
+	add_option (_("General"), bo);
+
+	SpinOption<uint32_t>* so = new SpinOption<uint32_t> (
+		     "export-tmp-ram-limit",
+		     _("Keep temporary export data in memory up to (megabytes)"),
+		     sigc::mem_fun (*_rc_config, &RCConfiguration::get_export_tmp_ram_limit),
+		     sigc::mem_fun (*_rc_config, &RCConfiguration::set_export_tmp_ram_limit),
+		     0, 16384, 64, 256
+		     );
+	Gtkmm2ext::UI::instance()->set_tip (so->tip_widget(),
+			_("Normalizing needs a second pass over the exported material. If it fits, it is kept in memory instead of a temporary file. The limit is shared by all files which are exported at the same time, including parallel stems. 0 always uses a file. Realtime export always uses a file."));
+	add_option (_("General"), so);
+
+	bo = new BoolOption (
+		     "export-parallel-stems",
+		     _("Export track stems in parallel"),
+		     sigc::mem_fun (*_rc_config, &RCConfiguration::get_export_parallel_stems),
+		     sigc::mem_fun (*_rc_config, &RCConfiguration::set_export_parallel_stems)
+		     );
+	Gtkmm2ext::UI::instance()->set_tip (bo->tip_widget(),
+			_("Stems of audio tracks which play from disk, exported without track processing, are read directly from the tracks' playlists, several at a time. Stems which need the engine are exported afterwards."));
+	add_option (_("General"), bo);
+
 #if defined PHONE_HOME && !defined MIXBUS
 	add_option (_("General"), new OptionEditorHeading (_("New Version Check")));
 	bo = new BoolOption (
@@ -4630,6 +4689,26 @@ These settings will only take effect after %1 is restarted.\n\
 
 	add_option (_("Performance"), new BufferingOptions (_rc_config));
 
+	bo = new BoolOption (
+		     "capture-direct-io",
+		     _("Write recordings bypassing the system's file cache"),
+		     sigc::mem_fun (*_rc_config, &RCConfiguration::get_capture_direct_io),
+		     sigc::mem_fun (*_rc_config, &RCConfiguration::set_capture_direct_io)
+		     );
+	Gtkmm2ext::UI::instance()->set_tip (bo->tip_widget(),
+			_("When enabled, mono 32 bit float WAV, BWF and RF64 recordings are written in large blocks to preallocated files without going through the system's file cache. This reduces memory pressure and disk fragmentation when recording many tracks. Other file formats are written as usual."));
+	add_option (_("Performance"), bo);
+
+	bo = new BoolOption (
+		     "capture-deferred-encoding",
+		     _("Record to float files and convert them after recording"),
+		     sigc::mem_fun (*_rc_config, &RCConfiguration::get_capture_deferred_encoding),
+		     sigc::mem_fun (*_rc_config, &RCConfiguration::set_capture_deferred_encoding)
+		     );
+	Gtkmm2ext::UI::instance()->set_tip (bo->tip_widget(),
+			_("When enabled, and the session's file format is FLAC or an integer sample format, audio is recorded as 32 bit float and converted to the session's file format in the background when the transport stops. This saves CPU time while recording, at the cost of more disk space until the conversion is done. The float files are removed when the session is saved."));
+	add_option (_("Performance"), bo);
+
 	/* Image cache size */
 	add_option (_("Performance"), new OptionEditorHeading (_("Memory Usage")));
 
@@ -4645,6 +4724,25 @@ These settings will only take effect after %1 is restarted.\n\
 		 _("Increasing the cache size uses more memory to store waveform images, which can improve graphical performance."));
 	add_option (_("Performance"), sics);
 
+	EntryOption* mbo = new EntryOption (
+			"memory-budgets",
+			_("Memory budgets"),
+			sigc::mem_fun (*_rc_config, &RCConfiguration::get_memory_budgets),
+			sigc::mem_fun (*_rc_config, &RCConfiguration::set_memory_budgets)
+			);
+	Gtkmm2ext::UI::instance()->set_tip (mbo->tip_widget(),
+			_("Comma separated list of <i>name=size</i> pairs, e.g. <i>undo-history=256M, peak-cache=64M</i>. When a cache exceeds its budget, the oldest or least needed data is released. Known names are: disk-buffers, process-buffers, waveform-cache, peak-cache, midi, undo-history and lua."));
+	add_option (_("Performance"), mbo);
+
+	add_option (_("Performance"),
+	     new SpinOption<uint32_t> (
+		     "memory-report-interval",
+		     _("Log memory usage every (seconds, 0 to disable)"),
+		     sigc::mem_fun (*_rc_config, &RCConfiguration::get_memory_report_interval),
+		     sigc::mem_fun (*_rc_config, &RCConfiguration::set_memory_report_interval),
+		     0, 3600, 10, 60
+		     ));
+
 	add_option (_("Performance"), new OptionEditorHeading (_("Automation")));
 
 	add_option (_("Performance"),
@@ -1842,7 +1842,9 @@ SoundFileOmega::SoundFileOmega (string title, ARDOUR::Session* s,
 
 	str.clear ();
 	str.push_back (_("Best"));
+	str.push_back (_("Best (polyphase)"));
 	str.push_back (_("Good"));
+	str.push_back (_("Good (polyphase)"));
 	str.push_back (_("Quick"));
 	str.push_back (_("Fast"));
 	str.push_back (_("Fastest"));
@@ -1949,8 +1951,12 @@ SoundFileOmega::get_src_quality() const
 
 	if (str == _("Best")) {
 		return SrcBest;
+	} else if (str == _("Best (polyphase)")) {
+		return SrcPolyphaseBest;
 	} else if (str == _("Good")) {
 		return SrcGood;
+	} else if (str == _("Good (polyphase)")) {
+		return SrcPolyphaseGood;
 	} else if (str == _("Quick")) {
 		return SrcQuick;
 	} else if (str == _("Fast")) {
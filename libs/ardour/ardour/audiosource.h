@@ -39,6 +39,10 @@
 #include "pbd/stateful.h"
 #include "pbd/xml++.h"
 
+namespace PBD {
+	class MemoryAccount;
+}
+
 namespace ARDOUR {
 
 class LIBARDOUR_API AudioSource : virtual public Source, public ARDOUR::AudioReadable
@@ -100,6 +104,12 @@ class LIBARDOUR_API AudioSource : virtual public Source, public ARDOUR::AudioRea
 	/** @return true if the each source sample s must be clamped to -1 < s < 1 */
 	virtual bool clamped_at_unity () const = 0;
 
+	/** Release the cached visual peaks, they are re-read from the peakfile when needed */
+	void drop_peak_cache ();
+
+	/** Accounts for the visual peak caches of all sources */
+	static PBD::MemoryAccount& peak_cache_account ();
+
   protected:
 	static bool _build_missing_peakfiles;
 	static bool _build_peakfiles;
@@ -158,6 +168,9 @@ class LIBARDOUR_API AudioSource : virtual public Source, public ARDOUR::AudioRea
 	mutable off_t _last_map_off;
 	mutable size_t  _last_raw_map_length;
 	mutable boost::scoped_array<PeakData> peak_cache;
+	mutable samplecnt_t _peak_cache_size;
+
+	void reset_peak_cache (samplecnt_t npeaks) const;
 };
 
 }
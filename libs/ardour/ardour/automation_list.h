@@ -129,6 +129,8 @@ public:
 private:
 	void create_curve_if_necessary ();
 	int deserialize_events (const XMLNode&);
+	bool deserialize_binary_events (std::string const &);
+	bool deserialize_text_events (std::string const &);
 
 	XMLNode& state (bool save_auto_state, bool need_lock);
 	XMLNode& serialize_events (bool need_lock);
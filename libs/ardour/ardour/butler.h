@@ -95,7 +95,7 @@ private:
 	void empty_pool_trash ();
 	void config_changed (std::string);
 
-	bool flush_tracks_to_disk_normal (boost::shared_ptr<RouteList>, uint32_t& errors);
+	bool flush_tracks_to_disk_normal (boost::shared_ptr<RouteList>, uint32_t& errors, bool urgent_only = false);
 
 	/**
 	 * Add request to butler thread request queue
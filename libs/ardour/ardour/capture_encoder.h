@@ -0,0 +1,105 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __ardour_capture_encoder_h__
+#define __ardour_capture_encoder_h__
+
+#include <ctime>
+#include <list>
+#include <string>
+
+#include <glibmm/threads.h>
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+
+#include "pbd/g_atomic_compat.h"
+#include "pbd/signals.h"
+
+#include "ardour/libardour_visibility.h"
+#include "ardour/types.h"
+
+namespace ARDOUR {
+
+class AudioFileSource;
+
+/** Encodes captures which were recorded to a capture journal.
+ *
+ * With deferred encoding, audio is captured as 32 bit float to a mono
+ * RF64 (or W64) file next to the file that would normally be recorded,
+ * the "journal". When the transport stops, finished takes are queued
+ * here and encoded in the background to the session's native file
+ * format. Once a take is encoded, the Encoded signal is emitted, and
+ * the source is switched over to the encoded file by calling
+ * use_encoded_file() from the GUI thread. The journal itself is left to
+ * Session::cleanup_sources().
+ */
+class LIBARDOUR_API CaptureEncoder {
+
+  public:
+	static void init ();
+	static void work ();
+	static void flush ();
+
+	/** @return true if captures in the given format are written to a journal first */
+	static bool needs_encoding (HeaderFormat, SampleFormat);
+
+	/** @return path of the journal for the capture file \p path */
+	static std::string journal_path (std::string const& path);
+
+	/** @return header format of the journal at \p journal_path */
+	static HeaderFormat journal_header_format (std::string const& journal_path);
+
+	/** Queue a finished take for encoding to the session's native file format.
+	 * \p when and \p twhen are the time of the capture, for BWF headers.
+	 * Nothing is queued while no handler is connected to Encoded, the
+	 * source then keeps using its journal.
+	 */
+	static void queue_source_for_encoding (boost::shared_ptr<AudioFileSource>, struct tm const& when, time_t twhen);
+
+	/** Emitted from the encoder thread when a take has been encoded to the
+	 * given path. Handlers are expected to call use_encoded_file() from
+	 * the thread that runs the GUI (the same thread which saves the
+	 * session).
+	 */
+	static PBD::Signal2<void, boost::weak_ptr<AudioFileSource>, std::string> Encoded;
+
+	/** Switch a source over from its journal to the encoded file at \p path.
+	 * If the source no longer exists, the encoded file is removed.
+	 */
+	static void use_encoded_file (boost::weak_ptr<AudioFileSource>, std::string const& path);
+
+  private:
+	struct Job {
+		boost::weak_ptr<AudioFileSource> source;
+		std::string                      path;
+		HeaderFormat                     header_format;
+		SampleFormat                     sample_format;
+		struct tm                        when;
+		time_t                           twhen;
+	};
+
+	static Glib::Threads::Mutex     encoding_active_lock;
+	static Glib::Threads::Mutex     encoding_queue_lock;
+	static Glib::Threads::Cond      SourcesToEncode;
+	static std::list<Job>           encoding_queue;
+	static GATOMIC_QUAL gint        _cancel;
+
+	static void encode (Job const&);
+};
+
+}
+
+#endif /* __ardour_capture_encoder_h__ */
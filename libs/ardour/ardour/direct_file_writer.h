@@ -0,0 +1,108 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __ardour_direct_file_writer_h__
+#define __ardour_direct_file_writer_h__
+
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+#include <boost/noncopyable.hpp>
+#include <sndfile.h>
+
+#include "ardour/libardour_visibility.h"
+#include "ardour/types.h"
+
+namespace ARDOUR {
+
+class BroadcastInfo;
+
+/** Writes a mono 32 bit float WAV (or RF64) file, bypassing the page cache.
+ *
+ * This is meant for capture: the file is preallocated in large extents,
+ * and the data is written in large, aligned blocks from an aligned
+ * buffer, using O_DIRECT where available. The header is written up front
+ * with placeholder sizes, and the sizes are filled in by finish().
+ *
+ * The data starts at offset 4096. The header contains a JUNK chunk that
+ * is turned into a ds64 chunk if the file grows beyond the limits of a
+ * RIFF file, the same way libsndfile does for RF64 files.
+ */
+class LIBARDOUR_API DirectFileWriter : public boost::noncopyable
+{
+public:
+	/** Create the file at \p path. \p info describes the format, \p rf64
+	 * requests an RF64 header even if the file is small. \p bwf is
+	 * optional broadcast info to add to the header.
+	 * \throw failed_constructor if the file cannot be created
+	 */
+	DirectFileWriter (std::string const& path, SF_INFO const& info, bool rf64, BroadcastInfo* bwf);
+	~DirectFileWriter ();
+
+	/** @return true if \p info can be written, i.e. a mono 32 bit float
+	 * WAV or RF64 file, on a platform with unbuffered I/O.
+	 */
+	static bool supported (SF_INFO const& info);
+
+	/** Append \p cnt samples.
+	 * @return \p cnt, or 0 on error. Once writing failed, all
+	 * further writes fail, and finish() only keeps the data that
+	 * was written before the error.
+	 */
+	samplecnt_t write (Sample const* data, samplecnt_t cnt);
+
+	/** Read previously written samples, including those which
+	 * are still buffered.
+	 * @return number of samples read
+	 */
+	samplecnt_t read (Sample* dst, samplepos_t start, samplecnt_t cnt) const;
+
+	/** Write the remaining data, release unused preallocated space,
+	 * fill in the header and close the file.
+	 * @return 0 on success
+	 */
+	int finish ();
+
+	samplecnt_t length () const { return _length; }
+
+private:
+	void make_header (SF_INFO const& info, BroadcastInfo* bwf);
+	void update_header ();
+	int  write_block (int64_t pos, size_t size);
+	void preallocate (int64_t end);
+
+	std::string       _path;
+	int               _fd;      // unbuffered, for writing
+	int               _read_fd; // buffered, for reading while writing
+	bool              _rf64;
+	bool              _preallocate;
+	bool              _failed;
+
+	std::vector<char> _header;
+	size_t            _fact_offset; // 0 if there is no fact chunk
+
+	char*             _buf;       // aligned
+	int64_t           _buf_pos;   // file offset of _buf
+	size_t            _buf_fill;  // bytes in _buf
+	int64_t           _allocated; // file space preallocated up to here
+	samplecnt_t       _length;
+};
+
+} // namespace ARDOUR
+
+#endif /* __ardour_direct_file_writer_h__ */
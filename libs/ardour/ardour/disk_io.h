@@ -24,6 +24,7 @@
 #include <string>
 #include <exception>
 
+#include "pbd/memory_account.h"
 #include "pbd/ringbufferNPT.h"
 #include "pbd/rcu.h"
 
@@ -169,6 +170,9 @@ protected:
 		samplecnt_t curr_capture_cnt;
 
 		virtual void resize (samplecnt_t) = 0;
+
+		/** Accounts for the ringbuffers of all disk readers and writers */
+		static PBD::MemoryAccount& buffer_account ();
 	};
 
 	typedef std::vector<ChannelInfo*> ChannelList;
@@ -135,6 +135,7 @@ protected:
 
 		~ReaderChannelInfo ()
 		{
+			buffer_account ().remove (pre_loop_buffer_size * sizeof (Sample));
 			delete[] pre_loop_buffer;
 		}
 
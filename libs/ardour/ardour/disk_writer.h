@@ -102,6 +102,17 @@ public:
 
 	float buffer_load () const;
 
+	/** @return the number of samples that can still be captured before the
+	 * capture buffer overflows, if nothing is flushed to disk meanwhile
+	 */
+	samplecnt_t headroom_samples () const;
+
+	/** @return the number of captured audio samples waiting to be written to disk */
+	samplecnt_t pending_write () const;
+
+	/** @return write statistics of the current take, or the last one */
+	CaptureWriteStats capture_write_stats () const;
+
 	int seek (samplepos_t sample, bool complete_refill);
 
 	static PBD::Signal0<void> Overrun;
@@ -140,7 +151,7 @@ protected:
 
 	int use_playlist (DataType, boost::shared_ptr<Playlist>);
 
-	int do_flush (RunContext context, bool force = false);
+	int do_flush (RunContext context, bool force = false, uint32_t max_chunks = 1);
 
 	void configuration_changed ();
 
@@ -167,6 +178,8 @@ private:
 
 	void loop (samplepos_t);
 
+	void add_write_stats (samplecnt_t, int64_t usecs);
+
 	CaptureInfos                 capture_info;
 	mutable Glib::Threads::Mutex capture_info_lock;
 
@@ -202,6 +215,10 @@ private:
 	 */
 	MidiBuffer                   _gui_feed_buffer;
 	mutable Glib::Threads::Mutex _gui_feed_buffer_mutex;
+
+	CaptureWriteStats            _write_stats;
+	bool                         _write_stats_done; // take finished, reset with the next write
+	mutable Glib::Threads::Mutex _write_stats_lock;
 };
 
 } // namespace
@@ -39,9 +39,11 @@ namespace ARDOUR {
 
 class Session;
 class AudioTrack;
+class AudioPlaylist;
 class AudioPort;
 class AudioRegion;
 class CapturingProcessor;
+class Route;
 
 /// Export channel base class interface for different source types
 class LIBARDOUR_API ExportChannel : public boost::less_than_comparable<ExportChannel>
@@ -170,6 +172,9 @@ class LIBARDOUR_API RouteExportChannel : public ExportChannel
 
         static void create_from_route(std::list<ExportChannelPtr> & result, boost::shared_ptr<Route> route);
 
+	boost::shared_ptr<Route> route () const;
+	size_t channel_index () const { return channel; }
+
   public: // ExportChannel interface
 	void prepare_export (samplecnt_t max_samples, sampleoffset_t common_latency);
 
@@ -189,6 +194,7 @@ class LIBARDOUR_API RouteExportChannel : public ExportChannel
 			ProcessorRemover (boost::shared_ptr<Route> route, boost::shared_ptr<CapturingProcessor> processor)
 				: route (route), processor (processor) {}
 			~ProcessorRemover();
+			boost::shared_ptr<Route> get_route () const { return route; }
 		private:
 			boost::shared_ptr<Route> route;
 			boost::shared_ptr<CapturingProcessor> processor;
@@ -201,6 +207,43 @@ class LIBARDOUR_API RouteExportChannel : public ExportChannel
 	boost::shared_ptr<ProcessorRemover> remover;
 };
 
+/** Export channel that reads a track's playlist directly, without the engine.
+ *
+ * This yields the same data as a RouteExportChannel of a track which plays
+ * from disk, but can run in any thread, and several of them in parallel.
+ */
+class LIBARDOUR_API PlaylistExportChannel : public ExportChannel
+{
+  public:
+	PlaylistExportChannel (boost::shared_ptr<AudioPlaylist> playlist, uint32_t channel, samplepos_t start);
+
+	/** @return the playlist of \a route if its stem (the output of the
+	 * route's export point) is plain disk data, null otherwise.
+	 */
+	static boost::shared_ptr<AudioPlaylist> disk_only_playlist (boost::shared_ptr<Route> route);
+
+  public: // ExportChannel interface
+	void prepare_export (samplecnt_t max_samples, sampleoffset_t common_latency);
+
+	void read (Sample const *& data, samplecnt_t samples) const;
+	bool empty () const { return false; }
+
+	void get_state (XMLNode * /*node*/) const {};
+	void set_state (XMLNode * /*node*/, Session & /*session*/) {};
+
+	bool operator< (ExportChannel const & other) const { return this < &other; }
+
+  private:
+	boost::shared_ptr<AudioPlaylist> _playlist;
+	uint32_t                         _channel;
+	mutable samplepos_t              _position;
+
+	samplecnt_t                 _buffer_size;
+	boost::scoped_array<Sample> _buffer;
+	boost::scoped_array<Sample> _mixdown_buffer;
+	boost::scoped_array<float>  _gain_buffer;
+};
+
 } // namespace ARDOUR
 
 #endif
@@ -114,7 +114,10 @@ class LIBARDOUR_API ExportFormatBase {
 		SRC_SincMedium = SRC_SINC_MEDIUM_QUALITY,
 		SRC_SincFast = SRC_SINC_FASTEST,
 		SRC_ZeroOrderHold = SRC_ZERO_ORDER_HOLD,
-		SRC_Linear = SRC_LINEAR
+		SRC_Linear = SRC_LINEAR,
+		/* zita-resampler, see AudioGrapher::ParallelSRC */
+		SRC_PolyphaseBest = 100,
+		SRC_PolyphaseGood = 101
 	};
 
 	/// Class for managing selection and compatibility states
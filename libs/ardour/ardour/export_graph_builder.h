@@ -25,15 +25,17 @@
 #include "ardour/export_handler.h"
 #include "ardour/export_analysis.h"
 
+#include "audiographer/general/threader_pool.h"
 #include "audiographer/utils/identity_vertex.h"
 
 #include <boost/ptr_container/ptr_list.hpp>
-#include <glibmm/threadpool.h>
+#include <glibmm/threads.h>
 
 namespace AudioGrapher {
 	class SampleRateConverter;
 	class PeakReader;
 	class LoudnessReader;
+	struct LoudnessMeasurement;
 	class Normalizer;
 	class Limiter;
 	class Analyser;
@@ -68,7 +70,10 @@ class LIBARDOUR_API ExportGraphBuilder
 
   public:
 
-	ExportGraphBuilder (Session const & session);
+	/** \param block_size largest number of samples passed to process (), 0: the engine's cycle size
+	 *  \param threaded run parallel branches of the graph in helper threads
+	 */
+	ExportGraphBuilder (Session const & session, samplecnt_t block_size = 0, bool threaded = true);
 	~ExportGraphBuilder ();
 
 	samplecnt_t process (samplecnt_t samples, bool last_cycle);
@@ -91,6 +96,18 @@ class LIBARDOUR_API ExportGraphBuilder
 
 	void add_split_config (FileSpec const & config);
 
+	/* Peak and loudness of the material fed to one branch of the graph,
+	 * used to normalize later exports of the same material in one pass.
+	 */
+	struct CachedAnalysis;
+	typedef boost::shared_ptr<CachedAnalysis> CachedAnalysisPtr;
+	typedef std::map<std::string, CachedAnalysisPtr> AnalysisCache;
+
+	std::string analysis_key (FileSpec const & config) const;
+	CachedAnalysisPtr cached_analysis (FileSpec const & config);
+	void cache_analysis (FileSpec const & config, CachedAnalysis const &);
+	samplecnt_t tmp_ram_samples (FileSpec const & config) const;
+
 	class Encoder {
             public:
 		template <typename T> boost::shared_ptr<AudioGrapher::Sink<T> > init (FileSpec const & new_config);
@@ -138,7 +155,8 @@ class LIBARDOUR_API ExportGraphBuilder
 
 		void set_duration (samplecnt_t);
 		void set_peak_dbfs (float, bool force = false);
-		void set_peak_lufs (AudioGrapher::LoudnessReader const&);
+		void set_peak_lufs (AudioGrapher::LoudnessMeasurement const&);
+		void set_analysis (CachedAnalysis const&);
 
 	private:
 		typedef boost::shared_ptr<AudioGrapher::Chunker<float> > ChunkerPtr;
@@ -219,7 +237,7 @@ class LIBARDOUR_API ExportGraphBuilder
 		typedef boost::shared_ptr<AudioGrapher::SampleRateConverter> SRConverterPtr;
 
 		template<typename T>
-		void add_child_to_list (FileSpec const & new_config, boost::ptr_list<T> & list);
+		T& add_child_to_list (FileSpec const & new_config, boost::ptr_list<T> & list);
 
 		ExportGraphBuilder &  parent;
 		FileSpec              config;
@@ -284,10 +302,19 @@ class LIBARDOUR_API ExportGraphBuilder
 
 	AnalysisMap analysis_map;
 
+	/* analysers of formats which are not normalized, they see the same
+	 * material as a normalizer would.
+	 */
+	std::list<std::pair<FileSpec, AnalysisPtr> > raw_analysers;
+
+	AnalysisCache        analysis_cache;
+	Glib::Threads::Mutex analysis_cache_lock;
+	uint32_t             timespan_modification_count;
+
 	bool        _realtime;
 	samplecnt_t _master_align;
 
-	Glib::ThreadPool     thread_pool;
+	AudioGrapher::ThreaderPool thread_pool;
 	Glib::Threads::Mutex engine_request_lock;
 };
 
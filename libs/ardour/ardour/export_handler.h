@@ -24,13 +24,17 @@
 #ifndef __ardour_export_handler_h__
 #define __ardour_export_handler_h__
 
+#include <atomic>
 #include <map>
+#include <vector>
 
+#include <boost/enable_shared_from_this.hpp>
 #include <boost/operators.hpp>
 #include <boost/shared_ptr.hpp>
 
 #include "pbd/gstdio_compat.h"
 
+#include "ardour/export_analysis.h"
 #include "ardour/export_pointers.h"
 #include "ardour/session.h"
 #include "ardour/libardour_visibility.h"
@@ -74,7 +78,7 @@ class LIBARDOUR_API ExportElementFactory
 };
 
 /** Export Handler */
-class LIBARDOUR_API ExportHandler : public ExportElementFactory, public sigc::trackable
+class LIBARDOUR_API ExportHandler : public ExportElementFactory, public sigc::trackable, public boost::enable_shared_from_this<ExportHandler>
 {
   public:
 	struct FileSpec {
@@ -152,6 +156,7 @@ class LIBARDOUR_API ExportHandler : public ExportElementFactory, public sigc::tr
 	int  process_timespan (samplecnt_t samples);
 	int  post_process ();
 	void finish_timespan ();
+	void finish_file (FileSpec const &);
 
 	typedef std::pair<ConfigMap::iterator, ConfigMap::iterator> TimespanBounds;
 	ExportTimespanPtr     current_timespan;
@@ -160,6 +165,36 @@ class LIBARDOUR_API ExportHandler : public ExportElementFactory, public sigc::tr
 	PBD::ScopedConnection process_connection;
 	samplepos_t           process_position;
 
+	/* Stems which do not need the engine, rendered in parallel from playlists */
+
+	struct OfflineStem {
+		OfflineStem (ConfigMap::iterator entry, FileSpec const & spec)
+		  : entry (entry)
+		  , spec (spec)
+		  {}
+
+		ConfigMap::iterator entry;
+		FileSpec            spec; // with playlist channels
+		AnalysisResults     results;
+	};
+
+	ExportChannelConfigPtr offline_channel_config (ExportChannelConfigPtr channel_config);
+	bool start_offline_stems ();
+
+	static void* render_offline_stems_bg (void*);
+	static void* offline_stem_worker (void*);
+
+	void render_offline_stems ();
+	void render_offline_stem (OfflineStem &);
+	void publish_offline_progress ();
+	void finish_offline_stems ();
+
+	std::vector<OfflineStem> offline_stems;
+	std::atomic<size_t>      offline_next;
+	std::atomic<size_t>      offline_running; // workers which have not finished yet
+	std::atomic<samplecnt_t> offline_progress; // summed up by the workers
+	samplecnt_t              offline_base;
+
 	/* CD Marker stuff */
 
 	struct CDMarkerStatus {
@@ -230,6 +230,21 @@ namespace ARDOUR { namespace LuaAPI {
 	 */
 	int build_filename (lua_State *lua);
 
+	/**
+	 * Memory used by each subsystem (see PBD::MemoryAccount).
+	 *
+	 * @returns a table indexed by account name, with the number of bytes
+	 * currently "used", the "peak" usage and the "budget" (0: unlimited)
+	 * of each account
+	 */
+	int memory_usage (lua_State *lua);
+
+	/**
+	 * Set the memory budget of the given account in bytes, 0 for unlimited.
+	 * This is not saved, see RCConfiguration::memory_budgets.
+	 */
+	void set_memory_budget (std::string const& account, int64_t bytes);
+
 	/**
 	 * Generic conversion from audio sample count to timecode.
 	 * (TimecodeType, sample-rate, sample-pos)
@@ -27,6 +27,7 @@
 #include <deque>
 #include <queue>
 #include <utility>
+#include <vector>
 
 #include <boost/utility.hpp>
 #include <glibmm/threads.h>
@@ -60,6 +61,7 @@ public:
 	typedef Temporal::Beats TimeType;
 
 	MidiModel (boost::shared_ptr<MidiSource>);
+	~MidiModel ();
 
 	NoteMode note_mode() const { return (percussive() ? Percussive : Sustained); }
 	void set_note_mode(NoteMode mode) { set_percussive(mode == Percussive); };
@@ -79,10 +81,42 @@ public:
 
 		boost::shared_ptr<MidiModel> model() const { return _model; }
 
+		/** A single property change of a note, sys-ex or patch change: the
+		 * ID of the changed object, which property changed and its old and
+		 * new value. Times are stored in ticks, everything else as a plain
+		 * integer.
+		 *
+		 * Commands keep their changes in a vector of these rather than
+		 * holding on to the changed objects, which keeps large edits (e.g.
+		 * quantizing a whole region) small in the undo history. The objects
+		 * are looked up by ID when the command is (un)done.
+		 */
+		struct PackedChange {
+			Evoral::event_id_t id;
+			uint8_t            property;
+			int64_t            old_value;
+			int64_t            new_value;
+		};
+
+		typedef std::vector<PackedChange> PackedChanges;
+
+		/** Store @param changes as the (base64 encoded) content of @param node.
+		 * The node's "packed" property (the number of changes) marks the
+		 * format, nodes without it hold one child node per change.
+		 */
+		static void pack_changes (XMLNode& node, PackedChanges const & changes);
+
+		/** Read changes stored by pack_changes()
+		 * @return false if @param node does not hold packed changes
+		 */
+		static bool unpack_changes (XMLNode const & node, PackedChanges& changes);
+
 	protected:
 		boost::shared_ptr<MidiModel> _model;
 		const std::string            _name;
 
+		void report_missing (size_t n_missing) const;
+
 	};
 
 	class LIBARDOUR_API NoteDiffCommand : public DiffCommand {
@@ -105,6 +139,8 @@ public:
 		int set_state (const XMLNode&, int version);
 		XMLNode & get_state ();
 
+		size_t memory_used () const;
+
 		void add (const NotePtr note);
 		void remove (const NotePtr note);
 		void side_effect_remove (const NotePtr note);
@@ -129,15 +165,7 @@ public:
 
 		static Variant::Type value_type (Property prop);
 
-		struct NoteChange {
-			NoteDiffCommand::Property property;
-			NotePtr note;
-			uint32_t note_id;
-			Variant old_value;
-			Variant new_value;
-		};
-
-		typedef std::list<NoteChange>                                    ChangeList;
+		typedef PackedChanges                                            ChangeList;
 		typedef std::list< boost::shared_ptr< Evoral::Note<TimeType> > > NoteList;
 
 		const ChangeList& changes()       const { return _changes; }
@@ -151,8 +179,12 @@ public:
 
 		std::set<NotePtr> side_effect_removals;
 
-		XMLNode &marshal_change(const NoteChange&);
-		NoteChange unmarshal_change(XMLNode *xml_note);
+		static int64_t pack_value (Property, const Variant&);
+		static void    set_value (const NotePtr, Property, int64_t);
+
+		void find_notes (std::vector<NotePtr>&) const;
+
+		PackedChange unmarshal_change(XMLNode *xml_note);
 
 		XMLNode &marshal_note(const NotePtr note);
 		NotePtr unmarshal_note(XMLNode *xml_note);
@@ -177,22 +209,13 @@ public:
 		void change (boost::shared_ptr<Evoral::Event<TimeType> >, TimeType);
 
 	private:
-		struct Change {
-			Change () : sysex_id (0) {}
-			boost::shared_ptr<Evoral::Event<TimeType> > sysex;
-			gint sysex_id;
-			SysExDiffCommand::Property property;
-			TimeType old_time;
-			TimeType new_time;
-		};
-
-		typedef std::list<Change> ChangeList;
-		ChangeList _changes;
+		PackedChanges _changes;
 
 		std::list<SysExPtr> _removed;
 
-		XMLNode & marshal_change (const Change &);
-		Change unmarshal_change (XMLNode *);
+		void find_sysexes (std::vector<SysExPtr>&) const;
+
+		PackedChange unmarshal_change (XMLNode *);
 	};
 
 	class LIBARDOUR_API PatchChangeDiffCommand : public DiffCommand {
@@ -221,39 +244,44 @@ public:
 		};
 
 	private:
-		struct Change {
-			PatchChangePtr patch;
-			Property       property;
-			gint           patch_id;
-			TimeType       old_time;
-			union {
-				uint8_t    old_channel;
-				int        old_bank;
-				uint8_t    old_program;
-			};
-			TimeType       new_time;
-			union {
-				uint8_t    new_channel;
-				uint8_t    new_program;
-				int        new_bank;
-			};
-
-		    Change() : patch_id (-1) {}
-		};
-
-		typedef std::list<Change> ChangeList;
-		ChangeList _changes;
+		PackedChanges _changes;
 
 		std::list<PatchChangePtr> _added;
 		std::list<PatchChangePtr> _removed;
 
-		XMLNode & marshal_change (const Change &);
-		Change unmarshal_change (XMLNode *);
+		void change (PatchChangePtr, Property, int64_t old_value, int64_t new_value);
+		void find_patch_changes (std::vector<PatchChangePtr>&) const;
+		static void set_value (PatchChangePtr, Property, int64_t);
+
+		PackedChange unmarshal_change (XMLNode *);
 
 		XMLNode & marshal_patch_change (constPatchChangePtr);
 		PatchChangePtr unmarshal_patch_change (XMLNode *);
 	};
 
+	/** A diff command from the undo history of a source whose model is
+	 * not loaded (load-midi-models-on-demand). The model is loaded, and
+	 * the diff command created, when the command is first (un)done.
+	 */
+	class LIBARDOUR_API DeferredDiffCommand : public Command {
+	public:
+		DeferredDiffCommand (boost::shared_ptr<MidiSource>, const XMLNode &);
+		~DeferredDiffCommand ();
+
+		void operator() ();
+		void undo ();
+
+		XMLNode & get_state ();
+		size_t memory_used () const;
+
+	private:
+		boost::weak_ptr<MidiSource> _source;
+		XMLNode                     _node;
+		DiffCommand*                _command;
+
+		DiffCommand* command ();
+	};
+
 	/** Start a new NoteDiff command.
 	 *
 	 * This has no side-effects on the model or Session, the returned command
@@ -302,6 +330,16 @@ public:
 	PBD::Signal0<void> ContentsChanged;
 	PBD::Signal1<void, Temporal::timecnt_t> ContentsShifted;
 
+	/** Approximate number of bytes of memory used by notes, sysex,
+	 * patch changes and controller events of the model.
+	 */
+	size_t memory_used () const;
+
+	/** Update the "midi" PBD::MemoryAccount after the model has been
+	 * (re)loaded. Edits are accounted for automatically.
+	 */
+	void update_memory_account ();
+
 	boost::shared_ptr<const MidiSource> midi_source ();
 	void set_midi_source (boost::shared_ptr<MidiSource>);
 
@@ -347,6 +385,8 @@ private:
 	void control_list_marked_dirty ();
 
 	PBD::ScopedConnectionList _midi_source_connections;
+	PBD::ScopedConnection     _memory_connection;
+	size_t                    _memory_accounted;
 
 	// We cannot use a boost::shared_ptr here to avoid a retain cycle
 	boost::weak_ptr<MidiSource> _midi_source;
@@ -25,6 +25,7 @@
 
 #include <vector>
 #include <list>
+#include <map>
 
 #include <boost/utility.hpp>
 
@@ -71,6 +72,14 @@ public:
 
 	~MidiPlaylist ();
 
+	/** Bring the rendered copy of the playlist (see rendered()) up to date.
+	 *
+	 * Once the playlist has been rendered, later calls only re-render the
+	 * time ranges covered by regions that were added, removed, moved,
+	 * trimmed, (un)muted or edited since, and splice the result into the
+	 * existing RTMidiBuffer. The whole playlist is rendered again if the
+	 * filter or note mode changed or if most of it is affected anyway.
+	 */
 	void render (MidiChannelFilter*);
 	RTMidiBuffer* rendered();
 
@@ -87,6 +96,7 @@ public:
   protected:
 	void remove_dependents (boost::shared_ptr<Region> region);
 	void region_going_away (boost::weak_ptr<Region> region);
+	bool region_changed (const PBD::PropertyChange&, boost::shared_ptr<Region>);
 
   private:
 	void dump () const;
@@ -94,6 +104,39 @@ public:
 	NoteMode     _note_mode;
 
 	RTMidiBuffer _rendered;
+
+	/** Extent of a region as it was last rendered into _rendered */
+	struct RenderedRegion {
+		RenderedRegion (Region const &);
+
+		bool operator!= (RenderedRegion const & other) const {
+			return start != other.start || end != other.end || offset != other.offset;
+		}
+
+		samplepos_t start;  ///< first sample of the region
+		samplepos_t end;    ///< end of rendered data (incl. resolved note-offs), exclusive
+		samplepos_t offset; ///< start of the region within its source
+	};
+
+	typedef std::map<PBD::ID, RenderedRegion>                 RenderedRegions;
+	typedef std::vector<std::pair<samplepos_t, samplepos_t> > Ranges;
+
+	/* state of the last render, only used by the render()ing thread */
+	RenderedRegions                 _rendered_regions;
+	bool                            _rendered_valid;
+	MidiChannelFilter*              _rendered_filter;
+	ChannelMode                     _rendered_channel_mode;
+	uint16_t                        _rendered_channel_mask;
+	NoteMode                        _rendered_note_mode;
+
+	/* ranges whose contents changed (edited regions) since the last render */
+	Glib::Threads::Mutex            _dirty_lock;
+	Ranges                          _dirty;
+
+	typedef std::vector<boost::shared_ptr<Region> > RegionVector;
+
+	void render_all (RegionVector const &, MidiChannelFilter*);
+	void render_ranges (RegionVector const &, Ranges const &, MidiChannelFilter*);
 };
 
 } /* namespace ARDOUR */
@@ -183,6 +183,11 @@ class LIBARDOUR_API MidiSource : virtual public Source
 	void set_note_mode(const Glib::Threads::Mutex::Lock& lock, NoteMode mode);
 
 	boost::shared_ptr<MidiModel> model() { return _model; }
+	/** Return the model, loading it first if necessary. Models may not
+	 * exist yet when RCConfiguration::load_midi_models_on_demand is set.
+	 * Must not be called while holding the source lock.
+	 */
+	boost::shared_ptr<MidiModel> ensure_model ();
 	void set_model(const Glib::Threads::Mutex::Lock& lock, boost::shared_ptr<MidiModel>);
 	void drop_model(const Glib::Threads::Mutex::Lock& lock);
 
@@ -244,6 +244,7 @@ public:
 	XMLNode&    get_state ();
 	virtual int set_state (const XMLNode&, int version);
 	XMLNode&    get_template ();
+	void        write_state (XMLStreamWriter&);
 
 	PBD::Signal1<void, bool>                     InUse;
 	PBD::Signal0<void>                           ContentsChanged;
@@ -474,6 +475,14 @@ private:
 	timepos_t _end_space;  //this is used when we are pasting a range with extra space at the end
 	bool _playlist_shift_active;
 
+	/* if true, state() leaves a placeholder for the regions which
+	 * write_state() streams, one at a time.
+	 */
+	bool     _stream_regions;
+	XMLNode* _region_placeholder;
+
+	void write_region_state (XMLStreamWriter&);
+
 	std::string _pgroup_id; // when we make multiple playlists in one action, they will share the same pgroup_id
 };
 
@@ -94,6 +94,9 @@ CONFIG_VARIABLE (BufferingPreset, buffering_preset, "buffering-preset", Medium)
 CONFIG_VARIABLE (float, audio_capture_buffer_seconds, "capture-buffer-seconds", 5.0)
 CONFIG_VARIABLE (float, audio_playback_buffer_seconds, "playback-buffer-seconds", 5.0)
 CONFIG_VARIABLE (float, midi_track_buffer_seconds, "midi-track-buffer-seconds", 1.0)
+CONFIG_VARIABLE (bool, load_midi_models_on_demand, "load-midi-models-on-demand", false)
+CONFIG_VARIABLE (bool, capture_direct_io, "capture-direct-io", false)
+CONFIG_VARIABLE (bool, capture_deferred_encoding, "capture-deferred-encoding", false)
 CONFIG_VARIABLE (uint32_t, disk_choice_space_threshold,  "disk-choice-space-threshold", 57600000)
 CONFIG_VARIABLE (bool, auto_analyse_audio, "auto-analyse-audio", false)
 CONFIG_VARIABLE (float, transient_sensitivity, "transient-sensitivity", 50)
@@ -200,10 +203,14 @@ CONFIG_VARIABLE (bool, hiding_groups_deactivates_groups, "hiding-groups-deactiva
 CONFIG_VARIABLE (bool, verify_remove_last_capture, "verify-remove-last-capture", true)
 CONFIG_VARIABLE (bool, save_history, "save-history", true)
 CONFIG_VARIABLE (int32_t, saved_history_depth, "save-history-depth", 20)
+CONFIG_VARIABLE (bool, incremental_history, "incremental-history", false)
 CONFIG_VARIABLE (int32_t, history_depth, "history-depth", 20)
+CONFIG_VARIABLE (std::string, memory_budgets, "memory-budgets", "") /* comma separated "account=size" list, see PBD::MemoryAccount::set_budgets */
+CONFIG_VARIABLE (uint32_t, memory_report_interval, "memory-report-interval", 0) /* seconds, 0: never */
 CONFIG_VARIABLE (RegionEquivalence, region_equivalence, "region-equivalency", LayerTime)
 CONFIG_VARIABLE (bool, periodic_safety_backups, "periodic-safety-backups", true)
 CONFIG_VARIABLE (uint32_t, periodic_safety_backup_interval, "periodic-safety-backup-interval", 120)
+CONFIG_VARIABLE (bool, save_pending_state_in_background, "save-pending-state-in-background", true)
 CONFIG_VARIABLE (float, automation_interval_msecs, "automation-interval-msecs", 30)
 #ifdef __APPLE__
 CONFIG_VARIABLE_SPECIAL (std::string, default_session_parent_dir, "default-session-parent-dir", "~/Music", poor_mans_glob)
@@ -220,6 +227,7 @@ CONFIG_VARIABLE (gain_t, max_gain, "max-gain", 2.0) /* +6.0dB */
 CONFIG_VARIABLE (uint32_t, max_recent_sessions, "max-recent-sessions", 10)
 CONFIG_VARIABLE (uint32_t, max_recent_templates, "max-recent-templates", 10)
 CONFIG_VARIABLE (double, automation_thinning_factor, "automation-thinning-factor", 20.0)
+CONFIG_VARIABLE (bool, binary_automation_data, "binary-automation-data", false)
 CONFIG_VARIABLE (std::string, freesound_download_dir, "freesound-download-dir", Glib::get_home_dir() + "/Freesound/snd")
 CONFIG_VARIABLE (samplecnt_t, range_location_minimum, "range-location-minimum", 128) /* samples */
 CONFIG_VARIABLE (EditMode, edit_mode, "edit-mode", Slide)
@@ -281,3 +289,6 @@ CONFIG_VARIABLE (bool, show_video_server_dialog, "show-video-server-dialog", fal
 /* export */
 CONFIG_VARIABLE (float, export_preroll, "export-preroll", 2.0) // seconds
 CONFIG_VARIABLE (float, export_silence_threshold, "export-silence-threshold", -90) // dB
+CONFIG_VARIABLE (bool, export_reuse_analysis, "export-reuse-analysis", false)
+CONFIG_VARIABLE (uint32_t, export_tmp_ram_limit, "export-tmp-ram-limit", 256) // MB, shared by all temporary export files, 0 to always use a file
+CONFIG_VARIABLE (bool, export_parallel_stems, "export-parallel-stems", false)
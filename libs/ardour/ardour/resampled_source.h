@@ -24,6 +24,8 @@
 
 #include <samplerate.h>
 
+#include "audiographer/general/parallel_src.h"
+
 #include "ardour/libardour_visibility.h"
 #include "ardour/types.h"
 #include "ardour/importable_source.h"
@@ -56,8 +58,8 @@ class LIBARDOUR_API ResampledImportableSource : public ImportableSource
 	boost::shared_ptr<ImportableSource> source;
 	float*          _input;
 	int             _src_type;
-	SRC_STATE*      _src_state;
 	SRC_DATA        _src_data;
+	AudioGrapher::ParallelSRC _src;
 	bool            _end_of_input;
 };
 
@@ -414,6 +414,7 @@ public:
 	XMLNode& get_state();
 	XMLNode& get_template();
 	virtual int set_state (const XMLNode&, int version);
+	void write_state (XMLStreamWriter&);
 
 	XMLNode& get_processor_state ();
 	void set_processor_state (const XMLNode&, int version);
@@ -812,6 +813,15 @@ private:
 
 	RoutePinWindowProxy*   _pinmgr_proxy;
 	PatchChangeGridDialog* _patch_selector_dialog;
+
+	/** if true, state() leaves a placeholder for the processors which
+	 *  write_state() streams, one at a time.
+	 */
+	bool     _stream_processors;
+	XMLNode* _processor_placeholder;
+
+	ProcessorList processors_to_save (bool save_template);
+	void write_processor_state (XMLStreamWriter&);
 };
 
 } // namespace ARDOUR
@@ -28,6 +28,7 @@
 #include <glibmm/threads.h>
 
 #include "evoral/Event.h"
+#include "evoral/EventList.h"
 #include "evoral/EventSink.h"
 #include "evoral/midi_util.h"
 
@@ -63,6 +64,17 @@ class LIBARDOUR_API RTMidiBuffer : public Evoral::EventSink<samplepos_t>
 	uint32_t write (TimeType time, Evoral::EventType type, uint32_t size, const uint8_t* buf);
 	uint32_t read (MidiBuffer& dst, samplepos_t start, samplepos_t end, MidiStateTracker& tracker, samplecnt_t offset = 0);
 
+	/** Replace all events with start <= time < end by @param events, which
+	 * must be sorted and lie within the same range. Used to update part of
+	 * a rendered playlist without rendering all of it again.
+	 *
+	 * Like write() and clear(), this must be called with the buffer
+	 * write-protected (see WriteProtectRender).
+	 *
+	 * @return number of events removed
+	 */
+	size_t splice (TimeType start, TimeType end, Evoral::EventList<TimeType> const & events);
+
 	void dump (uint32_t);
 	void reverse ();
 	bool reversed() const;
@@ -119,9 +131,14 @@ class LIBARDOUR_API RTMidiBuffer : public Evoral::EventSink<samplepos_t>
 
 	uint32_t alloc_blob (uint32_t size);
 	uint32_t store_blob (uint32_t size, uint8_t const * data);
+	void     compact_pool ();
 	uint32_t _pool_size;
 	uint32_t _pool_capacity;
 	uint8_t* _pool;
+	/* space in the pool used by blobs that were removed by splice() */
+	uint32_t _pool_dead;
+
+	void set_item (Item&, TimeType time, uint32_t size, const uint8_t* buf);
 
 	Glib::Threads::RWLock _lock;
 
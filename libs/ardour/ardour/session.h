@@ -93,6 +93,7 @@
 
 class XMLTree;
 class XMLNode;
+class XMLStreamWriter;
 struct _AEffect;
 typedef struct _AEffect AEffect;
 
@@ -242,6 +243,8 @@ public:
 	bool reconnection_in_progress () const         { return _reconnecting_routes_in_progress; }
 	bool routes_deletion_in_progress () const      { return _route_deletion_in_progress; }
 	bool dirty () const                            { return _state_of_the_state & Dirty; }
+	/** incremented by every set_dirty(), allows to check if anything changed since */
+	uint32_t modification_count () const          { return g_atomic_int_get (&_modification_count); }
 	bool deletion_in_progress () const             { return _state_of_the_state & Deletion; }
 	bool peaks_cleanup_in_progres () const         { return _state_of_the_state & PeakCleanup; }
 	bool loading () const                          { return _state_of_the_state & Loading; }
@@ -859,6 +862,7 @@ public:
 	boost::shared_ptr<ExportStatus> get_export_status ();
 
 	int start_audio_export (samplepos_t position, bool realtime = false, bool region_export = false);
+	int start_offline_export ();
 
 	PBD::Signal1<int, samplecnt_t> ProcessExport;
 	static PBD::Signal2<void,std::string, std::string> Exported;
@@ -905,6 +909,12 @@ public:
 	boost::shared_ptr<AudioFileSource> create_audio_source_for_session (
 		size_t, std::string const &, uint32_t);
 
+	/** Like create_audio_source_for_session(), but with deferred encoding
+	 * a capture journal is created, see CaptureEncoder.
+	 */
+	boost::shared_ptr<AudioFileSource> create_audio_capture_source_for_session (
+		size_t, std::string const &, uint32_t);
+
 	boost::shared_ptr<MidiSource> create_midi_source_for_session (std::string const &);
 	boost::shared_ptr<MidiSource> create_midi_source_by_stealing_name (boost::shared_ptr<Track>);
 
@@ -1126,6 +1136,7 @@ public:
 	// these commands are implemented in libs/ardour/session_command.cc
 	Command* memento_command_factory(XMLNode* n);
 	Command* stateful_diff_command_factory (XMLNode *);
+	Command* midi_diff_command_factory (boost::shared_ptr<MidiSource>, XMLNode const &);
 	void register_with_memento_command_factory(PBD::ID, PBD::StatefulDestructible*);
 
 	/* clicking */
@@ -1569,6 +1580,7 @@ private:
 	XMLTree*         state_tree;
 	bool             state_was_pending;
 	StateOfTheState _state_of_the_state;
+	mutable GATOMIC_QUAL guint _modification_count;
 
 	friend class    StateProtector;
 	GATOMIC_QUAL gint  _suspend_save;
@@ -1579,6 +1591,28 @@ private:
 	Glib::Threads::Mutex save_source_lock;
 	Glib::Threads::Mutex peak_cleanup_lock;
 
+	/* pending (backup) state is written by a background thread, so that
+	 * periodic saves only need to take a copy of the state.
+	 */
+	struct BackgroundSave {
+		XMLNode*    state;
+		std::string tmp_path;
+		std::string xml_path;
+		std::string backup_path;
+	};
+
+	Glib::Threads::Thread* _background_save_thread;
+	Glib::Threads::Mutex   _background_save_lock;
+	Glib::Threads::Mutex   _background_write_lock;
+	Glib::Threads::Cond    _background_save_cond;
+	BackgroundSave*        _background_save;
+	bool                   _background_save_quit;
+
+	void queue_background_save (BackgroundSave*);
+	void cancel_background_save ();
+	void background_save_thread ();
+	void background_save_thread_terminate ();
+
 	int        load_options (const XMLNode&);
 	int        load_state (std::string snapshot_name, bool from_template = false);
 	static int parse_stateful_loading_version (const std::string&);
@@ -1898,7 +1932,7 @@ private:
 
 	boost::shared_ptr<Graph> _process_graph;
 
-	SerializedRCUManager<RouteList>  routes;
+	EpochRCUManager<RouteList>       routes;
 
 	void add_routes (RouteList&, bool input_auto_connect, bool output_auto_connect, PresentationInfo::order_t);
 	void add_routes_inner (RouteList&, bool input_auto_connect, bool output_auto_connect, PresentationInfo::order_t);
@@ -1980,7 +2014,8 @@ private:
 	int load_sources (const XMLNode& node);
 	XMLNode& get_sources_as_xml ();
 
-	boost::shared_ptr<Source> XMLSourceFactory (const XMLNode&);
+	boost::shared_ptr<Source> XMLSourceFactory (const XMLNode&, bool defer_midi_model = false);
+	void reduce_source_memory (std::string const& account);
 
 	/* PLAYLISTS */
 
@@ -2071,6 +2106,18 @@ private:
 	UndoHistory      _history;
 	/** current undo transaction, or 0 */
 	UndoTransaction* _current_trans;
+
+	/** snapshot whose history journal matches the saved state of _history */
+	std::string      _history_journal_snapshot;
+	/** number of transactions in the history file and its journal */
+	uint32_t         _history_journal_written;
+
+	void start_history_journal (std::string const& snapshot_name, std::string const& xml_path, uint32_t n);
+	int  append_history_journal (std::string const& journal_path);
+	int  restore_history_journal (std::string const& snapshot_name, std::string const& xml_path, std::string const& journal_path);
+	std::vector<UndoTransaction*> load_history_journal (std::string const& xml_path, std::vector<std::string> const& records);
+	UndoTransaction* history_transaction_from_xml (XMLNode const&);
+
 	/** GQuarks to describe the reversible commands that are currently in progress.
 	 *  These may be nested, in which case more recently-started commands are toward
 	 *  the front of the list.
@@ -2089,7 +2136,11 @@ private:
 
 	XMLNode& state (bool save_template,
 	                snapshot_t snapshot_type = NormalSave,
-	                bool only_used_assets = false);
+	                bool only_used_assets = false,
+	                bool stream = false);
+
+	void write_route_states (XMLStreamWriter&);
+	void add_state_fillers (XMLStreamWriter&, XMLNode const& root);
 
 	XMLNode& get_state ();
 	int      set_state (const XMLNode& node, int version); // not idempotent
@@ -2176,6 +2227,12 @@ private:
 
 	void set_history_depth (uint32_t depth);
 
+	/** Release cached data held on behalf of the PBD::MemoryAccount
+	 * named @param account (undo history, peak or MIDI caches), until
+	 * it is back within its budget.
+	 */
+	void reduce_memory (std::string const& account);
+
 	static bool _disable_all_loaded_plugins;
 	static bool _bypass_all_loaded_plugins;
 
@@ -31,6 +31,7 @@
 #include "pbd/signals.h"
 
 class XMLNode;
+class XMLStreamWriter;
 
 namespace PBD {
 	class ID;
@@ -81,7 +82,8 @@ private:
 
 	void find_equivalent_playlist_regions (boost::shared_ptr<Region>, std::vector<boost::shared_ptr<Region> >& result);
 	void update_after_tempo_map_change ();
-	void add_state (XMLNode*, bool save_template, bool include_unused);
+	void add_state (XMLNode*, bool save_template, bool include_unused, bool stream = false);
+	void write_state (XMLStreamWriter&, bool unused);
 	bool maybe_delete_unused (boost::function<int(boost::shared_ptr<Playlist>)>);
 	int load (Session &, const XMLNode&);
 	int load_unused (Session &, const XMLNode&);
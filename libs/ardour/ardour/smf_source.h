@@ -29,7 +29,7 @@
 #include "ardour/midi_source.h"
 #include "ardour/file_source.h"
 
-namespace Evoral { template<typename T> class Event; }
+namespace Evoral { template<typename T> class Event; class SMFParser; }
 
 namespace ARDOUR {
 
@@ -68,20 +68,35 @@ public:
 	int set_state (const XMLNode&, int version);
 
 	void load_model (const Glib::Threads::Mutex::Lock& lock, bool force_reload=false);
+	void load_model (const Glib::Threads::Mutex::Lock& lock, Evoral::SMFParser const &);
 	void destroy_model (const Glib::Threads::Mutex::Lock& lock);
 
 	static bool safe_midi_file_extension (const std::string& path);
 	static bool valid_midi_file (const std::string& path);
 
+	/** (Re)load the models of all given sources, decoding their files
+	 * concurrently. Used when loading a session. With
+	 * load-midi-models-on-demand only the decoded files are kept, for
+	 * playback.
+	 */
+	static void load_models (std::vector<boost::shared_ptr<SMFSource> > const &);
+
 	void prevent_deletion ();
 	void set_path (const std::string& newpath);
 
+	/** Release the decoded file contents, playback then reads the file */
+	void drop_playback_data ();
+
   protected:
 	void close ();
 	void flush_midi (const Lock& lock);
 
   private:
 	bool _open;
+	/** Decoded file contents, used for playback while there is no model
+	 * (see RCConfiguration::load_midi_models_on_demand).
+	 */
+	mutable boost::shared_ptr<Evoral::SMFParser> _playback_data;
 	Temporal::Beats   _last_ev_time_beats;
 	samplepos_t       _last_ev_time_samples;
 	/** end time (start + duration) of last call to read_unlocked */
@@ -91,6 +106,19 @@ public:
 
 	int open_for_write ();
 
+	bool prepare_model_load (const Glib::Threads::Mutex::Lock& lock, bool force_reload);
+	boost::shared_ptr<Evoral::SMFParser> playback_data (const Lock& lock) const;
+	void set_playback_data (const Lock& lock, boost::shared_ptr<Evoral::SMFParser>);
+
+	timecnt_t read_playback_data (Evoral::SMFParser const&            data,
+	                              Evoral::EventSink<samplepos_t>& dst,
+	                              timepos_t const &               position,
+	                              timepos_t const &               start,
+	                              timecnt_t const &               cnt,
+	                              Temporal::Range*                loop_range,
+	                              MidiStateTracker*               tracker,
+	                              MidiChannelFilter*              filter) const;
+
 	void ensure_disk_file (const Lock& lock);
 
 	timecnt_t read_unlocked (const Lock&                     lock,
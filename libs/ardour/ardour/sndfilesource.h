@@ -33,6 +33,8 @@
 
 namespace ARDOUR {
 
+class DirectFileWriter;
+
 class LIBARDOUR_API SndFileSource : public AudioFileSource {
   public:
 	/** Constructor to be called for existing external-to-session files */
@@ -70,6 +72,12 @@ class LIBARDOUR_API SndFileSource : public AudioFileSource {
 
 	bool clamped_at_unity () const;
 
+	/** Write the file with a DirectFileWriter, bypassing the page cache,
+	 * if the format allows. Must be called before anything is written.
+	 * @return true if direct I/O will be used
+	 */
+	bool set_direct_io (bool yn);
+
 	static const Source::Flag default_writable_flags;
 
 	static int get_soundfile_info (const std::string& path, SoundFileInfo& _info, std::string& error_msg);
@@ -88,9 +96,13 @@ class LIBARDOUR_API SndFileSource : public AudioFileSource {
 	SNDFILE* _sndfile;
 	SF_INFO _info;
 	BroadcastInfo *_broadcast_info;
+	DirectFileWriter* _direct;
+	bool _use_direct_io;
 
 	void init_sndfile ();
 	int open();
+	int open_direct_io ();
+	int finish_direct_io ();
 	int setup_broadcast_info (samplepos_t when, struct tm&, time_t);
 	void file_closed ();
 
@@ -42,7 +42,10 @@ class LIBARDOUR_API SourceFactory {
 
 	static PBD::Signal1<void,boost::shared_ptr<Source> > SourceCreated;
 
-	static boost::shared_ptr<Source> create (Session&, const XMLNode& node, bool async = false);
+	/** @param defer_model true if the caller takes care of loading the
+	 * model of a MIDI source (see SMFSource::load_models())
+	 */
+	static boost::shared_ptr<Source> create (Session&, const XMLNode& node, bool async = false, bool defer_model = false);
 	static boost::shared_ptr<Source> createSilent (Session&, const XMLNode& node,
 	                                               samplecnt_t nframes, float sample_rate);
 
@@ -56,6 +59,14 @@ class LIBARDOUR_API SourceFactory {
 		 const std::string& path,
 		 samplecnt_t rate, bool announce = true, bool async = false);
 
+	/** Create a writable audio source in the given format, rather than
+	 * the session's native file format.
+	 */
+	static boost::shared_ptr<Source> createWritable
+		(DataType type, Session&,
+		 const std::string& path,
+		 samplecnt_t rate, SampleFormat, HeaderFormat, bool announce = true, bool async = false);
+
 
 	static boost::shared_ptr<Source> createForRecovery
 		(DataType type, Session&, const std::string& path, int chn);
@@ -52,6 +52,8 @@ public:
 
 private:
 	void allocate_pan_automation_buffers (samplecnt_t nframes, uint32_t howmany, bool force);
+
+	size_t _memory_used;
 };
 
 } // namespace
@@ -143,8 +143,11 @@ public:
 	void reset_write_sources (bool, bool force = false);
 	float playback_buffer_load () const;
 	float capture_buffer_load () const;
+	CaptureWriteStats capture_write_stats () const;
+	samplecnt_t capture_headroom_samples () const;
+	samplecnt_t capture_pending_write () const;
 	int do_refill ();
-	int do_flush (RunContext, bool force = false);
+	int do_flush (RunContext, bool force = false, uint32_t max_chunks = 1);
 	void set_pending_overwrite (OverwriteReason);
 	int seek (samplepos_t, bool complete_refill = false);
 	bool can_internal_playback_seek (samplecnt_t);
@@ -612,7 +612,9 @@ enum SrcQuality {
 	SrcGood,
 	SrcQuick,
 	SrcFast,
-	SrcFastest
+	SrcFastest,
+	SrcPolyphaseBest,
+	SrcPolyphaseGood
 };
 
 typedef std::list<samplepos_t> AnalysisFeatureList;
@@ -791,6 +793,19 @@ struct CaptureInfo {
 	XrunPositions xruns;
 };
 
+/** How fast a track's captured data is written to disk, per take */
+struct CaptureWriteStats {
+	CaptureWriteStats () : samples (0), writes (0), usecs (0), max_usecs (0) {}
+
+	samplecnt_t samples;   ///< samples written, all channels
+	uint32_t    writes;    ///< number of writes
+	int64_t     usecs;     ///< time spent writing
+	int64_t     max_usecs; ///< longest single write
+
+	/** @return samples written per second of writing, 0 if unknown */
+	double throughput () const { return usecs > 0 ? samples * 1e6 / usecs : 0; }
+};
+
 enum LoopFadeChoice {
 	NoLoopFade,
 	EndLoopFade,
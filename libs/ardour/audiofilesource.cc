@@ -331,6 +331,7 @@ AudioFileSource::safe_audio_file_extension(const string& file)
 		".ogg", ".OGG",
 		".paf", ".PAF",
 		".pvf", ".PVF",
+		".rf64", ".RF64",
 		".sf", ".SF",
 		".smp", ".SMP",
 		".snd", ".SND",
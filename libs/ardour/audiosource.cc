@@ -55,6 +55,7 @@
 #include <glibmm/miscutils.h>
 
 #include "pbd/file_utils.h"
+#include "pbd/memory_account.h"
 #include "pbd/playback_buffer.h"
 #include "pbd/scoped_file_descriptor.h"
 #include "pbd/xml++.h"
@@ -92,6 +93,7 @@ AudioSource::AudioSource (Session& s, const string& name)
 	, _last_scale (0.0)
 	, _last_map_off (0)
 	, _last_raw_map_length (0)
+	, _peak_cache_size (0)
 {
 }
 
@@ -108,6 +110,7 @@ AudioSource::AudioSource (Session& s, const XMLNode& node)
 	, _last_scale (0.0)
 	, _last_map_off (0)
 	, _last_raw_map_length (0)
+	, _peak_cache_size (0)
 {
 	if (set_state (node, Stateful::loading_state_version)) {
 		throw failed_constructor();
@@ -128,6 +131,33 @@ AudioSource::~AudioSource ()
 	}
 
 	delete [] peak_leftovers;
+
+	peak_cache_account ().remove (_peak_cache_size * sizeof (PeakData));
+}
+
+PBD::MemoryAccount&
+AudioSource::peak_cache_account ()
+{
+	static PBD::MemoryAccount& account (PBD::MemoryAccount::get (X_("peak-cache")));
+	return account;
+}
+
+/* caller must hold _lock */
+void
+AudioSource::reset_peak_cache (samplecnt_t npeaks) const
+{
+	peak_cache_account ().change (_peak_cache_size * sizeof (PeakData), npeaks * sizeof (PeakData));
+	peak_cache.reset (npeaks > 0 ? new PeakData[npeaks] : 0);
+	_peak_cache_size = npeaks;
+}
+
+void
+AudioSource::drop_peak_cache ()
+{
+	Glib::Threads::Mutex::Lock lm (_lock);
+	reset_peak_cache (0);
+	/* force the next read_peaks() to refill the cache */
+	_first_run = true;
 }
 
 XMLNode&
@@ -492,7 +522,7 @@ AudioSource::read_peaks_with_fpp (PeakData *peaks, samplecnt_t npeaks, samplepos
 		size_t map_length = bytes_to_read + map_delta;
 
 		if (_first_run  || (_last_scale != samples_per_visual_peak) || (_last_map_off != map_off) || (_last_raw_map_length  < bytes_to_read)) {
-			peak_cache.reset (new PeakData[npeaks]);
+			reset_peak_cache (npeaks);
 			char* addr;
 #ifdef PLATFORM_WINDOWS
 			HANDLE file_handle = (HANDLE) _get_osfhandle(int(sfd));
@@ -585,7 +615,7 @@ AudioSource::read_peaks_with_fpp (PeakData *peaks, samplecnt_t npeaks, samplepos
 		size_t map_length = (chunksize * sizeof(PeakData)) + map_delta;
 
 		if (_first_run || (_last_scale != samples_per_visual_peak) || (_last_map_off != map_off) || (_last_raw_map_length < raw_map_length)) {
-			peak_cache.reset (new PeakData[npeaks]);
+			reset_peak_cache (npeaks);
 			boost::scoped_array<PeakData> staging (new PeakData[chunksize]);
 
 			char* addr;
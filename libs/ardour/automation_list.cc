@@ -25,15 +25,19 @@
 #include <climits>
 #include <float.h>
 #include <cmath>
+#include <cstring>
 #include <sstream>
 #include <algorithm>
 
+#include <glib.h>
+
 #include "temporal/types_convert.h"
 
 #include "ardour/automation_list.h"
 #include "ardour/event_type_map.h"
 #include "ardour/parameter_descriptor.h"
 #include "ardour/parameter_types.h"
+#include "ardour/rc_configuration.h"
 #include "ardour/evoral_types_convert.h"
 #include "ardour/types_convert.h"
 
@@ -363,27 +367,118 @@ AutomationList::state (bool save_auto_state, bool need_lock)
 	return *root;
 }
 
+/* Binary event encoding.
+ *
+ * Text uses some 30-40 bytes per event and needs a string conversion for
+ * every time and value when loading. Binary data (base64 encoded in the
+ * events node) starts with a version byte, a time domain byte (0: audio
+ * time, 1: beat time) and is followed by one record per event: the
+ * difference to the previous event's time as a zigzag-encoded LEB128 varint,
+ * then the value as little-endian IEEE double. That is usually 10-12 bytes
+ * per event (about 16 as base64), and values are stored exactly.
+ */
+
+static const uint8_t binary_events_version = 1;
+
+static void
+put_varint (std::vector<uint8_t>& buf, int64_t v)
+{
+	uint64_t u = ((uint64_t) v << 1) ^ (uint64_t) (v >> 63);
+	while (u >= 0x80) {
+		buf.push_back ((u & 0x7f) | 0x80);
+		u >>= 7;
+	}
+	buf.push_back (u);
+}
+
+static bool
+get_varint (uint8_t const *& p, uint8_t const * end, int64_t& v)
+{
+	uint64_t u = 0;
+	for (int shift = 0; p < end && shift < 64; shift += 7) {
+		uint8_t const b = *p++;
+		u |= (uint64_t) (b & 0x7f) << shift;
+		if (!(b & 0x80)) {
+			v = (int64_t) (u >> 1) ^ -(int64_t) (u & 1);
+			return true;
+		}
+	}
+	return false;
+}
+
+/** @return false if the events cannot be encoded, because they are not all
+ * in the same time domain.
+ */
+static bool
+encode_events (Evoral::ControlList::EventList const & events, std::string& out)
+{
+	std::vector<uint8_t> buf;
+	buf.reserve (2 + events.size() * 12);
+
+	bool const beats = events.front()->when.is_beats ();
+
+	buf.push_back (binary_events_version);
+	buf.push_back (beats ? 1 : 0);
+
+	int64_t prev = 0;
+
+	for (Evoral::ControlList::EventList::const_iterator i = events.begin(); i != events.end(); ++i) {
+
+		if ((*i)->when.is_beats () != beats) {
+			return false;
+		}
+
+		int64_t const t = beats ? (*i)->when.ticks () : (*i)->when.superclocks ();
+		put_varint (buf, t - prev);
+		prev = t;
+
+		uint64_t bits;
+		double const value = (*i)->value;
+		memcpy (&bits, &value, sizeof (bits));
+
+		for (int n = 0; n < 8; ++n) {
+			buf.push_back ((bits >> (8 * n)) & 0xff);
+		}
+	}
+
+	gchar* b64 = g_base64_encode (&buf[0], buf.size());
+	out = b64;
+	g_free (b64);
+
+	return true;
+}
+
 XMLNode&
 AutomationList::serialize_events (bool need_lock)
 {
 	XMLNode* node = new XMLNode (X_("events"));
-	stringstream str;
+	std::string content;
 
 	Glib::Threads::RWLock::ReaderLock lm (Evoral::ControlList::_lock, Glib::Threads::NOT_LOCK);
 	if (need_lock) {
 		lm.acquire ();
 	}
-	for (iterator xx = _events.begin(); xx != _events.end(); ++xx) {
-		str << PBD::to_string ((*xx)->when);
-		str << ' ';
-		str << PBD::to_string ((*xx)->value);
-		str << '\n';
+
+	/* binary events cannot be read by older versions, so they are
+	 * only written when enabled explicitly.
+	 */
+	if (Config->get_binary_automation_data () && !_events.empty () && encode_events (_events, content)) {
+		node->set_property (X_("encoding"), X_("binary"));
+	} else {
+		stringstream str;
+		for (iterator xx = _events.begin(); xx != _events.end(); ++xx) {
+			str << PBD::to_string ((*xx)->when);
+			str << ' ';
+			str << PBD::to_string ((*xx)->value);
+			str << '\n';
+		}
+		content = str.str ();
 	}
 
 	/* XML is a bit wierd */
 
 	XMLNode* content_node = new XMLNode (X_("foo")); /* it gets renamed by libxml when we set content */
-	content_node->set_content (str.str());
+	content_node->set_content (content);
 
 	node->add_child_nocopy (*content_node);
 
@@ -406,7 +501,77 @@ AutomationList::deserialize_events (const XMLNode& node)
         ControlList::freeze ();
 	clear ();
 
-	stringstream str (content_node->content());
+	std::string encoding;
+	bool ok = true;
+
+	if (node.get_property (X_("encoding"), encoding) && encoding == X_("binary")) {
+		ok = deserialize_binary_events (content_node->content ());
+	} else {
+		ok = deserialize_text_events (content_node->content ());
+	}
+
+	if (!ok) {
+		clear ();
+		error << _("automation list: cannot load coordinates from XML, all points ignored") << endmsg;
+	} else {
+		mark_dirty ();
+		maybe_signal_changed ();
+	}
+
+        thaw ();
+
+	return 0;
+}
+
+bool
+AutomationList::deserialize_binary_events (std::string const & content)
+{
+	gsize size = 0;
+	guchar* data = g_base64_decode (content.c_str (), &size);
+
+	uint8_t const * p   = data;
+	uint8_t const * end = data + size;
+
+	bool ok = size >= 2 && p[0] == binary_events_version && p[1] <= 1;
+
+	if (ok) {
+		bool const beats = p[1];
+		int64_t t = 0;
+
+		p += 2;
+
+		while (p < end) {
+			int64_t delta;
+
+			if (!get_varint (p, end, delta) || end - p < 8) {
+				ok = false;
+				break;
+			}
+
+			uint64_t bits = 0;
+			for (int n = 0; n < 8; ++n) {
+				bits |= (uint64_t) p[n] << (8 * n);
+			}
+			p += 8;
+
+			double y;
+			memcpy (&y, &bits, sizeof (y));
+
+			t += delta;
+			y = std::min ((double)_desc.upper, std::max ((double)_desc.lower, y));
+			fast_simple_add (beats ? timepos_t::from_ticks (t) : timepos_t::from_superclock (t), y);
+		}
+	}
+
+	g_free (data);
+
+	return ok;
+}
+
+bool
+AutomationList::deserialize_text_events (std::string const & content)
+{
+	stringstream str (content);
 
 	std::string x_str;
 	std::string y_str;
@@ -428,17 +593,7 @@ AutomationList::deserialize_events (const XMLNode& node)
 		fast_simple_add (x, y);
 	}
 
-	if (!ok) {
-		clear ();
-		error << _("automation list: cannot load coordinates from XML, all points ignored") << endmsg;
-	} else {
-		mark_dirty ();
-		maybe_signal_changed ();
-	}
-
-        thaw ();
-
-	return 0;
+	return ok;
 }
 
 int
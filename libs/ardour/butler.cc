@@ -20,6 +20,9 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include <algorithm>
+#include <vector>
+
 #include <errno.h>
 #include <fcntl.h>
 #include <unistd.h>
@@ -38,6 +41,7 @@
 #include "ardour/debug.h"
 #include "ardour/disk_io.h"
 #include "ardour/disk_reader.h"
+#include "ardour/disk_writer.h"
 #include "ardour/io.h"
 #include "ardour/session.h"
 #include "ardour/track.h"
@@ -250,6 +254,13 @@ Butler::thread_work ()
 		RouteList rl_with_auditioner = *rl;
 		rl_with_auditioner.push_back (_session.the_auditioner());
 
+		if (should_run && _session.actively_recording ()) {
+			/* tracks which are close to a capture buffer overrun
+			 * cannot wait for playback buffers to be refilled.
+			 */
+			disk_work_outstanding = flush_tracks_to_disk_normal (rl, err, true);
+		}
+
 		DEBUG_TRACE (DEBUG::Butler, string_compose ("butler starts refill loop, twr = %1\n", transport_work_requested()));
 
 		for (i = rl_with_auditioner.begin(); !transport_work_requested() && should_run && i != rl_with_auditioner.end(); ++i) {
@@ -335,14 +346,42 @@ Butler::thread_work ()
 	return (0);
 }
 
+namespace {
+
+struct PendingFlush {
+	PendingFlush (boost::shared_ptr<Track> t)
+		: track (t)
+		, headroom (t->capture_headroom_samples ())
+		, pending (t->capture_pending_write ())
+	{}
+
+	/* the track with the least headroom has the earliest deadline */
+	bool operator< (PendingFlush const& other) const { return headroom < other.headroom; }
+
+	/* the capture buffer is more than half full */
+	bool urgent () const { return pending > headroom; }
+
+	boost::shared_ptr<Track> track;
+	samplecnt_t              headroom;
+	samplecnt_t              pending;
+};
+
+}
+
+/** Flush capture buffers, those of the tracks which are closest to an
+ * overrun first. Tracks whose buffers are more than half full write all
+ * they have at once, in as few writes as possible, rather than one chunk
+ * per butler cycle. If \p urgent_only is true, only those tracks are flushed.
+ */
 bool
-Butler::flush_tracks_to_disk_normal (boost::shared_ptr<RouteList> rl, uint32_t& errors)
+Butler::flush_tracks_to_disk_normal (boost::shared_ptr<RouteList> rl, uint32_t& errors, bool urgent_only)
 {
 	bool disk_work_outstanding = false;
 
-	for (RouteList::iterator i = rl->begin(); !transport_work_requested() && should_run && i != rl->end(); ++i) {
+	std::vector<PendingFlush> flushes;
+	flushes.reserve (rl->size ());
 
-		// cerr << "write behind for " << (*i)->name () << endl;
+	for (RouteList::iterator i = rl->begin(); i != rl->end(); ++i) {
 
 		boost::shared_ptr<Track> tr = boost::dynamic_pointer_cast<Track> (*i);
 
@@ -353,10 +392,34 @@ Butler::flush_tracks_to_disk_normal (boost::shared_ptr<RouteList> rl, uint32_t&
 		/* note that we still try to flush diskstreams attached to inactive routes
 		 */
 
+		PendingFlush pf (tr);
+
+		if (urgent_only && !pf.urgent ()) {
+			continue;
+		}
+
+		flushes.push_back (pf);
+	}
+
+	/* keep track order for tracks with the same headroom */
+	std::stable_sort (flushes.begin (), flushes.end ());
+
+	samplecnt_t const chunk = DiskWriter::chunk_samples ();
+
+	for (std::vector<PendingFlush>::iterator i = flushes.begin(); !transport_work_requested() && should_run && i != flushes.end(); ++i) {
+
+		boost::shared_ptr<Track> tr = i->track;
+		uint32_t chunks = 1;
+
+		if (i->urgent () && chunk > 0) {
+			chunks = (uint32_t) std::max<samplecnt_t> (1, i->pending / chunk);
+			DEBUG_TRACE (DEBUG::Butler, string_compose ("butler flushes %1 chunks of %2, %3 samples to overflow\n", chunks, tr->name(), i->headroom));
+		}
+
 		int ret;
 
 		// DEBUG_TRACE (DEBUG::Butler, string_compose ("butler flushes track %1 capture load %2\n", tr->name(), tr->capture_buffer_load()));
-		ret = tr->do_flush (ButlerContext, false);
+		ret = tr->do_flush (ButlerContext, false, chunks);
 		switch (ret) {
 		case 0:
 			//DEBUG_TRACE (DEBUG::Butler, string_compose ("\tflush complete for %1\n", tr->name()));
@@ -369,8 +432,8 @@ Butler::flush_tracks_to_disk_normal (boost::shared_ptr<RouteList> rl, uint32_t&
 
 		default:
 			errors++;
-			error << string_compose(_("Butler write-behind failure on dstream %1"), (*i)->name()) << endmsg;
-			std::cerr << string_compose(_("Butler write-behind failure on dstream %1"), (*i)->name()) << std::endl;
+			error << string_compose(_("Butler write-behind failure on dstream %1"), tr->name()) << endmsg;
+			std::cerr << string_compose(_("Butler write-behind failure on dstream %1"), tr->name()) << std::endl;
 			/* don't break - try to flush all streams in case they
 			   are split across disks.
 			*/
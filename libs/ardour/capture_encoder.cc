@@ -0,0 +1,263 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <algorithm>
+
+#include <glib/gstdio.h>
+#include <glibmm/fileutils.h>
+#include <glibmm/miscutils.h>
+
+#include "pbd/basename.h"
+#include "pbd/compose.h"
+#include "pbd/convert.h"
+#include "pbd/error.h"
+#include "pbd/failed_constructor.h"
+#include "pbd/pthread_utils.h"
+
+#include "ardour/audiofilesource.h"
+#include "ardour/capture_encoder.h"
+#include "ardour/debug.h"
+#include "ardour/session.h"
+#include "ardour/session_event.h"
+#include "ardour/sndfilesource.h"
+#include "ardour/utils.h"
+
+#include "pbd/i18n.h"
+
+using namespace std;
+using namespace ARDOUR;
+using namespace PBD;
+
+Glib::Threads::Mutex          CaptureEncoder::encoding_active_lock;
+Glib::Threads::Mutex          CaptureEncoder::encoding_queue_lock;
+Glib::Threads::Cond           CaptureEncoder::SourcesToEncode;
+list<CaptureEncoder::Job>     CaptureEncoder::encoding_queue;
+GATOMIC_QUAL gint             CaptureEncoder::_cancel = 0;
+
+PBD::Signal2<void, boost::weak_ptr<AudioFileSource>, std::string> CaptureEncoder::Encoded;
+
+static void
+capture_encoder_work ()
+{
+	pthread_set_name ("CaptureEncoder");
+	CaptureEncoder::work ();
+}
+
+void
+CaptureEncoder::init ()
+{
+	Glib::Threads::Thread::create (sigc::ptr_fun (capture_encoder_work));
+}
+
+bool
+CaptureEncoder::needs_encoding (HeaderFormat hf, SampleFormat sf)
+{
+	return hf == FLAC || sf != FormatFloat;
+}
+
+string
+CaptureEncoder::journal_path (string const& path)
+{
+	/* the journal has the same name as the capture file, so that new
+	 * captures do not use it. The extension only needs to differ from
+	 * the one of the capture file.
+	 */
+	string const ext = PBD::downcase (path.substr (path.find_last_of ('.') + 1));
+
+	return Glib::build_filename (Glib::path_get_dirname (path), PBD::basename_nosuffix (path) + (ext == "rf64" ? ".w64" : ".rf64"));
+}
+
+HeaderFormat
+CaptureEncoder::journal_header_format (string const& journal_path)
+{
+	/* RF64 files are written as WAV while they are smaller than 4 GB */
+	return PBD::downcase (journal_path.substr (journal_path.find_last_of ('.') + 1)) == "w64" ? WAVE64 : RF64_WAV;
+}
+
+void
+CaptureEncoder::queue_source_for_encoding (boost::shared_ptr<AudioFileSource> src, struct tm const& when, time_t twhen)
+{
+	if (!src || src->empty ()) {
+		return;
+	}
+
+	if (Encoded.empty ()) {
+		/* nobody would switch the source over (e.g. a headless
+		 * session tool), keep using the journal.
+		 */
+		return;
+	}
+
+	Session& s (src->session ());
+
+	Job job;
+	job.source        = src;
+	job.header_format = s.config.get_native_file_header_format ();
+	job.sample_format = s.config.get_native_file_data_format ();
+	job.path          = Glib::build_filename (Glib::path_get_dirname (src->path ()),
+	                                          PBD::basename_nosuffix (src->path ()) + native_header_format_extension (job.header_format, DataType::AUDIO));
+	job.when          = when;
+	job.twhen         = twhen;
+
+	if (job.path == src->path () || !needs_encoding (job.header_format, job.sample_format)) {
+		/* already in the native format */
+		return;
+	}
+
+	Glib::Threads::Mutex::Lock lm (encoding_queue_lock);
+	encoding_queue.push_back (job);
+	SourcesToEncode.broadcast ();
+}
+
+void
+CaptureEncoder::work ()
+{
+	SessionEvent::create_per_thread_pool ("CaptureEncoder", 64);
+
+	while (true) {
+		encoding_queue_lock.lock ();
+
+	  wait:
+		if (encoding_queue.empty()) {
+			SourcesToEncode.wait (encoding_queue_lock);
+		}
+
+		if (encoding_queue.empty()) {
+			goto wait;
+		}
+
+		Job job (encoding_queue.front());
+		encoding_queue.pop_front();
+		g_atomic_int_set (&_cancel, 0);
+		encoding_queue_lock.unlock ();
+
+		Glib::Threads::Mutex::Lock lm (encoding_active_lock);
+		encode (job);
+	}
+}
+
+void
+CaptureEncoder::encode (Job const& job)
+{
+	if (g_atomic_int_get (&_cancel)) {
+		return;
+	}
+
+	boost::shared_ptr<AudioFileSource> src (job.source.lock ());
+
+	if (!src || src->empty ()) {
+		return;
+	}
+
+	if (Glib::file_test (job.path, Glib::FILE_TEST_EXISTS)) {
+		error << string_compose (_("Cannot encode capture %1: %2 already exists"), src->path (), job.path) << endmsg;
+		return;
+	}
+
+	DEBUG_TRACE (DEBUG::Butler, string_compose ("encode capture %1 to %2\n", src->path (), job.path));
+
+	bool ok = true;
+
+	try {
+		/* not Removable, the file is removed below if encoding fails */
+		SndFileSource encoded (src->session (), job.path, src->origin (), job.sample_format, job.header_format,
+		                       src->sample_rate (), Source::Flag (Source::Writable | Source::NoPeakFile));
+
+		Sample buf[8192];
+		samplecnt_t const len = src->length ().samples ();
+
+		for (samplecnt_t off = 0; off < len && ok; ) {
+			if (g_atomic_int_get (&_cancel)) {
+				ok = false;
+				break;
+			}
+
+			samplecnt_t const n = src->read (buf, off, min<samplecnt_t> (8192, len - off), src->channel ());
+
+			if (n <= 0 || encoded.write (buf, n) != n) {
+				error << string_compose (_("Cannot encode capture %1 to %2"), src->path (), job.path) << endmsg;
+				ok = false;
+				break;
+			}
+			off += n;
+		}
+
+		if (ok) {
+			struct tm when (job.when);
+			if (encoded.update_header (src->natural_position ().samples (), when, job.twhen)) {
+				ok = false;
+			} else {
+				encoded.flush ();
+			}
+		}
+
+	} catch (failed_constructor& err) {
+		error << string_compose (_("Cannot create %1 to encode capture %2"), job.path, src->path ()) << endmsg;
+		ok = false;
+	}
+
+	if (!ok) {
+		::g_unlink (job.path.c_str ());
+		return;
+	}
+
+	if (Encoded.empty ()) {
+		/* the handler went away while encoding */
+		::g_unlink (job.path.c_str ());
+		return;
+	}
+
+	/* the source's path and name are also used by the GUI and when the
+	 * session is saved, it is switched over in the GUI thread.
+	 */
+	Encoded (src, job.path); /* EMIT SIGNAL */
+}
+
+void
+CaptureEncoder::use_encoded_file (boost::weak_ptr<AudioFileSource> wsrc, string const& path)
+{
+	boost::shared_ptr<AudioFileSource> src (wsrc.lock ());
+
+	if (!src) {
+		/* the take was removed while it was encoded */
+		::g_unlink (path.c_str ());
+		return;
+	}
+
+	DEBUG_TRACE (DEBUG::Butler, string_compose ("switch capture %1 to %2\n", src->path (), path));
+
+	/* Reads hold the source lock, so no read ever sees a half-switched
+	 * source. The journal is left in place, the snapshots which were
+	 * saved before may still use it. Session > Clean-up Unused Sources
+	 * removes it once no snapshot refers to it.
+	 */
+	{
+		Source::Lock lm (src->mutex ());
+		src->rename_peakfile (src->construct_peak_filepath (path, src->within_session ()));
+		src->replace_file (path);
+	}
+
+	src->session ().set_dirty ();
+}
+
+void
+CaptureEncoder::flush ()
+{
+	Glib::Threads::Mutex::Lock lq (encoding_queue_lock);
+	g_atomic_int_set (&_cancel, 1);
+	Glib::Threads::Mutex::Lock la (encoding_active_lock);
+	encoding_queue.clear();
+}
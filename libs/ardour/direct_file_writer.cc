@@ -0,0 +1,585 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#ifndef PLATFORM_WINDOWS
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <linux/falloc.h>
+#endif
+
+#include <glibmm/threads.h>
+
+#include "pbd/compose.h"
+#include "pbd/error.h"
+#include "pbd/failed_constructor.h"
+#include "pbd/malign.h"
+#include "pbd/memory_account.h"
+
+#include "ardour/broadcast_info.h"
+#include "ardour/direct_file_writer.h"
+
+#include "pbd/i18n.h"
+
+using namespace ARDOUR;
+using namespace PBD;
+using std::string;
+
+#ifdef PLATFORM_WINDOWS
+
+/* not implemented, supported() is false and the constructor fails */
+
+DirectFileWriter::DirectFileWriter (string const& path, SF_INFO const&, bool rf64, BroadcastInfo*)
+	: _path (path)
+	, _fd (-1)
+	, _read_fd (-1)
+	, _rf64 (rf64)
+	, _preallocate (false)
+	, _failed (true)
+	, _fact_offset (0)
+	, _buf (0)
+	, _buf_pos (0)
+	, _buf_fill (0)
+	, _allocated (0)
+	, _length (0)
+{
+	throw failed_constructor ();
+}
+
+DirectFileWriter::~DirectFileWriter ()
+{
+}
+
+bool
+DirectFileWriter::supported (SF_INFO const&)
+{
+	return false;
+}
+
+samplecnt_t
+DirectFileWriter::write (Sample const*, samplecnt_t)
+{
+	return 0;
+}
+
+samplecnt_t
+DirectFileWriter::read (Sample*, samplepos_t, samplecnt_t) const
+{
+	return 0;
+}
+
+int
+DirectFileWriter::finish ()
+{
+	return 0;
+}
+
+#else
+
+/* alignment of file offsets, sizes and memory for O_DIRECT */
+static const size_t  block_size  = 4096;
+/* the header is padded to one block, data starts here */
+static const size_t  data_offset = block_size;
+/* data is written in blocks of this size */
+static const size_t  buffer_size = 1024 * 1024;
+/* file space is preallocated in extents of this size */
+static const int64_t extent_size = 32 * 1024 * 1024;
+
+static inline int64_t
+round_up (int64_t n)
+{
+	return (n + block_size - 1) & ~((int64_t) block_size - 1);
+}
+
+/* Buffers are kept for the next take, capture sources are
+ * replaced every time the transport stops.
+ */
+static Glib::Threads::Mutex buffer_pool_lock;
+static std::vector<char*>   buffer_pool;
+/* more are freed, there are rarely more than this many capture sources */
+static const size_t         buffer_pool_max = 64;
+
+static PBD::MemoryAccount&
+buffer_account ()
+{
+	static PBD::MemoryAccount& account (PBD::MemoryAccount::get (X_("disk-buffers")));
+	return account;
+}
+
+static char*
+get_buffer ()
+{
+	{
+		Glib::Threads::Mutex::Lock lm (buffer_pool_lock);
+		if (!buffer_pool.empty ()) {
+			char* buf = buffer_pool.back ();
+			buffer_pool.pop_back ();
+			return buf;
+		}
+	}
+
+	void* buf = 0;
+	if (aligned_malloc (&buf, buffer_size, block_size) || !buf) {
+		return 0;
+	}
+	buffer_account ().add (buffer_size);
+	return static_cast<char*> (buf);
+}
+
+static void
+release_buffer (char* buf)
+{
+	{
+		Glib::Threads::Mutex::Lock lm (buffer_pool_lock);
+		if (buffer_pool.size () < buffer_pool_max) {
+			buffer_pool.push_back (buf);
+			return;
+		}
+	}
+
+	aligned_free (buf);
+	buffer_account ().remove (buffer_size);
+}
+
+static inline void
+put_u32 (char* dst, uint32_t v)
+{
+	for (int i = 0; i < 4; ++i, v >>= 8) {
+		dst[i] = v & 0xff;
+	}
+}
+
+static inline void
+put_u64 (char* dst, uint64_t v)
+{
+	for (int i = 0; i < 8; ++i, v >>= 8) {
+		dst[i] = v & 0xff;
+	}
+}
+
+static inline uint32_t
+get_u32 (char const* src)
+{
+	uint8_t const* s = reinterpret_cast<uint8_t const*> (src);
+	return s[0] | (s[1] << 8) | (s[2] << 16) | ((uint32_t) s[3] << 24);
+}
+
+/* libsndfile writes the header into memory, see make_header () */
+struct HeaderFile {
+	HeaderFile () : pos (0) {}
+
+	std::vector<char> data;
+	sf_count_t        pos;
+
+	static sf_count_t get_filelen (void* user_data)
+	{
+		return static_cast<HeaderFile*> (user_data)->data.size ();
+	}
+
+	static sf_count_t seek (sf_count_t offset, int whence, void* user_data)
+	{
+		HeaderFile* self = static_cast<HeaderFile*> (user_data);
+		switch (whence) {
+		case SEEK_CUR:
+			offset += self->pos;
+			break;
+		case SEEK_END:
+			offset += self->data.size ();
+			break;
+		default:
+			break;
+		}
+		if (offset < 0) {
+			return -1;
+		}
+		return self->pos = offset;
+	}
+
+	static sf_count_t read (void* ptr, sf_count_t count, void* user_data)
+	{
+		HeaderFile* self = static_cast<HeaderFile*> (user_data);
+		count = std::max<sf_count_t> (0, std::min<sf_count_t> (count, self->data.size () - self->pos));
+		memcpy (ptr, &self->data[0] + self->pos, count);
+		self->pos += count;
+		return count;
+	}
+
+	static sf_count_t write (void const* ptr, sf_count_t count, void* user_data)
+	{
+		HeaderFile* self = static_cast<HeaderFile*> (user_data);
+		if (self->pos + count > (sf_count_t) self->data.size ()) {
+			self->data.resize (self->pos + count);
+		}
+		memcpy (&self->data[0] + self->pos, ptr, count);
+		self->pos += count;
+		return count;
+	}
+
+	static sf_count_t tell (void* user_data)
+	{
+		return static_cast<HeaderFile*> (user_data)->pos;
+	}
+};
+
+DirectFileWriter::DirectFileWriter (string const& path, SF_INFO const& info, bool rf64, BroadcastInfo* bwf)
+	: _path (path)
+	, _fd (-1)
+	, _read_fd (-1)
+	, _rf64 (rf64)
+	, _preallocate (true)
+	, _failed (false)
+	, _fact_offset (0)
+	, _buf (0)
+	, _buf_pos (0)
+	, _buf_fill (0)
+	, _allocated (0)
+	, _length (0)
+{
+	if (!supported (info)) {
+		throw failed_constructor ();
+	}
+
+	make_header (info, bwf);
+
+#ifdef __linux__
+	_fd = ::open (_path.c_str (), O_CREAT | O_EXCL | O_WRONLY | O_DIRECT, 0644);
+	if (_fd < 0 && errno == EINVAL) {
+		/* the file system does not support O_DIRECT, the file may have been created */
+		_fd = ::open (_path.c_str (), O_CREAT | O_TRUNC | O_WRONLY, 0644);
+	}
+#else
+	_fd = ::open (_path.c_str (), O_CREAT | O_EXCL | O_WRONLY, 0644);
+# ifdef __APPLE__
+	if (_fd >= 0) {
+		fcntl (_fd, F_NOCACHE, 1);
+	}
+# endif
+#endif
+
+	if (_fd < 0) {
+		error << string_compose (_("DirectFileWriter: cannot create file \"%1\" (%2)"), _path, strerror (errno)) << endmsg;
+		throw failed_constructor ();
+	}
+
+	if ((_read_fd = ::open (_path.c_str (), O_RDONLY)) < 0 || (_buf = get_buffer ()) == 0) {
+		error << string_compose (_("DirectFileWriter: cannot open file \"%1\" (%2)"), _path, strerror (errno)) << endmsg;
+		if (_read_fd >= 0) {
+			::close (_read_fd);
+		}
+		::close (_fd);
+		::unlink (_path.c_str ());
+		throw failed_constructor ();
+	}
+
+	memcpy (_buf, &_header[0], data_offset);
+	_buf_fill = data_offset;
+}
+
+DirectFileWriter::~DirectFileWriter ()
+{
+	finish ();
+}
+
+bool
+DirectFileWriter::supported (SF_INFO const& info)
+{
+#if defined __BYTE_ORDER__ && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	/* samples are written as they are, WAV is little endian */
+	return false;
+#else
+	int const type = info.format & SF_FORMAT_TYPEMASK;
+	return info.channels == 1
+		&& (info.format & SF_FORMAT_SUBMASK) == SF_FORMAT_FLOAT
+		&& (info.format & SF_FORMAT_ENDMASK) != SF_ENDIAN_BIG
+		&& (type == SF_FORMAT_WAV || type == SF_FORMAT_RF64);
+#endif
+}
+
+void
+DirectFileWriter::make_header (SF_INFO const& info, BroadcastInfo* bwf)
+{
+	/* let libsndfile write the chunks (fmt, fact, bext) of an empty file */
+	HeaderFile hf;
+	SF_VIRTUAL_IO vio;
+	vio.get_filelen = &HeaderFile::get_filelen;
+	vio.seek        = &HeaderFile::seek;
+	vio.read        = &HeaderFile::read;
+	vio.write       = &HeaderFile::write;
+	vio.tell        = &HeaderFile::tell;
+
+	SF_INFO hinfo (info);
+	hinfo.format = SF_FORMAT_WAV | SF_FORMAT_FLOAT;
+
+	SNDFILE* sf = sf_open_virtual (&vio, SFM_WRITE, &hinfo, &hf);
+	if (!sf) {
+		throw failed_constructor ();
+	}
+
+	/* the peaks are not known here */
+	sf_command (sf, SFC_SET_ADD_PEAK_CHUNK, 0, SF_FALSE);
+	if (bwf) {
+		bwf->write_to_file (sf);
+	}
+	sf_command (sf, SFC_UPDATE_HEADER_NOW, 0, 0);
+
+	std::vector<char> const src (hf.data);
+	sf_close (sf);
+
+	/* RIFF, size, WAVE, ds64 placeholder */
+	_header.assign (data_offset, 0);
+	memcpy (&_header[0], "RIFF\0\0\0\0WAVEJUNK", 16);
+	put_u32 (&_header[16], 28);
+	size_t pos = 48;
+
+	/* copy libsndfile's chunks, up to the data chunk */
+	size_t off = 12;
+	while (off + 8 <= src.size ()) {
+		char const*    id   = &src[off];
+		uint32_t const size = get_u32 (&src[off + 4]);
+		size_t const   len  = 8 + size + (size & 1);
+
+		if (!memcmp (id, "data", 4)) {
+			break;
+		}
+		if (off + len > src.size ()) {
+			throw failed_constructor ();
+		}
+		if (memcmp (id, "JUNK", 4) && memcmp (id, "PAD ", 4) && memcmp (id, "ds64", 4)) {
+			if (pos + len + 16 > data_offset) {
+				/* header too large */
+				throw failed_constructor ();
+			}
+			if (!memcmp (id, "fact", 4)) {
+				_fact_offset = pos + 8;
+			}
+			memcpy (&_header[pos], id, len);
+			pos += len;
+		}
+		off += len;
+	}
+
+	/* pad up to the data chunk */
+	memcpy (&_header[pos], "JUNK", 4);
+	put_u32 (&_header[pos + 4], data_offset - pos - 16);
+	memcpy (&_header[data_offset - 8], "data", 4);
+}
+
+void
+DirectFileWriter::update_header ()
+{
+	uint64_t const data_bytes = _length * sizeof (Sample);
+	uint64_t const riff_size  = data_offset + data_bytes - 8;
+
+	if (_rf64 || riff_size > UINT32_MAX) {
+		memcpy (&_header[0], "RF64", 4);
+		put_u32 (&_header[4], UINT32_MAX);
+		memcpy (&_header[12], "ds64", 4);
+		put_u64 (&_header[20], riff_size);
+		put_u64 (&_header[28], data_bytes);
+		put_u64 (&_header[36], _length);
+		put_u32 (&_header[44], 0);
+		put_u32 (&_header[data_offset - 4], UINT32_MAX);
+	} else {
+		memcpy (&_header[0], "RIFF", 4);
+		put_u32 (&_header[4], riff_size);
+		memcpy (&_header[12], "JUNK", 4);
+		memset (&_header[20], 0, 28);
+		put_u32 (&_header[data_offset - 4], data_bytes);
+	}
+
+	if (_fact_offset) {
+		/* RF64 has the sample count in ds64 */
+		memcpy (&_header[_fact_offset - 8], (_header[0] == 'R' && _header[1] == 'F') ? "JUNK" : "fact", 4);
+		put_u32 (&_header[_fact_offset], std::min<uint64_t> (_length, UINT32_MAX));
+	}
+}
+
+void
+DirectFileWriter::preallocate (int64_t end)
+{
+#ifdef __linux__
+	if (!_preallocate || end <= _allocated) {
+		return;
+	}
+	int64_t const len = std::max (extent_size, end - _allocated);
+	/* keep the size, so that the file is valid after a crash */
+	if (fallocate (_fd, FALLOC_FL_KEEP_SIZE, _allocated, len) == 0) {
+		_allocated += len;
+	} else {
+		/* not supported by the file system, or full */
+		_preallocate = false;
+	}
+#endif
+}
+
+int
+DirectFileWriter::write_block (int64_t pos, size_t size)
+{
+	preallocate (pos + size);
+
+	char const* p = _buf;
+	while (size > 0) {
+		ssize_t const n = ::pwrite (_fd, p, size, pos);
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			error << string_compose (_("DirectFileWriter: cannot write to file \"%1\" (%2)"), _path, strerror (errno)) << endmsg;
+			return -1;
+		}
+		p    += n;
+		pos  += n;
+		size -= n;
+	}
+	return 0;
+}
+
+samplecnt_t
+DirectFileWriter::write (Sample const* data, samplecnt_t cnt)
+{
+	if (_fd < 0 || _failed) {
+		return 0;
+	}
+
+	char const* src   = reinterpret_cast<char const*> (data);
+	size_t      bytes = cnt * sizeof (Sample);
+
+	while (bytes > 0) {
+		size_t const n = std::min (bytes, buffer_size - _buf_fill);
+		memcpy (_buf + _buf_fill, src, n);
+		_buf_fill += n;
+		src       += n;
+		bytes     -= n;
+
+		if (_buf_fill == buffer_size) {
+			if (write_block (_buf_pos, buffer_size)) {
+				/* the buffer now holds part of this write, which
+				 * cannot be taken back.
+				 */
+				_failed = true;
+				return 0;
+			}
+			_buf_pos += buffer_size;
+			_buf_fill = 0;
+		}
+	}
+
+	_length += cnt;
+	return cnt;
+}
+
+samplecnt_t
+DirectFileWriter::read (Sample* dst, samplepos_t start, samplecnt_t cnt) const
+{
+	if (_fd < 0 || start >= _length) {
+		return 0;
+	}
+
+	cnt = std::min (cnt, _length - start);
+
+	char*   d     = reinterpret_cast<char*> (dst);
+	int64_t pos   = data_offset + start * sizeof (Sample);
+	size_t  bytes = cnt * sizeof (Sample);
+
+	/* written data, through the page cache */
+	while (pos < _buf_pos && bytes > 0) {
+		ssize_t const n = ::pread (_read_fd, d, std::min<int64_t> (bytes, _buf_pos - pos), pos);
+		if (n <= 0) {
+			if (n < 0 && errno == EINTR) {
+				continue;
+			}
+			return (pos - (int64_t) data_offset) / (int64_t) sizeof (Sample) - start;
+		}
+		d     += n;
+		pos   += n;
+		bytes -= n;
+	}
+
+	/* buffered data */
+	memcpy (d, _buf + (pos - _buf_pos), bytes);
+
+	return cnt;
+}
+
+int
+DirectFileWriter::finish ()
+{
+	if (_fd < 0) {
+		return 0;
+	}
+
+	int ret = 0;
+
+	if (_failed) {
+		/* only keep what was written before the error */
+		_length   = std::max<int64_t> (0, _buf_pos - (int64_t) data_offset) / sizeof (Sample);
+		_buf_fill = _buf_pos == 0 ? data_offset : 0;
+		ret = -1;
+	}
+
+	int64_t const end = data_offset + _length * sizeof (Sample);
+
+	update_header ();
+
+	if (_buf_pos == 0) {
+		memcpy (_buf, &_header[0], data_offset);
+	}
+
+	if (_buf_fill > 0) {
+		/* the last block is padded, and truncated below */
+		size_t const size = round_up (_buf_fill);
+		memset (_buf + _buf_fill, 0, size - _buf_fill);
+		ret |= write_block (_buf_pos, size);
+	}
+
+	if (_buf_pos > 0) {
+		memcpy (_buf, &_header[0], data_offset);
+		ret |= write_block (0, data_offset);
+	}
+
+#ifdef __linux__
+	/* release preallocated space */
+	if (_allocated > round_up (end)) {
+		fallocate (_fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, round_up (end), _allocated - round_up (end));
+	}
+#endif
+
+	if (ftruncate (_fd, end)) {
+		ret = -1;
+	}
+
+	::close (_fd);
+	::close (_read_fd);
+	_fd = _read_fd = -1;
+
+	release_buffer (_buf);
+	_buf = 0;
+
+	if (ret) {
+		error << string_compose (_("DirectFileWriter: cannot finish file \"%1\""), _path) << endmsg;
+	}
+
+	return ret;
+}
+
+#endif /* PLATFORM_WINDOWS */
@@ -332,6 +332,12 @@ DiskIOProcessor::ChannelInfo::ChannelInfo (samplecnt_t bufsize)
 
 DiskIOProcessor::ChannelInfo::~ChannelInfo ()
 {
+	if (rbuf) {
+		buffer_account ().remove (rbuf->bufsize () * sizeof (Sample));
+	}
+	if (wbuf) {
+		buffer_account ().remove (wbuf->bufsize () * sizeof (Sample));
+	}
 	delete rbuf;
 	delete wbuf;
 	delete capture_transition_buf;
@@ -340,6 +346,13 @@ DiskIOProcessor::ChannelInfo::~ChannelInfo ()
 	capture_transition_buf = 0;
 }
 
+PBD::MemoryAccount&
+DiskIOProcessor::ChannelInfo::buffer_account ()
+{
+	static PBD::MemoryAccount& account (PBD::MemoryAccount::get (X_("disk-buffers")));
+	return account;
+}
+
 /** Get the start, end, and length of a location "atomically".
  *
  * Note: Locations don't get deleted, so all we care about when I say "atomic"
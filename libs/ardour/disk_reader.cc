@@ -85,10 +85,14 @@ DiskReader::display_name () const
 void
 DiskReader::ReaderChannelInfo::resize (samplecnt_t bufsize)
 {
+	if (rbuf) {
+		buffer_account ().remove (rbuf->bufsize () * sizeof (Sample));
+	}
 	delete rbuf;
 	rbuf = 0;
 
 	rbuf = new PlaybackBuffer<Sample> (bufsize);
+	buffer_account ().add (rbuf->bufsize () * sizeof (Sample));
 	/* touch memory to lock it */
 	memset (rbuf->buffer (), 0, sizeof (Sample) * rbuf->bufsize ());
 	initialized = false;
@@ -102,6 +106,7 @@ DiskReader::ReaderChannelInfo::resize_preloop (samplecnt_t bufsize)
 	}
 
 	if (bufsize > pre_loop_buffer_size) {
+		buffer_account ().change (pre_loop_buffer_size * sizeof (Sample), bufsize * sizeof (Sample));
 		delete[] pre_loop_buffer;
 		pre_loop_buffer      = new Sample[bufsize];
 		pre_loop_buffer_size = bufsize;
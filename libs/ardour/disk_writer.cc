@@ -27,6 +27,7 @@
 #include "ardour/audioplaylist.h"
 #include "ardour/audioregion.h"
 #include "ardour/butler.h"
+#include "ardour/capture_encoder.h"
 #include "ardour/debug.h"
 #include "ardour/disk_writer.h"
 #include "ardour/midi_playlist.h"
@@ -36,6 +37,7 @@
 #include "ardour/region_factory.h"
 #include "ardour/session.h"
 #include "ardour/smf_source.h"
+#include "ardour/sndfilesource.h"
 
 #include "pbd/i18n.h"
 
@@ -60,6 +62,7 @@ DiskWriter::DiskWriter (Session& s, Track& t, string const & str, DiskIOProcesso
 	, _transport_looped (false)
 	, _transport_loop_sample (0)
 	, _gui_feed_buffer(AudioEngine::instance()->raw_buffer_size (DataType::MIDI))
+	, _write_stats_done (false)
 {
 	DiskIOProcessor::init ();
 	_xruns.reserve (128);
@@ -99,8 +102,12 @@ DiskWriter::WriterChannelInfo::resize (samplecnt_t bufsize)
 	if (!capture_transition_buf) {
 		capture_transition_buf = new RingBufferNPT<CaptureTransition> (256);
 	}
+	if (wbuf) {
+		buffer_account ().remove (wbuf->bufsize () * sizeof (Sample));
+	}
 	delete wbuf;
 	wbuf = new RingBufferNPT<Sample> (bufsize);
+	buffer_account ().add (wbuf->bufsize () * sizeof (Sample));
 	/* touch memory to lock it */
 	memset (wbuf->buffer(), 0, sizeof (Sample) * wbuf->bufsize());
 }
@@ -887,6 +894,56 @@ DiskWriter::buffer_load () const
 			(double) c->front()->wbuf->bufsize());
 }
 
+samplecnt_t
+DiskWriter::headroom_samples () const
+{
+	boost::shared_ptr<ChannelList> c = channels.reader ();
+	samplecnt_t rv = max_samplecnt;
+
+	for (ChannelList::const_iterator chan = c->begin (); chan != c->end (); ++chan) {
+		rv = min (rv, (samplecnt_t) (*chan)->wbuf->write_space ());
+	}
+
+	return rv;
+}
+
+samplecnt_t
+DiskWriter::pending_write () const
+{
+	boost::shared_ptr<ChannelList> c = channels.reader ();
+	samplecnt_t rv = 0;
+
+	for (ChannelList::const_iterator chan = c->begin (); chan != c->end (); ++chan) {
+		rv = max (rv, (samplecnt_t) (*chan)->wbuf->read_space ());
+	}
+
+	return rv;
+}
+
+CaptureWriteStats
+DiskWriter::capture_write_stats () const
+{
+	Glib::Threads::Mutex::Lock lm (_write_stats_lock);
+	return _write_stats;
+}
+
+void
+DiskWriter::add_write_stats (samplecnt_t n, int64_t usecs)
+{
+	Glib::Threads::Mutex::Lock lm (_write_stats_lock);
+
+	if (_write_stats_done) {
+		/* first write of a new take */
+		_write_stats = CaptureWriteStats ();
+		_write_stats_done = false;
+	}
+
+	_write_stats.samples  += n;
+	_write_stats.writes   += 1;
+	_write_stats.usecs    += usecs;
+	_write_stats.max_usecs = std::max (_write_stats.max_usecs, usecs);
+}
+
 void
 DiskWriter::set_note_mode (NoteMode m)
 {
@@ -898,8 +955,13 @@ DiskWriter::set_note_mode (NoteMode m)
 		mp->set_note_mode (m);
 	}
 
-	if (_midi_write_source && _midi_write_source->model())
-		_midi_write_source->model()->set_note_mode(m);
+	if (_midi_write_source) {
+		/* the model may be loaded or replaced at any time (load-midi-models-on-demand) */
+		boost::shared_ptr<MidiModel> mm = _midi_write_source->model ();
+		if (mm) {
+			mm->set_note_mode (m);
+		}
+	}
 }
 
 void
@@ -935,9 +997,10 @@ DiskWriter::reset_capture ()
 }
 
 int
-DiskWriter::do_flush (RunContext ctxt, bool force_flush)
+DiskWriter::do_flush (RunContext ctxt, bool force_flush, uint32_t max_chunks)
 {
 	uint32_t to_write;
+	samplecnt_t limit;
 	int32_t ret = 0;
 	RingBufferNPT<Sample>::rw_vector vector;
 	samplecnt_t total;
@@ -956,6 +1019,16 @@ DiskWriter::do_flush (RunContext ctxt, bool force_flush)
 			goto out;
 		}
 
+		/* write up to max_chunks chunks at once. While recording,
+		   only write whole chunks, the rest is written next time.
+		*/
+
+		limit = _chunk_samples * max (max_chunks, (uint32_t) 1);
+
+		if (!force_flush && _was_recording) {
+			limit = min (limit, total - (total % _chunk_samples));
+		}
+
 		/* if there are 2+ chunks of disk i/o possible for
 		   this track, let the caller know so that it can arrange
 		   for us to be called again, ASAP.
@@ -967,36 +1040,44 @@ DiskWriter::do_flush (RunContext ctxt, bool force_flush)
 		   let the caller know too.
 		*/
 
-		if (total >= 2 * _chunk_samples || ((force_flush || !_was_recording) && total > _chunk_samples)) {
+		if (total >= limit + _chunk_samples || ((force_flush || !_was_recording) && total > limit)) {
 			ret = 1;
 		}
 
-		to_write = min (_chunk_samples, (samplecnt_t) vector.len[0]);
+		to_write = min (limit, (samplecnt_t) vector.len[0]);
+
+		int64_t write_start = g_get_monotonic_time ();
 
 		if ((!(*chan)->write_source) || (*chan)->write_source->write (vector.buf[0], to_write) != to_write) {
 			error << string_compose(_("AudioDiskstream %1: cannot write to disk"), id()) << endmsg;
 			return -1;
 		}
 
+		add_write_stats (to_write, g_get_monotonic_time () - write_start);
+
 		(*chan)->wbuf->increment_read_ptr (to_write);
 		(*chan)->curr_capture_cnt += to_write;
 
-		if ((to_write == vector.len[0]) && (total > to_write) && (to_write < _chunk_samples)) {
+		if ((to_write == vector.len[0]) && (total > to_write) && (to_write < limit)) {
 
-			/* we wrote all of vector.len[0] but it wasn't an entire
-			   disk_write_chunk_samples of data, so arrange for some part
+			/* we wrote all of vector.len[0] but it wasn't all
+			   we wanted to write, so arrange for some part
 			   of vector.len[1] to be flushed to disk as well.
 			*/
 
-			to_write = min ((samplecnt_t)(_chunk_samples - to_write), (samplecnt_t) vector.len[1]);
+			to_write = min ((samplecnt_t)(limit - to_write), (samplecnt_t) vector.len[1]);
 
                         DEBUG_TRACE (DEBUG::Butler, string_compose ("%1 additional write of %2\n", name(), to_write));
 
+			write_start = g_get_monotonic_time ();
+
 			if ((*chan)->write_source->write (vector.buf[1], to_write) != to_write) {
 				error << string_compose(_("AudioDiskstream %1: cannot write to disk"), id()) << endmsg;
 				return -1;
 			}
 
+			add_write_stats (to_write, g_get_monotonic_time () - write_start);
+
 			(*chan)->wbuf->increment_read_ptr (to_write);
 			(*chan)->curr_capture_cnt += to_write;
 		}
@@ -1138,7 +1219,7 @@ DiskWriter::use_new_write_source (DataType dt, uint32_t n)
 		ChannelInfo* chan = (*c)[n];
 
 		try {
-			if ((chan->write_source = _session.create_audio_source_for_session (
+			if ((chan->write_source = _session.create_audio_capture_source_for_session (
 				     c->size(), write_source_name(), n)) == 0) {
 				throw failed_constructor();
 			}
@@ -1151,6 +1232,13 @@ DiskWriter::use_new_write_source (DataType dt, uint32_t n)
 		}
 
 		chan->write_source->set_allow_remove_if_empty (true);
+
+		if (Config->get_capture_direct_io ()) {
+			boost::shared_ptr<SndFileSource> sfs = boost::dynamic_pointer_cast<SndFileSource> (chan->write_source);
+			if (sfs) {
+				sfs->set_direct_io (true);
+			}
+		}
 	}
 
 	return 0;
@@ -1187,6 +1275,16 @@ DiskWriter::transport_stopped_wallclock (struct tm& when, time_t twhen, bool abo
 		}
 	}
 
+	{
+		Glib::Threads::Mutex::Lock lm (_write_stats_lock);
+		if (!_write_stats_done && _write_stats.writes > 0) {
+			DEBUG_TRACE (DEBUG::Butler, string_compose ("%1: wrote %2 samples in %3 writes, %4 ms, %5 samples/sec, longest write %6 ms\n",
+			                                            name (), _write_stats.samples, _write_stats.writes, _write_stats.usecs / 1000,
+			                                            (int64_t) _write_stats.throughput (), _write_stats.max_usecs / 1000.0));
+			_write_stats_done = true;
+		}
+	}
+
 	/* XXX is there anything we can do if err != 0 ? */
 	Glib::Threads::Mutex::Lock lm (capture_info_lock);
 
@@ -1306,6 +1404,13 @@ DiskWriter::transport_stopped_wallclock (struct tm& when, time_t twhen, bool abo
   out:
 	reset_write_sources (mark_write_completed);
 
+	if (mark_write_completed && Config->get_capture_deferred_encoding ()) {
+		/* the take is complete, peak files are written */
+		for (SourceList::iterator s = audio_srcs.begin (); s != audio_srcs.end (); ++s) {
+			CaptureEncoder::queue_source_for_encoding (boost::dynamic_pointer_cast<AudioFileSource> (*s), when, twhen);
+		}
+	}
+
 	for (vector<CaptureInfo*>::iterator ci = capture_info.begin(); ci != capture_info.end(); ++ci) {
 		delete *ci;
 	}
@@ -668,6 +668,8 @@ setup_enum_writer ()
 	REGISTER_CLASS_ENUM (ExportFormatBase, SRC_SincFast);
 	REGISTER_CLASS_ENUM (ExportFormatBase, SRC_ZeroOrderHold);
 	REGISTER_CLASS_ENUM (ExportFormatBase, SRC_Linear);
+	REGISTER_CLASS_ENUM (ExportFormatBase, SRC_PolyphaseBest);
+	REGISTER_CLASS_ENUM (ExportFormatBase, SRC_PolyphaseGood);
 	REGISTER (_ExportFormatBase_SRCQuality);
 
 	REGISTER_CLASS_ENUM (ExportProfileManager, Timecode);
@@ -23,11 +23,14 @@
 #include "ardour/audio_buffer.h"
 #include "ardour/audio_port.h"
 #include "ardour/audio_track.h"
+#include "ardour/audioplaylist.h"
 #include "ardour/audioengine.h"
 #include "ardour/audioregion.h"
 #include "ardour/capturing_processor.h"
 #include "ardour/export_channel.h"
 #include "ardour/export_failed.h"
+#include "ardour/monitor_control.h"
+#include "ardour/phase_control.h"
 #include "ardour/session.h"
 
 #include "pbd/error.h"
@@ -276,6 +279,12 @@ RouteExportChannel::create_from_route(std::list<ExportChannelPtr> & result, boos
 	}
 }
 
+boost::shared_ptr<Route>
+RouteExportChannel::route () const
+{
+	return remover->get_route ();
+}
+
 void
 RouteExportChannel::prepare_export (samplecnt_t max_samples, sampleoffset_t)
 {
@@ -327,3 +336,59 @@ RouteExportChannel::ProcessorRemover::~ProcessorRemover()
 {
 	route->remove_processor (processor);
 }
+
+PlaylistExportChannel::PlaylistExportChannel (boost::shared_ptr<AudioPlaylist> playlist, uint32_t channel, samplepos_t start)
+	: _playlist (playlist)
+	, _channel (channel)
+	, _position (start)
+	, _buffer_size (0)
+{
+}
+
+boost::shared_ptr<AudioPlaylist>
+PlaylistExportChannel::disk_only_playlist (boost::shared_ptr<Route> route)
+{
+	boost::shared_ptr<AudioTrack> track = boost::dynamic_pointer_cast<AudioTrack> (route);
+	if (!track || !track->active ()) {
+		return boost::shared_ptr<AudioPlaylist> ();
+	}
+
+	/* The export point directly follows the disk-reader, only input
+	 * monitoring and polarity inversion can change the data in between
+	 * (see Route::setup_invisible_processors ()).
+	 */
+	switch (track->monitoring_control ()->monitoring_choice ()) {
+		case MonitorAuto:
+		case MonitorDisk:
+			break;
+		default:
+			return boost::shared_ptr<AudioPlaylist> ();
+	}
+
+	if (!track->phase_control ()->none ()) {
+		return boost::shared_ptr<AudioPlaylist> ();
+	}
+
+	return boost::dynamic_pointer_cast<AudioPlaylist> (track->playlist ());
+}
+
+void
+PlaylistExportChannel::prepare_export (samplecnt_t max_samples, sampleoffset_t)
+{
+	_buffer_size = max_samples;
+	_buffer.reset (new Sample[max_samples]);
+	_mixdown_buffer.reset (new Sample[max_samples]);
+	_gain_buffer.reset (new float[max_samples]);
+}
+
+void
+PlaylistExportChannel::read (Sample const *& data, samplecnt_t samples) const
+{
+	assert (_buffer);
+	assert (samples <= _buffer_size);
+
+	_playlist->read (_buffer.get (), _mixdown_buffer.get (), _gain_buffer.get (), timepos_t (_position), timecnt_t::from_samples (samples), _channel);
+	_position += samples;
+
+	data = _buffer.get ();
+}
@@ -30,6 +30,7 @@
 #include "pbd/uuid.h"
 #include "pbd/file_utils.h"
 #include "pbd/cpus.h"
+#include "pbd/xml++.h"
 
 #include "audiographer/process_context.h"
 #include "audiographer/general/chunker.h"
@@ -46,6 +47,7 @@
 #include "audiographer/general/silence_trimmer.h"
 #include "audiographer/general/threader.h"
 #include "audiographer/sndfile/tmp_file.h"
+#include "audiographer/sndfile/tmp_file_mem.h"
 #include "audiographer/sndfile/tmp_file_rt.h"
 #include "audiographer/sndfile/tmp_file_sync.h"
 #include "audiographer/sndfile/sndfile_writer.h"
@@ -68,15 +70,38 @@ using std::string;
 
 namespace ARDOUR {
 
-ExportGraphBuilder::ExportGraphBuilder (Session const & session)
+struct ExportGraphBuilder::CachedAnalysis
+{
+	CachedAnalysis ()
+		: modification_count (0)
+		, have_peak (false)
+		, peak (0)
+		, have_loudness (false)
+		, n_samples (0)
+	{}
+
+	uint32_t            modification_count;
+	bool                have_peak;
+	float               peak;
+	bool                have_loudness;
+	LoudnessMeasurement loudness;
+	samplecnt_t         n_samples; // per channel, 0 if unknown
+};
+
+ExportGraphBuilder::ExportGraphBuilder (Session const & session, samplecnt_t block_size, bool threaded)
 	: session (session)
-	, thread_pool (hardware_concurrency())
+	, timespan_modification_count (0)
+	, thread_pool (threaded ? hardware_concurrency() : 0)
 {
-	process_buffer_samples = session.engine().samples_per_cycle();
+	process_buffer_samples = block_size > 0 ? block_size : session.engine().samples_per_cycle();
 }
 
 ExportGraphBuilder::~ExportGraphBuilder ()
 {
+	/* analysers may still be queued in the thread pool,
+	 * drop them while it is still around.
+	 */
+	reset ();
 }
 
 samplecnt_t
@@ -140,6 +165,7 @@ ExportGraphBuilder::reset ()
 	channels.clear ();
 	intermediates.clear ();
 	analysis_map.clear();
+	raw_analysers.clear ();
 	_realtime = false;
 	_master_align = 0;
 }
@@ -159,6 +185,7 @@ void
 ExportGraphBuilder::set_current_timespan (boost::shared_ptr<ExportTimespan> span)
 {
 	timespan = span;
+	timespan_modification_count = session.modification_count ();
 }
 
 void
@@ -223,6 +250,122 @@ ExportGraphBuilder::get_analysis_results (AnalysisResults& results) {
 			results.insert (std::make_pair (i->first, p));
 		}
 	}
+
+	/* remember what an analysis-only (or any un-normalized) export found,
+	 * a later normalized export of the same material can use it.
+	 */
+	for (std::list<std::pair<FileSpec, AnalysisPtr> >::const_iterator i = raw_analysers.begin(); i != raw_analysers.end(); ++i) {
+		/* n_samples is set by result() above, which does not
+		 * return incomplete results.
+		 */
+		ExportAnalysisPtr p = i->second->result (true);
+		if (p->n_samples == 0) {
+			continue;
+		}
+		CachedAnalysis ca;
+		ca.have_peak     = true;
+		ca.peak          = p->peak;
+		ca.have_loudness = true;
+		ca.loudness      = i->second->measurement ();
+		ca.n_samples     = p->n_samples;
+		cache_analysis (i->first, ca);
+	}
+	raw_analysers.clear ();
+}
+
+std::string
+ExportGraphBuilder::analysis_key (FileSpec const & config) const
+{
+	/* everything that affects the material up to the normalizer */
+	ExportFormatSpecification const & format = *config.format;
+	samplecnt_t const sample_rate = session.nominal_sample_rate ();
+
+	XMLTree tree;
+	tree.set_root (&config.channel_config->get_state ());
+
+	return string_compose ("%1 %2 %3 %4 %5 %6 %7 %8 %9 %10\n%11",
+	                       timespan->get_start (), timespan->get_end (), _master_align, sample_rate,
+	                       format.sample_rate (), format.src_quality (),
+	                       format.trim_beginning (), format.trim_end (),
+	                       format.silence_beginning_at (timespan->get_start (), sample_rate),
+	                       format.silence_end_at (timespan->get_end (), sample_rate),
+	                       tree.write_buffer ());
+}
+
+ExportGraphBuilder::CachedAnalysisPtr
+ExportGraphBuilder::cached_analysis (FileSpec const & config)
+{
+	if (!Config->get_export_reuse_analysis ()) {
+		return CachedAnalysisPtr ();
+	}
+
+	Glib::Threads::Mutex::Lock lm (analysis_cache_lock);
+	AnalysisCache::const_iterator i = analysis_cache.find (analysis_key (config));
+
+	if (i == analysis_cache.end () || i->second->modification_count != session.modification_count ()) {
+		/* the session was modified since */
+		return CachedAnalysisPtr ();
+	}
+
+	CachedAnalysisPtr ca = i->second;
+
+	if ((config.format->normalize () && !ca->have_peak) || (config.format->normalize_loudness () && !ca->have_loudness)) {
+		return CachedAnalysisPtr ();
+	}
+	return ca;
+}
+
+void
+ExportGraphBuilder::cache_analysis (FileSpec const & config, CachedAnalysis const & analysis)
+{
+	std::string const key (analysis_key (config));
+
+	Glib::Threads::Mutex::Lock lm (analysis_cache_lock);
+	CachedAnalysisPtr& ca (analysis_cache[key]);
+
+	if (!ca || ca->modification_count != timespan_modification_count) {
+		ca.reset (new CachedAnalysis);
+		ca->modification_count = timespan_modification_count;
+	}
+
+	if (analysis.have_peak) {
+		ca->have_peak = true;
+		ca->peak      = analysis.peak;
+	}
+	if (analysis.have_loudness) {
+		ca->have_loudness = true;
+		ca->loudness      = analysis.loudness;
+	}
+	if (analysis.n_samples > 0) {
+		ca->n_samples = analysis.n_samples;
+	}
+}
+
+samplecnt_t
+ExportGraphBuilder::tmp_ram_samples (FileSpec const & config) const
+{
+	/* realtime export relies on the TmpFileRt disk thread to start
+	 * post-processing, outside of the process callback.
+	 */
+	if (_realtime || Config->get_export_tmp_ram_limit () == 0) {
+		return 0;
+	}
+
+	ExportFormatSpecification const & format = *config.format;
+	samplecnt_t const sample_rate = session.nominal_sample_rate ();
+
+	/* the estimate used by the analyser, plus some slack for resampling */
+	samplecnt_t const duration = timespan->get_length ()
+		+ format.silence_beginning_at (timespan->get_start (), sample_rate)
+		+ format.silence_end_at (timespan->get_end (), sample_rate);
+
+	samplecnt_t const samples = (samplecnt_t) ceil (duration * format.sample_rate () / (double) sample_rate) + 8192;
+	samplecnt_t const total   = samples * config.channel_config->get_n_chans ();
+
+	if (total * (samplecnt_t) sizeof (Sample) > (samplecnt_t) Config->get_export_tmp_ram_limit () * 1048576) {
+		return 0;
+	}
+	return total;
 }
 
 void
@@ -459,11 +602,17 @@ ExportGraphBuilder::SFC::SFC (ExportGraphBuilder &parent, FileSpec const & new_c
 		                              (samplecnt_t) ceil (duration * config.format->sample_rate () / (double) sample_rate),
 		                              800 * ui_scale_factor, 200 * ui_scale_factor
 		                             ));
+		/* analyse in parallel with encoding */
+		analyser->set_thread_pool (parent.thread_pool);
 
 		config.filename->set_channel_config (config.channel_config);
 		parent.add_analyser (config.filename->get_path (config.format), analyser);
 		limiter->set_result (analyser->result (true));
 
+		if (!config.format->normalize () && !config.format->normalize_loudness ()) {
+			parent.raw_analysers.push_back (std::make_pair (config, analyser));
+		}
+
 		chunker->add_output (analyser);
 		intermediate->add_output (chunker);
 		intermediate = analyser;
@@ -531,23 +680,36 @@ ExportGraphBuilder::SFC::set_peak_dbfs (float peak, bool force)
 }
 
 void
-ExportGraphBuilder::SFC::set_peak_lufs (AudioGrapher::LoudnessReader const& lr)
+ExportGraphBuilder::SFC::set_peak_lufs (AudioGrapher::LoudnessMeasurement const& lr)
 {
 	if (!config.format->normalize_loudness ()) {
 		return;
 	}
-	float LUFSi, LUFSs;
 	if (!config.format->use_tp_limiter ()) {
 		float peak = lr.calc_peak (config.format->normalize_lufs (), config.format->normalize_dbtp ());
 		set_peak_dbfs (peak, true);
-	} else if (lr.get_loudness (&LUFSi, &LUFSs) && (LUFSi > -180 || LUFSs > -180)) {
-		float lufs = LUFSi > -180 ? LUFSi : LUFSs;
+	} else if (lr.have_lufs && (lr.integrated > -180 || lr.short_term > -180)) {
+		float lufs = lr.integrated > -180 ? lr.integrated : lr.short_term;
 		float peak = powf (10.f, .05 * (lufs - config.format->normalize_lufs () - 0.05));
 		limiter->set_threshold (config.format->normalize_dbtp ());
 		set_peak_dbfs (peak, true);
 	}
 }
 
+void
+ExportGraphBuilder::SFC::set_analysis (CachedAnalysis const& ca)
+{
+	if (ca.have_peak) {
+		set_peak_dbfs (ca.peak);
+	}
+	if (ca.have_loudness) {
+		set_peak_lufs (ca.loudness);
+	}
+	if (ca.n_samples > 0) {
+		set_duration (ca.n_samples);
+	}
+}
+
 ExportGraphBuilder::FloatSinkPtr
 ExportGraphBuilder::SFC::sink ()
 {
@@ -640,10 +802,17 @@ ExportGraphBuilder::Intermediate::Intermediate (ExportGraphBuilder & parent, Fil
 	threader.reset (new Threader<Sample> (parent.thread_pool));
 
 	int format = ExportFormatBase::F_RAW | ExportFormatBase::SF_Float;
+	samplecnt_t const ram_samples = parent.tmp_ram_samples (config);
 
 	if (parent._realtime) {
 		tmp_file.reset (new TmpFileRt<float> (&tmpfile_path_buf[0], format, channels, config.format->sample_rate()));
-	} else {
+	} else if (ram_samples > 0) {
+		/* the limit is shared by all intermediates of all exports (incl. parallel stems) */
+		tmp_file.reset (TmpFileMem<float>::create (format, channels, config.format->sample_rate(), ram_samples,
+		                                           (int64_t) Config->get_export_tmp_ram_limit () * 1048576));
+	}
+
+	if (!tmp_file) {
 		tmp_file.reset (new TmpFileSync<float> (&tmpfile_path_buf[0], format, channels, config.format->sample_rate()));
 	}
 
@@ -726,7 +895,7 @@ ExportGraphBuilder::Intermediate::prepare_post_processing()
 			(*i).set_peak_dbfs (peak_reader->get_peak());
 		}
 		if (use_loudness) {
-			(*i).set_peak_lufs (*loudness_reader);
+			(*i).set_peak_lufs (loudness_reader->measurement ());
 		}
 	}
 
@@ -737,10 +906,20 @@ ExportGraphBuilder::Intermediate::prepare_post_processing()
 void
 ExportGraphBuilder::Intermediate::start_post_processing()
 {
+	samplecnt_t const n_samples = tmp_file->get_samples_written() / config.channel_config->get_n_chans();
+
 	for (boost::ptr_list<SFC>::iterator i = children.begin(); i != children.end(); ++i) {
-		(*i).set_duration (tmp_file->get_samples_written() / config.channel_config->get_n_chans());
+		(*i).set_duration (n_samples);
 	}
 
+	CachedAnalysis ca;
+	ca.have_peak     = use_peak;
+	ca.peak          = peak_reader->get_peak ();
+	ca.have_loudness = use_peak || use_loudness; // the peak reader feeds the loudness reader
+	ca.loudness      = loudness_reader->measurement ();
+	ca.n_samples     = n_samples;
+	parent.cache_analysis (config, ca);
+
 	tmp_file->seek (0, SEEK_SET);
 
 	/* called in disk-thread when exporting in realtime,
@@ -769,6 +948,7 @@ ExportGraphBuilder::SRC::SRC (ExportGraphBuilder & parent, FileSpec const & new_
 {
 	config = new_config;
 	converter.reset (new SampleRateConverter (new_config.channel_config->get_n_chans()));
+	converter->set_thread_pool (parent.thread_pool);
 	ExportFormatSpecification & format = *new_config.format;
 	converter->init (parent.session.nominal_sample_rate(), format.sample_rate(), format.src_quality());
 	max_samples_out = converter->allocate_buffers (max_samples);
@@ -785,10 +965,24 @@ ExportGraphBuilder::SRC::sink ()
 void
 ExportGraphBuilder::SRC::add_child (FileSpec const & new_config)
 {
-	if (new_config.format->normalize() || parent._realtime) {
+	if (parent._realtime) {
 		add_child_to_list (new_config, intermediate_children);
-	} else {
+		return;
+	}
+
+	if (!new_config.format->normalize()) {
 		add_child_to_list (new_config, children);
+		return;
+	}
+
+	/* if the material was analysed before, the normalization gain is
+	 * known up front: encode directly, without a TmpFile pass.
+	 */
+	CachedAnalysisPtr ca = parent.cached_analysis (new_config);
+	if (ca) {
+		add_child_to_list (new_config, children).set_analysis (*ca);
+	} else {
+		add_child_to_list (new_config, intermediate_children);
 	}
 }
 
@@ -814,18 +1008,19 @@ ExportGraphBuilder::SRC::remove_children (bool remove_out_files)
 }
 
 template<typename T>
-void
+T&
 ExportGraphBuilder::SRC::add_child_to_list (FileSpec const & new_config, boost::ptr_list<T> & list)
 {
 	for (typename boost::ptr_list<T>::iterator it = list.begin(); it != list.end(); ++it) {
 		if (*it == new_config) {
 			it->add_child (new_config);
-			return;
+			return *it;
 		}
 	}
 
 	list.push_back (new T (parent, new_config, max_samples_out));
 	converter->add_output (list.back().sink ());
+	return list.back();
 }
 
 bool
@@ -918,7 +1113,7 @@ ExportGraphBuilder::ChannelConfig::ChannelConfig (ExportGraphBuilder & parent, F
 
 	config = new_config;
 
-	samplecnt_t max_samples = parent.session.engine().samples_per_cycle();
+	samplecnt_t max_samples = parent.process_buffer_samples;
 	interleaver.reset (new Interleaver<Sample> ());
 	interleaver->init (new_config.channel_config->get_n_chans(), max_samples);
 
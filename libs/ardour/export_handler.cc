@@ -27,11 +27,15 @@
 #include <glibmm/convert.h>
 
 #include "pbd/convert.h"
+#include "pbd/cpus.h"
+#include "pbd/pthread_utils.h"
 
 #include "ardour/audioengine.h"
 #include "ardour/audiofile_tagger.h"
 #include "ardour/audio_port.h"
+#include "ardour/audioplaylist.h"
 #include "ardour/debug.h"
+#include "ardour/export_channel.h"
 #include "ardour/export_graph_builder.h"
 #include "ardour/export_handler.h"
 #include "ardour/export_timespan.h"
@@ -44,6 +48,9 @@
 #include "pbd/openuri.h"
 #include "pbd/basename.h"
 #include "ardour/session_metadata.h"
+#include "ardour/rc_configuration.h"
+
+#include "temporal/tempo.h"
 
 #include "pbd/i18n.h"
 
@@ -116,6 +123,10 @@ ExportHandler::ExportHandler (Session & session)
   , graph_builder (new ExportGraphBuilder (session))
   , export_status (session.get_export_status ())
   , post_processing (false)
+  , offline_next (0)
+  , offline_running (0)
+  , offline_progress (0)
+  , offline_base (0)
   , cue_tracknum (0)
   , cue_indexnum (0)
 {
@@ -185,13 +196,20 @@ ExportHandler::start_timespan ()
 		return -1;
 	}
 
-	export_status->timespan++;
-
 	/* finish_timespan pops the config_map entry that has been done, so
-	   this is the timespan to do this time
+	   this is the timespan to do this time.
+	   If some stems of it were rendered offline, the remaining ones are
+	   exported using the engine now.
 	*/
+	bool const resume = (current_timespan == config_map.begin()->first);
 	current_timespan = config_map.begin()->first;
 
+	if (resume) {
+		export_status->total_samples += current_timespan->get_length();
+	} else {
+		export_status->timespan++;
+	}
+
 	export_status->total_samples_current_timespan = current_timespan->get_length();
 	export_status->timespan_name = current_timespan->name();
 	export_status->processed_samples_current_timespan = 0;
@@ -204,6 +222,11 @@ ExportHandler::start_timespan ()
 	graph_builder->set_current_timespan (current_timespan);
 	handle_duplicate_format_extensions();
 	bool realtime = current_timespan->realtime ();
+
+	if (!resume && !realtime && Config->get_export_parallel_stems () && start_offline_stems ()) {
+		return 0;
+	}
+
 	bool region_export = true;
 	for (ConfigMap::iterator it = timespan_bounds.first; it != timespan_bounds.second; ++it) {
 		// Filenames can be shared across timespans
@@ -372,146 +395,366 @@ ExportHandler::finish_timespan ()
 	graph_builder->get_analysis_results (export_status->result_map);
 
 	while (config_map.begin() != timespan_bounds.second) {
+		/* close file first, otherwise TagLib enounters an ERROR_SHARING_VIOLATION
+		 * The process cannot access the file because it is being used.
+		 * ditto for post-export and upload.
+		 */
+		graph_builder->reset ();
 
-		// XXX single timespan+format may produce multiple files
-		// e.g export selection == session
-		// -> TagLib::FileRef is null
+		finish_file (config_map.begin()->second);
+		config_map.erase (config_map.begin());
+	}
 
-		ExportFormatSpecPtr fmt = config_map.begin()->second.format;
-		std::string filename = config_map.begin()->second.filename->get_path(fmt);
-		if (fmt->with_cue()) {
-			export_cd_marker_file (current_timespan, fmt, filename, CDMarkerCUE);
-		}
+	/* finish timespan is called in freewheeling rt-context,
+	 * we cannot start a new export from here */
+	assert (AudioEngine::instance()->freewheeling ());
+	pthread_t tid;
+	pthread_create (&tid, NULL, ExportHandler::start_timespan_bg, this);
+	pthread_detach (tid);
+}
 
-		if (fmt->with_toc()) {
-			export_cd_marker_file (current_timespan, fmt, filename, CDMarkerTOC);
-		}
+void
+ExportHandler::finish_file (FileSpec const & spec)
+{
+	// XXX single timespan+format may produce multiple files
+	// e.g export selection == session
+	// -> TagLib::FileRef is null
+
+	ExportFormatSpecPtr fmt = spec.format;
+	std::string filename = spec.filename->get_path(fmt);
+	if (fmt->with_cue()) {
+		export_cd_marker_file (current_timespan, fmt, filename, CDMarkerCUE);
+	}
 
-		if (fmt->with_mp4chaps()) {
-			export_cd_marker_file (current_timespan, fmt, filename, MP4Chaps);
-		}
+	if (fmt->with_toc()) {
+		export_cd_marker_file (current_timespan, fmt, filename, CDMarkerTOC);
+	}
 
-		Session::Exported (current_timespan->name(), filename); /* EMIT SIGNAL */
+	if (fmt->with_mp4chaps()) {
+		export_cd_marker_file (current_timespan, fmt, filename, MP4Chaps);
+	}
 
-		/* close file first, otherwise TagLib enounters an ERROR_SHARING_VIOLATION
-		 * The process cannot access the file because it is being used.
-		 * ditto for post-export and upload.
-		 */
-		graph_builder->reset ();
+	Session::Exported (current_timespan->name(), filename); /* EMIT SIGNAL */
 
-		if (fmt->tag()) {
-			/* TODO: check Umlauts and encoding in filename.
-			 * TagLib eventually calls CreateFileA(),
-			 */
-			export_status->active_job = ExportStatus::Tagging;
-			AudiofileTagger::tag_file(filename, *SessionMetadata::Metadata());
-		}
+	if (fmt->tag()) {
+		/* TODO: check Umlauts and encoding in filename.
+		 * TagLib eventually calls CreateFileA(),
+		 */
+		export_status->active_job = ExportStatus::Tagging;
+		AudiofileTagger::tag_file(filename, *SessionMetadata::Metadata());
+	}
 
-		if (!fmt->command().empty()) {
-			SessionMetadata const & metadata (*SessionMetadata::Metadata());
+	if (!fmt->command().empty()) {
+		SessionMetadata const & metadata (*SessionMetadata::Metadata());
 
 #if 0 // would be nicer with C++11 initialiser...
-			std::map<char, std::string> subs {
-				{ 'f', filename },
-				{ 'd', Glib::path_get_dirname(filename)  + G_DIR_SEPARATOR },
-				{ 'b', PBD::basename_nosuffix(filename) },
-				...
-			};
+		std::map<char, std::string> subs {
+			{ 'f', filename },
+			{ 'd', Glib::path_get_dirname(filename)  + G_DIR_SEPARATOR },
+			{ 'b', PBD::basename_nosuffix(filename) },
+			...
+		};
 #endif
-			export_status->active_job = ExportStatus::Command;
-			PBD::ScopedConnection command_connection;
-			std::map<char, std::string> subs;
-
-			std::stringstream track_number;
-			track_number << metadata.track_number ();
-			std::stringstream total_tracks;
-			total_tracks << metadata.total_tracks ();
-			std::stringstream year;
-			year << metadata.year ();
-
-			subs.insert (std::pair<char, std::string> ('a', metadata.artist ()));
-			subs.insert (std::pair<char, std::string> ('b', PBD::basename_nosuffix (filename)));
-			subs.insert (std::pair<char, std::string> ('c', metadata.copyright ()));
-			subs.insert (std::pair<char, std::string> ('d', Glib::path_get_dirname (filename) + G_DIR_SEPARATOR));
-			subs.insert (std::pair<char, std::string> ('f', filename));
-			subs.insert (std::pair<char, std::string> ('l', metadata.lyricist ()));
-			subs.insert (std::pair<char, std::string> ('n', session.name ()));
-			subs.insert (std::pair<char, std::string> ('s', session.path ()));
-			subs.insert (std::pair<char, std::string> ('o', metadata.conductor ()));
-			subs.insert (std::pair<char, std::string> ('t', metadata.title ()));
-			subs.insert (std::pair<char, std::string> ('z', metadata.organization ()));
-			subs.insert (std::pair<char, std::string> ('A', metadata.album ()));
-			subs.insert (std::pair<char, std::string> ('C', metadata.comment ()));
-			subs.insert (std::pair<char, std::string> ('E', metadata.engineer ()));
-			subs.insert (std::pair<char, std::string> ('G', metadata.genre ()));
-			subs.insert (std::pair<char, std::string> ('L', total_tracks.str ()));
-			subs.insert (std::pair<char, std::string> ('M', metadata.mixer ()));
-			subs.insert (std::pair<char, std::string> ('N', current_timespan->name())); // =?= config_map.begin()->first->name ()
-			subs.insert (std::pair<char, std::string> ('O', metadata.composer ()));
-			subs.insert (std::pair<char, std::string> ('P', metadata.producer ()));
-			subs.insert (std::pair<char, std::string> ('S', metadata.disc_subtitle ()));
-			subs.insert (std::pair<char, std::string> ('T', track_number.str ()));
-			subs.insert (std::pair<char, std::string> ('Y', year.str ()));
-			subs.insert (std::pair<char, std::string> ('Z', metadata.country ()));
-
-			ARDOUR::SystemExec *se = new ARDOUR::SystemExec(fmt->command(), subs);
-			info << "Post-export command line : {" << se->to_s () << "}" << endmsg;
-			se->ReadStdout.connect_same_thread(command_connection, boost::bind(&ExportHandler::command_output, this, _1, _2));
-			int ret = se->start (SystemExec::MergeWithStdin);
-			if (ret == 0) {
-				// successfully started
-				while (se->is_running ()) {
-					// wait for system exec to terminate
-					Glib::usleep (1000);
-				}
-			} else {
-				error << "Post-export command FAILED with Error: " << ret << endmsg;
+		export_status->active_job = ExportStatus::Command;
+		PBD::ScopedConnection command_connection;
+		std::map<char, std::string> subs;
+
+		std::stringstream track_number;
+		track_number << metadata.track_number ();
+		std::stringstream total_tracks;
+		total_tracks << metadata.total_tracks ();
+		std::stringstream year;
+		year << metadata.year ();
+
+		subs.insert (std::pair<char, std::string> ('a', metadata.artist ()));
+		subs.insert (std::pair<char, std::string> ('b', PBD::basename_nosuffix (filename)));
+		subs.insert (std::pair<char, std::string> ('c', metadata.copyright ()));
+		subs.insert (std::pair<char, std::string> ('d', Glib::path_get_dirname (filename) + G_DIR_SEPARATOR));
+		subs.insert (std::pair<char, std::string> ('f', filename));
+		subs.insert (std::pair<char, std::string> ('l', metadata.lyricist ()));
+		subs.insert (std::pair<char, std::string> ('n', session.name ()));
+		subs.insert (std::pair<char, std::string> ('s', session.path ()));
+		subs.insert (std::pair<char, std::string> ('o', metadata.conductor ()));
+		subs.insert (std::pair<char, std::string> ('t', metadata.title ()));
+		subs.insert (std::pair<char, std::string> ('z', metadata.organization ()));
+		subs.insert (std::pair<char, std::string> ('A', metadata.album ()));
+		subs.insert (std::pair<char, std::string> ('C', metadata.comment ()));
+		subs.insert (std::pair<char, std::string> ('E', metadata.engineer ()));
+		subs.insert (std::pair<char, std::string> ('G', metadata.genre ()));
+		subs.insert (std::pair<char, std::string> ('L', total_tracks.str ()));
+		subs.insert (std::pair<char, std::string> ('M', metadata.mixer ()));
+		subs.insert (std::pair<char, std::string> ('N', current_timespan->name())); // =?= config_map.begin()->first->name ()
+		subs.insert (std::pair<char, std::string> ('O', metadata.composer ()));
+		subs.insert (std::pair<char, std::string> ('P', metadata.producer ()));
+		subs.insert (std::pair<char, std::string> ('S', metadata.disc_subtitle ()));
+		subs.insert (std::pair<char, std::string> ('T', track_number.str ()));
+		subs.insert (std::pair<char, std::string> ('Y', year.str ()));
+		subs.insert (std::pair<char, std::string> ('Z', metadata.country ()));
+
+		ARDOUR::SystemExec *se = new ARDOUR::SystemExec(fmt->command(), subs);
+		info << "Post-export command line : {" << se->to_s () << "}" << endmsg;
+		se->ReadStdout.connect_same_thread(command_connection, boost::bind(&ExportHandler::command_output, this, _1, _2));
+		int ret = se->start (SystemExec::MergeWithStdin);
+		if (ret == 0) {
+			// successfully started
+			while (se->is_running ()) {
+				// wait for system exec to terminate
+				Glib::usleep (1000);
 			}
-			delete (se);
+		} else {
+			error << "Post-export command FAILED with Error: " << ret << endmsg;
 		}
+		delete (se);
+	}
 
-		// XXX THIS IS IN REALTIME CONTEXT, CALLED FROM
-		// AudioEngine::process_callback()
-		// freewheeling, yes, but still uploading here is NOT
-		// a good idea.
-		//
-		// even less so, since SoundcloudProgress is using
-		// connect_same_thread() - GUI updates from the RT thread
-		// will cause crashes. http://pastebin.com/UJKYNGHR
-		if (fmt->soundcloud_upload()) {
-			SoundcloudUploader *soundcloud_uploader = new SoundcloudUploader;
-			std::string token = soundcloud_uploader->Get_Auth_Token(soundcloud_username, soundcloud_password);
-			DEBUG_TRACE (DEBUG::Soundcloud, string_compose(
-						"uploading %1 - username=%2, password=%3, token=%4",
-						filename, soundcloud_username, soundcloud_password, token) );
-			std::string path = soundcloud_uploader->Upload (
-					filename,
-					PBD::basename_nosuffix(filename), // title
-					token,
-					soundcloud_make_public,
-					soundcloud_downloadable,
-					this);
-
-			if (path.length() != 0) {
-				info << string_compose ( _("File %1 uploaded to %2"), filename, path) << endmsg;
-				if (soundcloud_open_page) {
-					DEBUG_TRACE (DEBUG::Soundcloud, string_compose ("opening %1", path) );
-					open_uri(path.c_str());  // open the soundcloud website to the new file
-				}
-			} else {
-				error << _("upload to Soundcloud failed. Perhaps your email or password are incorrect?\n") << endmsg;
+	// XXX THIS IS IN REALTIME CONTEXT, CALLED FROM
+	// AudioEngine::process_callback()
+	// freewheeling, yes, but still uploading here is NOT
+	// a good idea.
+	//
+	// even less so, since SoundcloudProgress is using
+	// connect_same_thread() - GUI updates from the RT thread
+	// will cause crashes. http://pastebin.com/UJKYNGHR
+	if (fmt->soundcloud_upload()) {
+		SoundcloudUploader *soundcloud_uploader = new SoundcloudUploader;
+		std::string token = soundcloud_uploader->Get_Auth_Token(soundcloud_username, soundcloud_password);
+		DEBUG_TRACE (DEBUG::Soundcloud, string_compose(
+					"uploading %1 - username=%2, password=%3, token=%4",
+					filename, soundcloud_username, soundcloud_password, token) );
+		std::string path = soundcloud_uploader->Upload (
+				filename,
+				PBD::basename_nosuffix(filename), // title
+				token,
+				soundcloud_make_public,
+				soundcloud_downloadable,
+				this);
+
+		if (path.length() != 0) {
+			info << string_compose ( _("File %1 uploaded to %2"), filename, path) << endmsg;
+			if (soundcloud_open_page) {
+				DEBUG_TRACE (DEBUG::Soundcloud, string_compose ("opening %1", path) );
+				open_uri(path.c_str());  // open the soundcloud website to the new file
 			}
-			delete soundcloud_uploader;
+		} else {
+			error << _("upload to Soundcloud failed. Perhaps your email or password are incorrect?\n") << endmsg;
 		}
-		config_map.erase (config_map.begin());
+		delete soundcloud_uploader;
 	}
+}
+
+/*** Offline stem export ***/
+
+/** @return a copy of \a channel_config which reads track playlists, or null
+ * if any of its channels needs the engine (busses, track processing, input
+ * monitoring..)
+ */
+ExportChannelConfigPtr
+ExportHandler::offline_channel_config (ExportChannelConfigPtr channel_config)
+{
+	ExportChannelConfiguration::ChannelList const & channels = channel_config->get_channels ();
+
+	if (channels.empty () || channel_config->region_processing_type () != RegionExportChannelFactory::None) {
+		return ExportChannelConfigPtr ();
+	}
+
+	ExportChannelConfigPtr offline_config = add_channel_config ();
+
+	for (ExportChannelConfiguration::ChannelList::const_iterator it = channels.begin(); it != channels.end(); ++it) {
+		RouteExportChannel const * rec = dynamic_cast<RouteExportChannel const *> (it->get ());
+		if (!rec) {
+			return ExportChannelConfigPtr ();
+		}
+		boost::shared_ptr<AudioPlaylist> playlist = PlaylistExportChannel::disk_only_playlist (rec->route ());
+		if (!playlist) {
+			return ExportChannelConfigPtr ();
+		}
+		offline_config->register_channel (ExportChannelPtr (new PlaylistExportChannel (playlist, rec->channel_index (), current_timespan->get_start ())));
+	}
+
+	offline_config->set_name (channel_config->name ());
+	offline_config->set_split (channel_config->get_split ());
+
+	return offline_config;
+}
+
+/** Render all stems of the current timespan that do not need the engine,
+ * in background threads.
+ * @return true if there are any, start_timespan() is called again when they are done.
+ */
+bool
+ExportHandler::start_offline_stems ()
+{
+	offline_stems.clear ();
+
+	for (ConfigMap::iterator it = timespan_bounds.first; it != timespan_bounds.second; ++it) {
+		FileSpec spec (it->second);
+		spec.filename->set_timespan (it->first);
+		if ((spec.channel_config = offline_channel_config (spec.channel_config))) {
+			offline_stems.push_back (OfflineStem (it, spec));
+		}
+	}
+
+	if (offline_stems.empty ()) {
+		return false;
+	}
+
+	session.start_offline_export ();
+
+	export_status->active_job = ExportStatus::Exporting;
+	offline_next     = 0;
+	offline_progress = 0;
+	offline_base     = export_status->processed_samples;
+
+	/* hold a reference, the session drops the handler when the export is aborted */
+	boost::shared_ptr<ExportHandler>* self = new boost::shared_ptr<ExportHandler> (shared_from_this ());
 
-	/* finish timespan is called in freewheeling rt-context,
-	 * we cannot start a new export from here */
-	assert (AudioEngine::instance()->freewheeling ());
 	pthread_t tid;
-	pthread_create (&tid, NULL, ExportHandler::start_timespan_bg, this);
+	if (pbd_pthread_create (PBD_RT_STACKSIZE_HELP, &tid, ExportHandler::render_offline_stems_bg, self)) {
+		delete self;
+		offline_stems.clear ();
+		return false;
+	}
 	pthread_detach (tid);
+	return true;
+}
+
+void*
+ExportHandler::render_offline_stems_bg (void* arg)
+{
+	pthread_set_name ("ExportStems");
+	Temporal::TempoMap::fetch ();
+
+	boost::shared_ptr<ExportHandler>* sp = static_cast<boost::shared_ptr<ExportHandler>*> (arg);
+	boost::shared_ptr<ExportHandler> self (*sp);
+	delete sp;
+
+	self->render_offline_stems ();
+
+	Glib::Threads::Mutex::Lock l (self->export_status->lock());
+	if (self->export_status->running ()) {
+		self->finish_offline_stems ();
+		self->start_timespan ();
+	}
+	return 0;
+}
+
+void*
+ExportHandler::offline_stem_worker (void* arg)
+{
+	pthread_set_name ("ExportStemWorker");
+	Temporal::TempoMap::fetch ();
+
+	ExportHandler* self = static_cast<ExportHandler*> (arg);
+	for (size_t i = self->offline_next++; i < self->offline_stems.size (); i = self->offline_next++) {
+		if (self->export_status->aborted ()) {
+			break;
+		}
+		self->render_offline_stem (self->offline_stems[i]);
+	}
+	--self->offline_running;
+	return 0;
+}
+
+void
+ExportHandler::render_offline_stems ()
+{
+	size_t const n_threads = std::min<size_t> (offline_stems.size (), std::max<uint32_t> (1, hardware_concurrency ()));
+
+	std::vector<pthread_t> threads;
+	offline_running = n_threads;
+
+	for (size_t i = 0; i < n_threads; ++i) {
+		pthread_t tid;
+		if (pbd_pthread_create (PBD_RT_STACKSIZE_PROC, &tid, ExportHandler::offline_stem_worker, this)) {
+			offline_running -= n_threads - i;
+			break;
+		}
+		threads.push_back (tid);
+	}
+
+	if (threads.empty ()) {
+		offline_running = 1;
+		offline_stem_worker (this);
+	}
+
+	/* the workers only count, export_status is updated by this thread alone */
+	while (offline_running.load () > 0) {
+		publish_offline_progress ();
+		Glib::usleep (20000);
+	}
+	publish_offline_progress ();
+
+	for (std::vector<pthread_t>::const_iterator i = threads.begin (); i != threads.end (); ++i) {
+		pthread_join (*i, NULL);
+	}
+}
+
+void
+ExportHandler::publish_offline_progress ()
+{
+	/* progress of all stems, relative to one timespan */
+	samplecnt_t const done = offline_progress.load () / (samplecnt_t) offline_stems.size ();
+	export_status->processed_samples_current_timespan = done;
+	export_status->processed_samples = offline_base + done;
+}
+
+void
+ExportHandler::render_offline_stem (OfflineStem & stem)
+{
+	/* several stems are rendered at the same time,
+	 * each graph runs in a single thread.
+	 */
+	static const samplecnt_t block_size = 8192;
+
+	ExportGraphBuilder builder (session, block_size, false);
+
+	try {
+		builder.set_current_timespan (current_timespan);
+		builder.add_config (stem.spec, false);
+
+		samplepos_t const end = current_timespan->get_end ();
+
+		for (samplepos_t pos = current_timespan->get_start (); pos < end; ) {
+			if (export_status->aborted ()) {
+				builder.cleanup (true);
+				return;
+			}
+			samplecnt_t const n = std::min (block_size, end - pos);
+			builder.process (n, pos + n >= end);
+			pos += n;
+			offline_progress += n;
+		}
+
+		while (!builder.post_process ()) {
+			if (export_status->aborted ()) {
+				builder.cleanup (true);
+				return;
+			}
+		}
+
+		builder.get_analysis_results (stem.results);
+
+	} catch (std::exception & e) {
+		error << string_compose (_("Export ended unexpectedly: %1"), e.what()) << endmsg;
+		export_status->abort (true);
+		builder.cleanup (true);
+		return;
+	}
+
+	/* close the files */
+	builder.cleanup ();
+}
+
+/** Called with the export-status lock held, after all offline stems were rendered */
+void
+ExportHandler::finish_offline_stems ()
+{
+	for (std::vector<OfflineStem>::iterator i = offline_stems.begin (); i != offline_stems.end (); ++i) {
+		export_status->result_map.insert (i->results.begin (), i->results.end ());
+		finish_file (i->entry->second);
+		config_map.erase (i->entry);
+	}
+	offline_stems.clear ();
 }
 
 void
@@ -87,6 +87,7 @@
 #include "pbd/file_utils.h"
 #include "pbd/fpu.h"
 #include "pbd/id.h"
+#include "pbd/memory_account.h"
 #include "pbd/pbd.h"
 #include "pbd/strsplit.h"
 
@@ -102,6 +103,7 @@
 #include "ardour/audioplaylist.h"
 #include "ardour/audioregion.h"
 #include "ardour/buffer_manager.h"
+#include "ardour/capture_encoder.h"
 #include "ardour/control_protocol_manager.h"
 #include "ardour/directory_names.h"
 #include "ardour/event_type_map.h"
@@ -332,11 +334,21 @@ request_dma_latency ()
 	return true;
 }
 
+static void
+set_memory_budgets ()
+{
+	if (!PBD::MemoryAccount::set_budgets (Config->get_memory_budgets ())) {
+		error << string_compose (_("Cannot parse memory budgets \"%1\""), Config->get_memory_budgets ()) << endmsg;
+	}
+}
+
 static void
 config_changed (std::string what_changed)
 {
 	if (what_changed == "cpu-dma-latency") {
 		request_dma_latency ();
+	} else if (what_changed == "memory-budgets") {
+		set_memory_budgets ();
 	}
 }
 
@@ -621,8 +633,11 @@ ARDOUR::init (bool try_optimization, const char* localedir, bool with_gui)
 		request_dma_latency ();
 	}
 
+	set_memory_budgets ();
+
 	SourceFactory::init ();
 	Analyser::init ();
+	CaptureEncoder::init ();
 
 	/* singletons - first object is "it" */
 	(void)PluginManager::instance ();
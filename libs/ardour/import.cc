@@ -33,6 +33,7 @@
 #include <sys/stat.h>
 #include <time.h>
 #include <stdint.h>
+#include <list>
 
 #include <sndfile.h>
 #include <samplerate.h>
@@ -46,6 +47,8 @@
 
 #include "pbd/basename.h"
 #include "pbd/convert.h"
+#include "pbd/cpus.h"
+#include "pbd/pthread_utils.h"
 
 #include "evoral/SMF.h"
 
@@ -253,7 +256,7 @@ compose_status_message (const string& path,
 }
 
 static void
-write_audio_data_to_new_files (ImportableSource* source, ImportStatus& status,
+write_audio_data_to_new_files (ImportableSource* source, ImportStatus& status, volatile float& progress,
                                vector<boost::shared_ptr<Source> >& newfiles)
 {
 	const samplecnt_t nframes = ResampledImportableSource::blocksize;
@@ -275,7 +278,7 @@ write_audio_data_to_new_files (ImportableSource* source, ImportStatus& status,
 	boost::shared_ptr<AudioSource> s = boost::dynamic_pointer_cast<AudioSource> (newfiles[0]);
 	assert (s);
 
-	status.progress = 0.0f;
+	progress = 0.0f;
 	float progress_multiplier = 1;
 	float progress_base = 0;
 	const float progress_length = source->ratio() * source->length();
@@ -299,7 +302,7 @@ write_audio_data_to_new_files (ImportableSource* source, ImportStatus& status,
 			peak = compute_peak (data.get(), nread, peak);
 
 			read_count += nread / channels;
-			status.progress = 0.5 * read_count / progress_length;
+			progress = 0.5 * read_count / progress_length;
 		}
 
 		if (peak >= 1) {
@@ -358,7 +361,7 @@ write_audio_data_to_new_files (ImportableSource* source, ImportStatus& status,
 		}
 
 		read_count += nfread;
-		status.progress = progress_base + progress_multiplier * read_count / progress_length;
+		progress = progress_base + progress_multiplier * read_count / progress_length;
 	}
 }
 
@@ -500,6 +503,181 @@ write_midi_data_to_new_files (Evoral::SMF* source, ImportStatus& status,
 	}
 }
 
+namespace {
+
+/** An audio file which has been opened, and for which the new
+ * sources have been created, waiting to be written.
+ */
+struct ImportJob {
+	ImportJob () : progress (0), done (false) {}
+
+	string                              doing_what;
+	boost::shared_ptr<ImportableSource> source;
+	vector<boost::shared_ptr<Source> >  newfiles;
+	volatile float                      progress;
+	bool                                done;
+};
+
+/** Threads which write the data of several audio files at the same time.
+ *
+ * Files are opened and their sources created by the import thread, in
+ * order, so that file names are unique and the sources are added to the
+ * session in the same order as before. Only the decoding, resampling and
+ * writing is done by the workers. The import thread is the only one to
+ * update the ImportStatus, while it waits for the workers.
+ */
+class ImportWorkers
+{
+public:
+	ImportWorkers (ImportStatus& status, uint32_t n_threads)
+		: _status (status)
+		, _max_pending (2 * n_threads)
+		, _finished (0)
+		, _quit (false)
+	{
+		for (uint32_t i = 0; i < n_threads; ++i) {
+			pthread_t tid;
+			if (pbd_pthread_create (PBD_RT_STACKSIZE_HELP, &tid, &ImportWorkers::worker, this)) {
+				break;
+			}
+			_threads.push_back (tid);
+		}
+	}
+
+	~ImportWorkers ()
+	{
+		{
+			Glib::Threads::Mutex::Lock lm (_lock);
+			_quit = true;
+			_work.broadcast ();
+		}
+		for (vector<pthread_t>::const_iterator i = _threads.begin (); i != _threads.end (); ++i) {
+			pthread_join (*i, NULL);
+		}
+		for (list<ImportJob*>::const_iterator i = _active.begin (); i != _active.end (); ++i) {
+			delete *i;
+		}
+	}
+
+	/** Queue a file to be written, and take ownership of \p job.
+	 * This waits while there are too many files pending, to limit
+	 * the number of files which are open at the same time.
+	 * @return false if there are no workers, in which case the caller
+	 * keeps the job and should write the file itself.
+	 */
+	bool push (ImportJob* job)
+	{
+		if (_threads.empty ()) {
+			return false;
+		}
+
+		Glib::Threads::Mutex::Lock lm (_lock);
+		while (_active.size () >= _max_pending) {
+			wait_and_update_status ();
+		}
+		_active.push_back (job);
+		_queue.push_back (job);
+		_work.signal ();
+		update_status ();
+		return true;
+	}
+
+	/** Wait for all queued files to be written */
+	void wait ()
+	{
+		Glib::Threads::Mutex::Lock lm (_lock);
+		while (!_active.empty ()) {
+			wait_and_update_status ();
+		}
+	}
+
+private:
+	static void* worker (void* arg)
+	{
+		pthread_set_name ("ImportWorker");
+		/* like the import thread, sources may use the tempo map */
+		Temporal::TempoMap::fetch ();
+		static_cast<ImportWorkers*> (arg)->run ();
+		return 0;
+	}
+
+	void run ()
+	{
+		Glib::Threads::Mutex::Lock lm (_lock);
+
+		while (true) {
+			while (_queue.empty () && !_quit) {
+				_work.wait (_lock);
+			}
+			if (_queue.empty ()) {
+				return;
+			}
+
+			ImportJob* job = _queue.front ();
+			_queue.pop_front ();
+
+			lm.release ();
+			write_audio_data_to_new_files (job->source.get (), _status, job->progress, job->newfiles);
+			/* close the file we read from */
+			job->source.reset ();
+			lm.acquire ();
+
+			job->done = true;
+			++_finished;
+			_done.signal ();
+		}
+	}
+
+	/* called by the import thread with _lock held */
+	void wait_and_update_status ()
+	{
+		/* also wake up now and then to update the progress */
+		_done.wait_until (_lock, g_get_monotonic_time () + 100000);
+		update_status ();
+	}
+
+	/* called by the import thread with _lock held */
+	void update_status ()
+	{
+		float progress = 0;
+
+		for (list<ImportJob*>::iterator i = _active.begin (); i != _active.end (); ) {
+			if ((*i)->done) {
+				delete *i;
+				i = _active.erase (i);
+			} else {
+				progress += (*i)->progress;
+				++i;
+			}
+		}
+
+		_status.current += _finished;
+		_finished = 0;
+
+		/* the import window shows (current - 1 + progress) / total,
+		 * so this adds up the progress of all files being written.
+		 */
+		_status.progress = progress;
+
+		if (!_active.empty ()) {
+			_status.doing_what = _active.front ()->doing_what;
+		}
+	}
+
+	ImportStatus&        _status;
+	size_t               _max_pending;
+	Glib::Threads::Mutex _lock;
+	Glib::Threads::Cond  _work;
+	Glib::Threads::Cond  _done;
+	list<ImportJob*>     _queue;  // not yet started
+	list<ImportJob*>     _active; // not yet seen to be done, in order
+	uint32_t             _finished;
+	bool                 _quit;
+	vector<pthread_t>    _threads;
+};
+
+} // anonymous namespace
+
 static void
 remove_file_source (boost::shared_ptr<Source> source)
 {
@@ -601,13 +779,19 @@ Session::import_files (ImportStatus& status)
 	boost::shared_ptr<AudioFileSource> afs;
 	boost::shared_ptr<SMFSource> smfs;
 	uint32_t num_channels = 0;
-	vector<string> smf_names;
 
 	status.sources.clear ();
 
+	/* audio files are written several at a time, see ImportWorkers */
+	boost::scoped_ptr<ImportWorkers> workers;
+	if (status.paths.size () > 1) {
+		workers.reset (new ImportWorkers (status, std::min<size_t> (status.paths.size (), std::max<uint32_t> (1, hardware_concurrency ()))));
+	}
+
 	for (vector<string>::const_iterator p = status.paths.begin(); p != status.paths.end() && !status.cancel; ++p) {
 
 		boost::shared_ptr<ImportableSource> source;
+		vector<string> smf_names;
 
 		const DataType type = SMFSource::safe_midi_file_extension (*p) ? DataType::MIDI : DataType::AUDIO;
 		boost::scoped_ptr<Evoral::SMF> smf_reader;
@@ -618,8 +802,8 @@ Session::import_files (ImportStatus& status)
 				num_channels = source->channels();
 			} catch (const failed_constructor& err) {
 				error << string_compose(_("Import: cannot open input sound file \"%1\""), (*p)) << endmsg;
-				status.done = status.cancel = true;
-				return;
+				status.cancel = true;
+				break;
 			}
 
 		} else {
@@ -682,8 +866,8 @@ Session::import_files (ImportStatus& status)
 				}
 			} catch (...) {
 				error << _("Import: error opening MIDI file") << endmsg;
-				status.done = status.cancel = true;
-				return;
+				status.cancel = true;
+				break;
 			}
 		}
 
@@ -718,9 +902,21 @@ Session::import_files (ImportStatus& status)
 		}
 
 		if (source) { // audio
-			status.doing_what = compose_status_message (*p, source->samplerate(),
-			                                            sample_rate(), status.current, status.total);
-			write_audio_data_to_new_files (source.get(), status, newfiles);
+			ImportJob* job = new ImportJob;
+			/* with workers, status.current counts finished files */
+			job->doing_what = compose_status_message (*p, source->samplerate(), sample_rate(),
+			                                          (p - status.paths.begin ()) + 1, status.total);
+			job->source = source;
+			job->newfiles = newfiles;
+			source.reset ();
+
+			if (workers && workers->push (job)) {
+				continue;
+			}
+
+			status.doing_what = job->doing_what;
+			write_audio_data_to_new_files (job->source.get(), status, status.progress, newfiles);
+			delete job;
 		} else if (smf_reader) { // midi
 			status.doing_what = string_compose(_("Loading MIDI file %1"), *p);
 			write_midi_data_to_new_files (smf_reader.get(), status, newfiles, status.split_midi_channels);
@@ -730,6 +926,13 @@ Session::import_files (ImportStatus& status)
 		status.progress = 0;
 	}
 
+	if (workers) {
+		/* also after cancel or failure, before the files are removed */
+		workers->wait ();
+		workers.reset ();
+		status.progress = 0;
+	}
+
 	if (!status.cancel) {
 		struct tm* now;
 		time_t xnow;
@@ -477,7 +477,7 @@ no_audio_tracks:
 		midi_track->playlist ()->add_region (region, timepos_t (pos.sample), 1.0, false);
 
 		boost::shared_ptr<MidiRegion> mr = boost::dynamic_pointer_cast<MidiRegion>(region);
-		boost::shared_ptr<MidiModel> mm = mr->midi_source (0)->model ();
+		boost::shared_ptr<MidiModel> mm = mr->midi_source (0)->ensure_model ();
 		MidiModel::NoteDiffCommand *midicmd;
 		midicmd = mm->new_note_diff_command ("Import ProTools MIDI");
 
@@ -23,6 +23,7 @@
 #include "pbd/compose.h"
 #include "pbd/error.h"
 #include "pbd/failed_constructor.h"
+#include "pbd/memory_account.h"
 
 #include "ardour/analyser.h"
 #include "ardour/audioengine.h"
@@ -712,6 +713,30 @@ ARDOUR::LuaAPI::build_filename (lua_State *L)
 	return 1;
 }
 
+int
+ARDOUR::LuaAPI::memory_usage (lua_State *L)
+{
+	luabridge::LuaRef tbl (luabridge::newTable (L));
+
+	std::vector<PBD::MemoryAccount*> accounts (PBD::MemoryAccount::accounts ());
+	for (std::vector<PBD::MemoryAccount*>::const_iterator i = accounts.begin (); i != accounts.end (); ++i) {
+		luabridge::LuaRef a (luabridge::newTable (L));
+		a["used"]   = (*i)->used ();
+		a["peak"]   = (*i)->peak ();
+		a["budget"] = (*i)->budget ();
+		tbl[(*i)->name ()] = a;
+	}
+
+	luabridge::push (L, tbl);
+	return 1;
+}
+
+void
+ARDOUR::LuaAPI::set_memory_budget (std::string const& account, int64_t bytes)
+{
+	PBD::MemoryAccount::get (account).set_budget (bytes);
+}
+
 luabridge::LuaRef::Proxy&
 luabridge::LuaRef::Proxy::clone_instance (const void* classkey, void* p) {
 	lua_rawgeti (m_L, LUA_REGISTRYINDEX, m_tableRef);
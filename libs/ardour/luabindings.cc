@@ -23,6 +23,7 @@
 #include <glibmm.h>
 
 #include "pbd/stateful_diff_command.h"
+#include "pbd/memory_account.h"
 #include "pbd/openuri.h"
 
 #include "temporal/bbt_time.h"
@@ -2046,6 +2047,7 @@ LuaBindings::common (lua_State* L)
 
 		.beginNamespace ("SrcQuality")
 		.addConst ("SrcBest", ARDOUR::SrcQuality(SrcBest))
+		.addConst ("SrcPolyphaseBest", ARDOUR::SrcQuality(SrcPolyphaseBest))
 		.endNamespace ()
 
 		.beginNamespace ("MeterType")
@@ -2648,6 +2650,9 @@ LuaBindings::common (lua_State* L)
 		.addFunction ("path_get_basename", Glib::path_get_basename)
 		.addFunction ("monotonic_time", ::g_get_monotonic_time)
 		.addCFunction ("build_filename", ARDOUR::LuaAPI::build_filename)
+		.addCFunction ("memory_usage", ARDOUR::LuaAPI::memory_usage)
+		.addFunction ("set_memory_budget", ARDOUR::LuaAPI::set_memory_budget)
+		.addFunction ("memory_report", PBD::MemoryAccount::report)
 		.addFunction ("new_noteptr", ARDOUR::LuaAPI::new_noteptr)
 		.addFunction ("note_list", ARDOUR::LuaAPI::note_list)
 		.addCFunction ("sample_to_timecode", ARDOUR::LuaAPI::sample_to_timecode)
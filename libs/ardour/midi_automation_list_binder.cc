@@ -52,7 +52,7 @@ MidiAutomationListBinder::MidiAutomationListBinder (XMLNode* node, Session::Sour
 void
 MidiAutomationListBinder::set_state (XMLNode const & node, int version) const
 {
-	boost::shared_ptr<MidiModel> model = _source->model ();
+	boost::shared_ptr<MidiModel> model = _source->ensure_model ();
 	assert (model);
 
 	boost::shared_ptr<AutomationControl> control = model->automation_control (_parameter);
@@ -64,7 +64,7 @@ MidiAutomationListBinder::set_state (XMLNode const & node, int version) const
 XMLNode&
 MidiAutomationListBinder::get_state () const
 {
-	boost::shared_ptr<MidiModel> model = _source->model ();
+	boost::shared_ptr<MidiModel> model = _source->ensure_model ();
 	assert (model);
 
 	boost::shared_ptr<AutomationControl> control = model->automation_control (_parameter);
@@ -76,7 +76,7 @@ MidiAutomationListBinder::get_state () const
 std::string
 MidiAutomationListBinder::type_name() const
 {
-	boost::shared_ptr<MidiModel> model = _source->model ();
+	boost::shared_ptr<MidiModel> model = _source->ensure_model ();
 	assert (model);
 
 	boost::shared_ptr<AutomationControl> control = model->automation_control (_parameter);
@@ -29,9 +29,12 @@
 #include <stdexcept>
 #include <stdint.h>
 
+#include <glib.h>
+
 #include "pbd/compose.h"
 #include "pbd/enumwriter.h"
 #include "pbd/error.h"
+#include "pbd/memory_account.h"
 
 #include "evoral/Control.h"
 
@@ -60,8 +63,55 @@ using namespace PBD;
 
 MidiModel::MidiModel (boost::shared_ptr<MidiSource> s)
 	: AutomatableSequence<TimeType> (s->session(), Temporal::BeatTime)
+	, _memory_accounted (0)
 {
 	set_midi_source (s);
+	ContentsChanged.connect_same_thread (_memory_connection, boost::bind (&MidiModel::update_memory_account, this));
+}
+
+MidiModel::~MidiModel ()
+{
+	PBD::MemoryAccount::get (X_("midi")).remove (_memory_accounted);
+}
+
+size_t
+MidiModel::memory_used () const
+{
+	/* Every note, sysex and patch change is a separately allocated,
+	 * reference counted object (a note also owns two events with heap
+	 * allocated buffers) held by one or two ordered containers. The
+	 * per-object overhead below is a rough but stable estimate.
+	 */
+	size_t const node = 48;
+	size_t const note = sizeof (Evoral::Note<TimeType>) + 2 * 16 + 32 + 2 * node;
+	size_t const event = sizeof (Evoral::Event<TimeType>) + 32 + node;
+	size_t const patch = sizeof (Evoral::PatchChange<TimeType>) + 32 + node;
+	size_t const control = sizeof (Evoral::ControlEvent) + node;
+
+	ReadLock lock (read_lock ());
+
+	size_t bytes = notes().size() * note;
+
+	bytes += sysexes().size() * event + sysex_bytes();
+	bytes += patch_changes().size() * patch;
+
+	Glib::Threads::Mutex::Lock lm (_control_lock);
+
+	for (Controls::const_iterator i = controls().begin(); i != controls().end(); ++i) {
+		if (i->second->list()) {
+			bytes += i->second->list()->events().size() * control;
+		}
+	}
+
+	return bytes;
+}
+
+void
+MidiModel::update_memory_account ()
+{
+	size_t const bytes = memory_used ();
+	PBD::MemoryAccount::get (X_("midi")).change (_memory_accounted, bytes);
+	_memory_accounted = bytes;
 }
 
 MidiModel::NoteDiffCommand*
@@ -131,6 +181,174 @@ MidiModel::DiffCommand::DiffCommand(boost::shared_ptr<MidiModel> m, const std::s
 	assert(_model);
 }
 
+/* packed changes are saved as fixed size little-endian records:
+ * 4 bytes ID, 1 byte property, 8 bytes old value, 8 bytes new value.
+ */
+static const size_t packed_change_size = 21;
+
+static inline void
+put_le (uint8_t*& p, uint64_t v, size_t n)
+{
+	for (size_t i = 0; i < n; ++i) {
+		*p++ = (v >> (8 * i)) & 0xff;
+	}
+}
+
+static inline uint64_t
+get_le (uint8_t const *& p, size_t n)
+{
+	uint64_t v = 0;
+	for (size_t i = 0; i < n; ++i) {
+		v |= (uint64_t) *p++ << (8 * i);
+	}
+	return v;
+}
+
+void
+MidiModel::DiffCommand::pack_changes (XMLNode& node, PackedChanges const & changes)
+{
+	node.set_property (X_("packed"), (uint32_t) changes.size ());
+
+	if (changes.empty ()) {
+		return;
+	}
+
+	std::vector<uint8_t> buf (changes.size () * packed_change_size);
+	uint8_t* p = &buf[0];
+
+	for (PackedChanges::const_iterator c = changes.begin (); c != changes.end (); ++c) {
+		put_le (p, (uint32_t) c->id, 4);
+		put_le (p, c->property, 1);
+		put_le (p, (uint64_t) c->old_value, 8);
+		put_le (p, (uint64_t) c->new_value, 8);
+	}
+
+	gchar* b64 = g_base64_encode (&buf[0], buf.size ());
+	node.add_content (b64);
+	g_free (b64);
+}
+
+bool
+MidiModel::DiffCommand::unpack_changes (XMLNode const & node, PackedChanges& changes)
+{
+	uint32_t n;
+
+	if (!node.get_property (X_("packed"), n)) {
+		return false;
+	}
+
+	changes.clear ();
+	changes.reserve (n);
+
+	for (XMLNodeList::const_iterator i = node.children ().begin (); i != node.children ().end (); ++i) {
+		if (!(*i)->is_content ()) {
+			continue;
+		}
+
+		gsize size;
+		guchar* buf = g_base64_decode ((*i)->content ().c_str (), &size);
+		uint8_t const * p = buf;
+
+		for (gsize off = 0; off + packed_change_size <= size; off += packed_change_size) {
+			PackedChange c;
+			c.id        = (int32_t) get_le (p, 4);
+			c.property  = get_le (p, 1);
+			c.old_value = (int64_t) get_le (p, 8);
+			c.new_value = (int64_t) get_le (p, 8);
+			changes.push_back (c);
+		}
+
+		g_free (buf);
+	}
+
+	if (changes.size () != n) {
+		warning << string_compose (_("MIDI edit history holds %1 changes instead of %2"), changes.size (), n) << endmsg;
+	}
+
+	return true;
+}
+
+void
+MidiModel::DiffCommand::report_missing (size_t n_missing) const
+{
+	if (n_missing) {
+		error << string_compose (_("MIDI edit \"%1\": %2 changes refer to events which do not exist, they were not applied"), _name, n_missing) << endmsg;
+	}
+}
+
+namespace {
+
+/** Look up the objects (notes, sys-exes or patch changes) that a list of
+ * packed changes refers to.
+ *
+ * The IDs are collected and sorted once, then candidate objects are matched
+ * against them with a binary search, so finding the targets of N changes
+ * costs O((N + M) log N) for M candidates instead of a linear search of the
+ * model per change.
+ */
+template<typename Ptr>
+class ChangeTargets {
+public:
+	ChangeTargets (MidiModel::DiffCommand::PackedChanges const & changes)
+	{
+		_index.reserve (changes.size ());
+
+		for (MidiModel::DiffCommand::PackedChanges::const_iterator c = changes.begin (); c != changes.end (); ++c) {
+			_index.push_back (make_pair (c->id, Ptr ()));
+		}
+
+		sort (_index.begin (), _index.end (), id_less);
+		_index.erase (unique (_index.begin (), _index.end (), id_equal), _index.end ());
+		_missing = _index.size ();
+	}
+
+	/** Match the objects in [@param b, @param e) against the IDs; for each ID
+	 * the first matching object is used.
+	 */
+	template<typename Iter>
+	void add (Iter b, Iter e)
+	{
+		for (; b != e && _missing; ++b) {
+			typename Index::iterator i = lower_bound (_index.begin (), _index.end (), Entry ((*b)->id (), Ptr ()), id_less);
+			if (i != _index.end () && i->first == (*b)->id () && !i->second) {
+				i->second = *b;
+				--_missing;
+			}
+		}
+	}
+
+	Ptr find (Evoral::event_id_t id) const
+	{
+		typename Index::const_iterator i = lower_bound (_index.begin (), _index.end (), Entry (id, Ptr ()), id_less);
+		if (i != _index.end () && i->first == id) {
+			return i->second;
+		}
+		return Ptr ();
+	}
+
+	void find_all (MidiModel::DiffCommand::PackedChanges const & changes, std::vector<Ptr>& targets) const
+	{
+		targets.clear ();
+		targets.reserve (changes.size ());
+
+		for (MidiModel::DiffCommand::PackedChanges::const_iterator c = changes.begin (); c != changes.end (); ++c) {
+			targets.push_back (find (c->id));
+		}
+	}
+
+private:
+	typedef std::pair<Evoral::event_id_t, Ptr> Entry;
+	typedef std::vector<Entry>                 Index;
+
+	static bool id_less (Entry const & a, Entry const & b) { return a.first < b.first; }
+	static bool id_equal (Entry const & a, Entry const & b) { return a.first == b.first; }
+
+	Index  _index;
+	size_t _missing;
+};
+
+} /* anonymous namespace */
+
 MidiModel::NoteDiffCommand::NoteDiffCommand (boost::shared_ptr<MidiModel> m, const XMLNode& node)
 	: DiffCommand (m, "")
 {
@@ -193,6 +411,44 @@ MidiModel::NoteDiffCommand::value_type(Property prop)
 	return Variant::NOTHING;
 }
 
+int64_t
+MidiModel::NoteDiffCommand::pack_value (Property prop, const Variant& value)
+{
+	switch (prop) {
+	case StartTime:
+	case Length:
+		return value.get_beats().to_ticks();
+	case NoteNumber:
+	case Velocity:
+	case Channel:
+		break;
+	}
+
+	return value.get_int();
+}
+
+void
+MidiModel::NoteDiffCommand::set_value (const NotePtr note, Property prop, int64_t value)
+{
+	switch (prop) {
+	case NoteNumber:
+		note->set_note (value);
+		break;
+	case Velocity:
+		note->set_velocity (value);
+		break;
+	case Channel:
+		note->set_channel (value);
+		break;
+	case StartTime:
+		note->set_time (TimeType::ticks (value));
+		break;
+	case Length:
+		note->set_length (TimeType::ticks (value));
+		break;
+	}
+}
+
 void
 MidiModel::NoteDiffCommand::change (const NotePtr  note,
                                     Property       prop,
@@ -200,17 +456,32 @@ MidiModel::NoteDiffCommand::change (const NotePtr  note,
 {
 	assert (note);
 
-	const NoteChange change = {
-		prop, note, 0, get_value(note, prop), new_value
+	const PackedChange change = {
+		note->id(), (uint8_t) prop, pack_value (prop, get_value (note, prop)), pack_value (prop, new_value)
 	};
 
-	if (change.old_value == new_value) {
+	if (change.old_value == change.new_value) {
 		return;
 	}
 
 	_changes.push_back (change);
 }
 
+void
+MidiModel::NoteDiffCommand::find_notes (std::vector<NotePtr>& notes) const
+{
+	ChangeTargets<NotePtr> targets (_changes);
+
+	/* a changed note is either in the model or on one of our own lists */
+
+	targets.add (_removed_notes.begin(), _removed_notes.end());
+	targets.add (_added_notes.begin(), _added_notes.end());
+	targets.add (side_effect_removals.begin(), side_effect_removals.end());
+	targets.add (_model->notes().begin(), _model->notes().end());
+
+	targets.find_all (_changes, notes);
+}
+
 MidiModel::NoteDiffCommand &
 MidiModel::NoteDiffCommand::operator+= (const NoteDiffCommand& other)
 {
@@ -230,6 +501,20 @@ MidiModel::NoteDiffCommand::operator+= (const NoteDiffCommand& other)
 	return *this;
 }
 
+size_t
+MidiModel::NoteDiffCommand::memory_used () const
+{
+	/* added notes are shared with the model, removed ones are only kept
+	 * alive by this command.
+	 */
+	size_t const node = 2 * sizeof (void*) + sizeof (NotePtr);
+
+	return Command::memory_used ()
+		+ _changes.capacity () * sizeof (PackedChange)
+		+ (_added_notes.size () + _removed_notes.size () + side_effect_removals.size ()) * node
+		+ _removed_notes.size () * (sizeof (Evoral::Note<TimeType>) + 64);
+}
+
 void
 MidiModel::NoteDiffCommand::operator() ()
 {
@@ -252,56 +537,42 @@ MidiModel::NoteDiffCommand::operator() ()
 		/* notes we modify in a way that requires remove-then-add to maintain ordering */
 		set<NotePtr> temporary_removals;
 
-		for (ChangeList::iterator i = _changes.begin(); i != _changes.end(); ++i) {
-			Property prop = i->property;
+		vector<NotePtr> notes;
+		find_notes (notes);
+		size_t missing = 0;
 
-			if (!i->note) {
-				/* note found during deserialization, so try
-				   again now that the model state is different.
-				*/
-				i->note = _model->find_note (i->note_id);
-				assert (i->note);
+		for (size_t n = 0; n < _changes.size(); ++n) {
+			Property const prop = (Property) _changes[n].property;
+			NotePtr const  note = notes[n];
+
+			if (!note) {
+				++missing;
+				continue;
 			}
 
 			switch (prop) {
 			case NoteNumber:
-				if (temporary_removals.find (i->note) == temporary_removals.end()) {
-					_model->remove_note_unlocked (i->note);
-					temporary_removals.insert (i->note);
-				}
-				i->note->set_note (i->new_value.get_int());
-				break;
-
 			case StartTime:
-				if (temporary_removals.find (i->note) == temporary_removals.end()) {
-					_model->remove_note_unlocked (i->note);
-					temporary_removals.insert (i->note);
-				}
-				i->note->set_time (i->new_value.get_beats());
-				break;
-
 			case Channel:
-				if (temporary_removals.find (i->note) == temporary_removals.end()) {
-					_model->remove_note_unlocked (i->note);
-					temporary_removals.insert (i->note);
+				if (temporary_removals.find (note) == temporary_removals.end()) {
+					_model->remove_note_unlocked (note);
+					temporary_removals.insert (note);
 				}
-				i->note->set_channel (i->new_value.get_int());
 				break;
 
 				/* no remove-then-add required for these properties, since we do not index them
 				 */
 
 			case Velocity:
-				i->note->set_velocity (i->new_value.get_int());
-				break;
-
 			case Length:
-				i->note->set_length (i->new_value.get_beats());
 				break;
-
 			}
+
+			set_value (note, prop, _changes[n].new_value);
 		}
 
+		report_missing (missing);
+
 		for (set<NotePtr>::iterator i = temporary_removals.begin(); i != temporary_removals.end(); ++i) {
 			NoteDiffCommand side_effects (model(), "side effects");
 			if (_model->add_note_unlocked (*i, &side_effects)) {
@@ -348,24 +619,29 @@ MidiModel::NoteDiffCommand::undo ()
 		set<NotePtr> temporary_removals;
 
 
-		/* lazily discover any affected notes that were not discovered when
-		 * loading the history because of deletions, etc.
+		/* look up the affected notes; when loading history they may not
+		 * have existed yet because of deletions, etc.
 		 */
 
-		for (ChangeList::iterator i = _changes.begin(); i != _changes.end(); ++i) {
-			if (!i->note) {
-				i->note = _model->find_note (i->note_id);
-				assert (i->note);
-			}
-		}
+		vector<NotePtr> notes;
+		find_notes (notes);
+		size_t missing = 0;
+
+		for (size_t n = 0; n < _changes.size(); ++n) {
+			Property const prop = (Property) _changes[n].property;
+			NotePtr const  note = notes[n];
 
-		for (ChangeList::iterator i = _changes.begin(); i != _changes.end(); ++i) {
-			Property prop = i->property;
+			if (!note) {
+				++missing;
+				continue;
+			}
 
 			switch (prop) {
 			case NoteNumber:
-				if (temporary_removals.find (i->note) == temporary_removals.end() &&
-				    find (_removed_notes.begin(), _removed_notes.end(), i->note) == _removed_notes.end()) {
+			case StartTime:
+			case Channel:
+				if (temporary_removals.find (note) == temporary_removals.end() &&
+				    find (_removed_notes.begin(), _removed_notes.end(), note) == _removed_notes.end()) {
 
 					/* We only need to mark this note for re-add if (a) we haven't
 					   already marked it and (b) it isn't on the _removed_notes
@@ -373,49 +649,24 @@ MidiModel::NoteDiffCommand::undo ()
 					   will be re-added anyway)
 					*/
 
-					_model->remove_note_unlocked (i->note);
-					temporary_removals.insert (i->note);
-				}
-				i->note->set_note (i->old_value.get_int());
-				break;
-
-			case StartTime:
-				if (temporary_removals.find (i->note) == temporary_removals.end() &&
-				    find (_removed_notes.begin(), _removed_notes.end(), i->note) == _removed_notes.end()) {
-
-					/* See above ... */
-
-					_model->remove_note_unlocked (i->note);
-					temporary_removals.insert (i->note);
-				}
-				i->note->set_time (i->old_value.get_beats());
-				break;
-
-			case Channel:
-				if (temporary_removals.find (i->note) == temporary_removals.end() &&
-				    find (_removed_notes.begin(), _removed_notes.end(), i->note) == _removed_notes.end()) {
-
-					/* See above ... */
-
-					_model->remove_note_unlocked (i->note);
-					temporary_removals.insert (i->note);
+					_model->remove_note_unlocked (note);
+					temporary_removals.insert (note);
 				}
-				i->note->set_channel (i->old_value.get_int());
 				break;
 
 				/* no remove-then-add required for these properties, since we do not index them
 				 */
 
 			case Velocity:
-				i->note->set_velocity (i->old_value.get_int());
-				break;
-
 			case Length:
-				i->note->set_length (i->old_value.get_beats());
 				break;
 			}
+
+			set_value (note, prop, _changes[n].old_value);
 		}
 
+		report_missing (missing);
+
 		for (NoteList::iterator i = _removed_notes.begin(); i != _removed_notes.end(); ++i) {
 			_model->add_note_unlocked(*i);
 		}
@@ -491,50 +742,20 @@ MidiModel::NoteDiffCommand::unmarshal_note (XMLNode *xml_note)
 	return note_ptr;
 }
 
-XMLNode&
-MidiModel::NoteDiffCommand::marshal_change (const NoteChange& change)
-{
-	XMLNode* xml_change = new XMLNode("Change");
-
-	/* first, the change itself */
-
-	xml_change->set_property ("property", change.property);
-
-	if (change.property == StartTime || change.property == Length) {
-		xml_change->set_property ("old", change.old_value.get_beats ());
-	} else {
-		xml_change->set_property ("old", change.old_value.get_int ());
-	}
-
-	if (change.property == StartTime || change.property == Length) {
-		xml_change->set_property ("new", change.new_value.get_beats ());
-	} else {
-		xml_change->set_property ("new", change.new_value.get_int ());
-	}
-
-	if (change.note) {
-		xml_change->set_property ("id", change.note->id());
-	} else if (change.note_id) {
-		warning << _("Change has no note, using note ID") << endmsg;
-		xml_change->set_property ("id", change.note_id);
-	} else {
-		error << _("Change has no note or note ID") << endmsg;
-	}
-
-	return *xml_change;
-}
-
-MidiModel::NoteDiffCommand::NoteChange
+/** Read a change as saved by older versions, one XML node per change */
+MidiModel::DiffCommand::PackedChange
 MidiModel::NoteDiffCommand::unmarshal_change (XMLNode *xml_change)
 {
-	NoteChange change;
-	change.note_id = 0;
+	PackedChange change = { -1, 0, 0, 0 };
+	Property     prop;
 
-	if (!xml_change->get_property("property", change.property)) {
+	if (!xml_change->get_property("property", prop)) {
 		fatal << "!!!" << endmsg;
 		abort(); /*NOTREACHED*/
 	}
 
+	change.property = prop;
+
 	int note_id;
 	if (!xml_change->get_property ("id", note_id)) {
 		error << _("No NoteID found for note property change - ignored") << endmsg;
@@ -543,9 +764,9 @@ MidiModel::NoteDiffCommand::unmarshal_change (XMLNode *xml_change)
 
 	int old_val;
 	Temporal::Beats old_time;
-	if ((change.property == StartTime || change.property == Length) &&
+	if ((prop == StartTime || prop == Length) &&
 	    xml_change->get_property ("old", old_time)) {
-		change.old_value = old_time;
+		change.old_value = old_time.to_ticks();
 	} else if (xml_change->get_property ("old", old_val)) {
 		change.old_value = old_val;
 	} else {
@@ -555,9 +776,9 @@ MidiModel::NoteDiffCommand::unmarshal_change (XMLNode *xml_change)
 
 	int new_val;
 	Temporal::Beats new_time;
-	if ((change.property == StartTime || change.property == Length) &&
+	if ((prop == StartTime || prop == Length) &&
 	    xml_change->get_property ("new", new_time)) {
-		change.new_value = new_time;
+		change.new_value = new_time.to_ticks();
 	} else if (xml_change->get_property ("new", new_val)) {
 		change.new_value = new_val;
 	} else {
@@ -565,14 +786,11 @@ MidiModel::NoteDiffCommand::unmarshal_change (XMLNode *xml_change)
 		abort(); /*NOTREACHED*/
 	}
 
-	/* we must point at the instance of the note that is actually in the model.
-	   so go look for it ... it may not be there (it could have been
-	   deleted in a later operation, so store the note id so that we can
-	   look it up again later).
+	/* the note is looked up when the command is (un)done, it may not be
+	   in the model yet (or anymore).
 	*/
 
-	change.note = _model->find_note (note_id);
-	change.note_id = note_id;
+	change.id = note_id;
 
 	return change;
 }
@@ -612,11 +830,14 @@ MidiModel::NoteDiffCommand::set_state (const XMLNode& diff_command, int /*versio
 
 	XMLNode* changed_notes = diff_command.child(DIFF_NOTES_ELEMENT);
 
-	if (changed_notes) {
+	if (changed_notes && !unpack_changes (*changed_notes, _changes)) {
 		XMLNodeList notes = changed_notes->children();
-		transform (notes.begin(), notes.end(), back_inserter(_changes),
-		           boost::bind (&NoteDiffCommand::unmarshal_change, this, _1));
-
+		for (XMLNodeList::iterator n = notes.begin(); n != notes.end(); ++n) {
+			PackedChange const change = unmarshal_change (*n);
+			if (change.id >= 0) {
+				_changes.push_back (change);
+			}
+		}
 	}
 
 	/* side effect removals caused by changes */
@@ -642,10 +863,7 @@ MidiModel::NoteDiffCommand::get_state ()
 	diff_command->set_property("midi-source", _model->midi_source()->id().to_s());
 
 	XMLNode* changes = diff_command->add_child(DIFF_NOTES_ELEMENT);
-	for_each(_changes.begin(), _changes.end(),
-	         boost::bind (
-		         boost::bind (&XMLNode::add_child_nocopy, changes, _1),
-		         boost::bind (&NoteDiffCommand::marshal_change, this, _1)));
+	pack_changes (*changes, _changes);
 
 	XMLNode* added_notes = diff_command->add_child(ADDED_NOTES_ELEMENT);
 	for_each(_added_notes.begin(), _added_notes.end(),
@@ -683,16 +901,24 @@ MidiModel::SysExDiffCommand::SysExDiffCommand (boost::shared_ptr<MidiModel> m, c
 void
 MidiModel::SysExDiffCommand::change (boost::shared_ptr<Evoral::Event<TimeType> > s, TimeType new_time)
 {
-	Change change;
-
-	change.sysex = s;
-	change.property = Time;
-	change.old_time = s->time ();
-	change.new_time = new_time;
+	const PackedChange change = {
+		s->id (), Time, s->time ().to_ticks (), new_time.to_ticks ()
+	};
 
 	_changes.push_back (change);
 }
 
+void
+MidiModel::SysExDiffCommand::find_sysexes (std::vector<SysExPtr>& sysexes) const
+{
+	ChangeTargets<SysExPtr> targets (_changes);
+
+	targets.add (_removed.begin(), _removed.end());
+	targets.add (_model->sysexes().begin(), _model->sysexes().end());
+
+	targets.find_all (_changes, sysexes);
+}
+
 void
 MidiModel::SysExDiffCommand::operator() ()
 {
@@ -703,21 +929,24 @@ MidiModel::SysExDiffCommand::operator() ()
 			_model->remove_sysex_unlocked (*i);
 		}
 
-		/* find any sysex events that were missing when unmarshalling */
+		vector<SysExPtr> sysexes;
+		find_sysexes (sysexes);
+		size_t missing = 0;
 
-		for (ChangeList::iterator i = _changes.begin(); i != _changes.end(); ++i) {
-			if (!i->sysex) {
-				i->sysex = _model->find_sysex (i->sysex_id);
-				assert (i->sysex);
+		for (size_t n = 0; n < _changes.size(); ++n) {
+			if (!sysexes[n]) {
+				++missing;
+				continue;
 			}
-		}
 
-		for (ChangeList::iterator i = _changes.begin(); i != _changes.end(); ++i) {
-			switch (i->property) {
+			switch ((Property) _changes[n].property) {
 			case Time:
-				i->sysex->set_time (i->new_time);
+				sysexes[n]->set_time (TimeType::ticks (_changes[n].new_value));
+				break;
 			}
 		}
+
+		report_missing (missing);
 	}
 
 	_model->ContentsChanged (); /* EMIT SIGNAL */
@@ -733,23 +962,25 @@ MidiModel::SysExDiffCommand::undo ()
 			_model->add_sysex_unlocked (*i);
 		}
 
-		/* find any sysex events that were missing when unmarshalling */
+		vector<SysExPtr> sysexes;
+		find_sysexes (sysexes);
+		size_t missing = 0;
 
-		for (ChangeList::iterator i = _changes.begin(); i != _changes.end(); ++i) {
-			if (!i->sysex) {
-				i->sysex = _model->find_sysex (i->sysex_id);
-				assert (i->sysex);
+		for (size_t n = 0; n < _changes.size(); ++n) {
+			if (!sysexes[n]) {
+				++missing;
+				continue;
 			}
-		}
 
-		for (ChangeList::iterator i = _changes.begin(); i != _changes.end(); ++i) {
-			switch (i->property) {
+			switch ((Property) _changes[n].property) {
 			case Time:
-				i->sysex->set_time (i->old_time);
+				sysexes[n]->set_time (TimeType::ticks (_changes[n].old_value));
 				break;
 			}
 		}
 
+		report_missing (missing);
+
 	}
 
 	_model->ContentsChanged(); /* EMIT SIGNAL */
@@ -761,53 +992,41 @@ MidiModel::SysExDiffCommand::remove (SysExPtr sysex)
 	_removed.push_back(sysex);
 }
 
-XMLNode&
-MidiModel::SysExDiffCommand::marshal_change (const Change& change)
-{
-	XMLNode* xml_change = new XMLNode ("Change");
-
-	/* first, the change itself */
-
-	xml_change->set_property ("property", change.property);
-	xml_change->set_property ("old", change.old_time);
-	xml_change->set_property ("new", change.new_time);
-	xml_change->set_property ("id", change.sysex->id());
-
-	return *xml_change;
-}
-
-MidiModel::SysExDiffCommand::Change
+/** Read a change as saved by older versions, one XML node per change */
+MidiModel::DiffCommand::PackedChange
 MidiModel::SysExDiffCommand::unmarshal_change (XMLNode *xml_change)
 {
-	Change change;
+	PackedChange change = { -1, 0, 0, 0 };
+	Property     prop;
 
-	if (!xml_change->get_property ("property", change.property)) {
+	if (!xml_change->get_property ("property", prop)) {
 		fatal << "!!!" << endmsg;
 		abort(); /*NOTREACHED*/
 	}
 
+	change.property = prop;
+
 	int sysex_id;
 	if (!xml_change->get_property ("id", sysex_id)) {
 		error << _("No SysExID found for sys-ex property change - ignored") << endmsg;
 		return change;
 	}
 
-	if (!xml_change->get_property ("old", change.old_time)) {
+	TimeType old_time;
+	if (!xml_change->get_property ("old", old_time)) {
 		fatal << "!!!" << endmsg;
 		abort(); /*NOTREACHED*/
 	}
 
-	if (!xml_change->get_property ("new", change.new_time)) {
+	TimeType new_time;
+	if (!xml_change->get_property ("new", new_time)) {
 		fatal << "!!!" << endmsg;
 		abort(); /*NOTREACHED*/
 	}
 
-	/* we must point at the instance of the sysex that is actually in the model.
-	   so go look for it ...
-	*/
-
-	change.sysex = _model->find_sysex (sysex_id);
-	change.sysex_id = sysex_id;
+	change.id        = sysex_id;
+	change.old_value = old_time.to_ticks ();
+	change.new_value = new_time.to_ticks ();
 
 	return change;
 }
@@ -825,11 +1044,14 @@ MidiModel::SysExDiffCommand::set_state (const XMLNode& diff_command, int /*versi
 
 	XMLNode* changed_sysexes = diff_command.child (DIFF_SYSEXES_ELEMENT);
 
-	if (changed_sysexes) {
+	if (changed_sysexes && !unpack_changes (*changed_sysexes, _changes)) {
 		XMLNodeList sysexes = changed_sysexes->children();
-		transform (sysexes.begin(), sysexes.end(), back_inserter (_changes),
-		           boost::bind (&SysExDiffCommand::unmarshal_change, this, _1));
-
+		for (XMLNodeList::iterator n = sysexes.begin(); n != sysexes.end(); ++n) {
+			PackedChange const change = unmarshal_change (*n);
+			if (change.id >= 0) {
+				_changes.push_back (change);
+			}
+		}
 	}
 
 	return 0;
@@ -842,10 +1064,7 @@ MidiModel::SysExDiffCommand::get_state ()
 	diff_command->set_property ("midi-source", _model->midi_source()->id().to_s());
 
 	XMLNode* changes = diff_command->add_child(DIFF_SYSEXES_ELEMENT);
-	for_each (_changes.begin(), _changes.end(),
-	          boost::bind (
-		          boost::bind (&XMLNode::add_child_nocopy, changes, _1),
-		          boost::bind (&SysExDiffCommand::marshal_change, this, _1)));
+	pack_changes (*changes, _changes);
 
 	return *diff_command;
 }
@@ -876,53 +1095,68 @@ MidiModel::PatchChangeDiffCommand::remove (PatchChangePtr p)
 }
 
 void
-MidiModel::PatchChangeDiffCommand::change_time (PatchChangePtr patch, TimeType t)
+MidiModel::PatchChangeDiffCommand::change (PatchChangePtr patch, Property prop, int64_t old_value, int64_t new_value)
 {
-	Change c;
-	c.property = Time;
-	c.patch = patch;
-	c.old_time = patch->time ();
-	c.new_time = t;
+	const PackedChange c = {
+		patch->id (), (uint8_t) prop, old_value, new_value
+	};
 
 	_changes.push_back (c);
 }
 
 void
-MidiModel::PatchChangeDiffCommand::change_channel (PatchChangePtr patch, uint8_t channel)
+MidiModel::PatchChangeDiffCommand::change_time (PatchChangePtr patch, TimeType t)
 {
-	Change c;
-	c.property = Channel;
-	c.patch = patch;
-	c.old_channel = patch->channel ();
-	c.new_channel = channel;
-	c.patch_id = patch->id();
+	change (patch, Time, patch->time ().to_ticks (), t.to_ticks ());
+}
 
-	_changes.push_back (c);
+void
+MidiModel::PatchChangeDiffCommand::change_channel (PatchChangePtr patch, uint8_t channel)
+{
+	change (patch, Channel, patch->channel (), channel);
 }
 
 void
 MidiModel::PatchChangeDiffCommand::change_program (PatchChangePtr patch, uint8_t program)
 {
-	Change c;
-	c.property = Program;
-	c.patch = patch;
-	c.old_program = patch->program ();
-	c.new_program = program;
-	c.patch_id = patch->id();
-
-	_changes.push_back (c);
+	change (patch, Program, patch->program (), program);
 }
 
 void
 MidiModel::PatchChangeDiffCommand::change_bank (PatchChangePtr patch, int bank)
 {
-	Change c;
-	c.property = Bank;
-	c.patch = patch;
-	c.old_bank = patch->bank ();
-	c.new_bank = bank;
+	change (patch, Bank, patch->bank (), bank);
+}
 
-	_changes.push_back (c);
+void
+MidiModel::PatchChangeDiffCommand::set_value (PatchChangePtr patch, Property prop, int64_t value)
+{
+	switch (prop) {
+	case Time:
+		patch->set_time (TimeType::ticks (value));
+		break;
+	case Channel:
+		patch->set_channel (value);
+		break;
+	case Program:
+		patch->set_program (value);
+		break;
+	case Bank:
+		patch->set_bank (value);
+		break;
+	}
+}
+
+void
+MidiModel::PatchChangeDiffCommand::find_patch_changes (std::vector<PatchChangePtr>& patches) const
+{
+	ChangeTargets<PatchChangePtr> targets (_changes);
+
+	targets.add (_added.begin(), _added.end());
+	targets.add (_removed.begin(), _removed.end());
+	targets.add (_model->patch_changes().begin(), _model->patch_changes().end());
+
+	targets.find_all (_changes, patches);
 }
 
 void
@@ -939,41 +1173,31 @@ MidiModel::PatchChangeDiffCommand::operator() ()
 			_model->remove_patch_change_unlocked (*i);
 		}
 
-		/* find any patch change events that were missing when unmarshalling */
-
-		for (ChangeList::iterator i = _changes.begin(); i != _changes.end(); ++i) {
-			if (!i->patch) {
-				i->patch = _model->find_patch_change (i->patch_id);
-				assert (i->patch);
-			}
-		}
+		vector<PatchChangePtr> patches;
+		find_patch_changes (patches);
+		size_t missing = 0;
 
 		set<PatchChangePtr> temporary_removals;
 
-		for (ChangeList::iterator i = _changes.begin(); i != _changes.end(); ++i) {
-			switch (i->property) {
-			case Time:
-				if (temporary_removals.find (i->patch) == temporary_removals.end()) {
-					_model->remove_patch_change_unlocked (i->patch);
-					temporary_removals.insert (i->patch);
-				}
-				i->patch->set_time (i->new_time);
-				break;
-
-			case Channel:
-				i->patch->set_channel (i->new_channel);
-				break;
+		for (size_t n = 0; n < _changes.size(); ++n) {
+			Property const prop = (Property) _changes[n].property;
+			PatchChangePtr const patch = patches[n];
 
-			case Program:
-				i->patch->set_program (i->new_program);
-				break;
+			if (!patch) {
+				++missing;
+				continue;
+			}
 
-			case Bank:
-				i->patch->set_bank (i->new_bank);
-				break;
+			if (prop == Time && temporary_removals.find (patch) == temporary_removals.end()) {
+				_model->remove_patch_change_unlocked (patch);
+				temporary_removals.insert (patch);
 			}
+
+			set_value (patch, prop, _changes[n].new_value);
 		}
 
+		report_missing (missing);
+
 		for (set<PatchChangePtr>::iterator i = temporary_removals.begin(); i != temporary_removals.end(); ++i) {
 			_model->add_patch_change_unlocked (*i);
 		}
@@ -996,41 +1220,31 @@ MidiModel::PatchChangeDiffCommand::undo ()
 			_model->add_patch_change_unlocked (*i);
 		}
 
-		/* find any patch change events that were missing when unmarshalling */
-
-		for (ChangeList::iterator i = _changes.begin(); i != _changes.end(); ++i) {
-			if (!i->patch) {
-				i->patch = _model->find_patch_change (i->patch_id);
-				assert (i->patch);
-			}
-		}
+		vector<PatchChangePtr> patches;
+		find_patch_changes (patches);
+		size_t missing = 0;
 
 		set<PatchChangePtr> temporary_removals;
 
-		for (ChangeList::iterator i = _changes.begin(); i != _changes.end(); ++i) {
-			switch (i->property) {
-			case Time:
-				if (temporary_removals.find (i->patch) == temporary_removals.end()) {
-					_model->remove_patch_change_unlocked (i->patch);
-					temporary_removals.insert (i->patch);
-				}
-				i->patch->set_time (i->old_time);
-				break;
-
-			case Channel:
-				i->patch->set_channel (i->old_channel);
-				break;
+		for (size_t n = 0; n < _changes.size(); ++n) {
+			Property const prop = (Property) _changes[n].property;
+			PatchChangePtr const patch = patches[n];
 
-			case Program:
-				i->patch->set_program (i->old_program);
-				break;
+			if (!patch) {
+				++missing;
+				continue;
+			}
 
-			case Bank:
-				i->patch->set_bank (i->old_bank);
-				break;
+			if (prop == Time && temporary_removals.find (patch) == temporary_removals.end()) {
+				_model->remove_patch_change_unlocked (patch);
+				temporary_removals.insert (patch);
 			}
+
+			set_value (patch, prop, _changes[n].old_value);
 		}
 
+		report_missing (missing);
+
 		for (set<PatchChangePtr>::iterator i = temporary_removals.begin(); i != temporary_removals.end(); ++i) {
 			_model->add_patch_change_unlocked (*i);
 		}
@@ -1054,38 +1268,6 @@ MidiModel::PatchChangeDiffCommand::marshal_patch_change (constPatchChangePtr p)
 	return *n;
 }
 
-XMLNode&
-MidiModel::PatchChangeDiffCommand::marshal_change (const Change& c)
-{
-	XMLNode* n = new XMLNode (X_("Change"));
-
-	n->set_property (X_("property"), c.property);
-
-	if (c.property == Time) {
-		n->set_property (X_("old"), c.old_time);
-	} else if (c.property == Channel) {
-		n->set_property (X_("old"), c.old_channel);
-	} else if (c.property == Program) {
-		n->set_property (X_("old"), c.old_program);
-	} else if (c.property == Bank) {
-		n->set_property (X_("old"), c.old_bank);
-	}
-
-	if (c.property == Time) {
-		n->set_property (X_ ("new"), c.new_time);
-	} else if (c.property == Channel) {
-		n->set_property (X_ ("new"), c.new_channel);
-	} else if (c.property == Program) {
-		n->set_property (X_ ("new"), c.new_program);
-	} else if (c.property == Bank) {
-		n->set_property (X_ ("new"), c.new_bank);
-	}
-
-	n->set_property ("id", c.patch->id ());
-
-	return *n;
-}
-
 MidiModel::PatchChangePtr
 MidiModel::PatchChangeDiffCommand::unmarshal_patch_change (XMLNode* n)
 {
@@ -1119,32 +1301,41 @@ MidiModel::PatchChangeDiffCommand::unmarshal_patch_change (XMLNode* n)
 	return p;
 }
 
-MidiModel::PatchChangeDiffCommand::Change
+/** Read a change as saved by older versions, one XML node per change */
+MidiModel::DiffCommand::PackedChange
 MidiModel::PatchChangeDiffCommand::unmarshal_change (XMLNode* n)
 {
-	Change c;
+	PackedChange c = { -1, 0, 0, 0 };
+	Property prop;
 	Evoral::event_id_t id;
 
-	if (!n->get_property ("property", c.property) || !n->get_property ("id", id)) {
+	if (!n->get_property ("property", prop) || !n->get_property ("id", id)) {
 		assert(false);
+		return c;
 	}
 
-	if ((c.property == Time && !n->get_property ("old", c.old_time)) ||
-	    (c.property == Channel && !n->get_property ("old", c.old_channel)) ||
-	    (c.property == Program && !n->get_property ("old", c.old_program)) ||
-	    (c.property == Bank && !n->get_property ("old", c.old_bank))) {
-		assert (false);
-	}
+	c.property = prop;
+
+	for (int i = 0; i < 2; ++i) {
+		char const * name = (i == 0 ? "old" : "new");
+		int64_t& value = (i == 0 ? c.old_value : c.new_value);
 
-	if ((c.property == Time && !n->get_property ("new", c.new_time)) ||
-	    (c.property == Channel && !n->get_property ("new", c.new_channel)) ||
-	    (c.property == Program && !n->get_property ("new", c.new_program)) ||
-	    (c.property == Bank && !n->get_property ("new", c.new_bank))) {
-		assert (false);
+		TimeType time;
+		uint8_t  channel_or_program;
+		int      bank;
+
+		if (prop == Time && n->get_property (name, time)) {
+			value = time.to_ticks ();
+		} else if ((prop == Channel || prop == Program) && n->get_property (name, channel_or_program)) {
+			value = channel_or_program;
+		} else if (prop == Bank && n->get_property (name, bank)) {
+			value = bank;
+		} else {
+			assert (false);
+		}
 	}
 
-	c.patch = _model->find_patch_change (id);
-	c.patch_id = id;
+	c.id = id;
 
 	return c;
 }
@@ -1172,9 +1363,14 @@ MidiModel::PatchChangeDiffCommand::set_state (const XMLNode& diff_command, int /
 
 	_changes.clear ();
 	XMLNode* changed = diff_command.child (DIFF_PATCH_CHANGES_ELEMENT);
-	if (changed) {
+	if (changed && !unpack_changes (*changed, _changes)) {
 		XMLNodeList p = changed->children ();
-		transform (p.begin(), p.end(), back_inserter (_changes), boost::bind (&PatchChangeDiffCommand::unmarshal_change, this, _1));
+		for (XMLNodeList::iterator i = p.begin(); i != p.end(); ++i) {
+			PackedChange const c = unmarshal_change (*i);
+			if (c.id >= 0) {
+				_changes.push_back (c);
+			}
+		}
 	}
 
 	return 0;
@@ -1203,16 +1399,88 @@ MidiModel::PatchChangeDiffCommand::get_state ()
 		);
 
 	XMLNode* changes = diff_command->add_child (DIFF_PATCH_CHANGES_ELEMENT);
-	for_each (_changes.begin(), _changes.end(),
-		  boost::bind (
-			  boost::bind (&XMLNode::add_child_nocopy, changes, _1),
-			  boost::bind (&PatchChangeDiffCommand::marshal_change, this, _1)
-			  )
-		);
+	pack_changes (*changes, _changes);
 
 	return *diff_command;
 }
 
+MidiModel::DeferredDiffCommand::DeferredDiffCommand (boost::shared_ptr<MidiSource> src, const XMLNode& node)
+	: _source (src)
+	, _node (node)
+	, _command (0)
+{
+}
+
+MidiModel::DeferredDiffCommand::~DeferredDiffCommand ()
+{
+	delete _command;
+}
+
+MidiModel::DiffCommand*
+MidiModel::DeferredDiffCommand::command ()
+{
+	if (_command) {
+		return _command;
+	}
+
+	boost::shared_ptr<MidiSource> src = _source.lock ();
+
+	if (!src) {
+		error << string_compose (_("Cannot undo or redo %1, its MIDI source no longer exists"), _node.name ()) << endmsg;
+		return 0;
+	}
+
+	boost::shared_ptr<MidiModel> m = src->ensure_model ();
+
+	if (_node.name () == NOTE_DIFF_COMMAND_ELEMENT) {
+		_command = new NoteDiffCommand (m, _node);
+	} else if (_node.name () == SYSEX_DIFF_COMMAND_ELEMENT) {
+		_command = new SysExDiffCommand (m, _node);
+	} else if (_node.name () == PATCH_CHANGE_DIFF_COMMAND_ELEMENT) {
+		_command = new PatchChangeDiffCommand (m, _node);
+	}
+
+	return _command;
+}
+
+void
+MidiModel::DeferredDiffCommand::operator() ()
+{
+	DiffCommand* c = command ();
+	if (c) {
+		(*c) ();
+	}
+}
+
+void
+MidiModel::DeferredDiffCommand::undo ()
+{
+	DiffCommand* c = command ();
+	if (c) {
+		c->undo ();
+	}
+}
+
+XMLNode &
+MidiModel::DeferredDiffCommand::get_state ()
+{
+	if (_command) {
+		return _command->get_state ();
+	}
+	return *(new XMLNode (_node));
+}
+
+size_t
+MidiModel::DeferredDiffCommand::memory_used () const
+{
+	/* a rough estimate, the packed changes are the bulk of the node */
+	size_t bytes = Command::memory_used () + sizeof (XMLNode);
+	for (XMLNodeConstIterator i = _node.children ().begin (); i != _node.children ().end (); ++i) {
+		bytes += sizeof (XMLNode) + (*i)->content ().size ();
+	}
+	return bytes;
+}
+
 /** Write all of the model to a MidiSource (i.e. save the model).
  * This is different from manually using read to write to a source in that
  * note off events are written regardless of the track mode.  This is so the
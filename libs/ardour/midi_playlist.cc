@@ -28,7 +28,10 @@
 #include "evoral/EventList.h"
 #include "evoral/Control.h"
 
+#include "pbd/timing.h"
+
 #include "ardour/debug.h"
+#include "ardour/midi_channel_filter.h"
 #include "ardour/midi_model.h"
 #include "ardour/midi_playlist.h"
 #include "ardour/midi_region.h"
@@ -49,6 +52,11 @@ using namespace std;
 MidiPlaylist::MidiPlaylist (Session& session, const XMLNode& node, bool hidden)
 	: Playlist (session, node, DataType::MIDI, hidden)
 	, _note_mode(Sustained)
+	, _rendered_valid (false)
+	, _rendered_filter (0)
+	, _rendered_channel_mode (AllChannels)
+	, _rendered_channel_mask (0)
+	, _rendered_note_mode (Sustained)
 {
 #ifndef NDEBUG
 	XMLProperty const * prop = node.property("type");
@@ -67,12 +75,22 @@ MidiPlaylist::MidiPlaylist (Session& session, const XMLNode& node, bool hidden)
 MidiPlaylist::MidiPlaylist (Session& session, string name, bool hidden)
 	: Playlist (session, name, DataType::MIDI, hidden)
 	, _note_mode(Sustained)
+	, _rendered_valid (false)
+	, _rendered_filter (0)
+	, _rendered_channel_mode (AllChannels)
+	, _rendered_channel_mask (0)
+	, _rendered_note_mode (Sustained)
 {
 }
 
 MidiPlaylist::MidiPlaylist (boost::shared_ptr<const MidiPlaylist> other, string name, bool hidden)
 	: Playlist (other, name, hidden)
 	, _note_mode(other->_note_mode)
+	, _rendered_valid (false)
+	, _rendered_filter (0)
+	, _rendered_channel_mode (AllChannels)
+	, _rendered_channel_mask (0)
+	, _rendered_note_mode (Sustained)
 {
 }
 
@@ -83,6 +101,11 @@ MidiPlaylist::MidiPlaylist (boost::shared_ptr<const MidiPlaylist> other,
                             bool                                  hidden)
 	: Playlist (other, start, dur, name, hidden)
 	, _note_mode(other->_note_mode)
+	, _rendered_valid (false)
+	, _rendered_filter (0)
+	, _rendered_channel_mode (AllChannels)
+	, _rendered_channel_mask (0)
+	, _rendered_note_mode (Sustained)
 {
 }
 
@@ -273,6 +296,11 @@ MidiPlaylist::contained_automation()
 	for (RegionList::const_iterator r = regions.begin(); r != regions.end(); ++r) {
 		boost::shared_ptr<MidiRegion> mr = boost::dynamic_pointer_cast<MidiRegion>(*r);
 
+		if (!mr || !mr->model()) {
+			/* model not loaded (yet), see RCConfiguration::load_midi_models_on_demand */
+			continue;
+		}
+
 		for (Automatable::Controls::iterator c = mr->model()->controls().begin();
 				c != mr->model()->controls().end(); ++c) {
 			if (c->second->list()->size() > 0) {
@@ -284,16 +312,42 @@ MidiPlaylist::contained_automation()
 	return ret;
 }
 
+MidiPlaylist::RenderedRegion::RenderedRegion (Region const & r)
+	: start (r.first_sample())
+	, end (r.first_sample() + r.length_samples() + 1)
+	, offset (r.start().samples())
+{
+}
+
+bool
+MidiPlaylist::region_changed (const PBD::PropertyChange& what_changed, boost::shared_ptr<Region> region)
+{
+	/* changes to region bounds, mute state etc. are found by comparing
+	 * the regions with the state of the last render, but an edit of the
+	 * model does not show up there.
+	 */
+
+	if (what_changed.contains (Properties::contents)) {
+		RenderedRegion const rr (*region);
+		Glib::Threads::Mutex::Lock lm (_dirty_lock);
+		_dirty.push_back (make_pair (rr.start, rr.end));
+	}
+
+	return Playlist::region_changed (what_changed, region);
+}
+
 void
 MidiPlaylist::render (MidiChannelFilter* filter)
 {
-	typedef pair<MidiStateTracker*,samplepos_t> TrackerInfo;
-
 	Playlist::RegionReadLock rl (this);
 
 	DEBUG_TRACE (DEBUG::MidiPlaylistIO, string_compose ("---- MidiPlaylist::render (regions: %1)-----\n", regions.size()));
 
-	std::vector< boost::shared_ptr<Region> > regs;
+	PBD::Timing timing;
+	timing.start ();
+
+	RegionVector    regs;
+	RenderedRegions now;
 
 	for (RegionList::iterator i = regions.begin(); i != regions.end(); ++i) {
 
@@ -308,8 +362,97 @@ MidiPlaylist::render (MidiChannelFilter* filter)
 		}
 
 		regs.push_back (*i);
+		now.insert (make_pair ((*i)->id(), RenderedRegion (**i)));
+	}
+
+	Ranges dirty;
+
+	{
+		Glib::Threads::Mutex::Lock lm (_dirty_lock);
+		dirty.swap (_dirty);
+	}
+
+	bool full = !_rendered_valid
+		|| _rendered.reversed ()
+		|| _note_mode != _rendered_note_mode
+		|| filter != _rendered_filter
+		|| (filter && (filter->get_channel_mode() != _rendered_channel_mode || filter->get_channel_mask() != _rendered_channel_mask));
+
+	if (!full) {
+
+		/* add the old and new extent of every region that was added,
+		 * removed, moved, trimmed or (un)muted since the last render.
+		 */
+
+		for (RenderedRegions::const_iterator i = now.begin(); i != now.end(); ++i) {
+			RenderedRegions::const_iterator o = _rendered_regions.find (i->first);
+			if (o == _rendered_regions.end()) {
+				dirty.push_back (make_pair (i->second.start, i->second.end));
+			} else if (o->second != i->second) {
+				dirty.push_back (make_pair (o->second.start, o->second.end));
+				dirty.push_back (make_pair (i->second.start, i->second.end));
+			}
+		}
+
+		for (RenderedRegions::const_iterator o = _rendered_regions.begin(); o != _rendered_regions.end(); ++o) {
+			if (now.find (o->first) == now.end()) {
+				dirty.push_back (make_pair (o->second.start, o->second.end));
+			}
+		}
+
+		/* merge overlapping and adjacent ranges */
+
+		sort (dirty.begin(), dirty.end());
+
+		Ranges merged;
+
+		for (Ranges::const_iterator r = dirty.begin(); r != dirty.end(); ++r) {
+			if (!merged.empty() && r->first <= merged.back().second) {
+				merged.back().second = max (merged.back().second, r->second);
+			} else {
+				merged.push_back (*r);
+			}
+		}
+
+		dirty.swap (merged);
+
+		/* re-rendering most of the playlist piecewise is more work than
+		 * doing all of it in one go.
+		 */
+
+		samplecnt_t affected = 0;
+
+		for (Ranges::const_iterator r = dirty.begin(); r != dirty.end(); ++r) {
+			affected += r->second - r->first;
+		}
+
+		if (affected > 0 && affected * 2 > _rendered.span()) {
+			full = true;
+		}
 	}
 
+	if (full) {
+		render_all (regs, filter);
+	} else if (!dirty.empty()) {
+		render_ranges (regs, dirty, filter);
+	}
+
+	_rendered_regions.swap (now);
+	_rendered_valid        = true;
+	_rendered_filter       = filter;
+	_rendered_channel_mode = filter ? filter->get_channel_mode() : AllChannels;
+	_rendered_channel_mask = filter ? filter->get_channel_mask() : 0;
+	_rendered_note_mode    = _note_mode;
+
+	timing.update ();
+
+	DEBUG_TRACE (DEBUG::MidiPlaylistIO, string_compose ("---- End MidiPlaylist::render, %1 render of %2 ranges took %3 usecs, events: %4\n",
+	                                                    (full ? "full" : "incremental"), (full ? 1 : dirty.size()), timing.elapsed(), _rendered.size()));
+}
+
+void
+MidiPlaylist::render_all (RegionVector const & regs, MidiChannelFilter* filter)
+{
 	/* If we are reading from a single region, we can read directly into _rendered.  Otherwise,
 	   we read into a temporarily list, sort it, then write that to _rendered.
 	*/
@@ -334,7 +477,7 @@ MidiPlaylist::render (MidiChannelFilter* filter)
 
 		DEBUG_TRACE (DEBUG::MidiPlaylistIO, string_compose ("\t%1 regions to read, direct: %2\n", regs.size(), (regs.size() == 1)));
 
-		for (vector<boost::shared_ptr<Region> >::iterator i = regs.begin(); i != regs.end(); ++i) {
+		for (RegionVector::const_iterator i = regs.begin(); i != regs.end(); ++i) {
 
 			boost::shared_ptr<MidiRegion> mr = boost::dynamic_pointer_cast<MidiRegion>(*i);
 
@@ -365,8 +508,84 @@ MidiPlaylist::render (MidiChannelFilter* filter)
 	}
 
 	/* no need to release - RAII with WriteProtectRender takes care of it */
+}
+
+static bool
+range_ends_before (pair<samplepos_t, samplepos_t> const & range, samplepos_t t)
+{
+	return range.second <= t;
+}
+
+void
+MidiPlaylist::render_ranges (RegionVector const & regs, Ranges const & dirty, MidiChannelFilter* filter)
+{
+	/* @param dirty is sorted and its ranges do not overlap. Every region
+	 * touching any of them is rendered in full (exactly like render_all()
+	 * does) and only events inside a dirty range are kept. This is all
+	 * done before write-protecting _rendered, so playback is only blocked
+	 * while the results are spliced in.
+	 */
+
+	vector<Evoral::EventList<samplepos_t> > evlists (dirty.size());
+	Evoral::EventList<samplepos_t>          tmp;
+
+	for (RegionVector::const_iterator i = regs.begin(); i != regs.end(); ++i) {
+
+		boost::shared_ptr<MidiRegion> mr = boost::dynamic_pointer_cast<MidiRegion>(*i);
+
+		if (!mr) {
+			continue;
+		}
+
+		RenderedRegion const rr (*mr);
+		Ranges::const_iterator r = lower_bound (dirty.begin(), dirty.end(), rr.start, range_ends_before);
+
+		if (r == dirty.end() || r->first >= rr.end) {
+			/* region does not touch any dirty range */
+			continue;
+		}
+
+		DEBUG_TRACE (DEBUG::MidiPlaylistIO, string_compose ("render from %1\n", mr->name()));
+		mr->render (tmp, 0, _note_mode, filter);
+
+		for (Evoral::EventList<samplepos_t>::iterator e = tmp.begin(); e != tmp.end(); ++e) {
+			Ranges::const_iterator d = lower_bound (dirty.begin(), dirty.end(), (*e)->time(), range_ends_before);
+			if (d != dirty.end() && d->first <= (*e)->time()) {
+				evlists[d - dirty.begin()].push_back (*e);
+			} else {
+				delete *e;
+			}
+		}
+
+		tmp.clear ();
+	}
+
+	EventsSortByTimeAndType<samplepos_t> cmp;
+
+	for (size_t n = 0; n < evlists.size(); ++n) {
+		evlists[n].sort (cmp);
+	}
+
+	size_t removed = 0;
+	size_t added = 0;
+
+	{
+		RTMidiBuffer::WriteProtectRender wpr (_rendered);
+		wpr.acquire ();
+
+		for (size_t n = 0; n < dirty.size(); ++n) {
+			removed += _rendered.splice (dirty[n].first, dirty[n].second, evlists[n]);
+			added += evlists[n].size();
+		}
+	}
+
+	for (size_t n = 0; n < evlists.size(); ++n) {
+		for (Evoral::EventList<samplepos_t>::iterator e = evlists[n].begin(); e != evlists[n].end(); ++e) {
+			delete *e;
+		}
+	}
 
-	DEBUG_TRACE (DEBUG::MidiPlaylistIO, string_compose ("---- End MidiPlaylist::render, events: %1\n", _rendered.size()));
+	DEBUG_TRACE (DEBUG::MidiPlaylistIO, string_compose ("\tspliced %1 ranges, removed %2 events, added %3\n", dirty.size(), removed, added));
 }
 
 RTMidiBuffer*
@@ -391,13 +391,18 @@ MidiRegion::separate_by_channel (vector< boost::shared_ptr<Region> >&) const
 boost::shared_ptr<Evoral::Control>
 MidiRegion::control (const Evoral::Parameter& id, bool create)
 {
-	return model()->control(id, create);
+	return midi_source()->ensure_model()->control(id, create);
 }
 
 boost::shared_ptr<const Evoral::Control>
 MidiRegion::control (const Evoral::Parameter& id) const
 {
-	return model()->control(id);
+	boost::shared_ptr<const MidiModel> m = model();
+	if (!m) {
+		/* not loaded yet (load-midi-models-on-demand) */
+		return boost::shared_ptr<const Evoral::Control>();
+	}
+	return m->control(id);
 }
 
 boost::shared_ptr<MidiModel>
@@ -499,7 +504,8 @@ MidiRegion::model_automation_state_changed (Evoral::Parameter const & p)
 {
 	/* Update our filtered parameters list after a change to a parameter's AutoState */
 
-	boost::shared_ptr<AutomationControl> ac = model()->automation_control (p);
+	boost::shared_ptr<MidiModel> m = model();
+	boost::shared_ptr<AutomationControl> ac = m ? m->automation_control (p) : boost::shared_ptr<AutomationControl> ();
 	if (!ac || ac->alist()->automation_state() == Play) {
 		/* It should be "impossible" for ac to be NULL, but if it is, don't
 		   filter the parameter so events aren't lost. */
@@ -525,9 +531,11 @@ MidiRegion::model_automation_state_changed (Evoral::Parameter const & p)
 void
 MidiRegion::fix_negative_start ()
 {
+	boost::shared_ptr<MidiModel> m = midi_source()->ensure_model ();
+
 	_ignore_shift = true;
 
-	model()->insert_silence_at_start (-start().beats());
+	m->insert_silence_at_start (-start().beats());
 
 	_start = timepos_t::zero (start().time_domain());
 }
@@ -361,6 +361,7 @@ MidiSource::mark_midi_streaming_write_completed (const Lock&
 {
 	if (_model) {
 		_model->end_write (option, end);
+		_model->update_memory_account ();
 
 		/* Make captured controls discrete to play back user input exactly. */
 		for (MidiModel::Controls::iterator i = _model->controls().begin(); i != _model->controls().end(); ++i) {
@@ -474,6 +475,16 @@ MidiSource::set_note_mode(const Lock& lock, NoteMode mode)
 	}
 }
 
+boost::shared_ptr<MidiModel>
+MidiSource::ensure_model ()
+{
+	Lock lm (_lock);
+	if (!_model) {
+		load_model (lm);
+	}
+	return _model;
+}
+
 void
 MidiSource::drop_model (const Lock& lock)
 {
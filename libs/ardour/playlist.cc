@@ -343,6 +343,8 @@ Playlist::init (bool hide)
 	_combine_ops = 0;
 	_end_space = timecnt_t (_type == DataType::AUDIO ? Temporal::AudioTime : Temporal::BeatTime);
 	_playlist_shift_active = false;
+	_stream_regions = false;
+	_region_placeholder = 0;
 
 	_session.history ().BeginUndoRedo.connect_same_thread (*this, boost::bind (&Playlist::begin_undo, this));
 	_session.history ().EndUndoRedo.connect_same_thread (*this, boost::bind (&Playlist::end_undo, this));
@@ -2326,9 +2328,13 @@ Playlist::state (bool full_state)
 
 		node->set_property ("combine-ops", _combine_ops);
 
-		for (RegionList::iterator i = regions.begin (); i != regions.end (); ++i) {
-			assert ((*i)->sources ().size () > 0 && (*i)->master_sources ().size () > 0);
-			node->add_child_nocopy ((*i)->get_state ());
+		if (_stream_regions) {
+			_region_placeholder = node->add_child (X_("Region"));
+		} else {
+			for (RegionList::iterator i = regions.begin (); i != regions.end (); ++i) {
+				assert ((*i)->sources ().size () > 0 && (*i)->master_sources ().size () > 0);
+				node->add_child_nocopy ((*i)->get_state ());
+			}
 		}
 	}
 
@@ -2339,6 +2345,38 @@ Playlist::state (bool full_state)
 	return *node;
 }
 
+void
+Playlist::write_state (XMLStreamWriter& writer)
+{
+	XMLNode* node;
+
+	{
+		PBD::Unwinder<bool> uw (_stream_regions, true);
+		node = &get_state ();
+	}
+
+	writer.replace (_region_placeholder, boost::bind (&Playlist::write_region_state, this, _1));
+	writer.node (*node);
+	delete node;
+	_region_placeholder = 0;
+}
+
+void
+Playlist::write_region_state (XMLStreamWriter& writer)
+{
+	RegionList rl;
+
+	{
+		RegionReadLock rlock (this);
+		rl.insert (rl.end (), regions.begin (), regions.end ());
+	}
+
+	for (RegionList::iterator i = rl.begin (); i != rl.end (); ++i) {
+		assert ((*i)->sources ().size () > 0 && (*i)->master_sources ().size () > 0);
+		(*i)->write_state (writer);
+	}
+}
+
 bool
 Playlist::empty () const
 {
@@ -20,6 +20,9 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include <algorithm>
+
+#include "pbd/cpus.h"
 #include "pbd/error.h"
 #include "ardour/resampled_source.h"
 #include "pbd/failed_constructor.h"
@@ -35,9 +38,18 @@ const uint32_t ResampledImportableSource::blocksize = 524288U;
 const uint32_t ResampledImportableSource::blocksize = 16384U;
 #endif
 
+/* shared by all imports, the channels of a file are converted in parallel */
+static AudioGrapher::ThreaderPool&
+import_thread_pool ()
+{
+	/* hardware_concurrency() is 0 if it cannot be determined */
+	static AudioGrapher::ThreaderPool* pool = new AudioGrapher::ThreaderPool (std::max<int> (0, (int) hardware_concurrency () - 1), false);
+	return *pool;
+}
+
 ResampledImportableSource::ResampledImportableSource (boost::shared_ptr<ImportableSource> src, samplecnt_t rate, SrcQuality srcq)
 	: source (src)
-	, _src_state (0)
+	, _src (src->channels ())
 {
 	_src_type = SRC_SINC_BEST_QUALITY;
 
@@ -57,6 +69,22 @@ ResampledImportableSource::ResampledImportableSource (boost::shared_ptr<Importab
 	case SrcFastest:
 		_src_type = SRC_LINEAR;
 		break;
+	case SrcPolyphaseBest:
+		_src_type = AudioGrapher::ParallelSRC::ZitaBest;
+		break;
+	case SrcPolyphaseGood:
+		_src_type = AudioGrapher::ParallelSRC::ZitaGood;
+		break;
+	}
+
+	int err;
+	if ((err = _src.setup (source->samplerate (), rate, _src_type))) {
+		error << string_compose(_("Import: src_new() failed : %1"), AudioGrapher::ParallelSRC::strerror (err)) << endmsg ;
+		throw failed_constructor ();
+	}
+	_src.allocate (blocksize / source->channels ());
+	if (source->channels () > 1) {
+		_src.set_thread_pool (&import_thread_pool ());
 	}
 
 	_input = new float[blocksize];
@@ -68,7 +96,6 @@ ResampledImportableSource::ResampledImportableSource (boost::shared_ptr<Importab
 
 ResampledImportableSource::~ResampledImportableSource ()
 {
-	_src_state = src_delete (_src_state) ;
 	delete [] _input;
 }
 
@@ -106,8 +133,8 @@ ResampledImportableSource::read (Sample* output, samplecnt_t nframes)
 		_src_data.end_of_input = true;
 	}
 
-	if ((err = src_process (_src_state, &_src_data))) {
-		error << string_compose(_("Import: %1"), src_strerror (err)) << endmsg ;
+	if ((err = _src.process (_src_data))) {
+		error << string_compose(_("Import: %1"), AudioGrapher::ParallelSRC::strerror (err)) << endmsg ;
 		return 0 ;
 	}
 
@@ -129,16 +156,7 @@ ResampledImportableSource::seek (samplepos_t pos)
 
 	/* and reset things so that we start from scratch with the conversion */
 
-	if (_src_state) {
-		src_delete (_src_state);
-	}
-
-	int err;
-
-	if ((_src_state = src_new (_src_type, source->channels(), &err)) == 0) {
-		error << string_compose(_("Import: src_new() failed : %1"), src_strerror (err)) << endmsg ;
-		throw failed_constructor ();
-	}
+	_src.reset ();
 
 	_src_data.input_frames = 0;
 	_src_data.data_in = _input;
@@ -136,6 +136,8 @@ Route::Route (Session& sess, string name, PresentationInfo::Flag flag, DataType
 	, _custom_meter_position_noted (false)
 	, _pinmgr_proxy (0)
 	, _patch_selector_dialog (0)
+	, _stream_processors (false)
+	, _processor_placeholder (0)
 {
 	processor_max_streams.reset();
 
@@ -2529,7 +2531,6 @@ Route::state (bool save_template)
 	}
 
 	XMLNode *node = new XMLNode("Route");
-	ProcessorList::iterator i;
 
 	if(save_template) {
 		XMLNode* child = node->add_child("ProgramVersion");
@@ -2594,30 +2595,11 @@ Route::state (bool save_template)
 		node->add_child_nocopy (_pannable->get_state ());
 	}
 
-	{
-		Glib::Threads::RWLock::ReaderLock lm (_processor_lock);
-		for (i = _processors.begin(); i != _processors.end(); ++i) {
-			if (*i == _delayline) {
-				continue;
-			}
-			if (save_template) {
-				/* template save: do not include internal sends functioning as
-					 aux sends because the chance of the target ID
-					 in the session where this template is used
-					 is not very likely.
-
-					 similarly, do not save listen sends which connect to
-					 the monitor section, because these will always be
-					 added if necessary.
-					 */
-				boost::shared_ptr<InternalSend> is;
-
-				if ((is = boost::dynamic_pointer_cast<InternalSend> (*i)) != 0) {
-					if (is->role() == Delivery::Listen) {
-						continue;
-					}
-				}
-			}
+	if (_stream_processors) {
+		_processor_placeholder = node->add_child (X_("Processor"));
+	} else {
+		ProcessorList pl (processors_to_save (save_template));
+		for (ProcessorList::iterator i = pl.begin(); i != pl.end(); ++i) {
 			node->add_child_nocopy((*i)->get_state ());
 		}
 	}
@@ -2642,6 +2624,75 @@ Route::state (bool save_template)
 	return *node;
 }
 
+ProcessorList
+Route::processors_to_save (bool save_template)
+{
+	ProcessorList pl;
+	Glib::Threads::RWLock::ReaderLock lm (_processor_lock);
+
+	for (ProcessorList::iterator i = _processors.begin(); i != _processors.end(); ++i) {
+		if (*i == _delayline) {
+			continue;
+		}
+		if (save_template) {
+			/* template save: do not include internal sends functioning as
+				 aux sends because the chance of the target ID
+				 in the session where this template is used
+				 is not very likely.
+
+				 similarly, do not save listen sends which connect to
+				 the monitor section, because these will always be
+				 added if necessary.
+				 */
+			boost::shared_ptr<InternalSend> is;
+
+			if ((is = boost::dynamic_pointer_cast<InternalSend> (*i)) != 0) {
+				if (is->role() == Delivery::Listen) {
+					continue;
+				}
+			}
+		}
+		pl.push_back (*i);
+	}
+
+	return pl;
+}
+
+void
+Route::write_state (XMLStreamWriter& writer)
+{
+	if (!_session._template_state_dir.empty()) {
+		/* plugins write their state to the template dir while state() runs */
+		Stateful::write_state (writer);
+		return;
+	}
+
+	XMLNode* node;
+
+	{
+		PBD::Unwinder<bool> uw (_stream_processors, true);
+		node = &get_state ();
+	}
+
+	writer.replace (_processor_placeholder, boost::bind (&Route::write_processor_state, this, _1));
+	writer.node (*node);
+	delete node;
+	_processor_placeholder = 0;
+}
+
+void
+Route::write_processor_state (XMLStreamWriter& writer)
+{
+	/* the processors are written outside of the processor lock, the
+	 * shared_ptr keep them alive while they are written.
+	 */
+	ProcessorList pl (processors_to_save (false));
+
+	for (ProcessorList::iterator i = pl.begin(); i != pl.end(); ++i) {
+		(*i)->write_state (writer);
+	}
+}
+
 int
 Route::set_state (const XMLNode& node, int version)
 {
@@ -41,6 +41,7 @@ RTMidiBuffer::RTMidiBuffer ()
 	, _pool_size (0)
 	, _pool_capacity (0)
 	, _pool (0)
+	, _pool_dead (0)
 {
 }
 
@@ -200,38 +201,44 @@ RTMidiBuffer::write (TimeType time, Evoral::EventType /*type*/, uint32_t size, c
 		}
 	}
 
-	_data[_size].timestamp = time;
+	set_item (_data[_size], time, size, buf);
+
+	++_size;
+
+	return size;
+}
+
+void
+RTMidiBuffer::set_item (Item& item, TimeType time, uint32_t size, const uint8_t* buf)
+{
+	item.timestamp = time;
 
 	if (size > 3) {
 
 		uint32_t off = store_blob (size, buf);
 
 		/* non-zero MSbit indicates that the data (more than 3 bytes) is not inline */
-		_data[_size].offset = (off | (1<<(CHAR_BIT-1)));
+		item.offset = (off | (1<<(CHAR_BIT-1)));
 
 	} else {
 
 		assert ((int) size == Evoral::midi_event_size (buf[0]));
 
 		/* zero MSbit indicates that the data (up to 3 bytes) is inline */
-		_data[_size].bytes[0] = 0;
+		item.bytes[0] = 0;
 
 		switch (size) {
 		case 3:
-			_data[_size].bytes[3] = buf[2];
+			item.bytes[3] = buf[2];
 			/* fallthru */
 		case 2:
-			_data[_size].bytes[2] = buf[1];
+			item.bytes[2] = buf[1];
 			/* fallthru */
 		case 1:
-			_data[_size].bytes[1] = buf[0];
+			item.bytes[1] = buf[0];
 			break;
 		}
 	}
-
-	++_size;
-
-	return size;
 }
 
 /* requires C++20 to be usable */
@@ -369,6 +376,77 @@ RTMidiBuffer::read (MidiBuffer& dst, samplepos_t start, samplepos_t end, MidiSta
 	return count;
 }
 
+size_t
+RTMidiBuffer::splice (TimeType start, TimeType end, Evoral::EventList<TimeType> const & events)
+{
+	assert (!_reversed);
+
+	Item foo;
+
+	foo.timestamp = start;
+	Item* first = lower_bound (_data, _data + _size, foo, item_item_earlier);
+	foo.timestamp = end;
+	Item* last = lower_bound (first, _data + _size, foo, item_item_earlier);
+
+	size_t const lo = first - _data;
+	size_t const hi = last - _data;
+	size_t const tail = _size - hi;
+	size_t const n = events.size ();
+
+	/* blobs of removed events stay in the pool until it is compacted */
+
+	for (size_t i = lo; i < hi; ++i) {
+		if (_data[i].bytes[0]) {
+			uint32_t offset = _data[i].offset & ~(1<<(CHAR_BIT-1));
+			_pool_dead += reinterpret_cast<Blob*> (&_pool[offset])->size;
+		}
+	}
+
+	if (lo + n + tail > _capacity) {
+		resize (lo + n + tail + 1024); // XXX 1024 is as arbitrary as in ::write()
+	}
+
+	if (tail && n != hi - lo) {
+		memmove (_data + lo + n, _data + hi, tail * sizeof (Item));
+	}
+
+	Item* item = _data + lo;
+
+	for (Evoral::EventList<TimeType>::const_iterator e = events.begin(); e != events.end(); ++e, ++item) {
+		assert ((*e)->time() >= start && (*e)->time() < end);
+		set_item (*item, (*e)->time(), (*e)->size(), (*e)->buffer());
+	}
+
+	_size = lo + n + tail;
+
+	if (_pool_dead > _pool_size / 2) {
+		compact_pool ();
+	}
+
+	return hi - lo;
+}
+
+void
+RTMidiBuffer::compact_pool ()
+{
+	uint8_t* old_pool = _pool;
+
+	_pool = 0;
+	_pool_size = 0;
+	_pool_capacity = 0;
+	_pool_dead = 0;
+
+	for (size_t i = 0; i < _size; ++i) {
+		if (_data[i].bytes[0]) {
+			uint32_t offset = _data[i].offset & ~(1<<(CHAR_BIT-1));
+			Blob* blob = reinterpret_cast<Blob*> (&old_pool[offset]);
+			_data[i].offset = (store_blob (blob->size, blob->data) | (1<<(CHAR_BIT-1)));
+		}
+	}
+
+	cache_aligned_free (old_pool);
+}
+
 uint32_t
 RTMidiBuffer::alloc_blob (uint32_t size)
 {
@@ -412,6 +490,7 @@ RTMidiBuffer::clear ()
 	_size = 0;
 	/* free the entire current pool size, if any */
 	_pool_size = 0;
+	_pool_dead = 0;
 	/* rendering new data .. it will not be reversed */
 	_reversed = false;
 }
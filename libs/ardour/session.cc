@@ -51,6 +51,7 @@
 #include "pbd/error.h"
 #include "pbd/file_utils.h"
 #include "pbd/md5.h"
+#include "pbd/memory_account.h"
 #include "pbd/pthread_utils.h"
 #include "pbd/search_path.h"
 #include "pbd/stl_delete.h"
@@ -72,6 +73,7 @@
 #include "ardour/buffer_set.h"
 #include "ardour/bundle.h"
 #include "ardour/butler.h"
+#include "ardour/capture_encoder.h"
 #include "ardour/click.h"
 #include "ardour/control_protocol_manager.h"
 #include "ardour/data_type.h"
@@ -238,6 +240,9 @@ Session::Session (AudioEngine &eng,
 	, _state_of_the_state (StateOfTheState (CannotSave | InitialConnecting | Loading))
 	, _save_queued (false)
 	, _save_queued_pending (false)
+	, _background_save_thread (0)
+	, _background_save (0)
+	, _background_save_quit (false)
 	, _last_roll_location (0)
 	, _last_roll_or_reversal_location (0)
 	, _last_record_location (0)
@@ -290,6 +295,7 @@ Session::Session (AudioEngine &eng,
 	, _bundles (new BundleList)
 	, _bundle_xml_node (0)
 	, _current_trans (0)
+	, _history_journal_written (0)
 	, _clicking (false)
 	, _click_rec_only (false)
 	, click_data (0)
@@ -323,6 +329,7 @@ Session::Session (AudioEngine &eng,
 	, _active_cue (-1)
 {
 	g_atomic_int_set (&_suspend_save, 0);
+	g_atomic_int_set (&_modification_count, 0);
 	g_atomic_int_set (&_playback_load, 0);
 	g_atomic_int_set (&_capture_load, 0);
 	g_atomic_int_set (&_post_transport_work, 0);
@@ -489,6 +496,10 @@ Session::Session (AudioEngine &eng,
 
 	Location::cue_change.connect_same_thread (*this, boost::bind (&Session::cue_marker_change, this, _1));
 
+	MemoryAccount::get (X_("undo-history")).OverBudget.connect_same_thread (*this, boost::bind (&Session::reduce_memory, this, std::string (X_("undo-history"))));
+	MemoryAccount::get (X_("peak-cache")).OverBudget.connect_same_thread (*this, boost::bind (&Session::reduce_memory, this, std::string (X_("peak-cache"))));
+	MemoryAccount::get (X_("midi")).OverBudget.connect_same_thread (*this, boost::bind (&Session::reduce_memory, this, std::string (X_("midi"))));
+
 	emit_thread_start ();
 	auto_connect_thread_start ();
 
@@ -610,8 +621,10 @@ Session::destroy ()
 	*/
 
 	remove_pending_capture_state ();
+	background_save_thread_terminate ();
 
 	Analyser::flush ();
+	CaptureEncoder::flush ();
 
 	_state_of_the_state = StateOfTheState (CannotSave | Deletion);
 
@@ -4814,6 +4827,13 @@ Session::audio_source_name_is_unique (const string& name)
 			existing++;
 			break;
 		}
+
+		/* ditto for capture journals, which have a different extension */
+
+		if (audio_source_by_path_and_channel (CaptureEncoder::journal_path (possible_path), 0)) {
+			existing++;
+			break;
+		}
 	}
 
 	return (existing == 0);
@@ -4973,6 +4993,27 @@ Session::create_audio_source_for_session (size_t n_chans, string const & base, u
 	}
 }
 
+boost::shared_ptr<AudioFileSource>
+Session::create_audio_capture_source_for_session (size_t n_chans, string const & base, uint32_t chan)
+{
+	if (!Config->get_capture_deferred_encoding ()
+	    || !CaptureEncoder::needs_encoding (config.get_native_file_header_format (), config.get_native_file_data_format ())) {
+		return create_audio_source_for_session (n_chans, base, chan);
+	}
+
+	const string path = new_audio_source_path (base, n_chans, chan, true);
+
+	if (path.empty()) {
+		throw failed_constructor ();
+	}
+
+	const string journal = CaptureEncoder::journal_path (path);
+
+	return boost::dynamic_pointer_cast<AudioFileSource> (SourceFactory::createWritable (DataType::AUDIO, *this, journal, sample_rate(),
+	                                                                                    FormatFloat, CaptureEncoder::journal_header_format (journal),
+	                                                                                    true, true));
+}
+
 /** Create a new within-session MIDI source */
 boost::shared_ptr<MidiSource>
 Session::create_midi_source_for_session (string const & basic_name)
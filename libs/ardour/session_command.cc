@@ -24,6 +24,8 @@
 #include "ardour/automation_list.h"
 #include "ardour/location.h"
 #include "ardour/midi_automation_list_binder.h"
+#include "ardour/midi_model.h"
+#include "ardour/midi_source.h"
 #include "ardour/playlist.h"
 #include "ardour/region.h"
 #include "ardour/region_factory.h"
@@ -150,6 +152,29 @@ Session::memento_command_factory(XMLNode *n)
     return 0 ;
 }
 
+Command *
+Session::midi_diff_command_factory (boost::shared_ptr<MidiSource> src, XMLNode const & n)
+{
+	boost::shared_ptr<MidiModel> m = src->model ();
+
+	if (!m) {
+		/* do not load the model (load-midi-models-on-demand)
+		 * unless the command is actually undone or redone
+		 */
+		return new MidiModel::DeferredDiffCommand (src, n);
+	}
+
+	if (n.name () == "NoteDiffCommand") {
+		return new MidiModel::NoteDiffCommand (m, n);
+	} else if (n.name () == "SysExDiffCommand") {
+		return new MidiModel::SysExDiffCommand (m, n);
+	} else if (n.name () == "PatchChangeDiffCommand") {
+		return new MidiModel::PatchChangeDiffCommand (m, n);
+	}
+
+	return 0;
+}
+
 Command *
 Session::stateful_diff_command_factory (XMLNode* n)
 {
@@ -111,6 +111,23 @@ Session::pre_export ()
 	return 0;
 }
 
+/** Called before rendering a range without the engine, the
+ * ExportHandler reads track playlists directly in that case.
+ */
+int
+Session::start_offline_export ()
+{
+	assert (!engine().in_process_thread ());
+
+	if (!_exporting) {
+		pre_export ();
+	} else if (_transport_fsm->transport_speed() != 0) {
+		realtime_stop (true, true);
+	}
+
+	return 0;
+}
+
 /** Called for each range that is being exported */
 int
 Session::start_audio_export (samplepos_t position, bool realtime, bool region_export)
@@ -419,11 +419,21 @@ get_id_sorted_playlists (const List& playlists, IDSortedList& id_sorted_playlist
 
 } // anonymous namespace
 
+/** @param stream true to leave the Playlists and UnusedPlaylists nodes empty,
+ * the caller then adds the playlists using write_state().
+ */
 void
-SessionPlaylists::add_state (XMLNode* node, bool save_template, bool include_unused)
+SessionPlaylists::add_state (XMLNode* node, bool save_template, bool include_unused, bool stream)
 {
 	XMLNode* child = node->add_child ("Playlists");
 
+	if (stream) {
+		if (include_unused) {
+			node->add_child ("UnusedPlaylists");
+		}
+		return;
+	}
+
 	IDSortedList id_sorted_playlists;
 	get_id_sorted_playlists (playlists, id_sorted_playlists);
 
@@ -460,6 +470,23 @@ SessionPlaylists::add_state (XMLNode* node, bool save_template, bool include_unu
 	}
 }
 
+/** Write the state of the (unused) playlists, in the same order as add_state()
+ * adds them.
+ */
+void
+SessionPlaylists::write_state (XMLStreamWriter& writer, bool unused)
+{
+	IDSortedList id_sorted_playlists;
+	get_id_sorted_playlists (unused ? unused_playlists : playlists, id_sorted_playlists);
+
+	for (IDSortedList::iterator i = id_sorted_playlists.begin (); i != id_sorted_playlists.end (); ++i) {
+		if ((*i)->hidden () || (unused && (*i)->empty ())) {
+			continue;
+		}
+		(*i)->write_state (writer);
+	}
+}
+
 /** @return true for `stop cleanup', otherwise false */
 bool
 SessionPlaylists::maybe_delete_unused (boost::function<int(boost::shared_ptr<Playlist>)> ask)
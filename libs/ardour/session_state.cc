@@ -38,6 +38,7 @@
 #include <string>
 #include <cerrno>
 #include <cstdio> /* snprintf(3) ... grrr */
+#include <cstdlib>
 #include <cmath>
 
 #include <unistd.h>
@@ -78,13 +79,16 @@
 #include "evoral/SMF.h"
 
 #include "pbd/basename.h"
+#include "pbd/cpus.h"
 #include "pbd/debug.h"
 #include "pbd/enumwriter.h"
 #include "pbd/error.h"
 #include "pbd/file_utils.h"
+#include "pbd/memory_account.h"
 #include "pbd/pathexpand.h"
 #include "pbd/pthread_utils.h"
 #include "pbd/scoped_file_descriptor.h"
+#include "pbd/timing.h"
 #include "pbd/types_convert.h"
 #include "pbd/localtime_r.h"
 #include "pbd/unwind.h"
@@ -676,6 +680,8 @@ Session::maybe_write_autosave()
 void
 Session::remove_pending_capture_state ()
 {
+	cancel_background_save ();
+
 	std::string pending_state_file_path(_session_dir->root_path());
 
 	pending_state_file_path = Glib::build_filename (pending_state_file_path, legalize_for_path (_current_snapshot_name) + pending_suffix);
@@ -749,6 +755,53 @@ Session::remove_state (string snapshot_name)
 	StateSaved (snapshot_name); /* EMIT SIGNAL */
 }
 
+/** Write @param root to @param tmp_path and atomically replace the file at
+ * @param xml_path with it. If @param setup is set, it is called before
+ * writing to add the fillers for the nodes which were left empty.
+ * @return 0 on success
+ */
+static int
+write_state_file (XMLNode const & root, std::string const & tmp_path, std::string const & xml_path, std::string const & backup_path, XMLStreamWriter::Filler const & setup)
+{
+	XMLStreamWriter writer (tmp_path);
+
+	if (setup) {
+		setup (writer);
+	}
+
+	writer.node (root);
+
+	if (!writer.close ()) {
+		error << string_compose (_("state could not be saved to %1"), tmp_path) << endmsg;
+		if (g_remove (tmp_path.c_str()) != 0) {
+			error << string_compose(_("Could not remove temporary session file at path \"%1\" (%2)"),
+					tmp_path, g_strerror (errno)) << endmsg;
+		}
+		return -1;
+	}
+
+#ifndef NDEBUG
+	cerr << "renaming state to " << xml_path << endl;
+#endif
+
+	if (::g_rename (tmp_path.c_str(), xml_path.c_str()) != 0) {
+		error << string_compose (_("could not rename temporary session file %1 to %2 (%3)"),
+				tmp_path, xml_path, g_strerror(errno)) << endmsg;
+		if (g_remove (tmp_path.c_str()) != 0) {
+			error << string_compose(_("Could not remove temporary session file at path \"%1\" (%2)"),
+					tmp_path, g_strerror (errno)) << endmsg;
+		}
+		return -1;
+	}
+
+	if (!backup_path.empty() && !copy_file (xml_path, backup_path)) {
+		error << string_compose(_("Could not save backup file at path \"%1\" (%2)"),
+				backup_path, g_strerror (errno)) << endmsg;
+	}
+
+	return 0;
+}
+
 /** @param snapshot_name Name to save under, without .ardour / .pending prefix */
 int
 Session::save_state (string snapshot_name, bool pending, bool switch_to_snapshot, bool template_only, bool for_archive, bool only_used_assets)
@@ -795,6 +848,11 @@ Session::save_state (string snapshot_name, bool pending, bool switch_to_snapshot
 		_save_queued = false;
 	}
 
+	/* pending saves (backups) are not user-visible, they only need a copy
+	 * of the state taken here and are written by a background thread.
+	 */
+	bool const background = pending && Config->get_save_pending_state_in_background ();
+
 	snapshot_t fork_state = NormalSave;
 	if (!snapshot_name.empty() && snapshot_name != _current_snapshot_name && !template_only && !pending && !for_archive) {
 		/* snapshot, close midi */
@@ -828,7 +886,10 @@ Session::save_state (string snapshot_name, bool pending, bool switch_to_snapshot
 		mark_as_clean = false;
 		tree.set_root (&get_template());
 	} else {
-		tree.set_root (&state (false, fork_state, only_used_assets));
+		/* routes and playlists are streamed to the file when writing
+		 * it here, a background save needs a complete copy.
+		 */
+		tree.set_root (&state (false, fork_state, only_used_assets, !background));
 	}
 
 	if (snapshot_name.empty()) {
@@ -859,36 +920,9 @@ Session::save_state (string snapshot_name, bool pending, bool switch_to_snapshot
 	}
 
 	std::string tmp_path(_session_dir->root_path());
-	tmp_path = Glib::build_filename (tmp_path, legalize_for_path (snapshot_name) + temp_suffix);
-
-#ifndef NDEBUG
-	cerr << "actually writing state to " << tmp_path << endl;
-#endif
-
-	if (!tree.write (tmp_path)) {
-		error << string_compose (_("state could not be saved to %1"), tmp_path) << endmsg;
-		if (g_remove (tmp_path.c_str()) != 0) {
-			error << string_compose(_("Could not remove temporary session file at path \"%1\" (%2)"),
-					tmp_path, g_strerror (errno)) << endmsg;
-		}
-		return -1;
-
-	} else {
+	tmp_path = Glib::build_filename (tmp_path, legalize_for_path (snapshot_name) + (background ? pending_suffix : "") + temp_suffix);
 
-#ifndef NDEBUG
-		cerr << "renaming state to " << xml_path << endl;
-#endif
-
-		if (::g_rename (tmp_path.c_str(), xml_path.c_str()) != 0) {
-			error << string_compose (_("could not rename temporary session file %1 to %2 (%3)"),
-					tmp_path, xml_path, g_strerror(errno)) << endmsg;
-			if (g_remove (tmp_path.c_str()) != 0) {
-				error << string_compose(_("Could not remove temporary session file at path \"%1\" (%2)"),
-						tmp_path, g_strerror (errno)) << endmsg;
-			}
-			return -1;
-		}
-	}
+	std::string backup_path;
 
 	//Mixbus auto-backup mechanism
 	if(Profile->get_mixbus()) {
@@ -902,16 +936,41 @@ Session::save_state (string snapshot_name, bool pending, bool switch_to_snapshot
 			time (&n);
 			localtime_r (&n, &local_time);
 			strftime (timebuf, sizeof(timebuf), "%y-%m-%d.%H", &local_time);
-			std::string save_path(session_directory().backup_path());
-			save_path += G_DIR_SEPARATOR;
-			save_path += legalize_for_path(_current_snapshot_name);
-			save_path += "-";
-			save_path += timebuf;
-			save_path += statefile_suffix;
-			if (!copy_file (xml_path, save_path)) {
-					error << string_compose(_("Could not save backup file at path \"%1\" (%2)"),
-							save_path, g_strerror (errno)) << endmsg;
-			}
+			backup_path = session_directory().backup_path();
+			backup_path += G_DIR_SEPARATOR;
+			backup_path += legalize_for_path(_current_snapshot_name);
+			backup_path += "-";
+			backup_path += timebuf;
+			backup_path += statefile_suffix;
+		}
+	}
+
+	if (background) {
+
+		BackgroundSave* bs = new BackgroundSave;
+		bs->state       = tree.root ();
+		bs->tmp_path    = tmp_path;
+		bs->xml_path    = xml_path;
+		bs->backup_path = backup_path;
+
+		tree.set_root (0);
+		queue_background_save (bs);
+
+	} else {
+
+#ifndef NDEBUG
+		cerr << "actually writing state to " << tmp_path << endl;
+#endif
+
+		LocaleGuard lg;
+		XMLStreamWriter::Filler setup;
+
+		if (!template_only) {
+			setup = boost::bind (&Session::add_state_fillers, this, _1, boost::cref (*tree.root()));
+		}
+
+		if (write_state_file (*tree.root(), tmp_path, xml_path, backup_path, setup)) {
+			return -1;
 		}
 	}
 
@@ -938,6 +997,105 @@ Session::save_state (string snapshot_name, bool pending, bool switch_to_snapshot
 	return 0;
 }
 
+/** Hand a copy of the state to the background save thread. Only the most
+ * recent state matters, so a save that has not been started yet is
+ * replaced.
+ */
+void
+Session::queue_background_save (BackgroundSave* bs)
+{
+	Glib::Threads::Mutex::Lock lm (_background_save_lock);
+
+	if (!_background_save_thread) {
+		try {
+			_background_save_thread = Glib::Threads::Thread::create (boost::bind (&Session::background_save_thread, this));
+		} catch (...) {
+			lm.release ();
+			error << _("Session: could not create background save thread, saving in the foreground") << endmsg;
+			write_state_file (*bs->state, bs->tmp_path, bs->xml_path, bs->backup_path, XMLStreamWriter::Filler ());
+			delete bs->state;
+			delete bs;
+			return;
+		}
+	}
+
+	if (_background_save) {
+		delete _background_save->state;
+		delete _background_save;
+	}
+
+	_background_save = bs;
+	_background_save_cond.signal ();
+}
+
+/** Drop a queued background save and wait for one in progress to finish.
+ * Called when the pending state is about to be removed, so that it cannot
+ * be re-created by a save that was started earlier.
+ */
+void
+Session::cancel_background_save ()
+{
+	Glib::Threads::Mutex::Lock lm (_background_save_lock);
+
+	if (_background_save) {
+		delete _background_save->state;
+		delete _background_save;
+		_background_save = 0;
+	}
+
+	Glib::Threads::Mutex::Lock lw (_background_write_lock);
+}
+
+void
+Session::background_save_thread ()
+{
+	pthread_set_name (X_("SessionSave"));
+
+	Glib::Threads::Mutex::Lock lm (_background_save_lock);
+
+	while (!_background_save_quit) {
+
+		if (!_background_save) {
+			_background_save_cond.wait (_background_save_lock);
+			continue;
+		}
+
+		BackgroundSave* bs = _background_save;
+		_background_save = 0;
+
+		Glib::Threads::Mutex::Lock lw (_background_write_lock);
+		lm.release ();
+
+		write_state_file (*bs->state, bs->tmp_path, bs->xml_path, bs->backup_path, XMLStreamWriter::Filler ());
+
+		delete bs->state;
+		delete bs;
+
+		lw.release ();
+		lm.acquire ();
+	}
+}
+
+void
+Session::background_save_thread_terminate ()
+{
+	cancel_background_save ();
+
+	{
+		Glib::Threads::Mutex::Lock lm (_background_save_lock);
+
+		if (!_background_save_thread) {
+			return;
+		}
+
+		_background_save_quit = true;
+		_background_save_cond.signal ();
+	}
+
+	_background_save_thread->join ();
+	_background_save_thread = 0;
+}
+
 int
 Session::restore_state (string snapshot_name)
 {
@@ -995,7 +1153,7 @@ Session::load_state (string snapshot_name, bool from_template)
 
 	_writable = exists_and_writable (xmlpath) && exists_and_writable(Glib::path_get_dirname(xmlpath));
 
-	if (!state_tree->read (xmlpath)) {
+	if (!state_tree->read_streaming (xmlpath)) {
 		error << string_compose(_("Could not understand session file %1"), xmlpath) << endmsg;
 		delete state_tree;
 		state_tree = 0;
@@ -1168,8 +1326,45 @@ struct route_id_compare {
 };
 } // anon namespace
 
+/** Write the state of all routes, in the same order as state() adds them.
+ * Routes hold most of the state of a session (processors, plugin state,
+ * automation), so writing them one at a time saves building, and holding,
+ * the complete tree.
+ */
+void
+Session::write_route_states (XMLStreamWriter& writer)
+{
+	boost::shared_ptr<RouteList> r = routes.reader ();
+
+	route_id_compare cmp;
+	RouteList xml_node_order (*r);
+	xml_node_order.sort (cmp);
+
+	for (RouteList::const_iterator i = xml_node_order.begin(); i != xml_node_order.end(); ++i) {
+		if (!(*i)->is_auditioner()) {
+			(*i)->write_state (writer);
+		}
+	}
+}
+
+/** Add fillers which write the routes and playlists to the nodes that
+ * state() left empty when streaming.
+ */
+void
+Session::add_state_fillers (XMLStreamWriter& writer, XMLNode const& root)
+{
+	writer.add_filler (root.child ("Routes"), boost::bind (&Session::write_route_states, this, _1));
+	writer.add_filler (root.child ("Playlists"), boost::bind (&SessionPlaylists::write_state, _playlists, _1, false));
+
+	XMLNode const* unused = root.child ("UnusedPlaylists");
+
+	if (unused) {
+		writer.add_filler (unused, boost::bind (&SessionPlaylists::write_state, _playlists, _1, true));
+	}
+}
+
 XMLNode&
-Session::state (bool save_template, snapshot_t snapshot_type, bool only_used_assets)
+Session::state (bool save_template, snapshot_t snapshot_type, bool only_used_assets, bool stream)
 {
 	LocaleGuard lg;
 	XMLNode* node = new XMLNode("Session");
@@ -1472,7 +1667,10 @@ Session::state (bool save_template, snapshot_t snapshot_type, bool only_used_ass
 	node->add_child_nocopy (_vca_manager->get_state());
 
 	child = node->add_child ("Routes");
-	{
+
+	if (stream) {
+		/* the caller adds the routes using write_route_states() */
+	} else {
 		boost::shared_ptr<RouteList> r = routes.reader ();
 
 		route_id_compare cmp;
@@ -1490,7 +1688,7 @@ Session::state (bool save_template, snapshot_t snapshot_type, bool only_used_ass
 		}
 	}
 
-	_playlists->add_state (node, save_template, !only_used_assets);
+	_playlists->add_state (node, save_template, !only_used_assets, stream);
 
 	child = node->add_child ("RouteGroups");
 	for (list<RouteGroup *>::iterator i = _route_groups.begin(); i != _route_groups.end(); ++i) {
@@ -1540,6 +1738,15 @@ Session::get_control_protocol_state ()
 	return ControlProtocolManager::instance().get_state ();
 }
 
+static void
+add_load_phase (std::string& phases, PBD::Timing& timing, char const* name)
+{
+	if (!phases.empty ()) {
+		phases += ", ";
+	}
+	phases += string_compose ("%1: %2 ms", name, timing.get_interval () / 1000);
+}
+
 int
 Session::set_state (const XMLNode& node, int version)
 {
@@ -1548,6 +1755,10 @@ Session::set_state (const XMLNode& node, int version)
 	XMLNode* child;
 	int ret = -1;
 
+	PBD::Timing total_timing;
+	PBD::Timing phase_timing;
+	std::string phases;
+
 	_state_of_the_state = StateOfTheState (_state_of_the_state | CannotSave);
 
 	if (node.name() != X_("Session")) {
@@ -1649,6 +1860,8 @@ Session::set_state (const XMLNode& node, int version)
 		_speakers->set_state (*child, version);
 	}
 
+	add_load_phase (phases, phase_timing, "setup");
+
 	if ((child = find_named_node (node, "Sources")) == 0) {
 		error << _("Session: XML state has no sources section") << endmsg;
 		goto out;
@@ -1656,6 +1869,8 @@ Session::set_state (const XMLNode& node, int version)
 		goto out;
 	}
 
+	add_load_phase (phases, phase_timing, "sources");
+
 	if ((child = find_named_node (node, "Locations")) == 0) {
 		error << _("Session: XML state has no locations section") << endmsg;
 		goto out;
@@ -1669,6 +1884,8 @@ Session::set_state (const XMLNode& node, int version)
 		AudioFileSource::set_header_position_offset (_session_range_location->start().samples());
 	}
 
+	add_load_phase (phases, phase_timing, "locations");
+
 	if ((child = find_named_node (node, "Regions")) == 0) {
 		error << _("Session: XML state has no Regions section") << endmsg;
 		goto out;
@@ -1676,6 +1893,8 @@ Session::set_state (const XMLNode& node, int version)
 		goto out;
 	}
 
+	add_load_phase (phases, phase_timing, "regions");
+
 	if ((child = find_named_node (node, "Playlists")) == 0) {
 		error << _("Session: XML state has no playlists section") << endmsg;
 		goto out;
@@ -1695,6 +1914,8 @@ Session::set_state (const XMLNode& node, int version)
 		}
 	}
 
+	add_load_phase (phases, phase_timing, "playlists");
+
 	if (version >= 3000) {
 		if ((child = find_named_node (node, "Bundles")) == 0) {
 			warning << _("Session: XML state has no bundles section") << endmsg;
@@ -1774,6 +1995,8 @@ Session::set_state (const XMLNode& node, int version)
 		}
 	}
 
+	add_load_phase (phases, phase_timing, "whole-file regions");
+
 	if ((child = find_named_node (node, "Routes")) == 0) {
 		error << _("Session: XML state has no routes section") << endmsg;
 		goto out;
@@ -1781,6 +2004,8 @@ Session::set_state (const XMLNode& node, int version)
 		goto out;
 	}
 
+	add_load_phase (phases, phase_timing, "routes");
+
 	/* Now that we Tracks have been loaded and playlists are assigned */
 	_playlists->update_tracking ();
 
@@ -1851,6 +2076,10 @@ Session::set_state (const XMLNode& node, int version)
 	update_route_record_state ();
 	sync_cues ();
 
+	add_load_phase (phases, phase_timing, "other");
+	total_timing.update ();
+	info << string_compose (_("Session state loaded in %1 ms (%2)"), total_timing.elapsed_msecs (), phases) << endmsg;
+
 	/* here beginneth the second phase ... */
 	set_snapshot_name (_current_snapshot_name);
 
@@ -2431,6 +2660,80 @@ Session::reset_write_sources (bool mark_write_complete, bool force)
 	}
 }
 
+namespace {
+
+/** What a worker found out about the file of an audio source */
+struct AudioFileProbe {
+	AudioFileProbe () : node (0), index (0) {}
+
+	XMLNode const* node;
+	size_t         index;   ///< of node in the session's list of sources
+	std::string    failure; ///< why the file could not be opened, empty if it could
+};
+
+}
+
+/** Find the file of an audio source and read its header, on a worker
+ * thread, so that it is in the OS's cache by the time the source is
+ * created. This does not create the source: sources report problems via
+ * the PBD transmitters, which must only be used by one thread at a time.
+ * Failures are recorded instead, Session::load_sources() reports them.
+ */
+static void
+probe_audio_file (std::vector<std::string> const* dirs, AudioFileProbe* probe)
+{
+	std::string name;
+
+	if (!probe->node->get_property (X_("name"), name)) {
+		probe->failure = _("no file name");
+		return;
+	}
+
+	std::vector<std::string> paths;
+
+	if (Glib::path_is_absolute (name)) {
+		paths.push_back (name);
+	} else {
+		for (std::vector<std::string>::const_iterator d = dirs->begin (); d != dirs->end (); ++d) {
+			paths.push_back (Glib::build_filename (*d, name));
+		}
+	}
+
+	for (std::vector<std::string>::const_iterator p = paths.begin (); p != paths.end (); ++p) {
+
+		if (!Glib::file_test (*p, Glib::FILE_TEST_IS_REGULAR)) {
+			continue;
+		}
+
+#ifdef PLATFORM_WINDOWS
+		int fd = g_open (p->c_str (), O_RDONLY, 0444);
+#else
+		int fd = ::open (p->c_str (), O_RDONLY, 0444);
+#endif
+		if (fd == -1) {
+			probe->failure = g_strerror (errno);
+			return;
+		}
+
+		SF_INFO info;
+		info.format = 0;
+
+		SNDFILE* sf = sf_open_fd (fd, SFM_READ, &info, true);
+
+		if (!sf) {
+			char errbuf[256];
+			sf_error_str (0, errbuf, sizeof (errbuf) - 1);
+			probe->failure = errbuf;
+			return;
+		}
+
+		sf_close (sf);
+		return;
+	}
+
+	probe->failure = _("file not found");
+}
+
 int
 Session::load_sources (const XMLNode& node)
 {
@@ -2447,10 +2750,60 @@ Session::load_sources (const XMLNode& node)
 	set_dirty();
 	std::map<std::string, std::string> relocation;
 
-	for (niter = nlist.begin(); niter != nlist.end(); ++niter) {
+	/* MIDI models are loaded all at once, after all sources exist */
+	std::vector<boost::shared_ptr<SMFSource> > midi_sources;
+
+	/* Opening and probing audio files is mostly waiting for the disk, so
+	 * do that for all (plain) audio file sources in parallel first. The
+	 * sources themselves are then created by the loop below, in the order
+	 * of the XML, and find their files in the cache.
+	 */
+	std::vector<AudioFileProbe> probes;
+	{
+		size_t n = 0;
+
+		for (niter = nlist.begin(); niter != nlist.end(); ++niter, ++n) {
+			DataType type = DataType::AUDIO;
+			(*niter)->get_property (X_("type"), type);
+			if ((*niter)->name() == X_("Source") && type == DataType::AUDIO && !(*niter)->property (X_("playlist"))) {
+				probes.push_back (AudioFileProbe ());
+				probes.back ().node  = *niter;
+				probes.back ().index = n;
+			}
+		}
+
+		if (probes.size () > 1) {
+			std::vector<std::string> const dirs (source_search_path (DataType::AUDIO));
+#ifdef PLATFORM_WINDOWS
+			int old_mode = SetErrorMode(SEM_FAILCRITICALERRORS);
+#endif
+			Glib::ThreadPool pool (std::max<uint32_t> (1, std::min<uint32_t> (hardware_concurrency (), probes.size ())));
+			for (size_t i = 0; i < probes.size (); ++i) {
+				pool.push (sigc::bind (sigc::ptr_fun (&probe_audio_file), &dirs, &probes[i]));
+			}
+			/* wait for all queued work to complete */
+			pool.shutdown ();
+#ifdef PLATFORM_WINDOWS
+			SetErrorMode(old_mode);
+#endif
+		} else {
+			probes.clear ();
+		}
+	}
+
+	size_t n = 0;
+	std::vector<AudioFileProbe>::const_iterator probe = probes.begin ();
+
+	for (niter = nlist.begin(); niter != nlist.end(); ++niter, ++n) {
 #ifdef PLATFORM_WINDOWS
 		int old_mode = 0;
 #endif
+		std::string probe_failure;
+
+		if (probe != probes.end () && probe->index == n) {
+			probe_failure = probe->failure;
+			++probe;
+		}
 
 		XMLNode srcnode (**niter);
 		bool try_replace_abspath = true;
@@ -2461,8 +2814,14 @@ retry:
 			// do not show "insert media" popups (files embedded from removable media).
 			old_mode = SetErrorMode(SEM_FAILCRITICALERRORS);
 #endif
-			if ((source = XMLSourceFactory (srcnode)) == 0) {
-				error << _("Session: cannot create Source from XML description.") << endmsg;
+			if ((source = XMLSourceFactory (srcnode, true)) == 0) {
+				if (probe_failure.empty ()) {
+					error << _("Session: cannot create Source from XML description.") << endmsg;
+				} else {
+					error << string_compose (_("Session: cannot create Source from XML description (%1)."), probe_failure) << endmsg;
+				}
+			} else if (boost::shared_ptr<SMFSource> smf = boost::dynamic_pointer_cast<SMFSource> (source)) {
+				midi_sources.push_back (smf);
 			}
 #ifdef PLATFORM_WINDOWS
 			SetErrorMode(old_mode);
@@ -2568,11 +2927,13 @@ retry:
 		}
 	}
 
+	SMFSource::load_models (midi_sources);
+
 	return 0;
 }
 
 boost::shared_ptr<Source>
-Session::XMLSourceFactory (const XMLNode& node)
+Session::XMLSourceFactory (const XMLNode& node, bool defer_midi_model)
 {
 	if (node.name() != "Source") {
 		return boost::shared_ptr<Source>();
@@ -2580,7 +2941,7 @@ Session::XMLSourceFactory (const XMLNode& node)
 
 	try {
 		/* note: do peak building in another thread when loading session state */
-		return SourceFactory::create (*this, node, true);
+		return SourceFactory::create (*this, node, true, defer_midi_model);
 	}
 
 	catch (failed_constructor& err) {
@@ -3795,13 +4156,15 @@ Session::cleanup_trash_sources (CleanupReport& rep)
 void
 Session::set_dirty ()
 {
-	/* return early if there's nothing to do */
-	if (dirty ()) {
+	/* never mark session dirty during loading */
+	if (loading () || deletion_in_progress ()) {
 		return;
 	}
 
-	/* never mark session dirty during loading */
-	if (loading () || deletion_in_progress ()) {
+	g_atomic_int_inc (&_modification_count);
+
+	/* return early if there's nothing to do */
+	if (dirty ()) {
 		return;
 	}
 
@@ -3901,6 +4264,86 @@ Session::instant_xml (const string& node_name)
 	return Stateful::instant_xml (node_name, _path);
 }
 
+/* The undo history journal.
+ *
+ * With incremental-history enabled, the .history file is only rewritten
+ * every now and then. In between, each save appends a record to the
+ * journal that describes how the saved list of transactions changed: the
+ * first "drop" transactions are removed, the following "keep" are
+ * retained and the transactions that are children of the record are
+ * appended. The first record describes the .history file itself.
+ *
+ * The journal is a text file: a header line, then each record as its size
+ * in bytes on a line of its own, followed by an XML document.
+ */
+
+static const char* const history_journal_header = "ArdourHistoryJournal 1\n";
+
+static int
+write_history_journal_record (std::string const& path, XMLNode* node, bool create)
+{
+	XMLTree tree;
+	tree.set_root (node);
+
+	std::string const& buf (tree.write_buffer ());
+
+	FILE* f = g_fopen (path.c_str(), create ? "wb" : "ab");
+
+	if (!f) {
+		return -1;
+	}
+
+	if (create) {
+		fputs (history_journal_header, f);
+	}
+
+	fprintf (f, "%lu\n", (unsigned long) buf.size ());
+	fwrite (buf.data (), 1, buf.size (), f);
+	fputc ('\n', f);
+
+	bool const ok = !ferror (f) && fflush (f) == 0;
+
+	fclose (f);
+	return ok ? 0 : -1;
+}
+
+static bool
+read_history_journal (std::string const& path, std::vector<std::string>& records)
+{
+	std::string contents;
+
+	try {
+		contents = Glib::file_get_contents (path);
+	} catch (...) {
+		return false;
+	}
+
+	size_t const header = strlen (history_journal_header);
+
+	if (contents.compare (0, header, history_journal_header)) {
+		return false;
+	}
+
+	for (size_t pos = header; pos < contents.size (); ) {
+		size_t const eol = contents.find ('\n', pos);
+		if (eol == std::string::npos) {
+			break;
+		}
+
+		unsigned long const len = strtoul (contents.c_str () + pos, NULL, 10);
+
+		if (len == 0 || eol + 1 + len > contents.size ()) {
+			/* incomplete record, e.g. when running out of disk space */
+			break;
+		}
+
+		records.push_back (contents.substr (eol + 1, len));
+		pos = eol + 1 + len + 1;
+	}
+
+	return true;
+}
+
 int
 Session::save_history (string snapshot_name)
 {
@@ -3918,6 +4361,31 @@ Session::save_history (string snapshot_name)
 	const string backup_filename = history_filename + backup_suffix;
 	const std::string xml_path(Glib::build_filename (_session_dir->root_path(), history_filename));
 	const std::string backup_path(Glib::build_filename (_session_dir->root_path(), backup_filename));
+	const std::string journal_path (xml_path + history_journal_suffix);
+
+	if (Config->get_incremental_history() && Config->get_save_history() && Config->get_saved_history_depth() >= 0 &&
+	    snapshot_name == _history_journal_snapshot && Glib::file_test (journal_path, Glib::FILE_TEST_EXISTS)) {
+		if (append_history_journal (journal_path) == 0) {
+			return 0;
+		}
+		/* otherwise rewrite everything */
+	}
+
+	/* deferred transactions are read from the files which are about to
+	 * be replaced, load them first.
+	 */
+	if (Config->get_save_history() && Config->get_saved_history_depth() >= 0 && !_history.load_deferred ()) {
+		error << _("could not load the saved undo history, current history not saved") << endmsg;
+		return -1;
+	}
+
+	if (Glib::file_test (journal_path, Glib::FILE_TEST_EXISTS)) {
+		::g_unlink (journal_path.c_str());
+	}
+
+	if (snapshot_name == _history_journal_snapshot) {
+		_history_journal_snapshot = "";
+	}
 
 	if (Glib::file_test (xml_path, Glib::FILE_TEST_EXISTS)) {
 		if (::g_rename (xml_path.c_str(), backup_path.c_str()) != 0) {
@@ -3949,9 +4417,212 @@ Session::save_history (string snapshot_name)
 		return -1;
 	}
 
+	if (Config->get_incremental_history()) {
+		start_history_journal (snapshot_name, xml_path, tree.root()->children().size());
+	}
+
+	return 0;
+}
+
+/** Start a new journal for the .history file at @param xml_path, which
+ * has just been written with @param n transactions.
+ */
+void
+Session::start_history_journal (std::string const& snapshot_name, std::string const& xml_path, uint32_t n)
+{
+	GStatBuf statbuf;
+
+	if (g_stat (xml_path.c_str(), &statbuf) != 0) {
+		return;
+	}
+
+	XMLNode* node = new XMLNode (X_("HistoryJournal"));
+
+	node->set_property (X_("base-size"), (int64_t) statbuf.st_size);
+	node->set_property (X_("drop"), (uint32_t) 0);
+	node->set_property (X_("keep"), n);
+	node->set_property (X_("written"), n);
+	node->set_property (X_("next"), _history.next_undo ());
+
+	if (write_history_journal_record (xml_path + history_journal_suffix, node, true)) {
+		warning << string_compose (_("Could not write undo history journal for %1"), xml_path) << endmsg;
+		return;
+	}
+
+	_history.mark_saved (Config->get_saved_history_depth());
+	_history_journal_snapshot = snapshot_name;
+	_history_journal_written  = n;
+}
+
+/** Append all changes to the undo history since it was last saved to
+ * the journal at @param journal_path.
+ *
+ * @return 0 on success, 1 if the history should be rewritten instead
+ */
+int
+Session::append_history_journal (std::string const& journal_path)
+{
+	uint32_t const depth = Config->get_saved_history_depth();
+	uint32_t drop;
+	uint32_t keep;
+	std::list<UndoTransaction*> added;
+
+	_history.changes_since_save (depth, drop, keep, added);
+
+	if (drop == 0 && keep == _history.saved_size () && added.empty ()) {
+		return 0;
+	}
+
+	/* compact the journal once the files hold twice as many transactions
+	 * as the saved history, so loading remains bounded.
+	 */
+	if (_history_journal_written + added.size () > 2 * std::max (depth, (uint32_t) 16)) {
+		return 1;
+	}
+
+	XMLNode* node = new XMLNode (X_("HistoryJournal"));
+
+	node->set_property (X_("drop"), drop);
+	node->set_property (X_("keep"), keep);
+	node->set_property (X_("written"), (uint32_t) (_history_journal_written + added.size ()));
+	node->set_property (X_("next"), _history.next_undo ());
+
+	for (std::list<UndoTransaction*>::const_iterator i = added.begin(); i != added.end(); ++i) {
+		node->add_child_nocopy ((*i)->get_state ());
+	}
+
+	if (write_history_journal_record (journal_path, node, false)) {
+		error << string_compose (_("Could not append to undo history journal %1 (%2)"), journal_path, g_strerror (errno)) << endmsg;
+		return 1;
+	}
+
+	_history.mark_saved (depth);
+	_history_journal_written += added.size ();
+
+	return 0;
+}
+
+/** Set up deferred loading of the history described by the journal at
+ * @param journal_path
+ *
+ * @return 0 on success, 1 if there is no (usable) journal
+ */
+int
+Session::restore_history_journal (std::string const& snapshot_name, std::string const& xml_path, std::string const& journal_path)
+{
+	std::vector<std::string> records;
+
+	if (!Glib::file_test (journal_path, Glib::FILE_TEST_EXISTS)) {
+		return 1;
+	}
+
+	if (!read_history_journal (journal_path, records) || records.empty ()) {
+		warning << string_compose (_("Ignoring damaged undo history journal %1"), journal_path) << endmsg;
+		return 1;
+	}
+
+	XMLTree  first;
+	int64_t  base_size;
+	uint32_t written = 0;
+	uint32_t n = 0;
+	std::string next;
+	GStatBuf statbuf;
+
+	if (!first.read_buffer (records.front ().c_str ()) || !first.root ()->get_property (X_("base-size"), base_size) ||
+	    !first.root ()->get_property (X_("keep"), n) || g_stat (xml_path.c_str(), &statbuf) != 0 || statbuf.st_size != base_size) {
+		/* the history file was written without updating the journal,
+		 * e.g. by an older version of Ardour.
+		 */
+		warning << string_compose (_("Ignoring outdated undo history journal %1"), journal_path) << endmsg;
+		return 1;
+	}
+
+	/* count the transactions, without creating them */
+	for (std::vector<std::string>::const_iterator r = records.begin(); r != records.end(); ++r) {
+		XMLTree tree;
+		uint32_t drop;
+		uint32_t keep;
+
+		if (!tree.read_buffer (r->c_str ()) || !tree.root ()->get_property (X_("drop"), drop) || !tree.root ()->get_property (X_("keep"), keep)) {
+			warning << string_compose (_("Ignoring damaged undo history journal %1"), journal_path) << endmsg;
+			return 1;
+		}
+
+		n = std::min (n > drop ? n - drop : 0, keep) + tree.root ()->children ().size ();
+
+		tree.root ()->get_property (X_("written"), written);
+		tree.root ()->get_property (X_("next"), next);
+	}
+
+	/* the deferred transactions are the saved ones */
+	_history.set_deferred (n, next, boost::bind (&Session::load_history_journal, this, xml_path, records));
+
+	_history_journal_snapshot = snapshot_name;
+	_history_journal_written  = written;
+
+	info << string_compose (_("Deferred loading of %1 undo transactions"), n) << endmsg;
+
 	return 0;
 }
 
+/** Create the transactions of a history that was restored from a journal */
+std::vector<UndoTransaction*>
+Session::load_history_journal (std::string const& xml_path, std::vector<std::string> const& records)
+{
+	std::vector<UndoTransaction*> transactions;
+	std::vector<boost::shared_ptr<XMLTree> > trees;
+	std::vector<XMLNode const*> nodes;
+
+	PBD::Timing timing;
+	timing.start ();
+
+	boost::shared_ptr<XMLTree> base (new XMLTree);
+
+	if (!base->read_streaming (xml_path)) {
+		error << string_compose (_("Could not understand session history file \"%1\""), xml_path) << endmsg;
+		return transactions;
+	}
+
+	trees.push_back (base);
+	nodes.insert (nodes.end(), base->root()->children().begin(), base->root()->children().end());
+
+	for (std::vector<std::string>::const_iterator r = records.begin(); r != records.end(); ++r) {
+		boost::shared_ptr<XMLTree> tree (new XMLTree);
+		uint32_t drop = 0;
+		uint32_t keep = 0;
+
+		if (!tree->read_buffer (r->c_str ())) {
+			break;
+		}
+
+		tree->root ()->get_property (X_("drop"), drop);
+		tree->root ()->get_property (X_("keep"), keep);
+
+		nodes.erase (nodes.begin(), nodes.begin() + std::min ((size_t) drop, nodes.size ()));
+		nodes.resize (std::min ((size_t) keep, nodes.size ()));
+		nodes.insert (nodes.end(), tree->root()->children().begin(), tree->root()->children().end());
+
+		trees.push_back (tree);
+	}
+
+	transactions.reserve (nodes.size ());
+
+	try {
+		for (std::vector<XMLNode const*>::const_iterator n = nodes.begin(); n != nodes.end(); ++n) {
+			transactions.push_back (history_transaction_from_xml (**n));
+		}
+	} catch (std::exception const & e) {
+		error << string_compose (_("Error during loading undo history (%1). Undo history will be ignored"), e.what()) << endmsg;
+	}
+
+	transactions.resize (nodes.size (), 0);
+
+	timing.update ();
+	info << string_compose (_("Loaded %1 undo transactions in %2 ms"), transactions.size (), timing.elapsed_msecs ()) << endmsg;
+
+	return transactions;
+}
+
 int
 Session::restore_history (string snapshot_name)
 {
@@ -3972,7 +4643,14 @@ Session::restore_history (string snapshot_name)
 		return 1;
 	}
 
-	if (!tree.read (xml_path)) {
+	/* the journal is used even if incremental saving has been disabled,
+	 * since the history file on its own is outdated.
+	 */
+	if (restore_history_journal (snapshot_name, xml_path, xml_path + history_journal_suffix) == 0) {
+		return 0;
+	}
+
+	if (!tree.read_streaming (xml_path)) {
 		error << string_compose (_("Could not understand session history file \"%1\""),
 				xml_path) << endmsg;
 		return -1;
@@ -3983,89 +4661,96 @@ Session::restore_history (string snapshot_name)
 
 	try {
 		for (XMLNodeConstIterator it  = tree.root()->children().begin(); it != tree.root()->children().end(); ++it) {
+			UndoTransaction* ut = history_transaction_from_xml (**it);
+			if (ut) {
+				_history.add (ut);
+			}
+		}
 
-			XMLNode *t = *it;
+	} catch (std::exception const & e) {
+		error << string_compose (_("Error during loading undo history (%1). Undo history will be ignored"), e.what()) << endmsg;
+	}
 
-			std::string name;
-			int64_t tv_sec;
-			int64_t tv_usec;
+	return 0;
+}
 
-			if (!t->get_property ("name", name) || !t->get_property ("tv-sec", tv_sec) ||
-			    !t->get_property ("tv-usec", tv_usec)) {
-				continue;
-			}
+/** @return a new UndoTransaction for the state in @param t, or 0 */
+UndoTransaction*
+Session::history_transaction_from_xml (XMLNode const & t)
+{
+	std::string name;
+	int64_t tv_sec;
+	int64_t tv_usec;
 
-			UndoTransaction* ut = new UndoTransaction ();
-			ut->set_name (name);
+	if (!t.get_property ("name", name) || !t.get_property ("tv-sec", tv_sec) ||
+	    !t.get_property ("tv-usec", tv_usec)) {
+		return 0;
+	}
 
-			struct timeval tv;
-			tv.tv_sec = tv_sec;
-			tv.tv_usec = tv_usec;
-			ut->set_timestamp(tv);
+	UndoTransaction* ut = new UndoTransaction ();
+	ut->set_name (name);
 
-			for (XMLNodeConstIterator child_it  = t->children().begin();
-			     child_it != t->children().end(); child_it++)
-			{
-				XMLNode *n = *child_it;
-				Command *c;
+	struct timeval tv;
+	tv.tv_sec = tv_sec;
+	tv.tv_usec = tv_usec;
+	ut->set_timestamp(tv);
 
-				if (n->name() == "MementoCommand" ||
-				    n->name() == "MementoUndoCommand" ||
-				    n->name() == "MementoRedoCommand") {
+	for (XMLNodeConstIterator child_it  = t.children().begin();
+	     child_it != t.children().end(); child_it++)
+	{
+		XMLNode *n = *child_it;
+		Command *c;
 
-					if ((c = memento_command_factory(n))) {
-						ut->add_command(c);
-					}
+		if (n->name() == "MementoCommand" ||
+		    n->name() == "MementoUndoCommand" ||
+		    n->name() == "MementoRedoCommand") {
 
-				} else if (n->name() == "NoteDiffCommand") {
-					PBD::ID id (n->property("midi-source")->value());
-					boost::shared_ptr<MidiSource> midi_source =
-						boost::dynamic_pointer_cast<MidiSource, Source>(source_by_id(id));
-					if (midi_source) {
-						ut->add_command (new MidiModel::NoteDiffCommand(midi_source->model(), *n));
-					} else {
-						error << _("Failed to downcast MidiSource for NoteDiffCommand") << endmsg;
-					}
+			if ((c = memento_command_factory(n))) {
+				ut->add_command(c);
+			}
 
-				} else if (n->name() == "SysExDiffCommand") {
+		} else if (n->name() == "NoteDiffCommand") {
+			PBD::ID id (n->property("midi-source")->value());
+			boost::shared_ptr<MidiSource> midi_source =
+				boost::dynamic_pointer_cast<MidiSource, Source>(source_by_id(id));
+			if (midi_source) {
+				ut->add_command (midi_diff_command_factory (midi_source, *n));
+			} else {
+				error << _("Failed to downcast MidiSource for NoteDiffCommand") << endmsg;
+			}
 
-					PBD::ID id (n->property("midi-source")->value());
-					boost::shared_ptr<MidiSource> midi_source =
-						boost::dynamic_pointer_cast<MidiSource, Source>(source_by_id(id));
-					if (midi_source) {
-						ut->add_command (new MidiModel::SysExDiffCommand (midi_source->model(), *n));
-					} else {
-						error << _("Failed to downcast MidiSource for SysExDiffCommand") << endmsg;
-					}
+		} else if (n->name() == "SysExDiffCommand") {
 
-				} else if (n->name() == "PatchChangeDiffCommand") {
+			PBD::ID id (n->property("midi-source")->value());
+			boost::shared_ptr<MidiSource> midi_source =
+				boost::dynamic_pointer_cast<MidiSource, Source>(source_by_id(id));
+			if (midi_source) {
+				ut->add_command (midi_diff_command_factory (midi_source, *n));
+			} else {
+				error << _("Failed to downcast MidiSource for SysExDiffCommand") << endmsg;
+			}
 
-					PBD::ID id (n->property("midi-source")->value());
-					boost::shared_ptr<MidiSource> midi_source =
-						boost::dynamic_pointer_cast<MidiSource, Source>(source_by_id(id));
-					if (midi_source) {
-						ut->add_command (new MidiModel::PatchChangeDiffCommand (midi_source->model(), *n));
-					} else {
-						error << _("Failed to downcast MidiSource for PatchChangeDiffCommand") << endmsg;
-					}
+		} else if (n->name() == "PatchChangeDiffCommand") {
 
-				} else if (n->name() == "StatefulDiffCommand") {
-					if ((c = stateful_diff_command_factory (n))) {
-						ut->add_command (c);
-					}
-				} else {
-					error << string_compose(_("Couldn't figure out how to make a Command out of a %1 XMLNode."), n->name()) << endmsg;
-				}
+			PBD::ID id (n->property("midi-source")->value());
+			boost::shared_ptr<MidiSource> midi_source =
+				boost::dynamic_pointer_cast<MidiSource, Source>(source_by_id(id));
+			if (midi_source) {
+				ut->add_command (midi_diff_command_factory (midi_source, *n));
+			} else {
+				error << _("Failed to downcast MidiSource for PatchChangeDiffCommand") << endmsg;
 			}
 
-			_history.add (ut);
+		} else if (n->name() == "StatefulDiffCommand") {
+			if ((c = stateful_diff_command_factory (n))) {
+				ut->add_command (c);
+			}
+		} else {
+			error << string_compose(_("Couldn't figure out how to make a Command out of a %1 XMLNode."), n->name()) << endmsg;
 		}
-
-	} catch (std::exception const & e) {
-		error << string_compose (_("Error during loading undo history (%1). Undo history will be ignored"), e.what()) << endmsg;
 	}
 
-	return 0;
+	return ut;
 }
 
 void
@@ -4315,6 +5000,61 @@ Session::set_history_depth (uint32_t d)
 	_history.set_depth (d);
 }
 
+void
+Session::reduce_memory (std::string const& name)
+{
+	PBD::MemoryAccount& account (PBD::MemoryAccount::get (name));
+	int64_t const       excess = account.excess ();
+
+	if (excess <= 0) {
+		return;
+	}
+
+	/* This is called again, less often, if nothing could be released,
+	 * see PBD::MemoryAccount::check_budgets().
+	 */
+	int64_t const used = account.used ();
+
+	if (name == X_("undo-history")) {
+		_history.reduce_memory (excess);
+	} else {
+		reduce_source_memory (name);
+	}
+
+	info << string_compose (_("%1 exceeded its memory budget by %2 kB, released %3 kB"),
+	                        name, excess / 1024, std::max<int64_t> (0, used - account.used ()) / 1024) << endmsg;
+}
+
+void
+Session::reduce_source_memory (std::string const& name)
+{
+	/* do not hold the source_lock while taking each source's lock */
+	std::vector<boost::shared_ptr<Source> > srcs;
+	{
+		Glib::Threads::Mutex::Lock lm (source_lock);
+		for (SourceMap::const_iterator i = sources.begin (); i != sources.end (); ++i) {
+			srcs.push_back (i->second);
+		}
+	}
+
+	for (std::vector<boost::shared_ptr<Source> >::const_iterator i = srcs.begin (); i != srcs.end (); ++i) {
+		if (name == X_("peak-cache")) {
+			boost::shared_ptr<AudioSource> as = boost::dynamic_pointer_cast<AudioSource> (*i);
+			if (as) {
+				as->drop_peak_cache ();
+			}
+		} else if (name == X_("midi")) {
+			/* models may hold unsaved edits, only decoded files can go.
+			 * Those only exist with load-midi-models-on-demand.
+			 */
+			boost::shared_ptr<SMFSource> smf = boost::dynamic_pointer_cast<SMFSource> (*i);
+			if (smf) {
+				smf->drop_playback_data ();
+			}
+		}
+	}
+}
+
 /** Connect things to the MMC object */
 void
 Session::setup_midi_machine_control ()
@@ -4413,6 +5153,9 @@ Session::rename (const std::string& new_name)
 
 	StateProtector stp (this);
 
+	/* a backup that is still being written would use the old paths */
+	cancel_background_save ();
+
 	/* Rename:
 
 	 * session directory
@@ -4560,7 +5303,11 @@ Session::rename (const std::string& new_name)
 		return 1;
 	}
 
-	/* history file */
+	/* history file and its journal. A deferred history is loaded from
+	 * the old location first.
+	 */
+
+	_history.load_deferred ();
 
 	oldstr = Glib::build_filename (new_path, _current_snapshot_name) + history_suffix;
 
@@ -4574,6 +5321,14 @@ Session::rename (const std::string& new_name)
 			error << string_compose (_("renaming %1 as %2 failed (%3)"), oldstr, newstr, g_strerror (errno)) << endmsg;
 			return 1;
 		}
+
+		oldstr += history_journal_suffix;
+		newstr += history_journal_suffix;
+
+		if (Glib::file_test (oldstr, Glib::FILE_TEST_EXISTS) && ::g_rename (oldstr.c_str(), newstr.c_str()) != 0) {
+			error << string_compose (_("renaming %1 as %2 failed (%3)"), oldstr, newstr, g_strerror (errno)) << endmsg;
+			return 1;
+		}
 	}
 
 	/* remove old name from recent sessions */
@@ -4927,6 +5682,7 @@ Session::save_as (SaveAs& saveas)
 	do_not_copy_extensions.push_back (backup_suffix);
 	do_not_copy_extensions.push_back (temp_suffix);
 	do_not_copy_extensions.push_back (history_suffix);
+	do_not_copy_extensions.push_back (history_journal_suffix);
 
 	/* get total size */
 
@@ -5418,6 +6174,7 @@ Session::archive_session (const std::string& dest,
 	do_not_copy_extensions.push_back (backup_suffix);
 	do_not_copy_extensions.push_back (temp_suffix);
 	do_not_copy_extensions.push_back (history_suffix);
+	do_not_copy_extensions.push_back (history_journal_suffix);
 
 	vector<string> blacklist_dirs;
 	blacklist_dirs.push_back (string (peak_dir_name) + G_DIR_SEPARATOR);
@@ -5663,6 +6420,7 @@ Session::archive_session (const std::string& dest,
 	vector<string> files;
 	do_not_copy_extensions.clear ();
 	do_not_copy_extensions.push_back (history_suffix);
+	do_not_copy_extensions.push_back (history_journal_suffix);
 
 	blacklist_dirs.clear ();
 	blacklist_dirs.push_back (string (externals_dir_name) + G_DIR_SEPARATOR);
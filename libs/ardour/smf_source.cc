@@ -23,6 +23,7 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include <cstring>
 #include <vector>
 
 #include <sys/time.h>
@@ -31,6 +32,7 @@
 #include <errno.h>
 #include <regex.h>
 
+#include "pbd/cpus.h"
 #include "pbd/file_utils.h"
 #include "pbd/stl_delete.h"
 #include "pbd/strsplit.h"
@@ -39,9 +41,11 @@
 #include "pbd/gstdio_compat.h"
 #include <glibmm/miscutils.h>
 #include <glibmm/fileutils.h>
+#include <glibmm/threadpool.h>
 
 #include "evoral/Control.h"
 #include "evoral/SMF.h"
+#include "evoral/SMFParser.h"
 
 #include "temporal/tempo.h"
 
@@ -51,6 +55,7 @@
 #include "ardour/midi_ring_buffer.h"
 #include "ardour/midi_state_tracker.h"
 #include "ardour/parameter_types.h"
+#include "ardour/rc_configuration.h"
 #include "ardour/session.h"
 #include "ardour/smf_source.h"
 
@@ -229,6 +234,12 @@ SMFSource::read_unlocked (const Lock&                     lock,
 
 	DEBUG_TRACE (DEBUG::MidiSourceIO, string_compose ("SMF read_unlocked: start %1 duration %2\n", start, duration));
 
+	boost::shared_ptr<Evoral::SMFParser> data (playback_data (lock));
+
+	if (data) {
+		return read_playback_data (*data, destination, source_start, start, duration, loop_range, tracker, filter);
+	}
+
 	// Output parameters for read_event (which will allocate scratch in buffer as needed)
 	uint32_t ev_delta_t = 0;
 	uint32_t ev_size    = 0;
@@ -311,6 +322,120 @@ SMFSource::read_unlocked (const Lock&                     lock,
 	return duration;
 }
 
+/** Return the decoded contents of the file, if they were loaded by
+ * load_models(). Only available while the file on disk is complete, i.e.
+ * when there is no model (which may hold unsaved edits) and no write in
+ * progress.
+ *
+ * This is called by the butler, so it never decodes the file itself: on a
+ * miss read_unlocked() reads the file incrementally, as it does without
+ * load-midi-models-on-demand.
+ */
+boost::shared_ptr<Evoral::SMFParser>
+SMFSource::playback_data (const Lock& lock) const
+{
+	if (_model || _writing) {
+		_playback_data.reset ();
+	}
+
+	return _playback_data;
+}
+
+void
+SMFSource::set_playback_data (const Lock& lock, boost::shared_ptr<Evoral::SMFParser> data)
+{
+	if (_model || _writing) {
+		return;
+	}
+
+	_playback_data = data;
+}
+
+void
+SMFSource::drop_playback_data ()
+{
+	Lock lm (_lock);
+	_playback_data.reset ();
+}
+
+/** Equivalent of MidiSource::midi_read() for a source without a model,
+ * reading from the decoded file instead.
+ */
+timecnt_t
+SMFSource::read_playback_data (Evoral::SMFParser const&        data,
+                               Evoral::EventSink<samplepos_t>& dst,
+                               timepos_t const &               source_start,
+                               timepos_t const &               start,
+                               timecnt_t const &               cnt,
+                               Temporal::Range*                loop_range,
+                               MidiStateTracker*               tracker,
+                               MidiChannelFilter*              filter) const
+{
+	Evoral::SMFParser::Events const & events (data.events ());
+
+	const Temporal::Beats source_start_beats   = source_start.beats();
+	const Temporal::Beats session_source_start = (source_start + start).beats();
+	const Temporal::Beats end                  = source_start_beats + start.beats() + cnt.beats();
+
+	/* binary search for the first event at or after start (in SMF ticks) */
+	const uint64_t start_ticks = (uint64_t) std::max<int64_t> (0, start.beats().to_ticks (data.ppqn ()));
+
+	Evoral::SMFParser::Events::const_iterator i = events.begin();
+	Evoral::SMFParser::Events::const_iterator last = events.end();
+	size_t n = events.size();
+
+	while (n > 0) {
+		size_t const half = n / 2;
+		if ((i + half)->time < start_ticks) {
+			i += half + 1;
+			n -= half + 1;
+		} else {
+			n = half;
+		}
+	}
+
+	uint8_t scratch[3];
+
+	for (; i != last; ++i) {
+
+		const Temporal::Beats session_event_beats = source_start_beats + Temporal::Beats::ticks_at_rate (i->time, data.ppqn ());
+
+		if (session_event_beats < session_source_start) {
+			continue;
+		} else if (session_event_beats >= end) {
+			break;
+		}
+
+		timepos_t seb = timepos_t (session_event_beats);
+		samplepos_t time_samples = seb.samples();
+
+		if (loop_range) {
+			time_samples = loop_range->squish (seb).samples();
+		}
+
+		uint8_t const * buf              = data.buffer (*i);
+		const uint8_t   status           = buf[0];
+		const bool      is_channel_event = (0x80 <= (status & 0xF0)) && (status <= 0xE0);
+
+		if (filter && is_channel_event && i->size <= sizeof (scratch)) {
+			/* the filter may modify the channel, never touch the decoded data */
+			memcpy (scratch, buf, i->size);
+			if (filter->filter (scratch, i->size)) {
+				continue;
+			}
+			buf = scratch;
+		}
+
+		dst.write (time_samples, Evoral::MIDI_EVENT, i->size, buf);
+
+		if (tracker) {
+			tracker->track (buf);
+		}
+	}
+
+	return cnt;
+}
+
 timecnt_t
 SMFSource::write_unlocked (const Lock&                  lock,
                            MidiRingBuffer<samplepos_t>& source,
@@ -628,15 +753,18 @@ static bool compare_eventlist (
 	return ( a.first->time() < b.first->time() );
 }
 
-void
-SMFSource::load_model (const Glib::Threads::Mutex::Lock& lock, bool force_reload)
+/** Create or clear the model, ready to be filled from the file.
+ * @return false if there is nothing to load.
+ */
+bool
+SMFSource::prepare_model_load (const Glib::Threads::Mutex::Lock& lock, bool force_reload)
 {
 	if (_writing) {
-		return;
+		return false;
 	}
 
 	if (_model && !force_reload) {
-		return;
+		return false;
 	}
 
 	if (!_model) {
@@ -646,13 +774,35 @@ SMFSource::load_model (const Glib::Threads::Mutex::Lock& lock, bool force_reload
 		_model->clear();
 	}
 
+	/* from now on, the model is the authoritative copy of the data */
+	_playback_data.reset ();
+
 	invalidate(lock);
 
 	if (writable() && !_open) {
+		return false;
+	}
+
+	return true;
+}
+
+void
+SMFSource::load_model (const Glib::Threads::Mutex::Lock& lock, bool force_reload)
+{
+	if (!_model && _playback_data && !_writing) {
+		/* already decoded for playback, build the model from that */
+		boost::shared_ptr<Evoral::SMFParser> data (_playback_data);
+		load_model (lock, *data);
 		return;
 	}
 
-	_model->start_write();
+	bool const had_model = (bool) _model;
+
+	if (!prepare_model_load (lock, force_reload)) {
+		return;
+	}
+
+	_model->start_write (true);
 	Evoral::SMF::seek_to_start();
 
 	uint64_t time = 0; /* in SMF ticks */
@@ -740,9 +890,144 @@ SMFSource::load_model (const Glib::Threads::Mutex::Lock& lock, bool force_reload
 
 	_model->end_write (Evoral::Sequence<Temporal::Beats>::ResolveStuckNotes, _length.beats());
 	_model->set_edited (false);
+	_model->update_memory_account ();
 	invalidate(lock);
 
 	free(buf);
+
+	if (!had_model) {
+		/* let regions created before the model existed know about it */
+		ModelChanged (); /* EMIT SIGNAL */
+	}
+}
+
+/** Fill the model from events decoded by @param parser, which must have
+ * loaded this source's file. This avoids walking libsmf's per-event
+ * allocations and the intermediate list of heap-allocated events, since
+ * the parser's events are already merged and sorted.
+ */
+void
+SMFSource::load_model (const Glib::Threads::Mutex::Lock& lock, Evoral::SMFParser const & parser)
+{
+	bool const had_model = (bool) _model;
+
+	if (!prepare_model_load (lock, true)) {
+		return;
+	}
+
+	_model->start_write (true);
+
+	Evoral::SMFParser::Events const & events (parser.events ());
+	Evoral::Event<Temporal::Beats> ev (Evoral::MIDI_EVENT, Temporal::Beats(), 0, NULL, false);
+
+	for (Evoral::SMFParser::Events::const_iterator i = events.begin(); i != events.end(); ++i) {
+		const Temporal::Beats event_time = Temporal::Beats::ticks_at_rate (i->time, parser.ppqn());
+		/* the model copies what it keeps, so point at the parser's data */
+		ev.set_buffer (i->size, const_cast<uint8_t*> (parser.buffer (*i)), false);
+		ev.set_time (event_time);
+		_model->append (ev, i->id >= 0 ? i->id : Evoral::next_event_id());
+	}
+
+	if (!events.empty()) {
+		_length = max (_length, timecnt_t (Temporal::Beats::ticks_at_rate (parser.duration (), parser.ppqn())));
+	}
+
+	_model->end_write (Evoral::Sequence<Temporal::Beats>::ResolveStuckNotes, _length.beats());
+	_model->set_edited (false);
+	_model->update_memory_account ();
+	invalidate(lock);
+
+	if (!had_model) {
+		ModelChanged (); /* EMIT SIGNAL */
+	}
+}
+
+namespace {
+/** Files of one batch which are still being decoded */
+struct ParseBatch {
+	Glib::Threads::Mutex lock;
+	Glib::Threads::Cond  done;
+	size_t               pending;
+};
+}
+
+static void
+parse_smf (std::string path, Evoral::SMFParser* parser, int* result, ParseBatch* batch)
+{
+	*result = parser->load (path);
+
+	Glib::Threads::Mutex::Lock lm (batch->lock);
+	if (--batch->pending == 0) {
+		batch->done.signal ();
+	}
+}
+
+void
+SMFSource::load_models (std::vector<boost::shared_ptr<SMFSource> > const & sources)
+{
+	if (sources.empty ()) {
+		return;
+	}
+
+	/* models are created by MidiSource::ensure_model() or the GUI when
+	 * needed, until then playback uses the decoded files.
+	 */
+	bool const on_demand = Config->get_load_midi_models_on_demand ();
+
+	PBD::Timing timing;
+
+	/* Decode files in batches on a worker pool, then fill the models in
+	 * this thread (model creation sets up automation controls, which is
+	 * not safe to do concurrently). Batching bounds the memory used by
+	 * decoded, but not yet consumed files.
+	 */
+	uint32_t const n_threads  = std::max<uint32_t> (1, std::min<uint32_t> (hardware_concurrency (), sources.size ()));
+	size_t const   batch_size = 4 * n_threads;
+
+	Glib::ThreadPool pool (n_threads);
+	ParseBatch       batch;
+
+	for (size_t first = 0; first < sources.size (); first += batch_size) {
+
+		size_t const n = std::min (batch_size, sources.size () - first);
+
+		std::vector<boost::shared_ptr<Evoral::SMFParser> > parsers (n);
+		std::vector<int>                                   results (n, -1);
+
+		{
+			Glib::Threads::Mutex::Lock lm (batch.lock);
+			batch.pending = n;
+			for (size_t i = 0; i < n; ++i) {
+				parsers[i].reset (new Evoral::SMFParser);
+				pool.push (sigc::bind (sigc::ptr_fun (&parse_smf), sources[first + i]->path (), parsers[i].get (), &results[i], &batch));
+			}
+			/* wait for the whole batch, the pool is reused for the next one */
+			while (batch.pending > 0) {
+				batch.done.wait (batch.lock);
+			}
+		}
+
+		for (size_t i = 0; i < n; ++i) {
+			boost::shared_ptr<SMFSource> src (sources[first + i]);
+			Source::Lock lm (src->mutex ());
+			if (on_demand) {
+				/* files SMFParser cannot read are played through libsmf */
+				if (results[i] == 0) {
+					src->set_playback_data (lm, parsers[i]);
+				}
+			} else if (results[i] == 0) {
+				src->load_model (lm, *parsers[i]);
+			} else {
+				/* not on disk (yet), or not something SMFParser can
+				 * read: fall back to libsmf.
+				 */
+				src->load_model (lm, true);
+			}
+		}
+	}
+
+	timing.update ();
+	DEBUG_TRACE (DEBUG::MidiSourceIO, string_compose ("loaded %1 MIDI %2 in %3 ms\n", sources.size (), on_demand ? "files" : "models", timing.elapsed_msecs ()));
 }
 
 void
@@ -41,6 +41,7 @@
 #include <glibmm/fileutils.h>
 #include <glibmm/miscutils.h>
 
+#include "ardour/direct_file_writer.h"
 #include "ardour/runtime_functions.h"
 #include "ardour/sndfilesource.h"
 #include "ardour/sndfile_helpers.h"
@@ -65,6 +66,8 @@ SndFileSource::SndFileSource (Session& s, const XMLNode& node)
 	, AudioFileSource (s, node)
 	, _sndfile (0)
 	, _broadcast_info (0)
+	, _direct (0)
+	, _use_direct_io (false)
 {
 	init_sndfile ();
 
@@ -85,6 +88,8 @@ SndFileSource::SndFileSource (Session& s, const string& path, int chn, Flag flag
 	, AudioFileSource (s, path, Flag (flags & ~(Writable|Removable|RemovableIfEmpty|RemoveAtDestroy)))
 	, _sndfile (0)
 	, _broadcast_info (0)
+	, _direct (0)
+	, _use_direct_io (false)
 {
 	_channel = chn;
 
@@ -107,6 +112,8 @@ SndFileSource::SndFileSource (Session& s, const string& path, const string& orig
 	, AudioFileSource (s, path, origin, flags, sfmt, hf)
 	, _sndfile (0)
 	, _broadcast_info (0)
+	, _direct (0)
+	, _use_direct_io (false)
 {
 	int fmt = 0;
 
@@ -208,6 +215,8 @@ SndFileSource::SndFileSource (Session& s, const string& path, int chn)
 	, AudioFileSource (s, path, Flag (0))
 	, _sndfile (0)
 	, _broadcast_info (0)
+	, _direct (0)
+	, _use_direct_io (false)
 {
 	_channel = chn;
 
@@ -227,6 +236,8 @@ SndFileSource::SndFileSource (Session& s, const AudioFileSource& other, const st
 	, AudioFileSource (s, path, "", Flag ((other.flags () | default_writable_flags | NoPeakFile) & ~RF64_RIFF), /*unused*/ FormatFloat, /*unused*/ WAVE64)
 	, _sndfile (0)
 	, _broadcast_info (0)
+	, _direct (0)
+	, _use_direct_io (false)
 {
 	if (other.readable_length_samples () == 0) {
 		throw failed_constructor();
@@ -329,6 +340,8 @@ SndFileSource::init_sndfile ()
 void
 SndFileSource::close ()
 {
+	finish_direct_io ();
+
 	if (_sndfile) {
 		sf_close (_sndfile);
 		_sndfile = 0;
@@ -494,6 +507,13 @@ SndFileSource::read_unlocked (Sample *dst, samplepos_t start, samplecnt_t cnt) c
 	samplecnt_t real_cnt;
 	samplepos_t file_cnt;
 
+	if (_direct) {
+		/* capture in progress */
+		samplecnt_t const n = _direct->read (dst, start, cnt);
+		memset (dst + n, 0, sizeof (Sample) * (cnt - n));
+		return cnt;
+	}
+
         if (writable() && !_sndfile) {
                 /* file has not been opened yet - nothing written to it */
                 memset (dst, 0, sizeof (Sample) * cnt);
@@ -584,7 +604,12 @@ SndFileSource::read_unlocked (Sample *dst, samplepos_t start, samplecnt_t cnt) c
 samplecnt_t
 SndFileSource::write_unlocked (Sample *data, samplecnt_t cnt)
 {
-        if (open()) {
+	if (_use_direct_io && !_direct && open_direct_io ()) {
+		/* fall back to libsndfile */
+		_use_direct_io = false;
+	}
+
+        if (!_direct && open()) {
                 return 0; // failure
         }
 
@@ -623,6 +648,10 @@ SndFileSource::nondestructive_write_unlocked (Sample *data, samplecnt_t cnt)
 int
 SndFileSource::update_header (samplepos_t when, struct tm& now, time_t tnow)
 {
+	if (_direct && (finish_direct_io () || open ())) {
+		return -1;
+	}
+
 	set_natural_position (timepos_t (when));
 
 	if (_flags & Broadcast) {
@@ -642,6 +671,10 @@ SndFileSource::flush_header ()
 		return -1;
 	}
 
+	if (_direct && (finish_direct_io () || open ())) {
+		return -1;
+	}
+
 	if (_sndfile == 0) {
 		error << string_compose (_("could not allocate file %1 to write header"), _path) << endmsg;
 		return -1;
@@ -719,6 +752,11 @@ SndFileSource::set_header_natural_position ()
 samplecnt_t
 SndFileSource::write_float (Sample* data, samplepos_t sample_pos, samplecnt_t cnt)
 {
+	if (_direct) {
+		assert (_direct->length () == sample_pos);
+		return _direct->write (data, cnt);
+	}
+
 	if ((_info.format & SF_FORMAT_TYPEMASK ) == SF_FORMAT_FLAC) {
 		assert (_length == sample_pos);
 	}
@@ -736,6 +774,60 @@ SndFileSource::write_float (Sample* data, samplepos_t sample_pos, samplecnt_t cn
 	return cnt;
 }
 
+bool
+SndFileSource::set_direct_io (bool yn)
+{
+	if (yn && (!writable () || _sndfile || _length != 0 || !DirectFileWriter::supported (_info))) {
+		return false;
+	}
+
+	_use_direct_io = yn;
+	return yn;
+}
+
+int
+SndFileSource::open_direct_io ()
+{
+	if (_flags & Broadcast) {
+		if (!_broadcast_info) {
+			_broadcast_info = new BroadcastInfo;
+		}
+		/* the time reference is set by update_header () */
+		_broadcast_info->set_from_session (_session, header_position_offset);
+		_broadcast_info->set_description (string_compose ("BWF %1", _name));
+	}
+
+	/* RF64 files with RF64_RIFF are only RF64 if they need to be */
+	bool const rf64 = (_info.format & SF_FORMAT_TYPEMASK) == SF_FORMAT_RF64 && !(_flags & RF64_RIFF);
+
+	try {
+		_direct = new DirectFileWriter (_path, _info, rf64, (_flags & Broadcast) ? _broadcast_info : 0);
+	} catch (failed_constructor&) {
+		warning << string_compose (_("cannot use direct I/O for audio file %1"), _path) << endmsg;
+		return -1;
+	}
+
+	return 0;
+}
+
+/** Complete the file written with direct I/O, after which
+ * libsndfile can open it.
+ */
+int
+SndFileSource::finish_direct_io ()
+{
+	if (!_direct) {
+		return 0;
+	}
+
+	int const ret = _direct->finish ();
+	delete _direct;
+	_direct = 0;
+	_use_direct_io = false;
+
+	return ret;
+}
+
 void
 SndFileSource::set_natural_position (timepos_t const & pos)
 {
@@ -147,7 +147,7 @@ SourceFactory::createSilent (Session& s, const XMLNode& node, samplecnt_t nframe
 }
 
 boost::shared_ptr<Source>
-SourceFactory::create (Session& s, const XMLNode& node, bool defer_peaks)
+SourceFactory::create (Session& s, const XMLNode& node, bool defer_peaks, bool defer_model)
 {
 	DataType type = DataType::AUDIO;
 	XMLProperty const * prop = node.property("type");
@@ -214,8 +214,10 @@ SourceFactory::create (Session& s, const XMLNode& node, bool defer_peaks)
 	} else if (type == DataType::MIDI) {
 		try {
 			boost::shared_ptr<SMFSource> src (new SMFSource (s, node));
-			Source::Lock lock(src->mutex());
-			src->load_model (lock, true);
+			if (!defer_model) {
+				Source::Lock lock(src->mutex());
+				src->load_model (lock, true);
+			}
 			BOOST_MARK_SOURCE (src);
 			src->check_for_analysis_data_on_disk ();
 			SourceCreated (src);
@@ -306,13 +308,23 @@ SourceFactory::createExternal (DataType type, Session& s, const string& path,
 boost::shared_ptr<Source>
 SourceFactory::createWritable (DataType type, Session& s, const std::string& path,
 			       samplecnt_t rate, bool announce, bool defer_peaks)
+{
+	return createWritable (type, s, path, rate,
+	                       s.config.get_native_file_data_format(),
+	                       s.config.get_native_file_header_format(),
+	                       announce, defer_peaks);
+}
+
+boost::shared_ptr<Source>
+SourceFactory::createWritable (DataType type, Session& s, const std::string& path,
+			       samplecnt_t rate, SampleFormat sfmt, HeaderFormat hf, bool announce, bool defer_peaks)
 {
 	/* this might throw failed_constructor(), which is OK */
 
 	if (type == DataType::AUDIO) {
 		Source* src = new SndFileSource (s, path, string(),
-						 s.config.get_native_file_data_format(),
-						 s.config.get_native_file_header_format(),
+						 sfmt,
+						 hf,
 						 rate,
 		                                 SndFileSource::default_writable_flags);
 		boost::shared_ptr<Source> ret (src);
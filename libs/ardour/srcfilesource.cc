@@ -46,9 +46,11 @@ SrcFileSource::SrcFileSource (Session& s, boost::shared_ptr<AudioFileSource> src
 
 	switch (srcq) {
 		case SrcBest:
+		case SrcPolyphaseBest:
 			src_type = SRC_SINC_BEST_QUALITY;
 			break;
 		case SrcGood:
+		case SrcPolyphaseGood:
 			src_type = SRC_SINC_MEDIUM_QUALITY;
 			break;
 		case SrcQuick:
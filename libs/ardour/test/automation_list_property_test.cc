@@ -24,6 +24,7 @@
 #include "pbd/properties.h"
 #include "pbd/stateful_diff_command.h"
 #include "ardour/automation_list.h"
+#include "ardour/rc_configuration.h"
 #include "automation_list_property_test.h"
 #include "test_util.h"
 
@@ -179,3 +180,45 @@ AutomationListPropertyTest::undoTest ()
 	write_automation_list_xml (&sheila->get_state(), test_data_filename);
 	check_xml (&sheila->get_state(), test_data_file4, ignore_properties);
 }
+
+void
+AutomationListPropertyTest::binaryEventsTest ()
+{
+	AutomationList al (Evoral::Parameter (GainAutomation), Temporal::AudioTime);
+
+	al.add (timepos_t (0), 1.0, false, false);
+	al.add (timepos_t (48000), 0.123456789, false, false);
+	al.add (timepos_t (96000), 2.0, false, false);
+	al.add (timepos_t (96001), 0.0, false, false);
+
+	bool const binary = Config->get_binary_automation_data ();
+
+	for (int pass = 0; pass < 2; ++pass) {
+
+		Config->set_binary_automation_data (pass == 0);
+
+		XMLNode& state (al.get_state ());
+		XMLNode* events = state.child (X_("events"));
+		CPPUNIT_ASSERT (events);
+
+		std::string encoding;
+		CPPUNIT_ASSERT_EQUAL (pass == 0, events->get_property (X_("encoding"), encoding) && encoding == X_("binary"));
+
+		AutomationList copy (state, Evoral::Parameter (GainAutomation));
+		delete &state;
+
+		CPPUNIT_ASSERT_EQUAL (al.size (), copy.size ());
+
+		for (AutomationList::const_iterator i = al.begin (), j = copy.begin (); i != al.end (); ++i, ++j) {
+			CPPUNIT_ASSERT ((*i)->when == (*j)->when);
+			if (pass == 0) {
+				/* binary data keeps values exactly */
+				CPPUNIT_ASSERT_EQUAL ((*i)->value, (*j)->value);
+			} else {
+				CPPUNIT_ASSERT_DOUBLES_EQUAL ((*i)->value, (*j)->value, 1e-6);
+			}
+		}
+	}
+
+	Config->set_binary_automation_data (binary);
+}
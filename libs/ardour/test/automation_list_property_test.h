@@ -24,6 +24,7 @@ class AutomationListPropertyTest : public CppUnit::TestFixture
 	CPPUNIT_TEST_SUITE (AutomationListPropertyTest);
 	CPPUNIT_TEST (basicTest);
 	CPPUNIT_TEST (undoTest);
+	CPPUNIT_TEST (binaryEventsTest);
 	CPPUNIT_TEST_SUITE_END ();
 
 public:
@@ -31,4 +32,5 @@ public:
 	void tearDown ();
 	void basicTest ();
 	void undoTest ();
+	void binaryEventsTest ();
 };
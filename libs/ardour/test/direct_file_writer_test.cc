@@ -0,0 +1,210 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <vector>
+
+#ifndef PLATFORM_WINDOWS
+#include <csignal>
+#include <sys/resource.h>
+#endif
+
+#include <glib/gstdio.h>
+#include <glibmm/miscutils.h>
+
+#include "ardour/broadcast_info.h"
+#include "ardour/direct_file_writer.h"
+
+#include "direct_file_writer_test.h"
+#include "test_util.h"
+
+using namespace std;
+using namespace ARDOUR;
+
+CPPUNIT_TEST_SUITE_REGISTRATION (DirectFileWriterTest);
+
+/* more than one write buffer, and not a multiple of the block size */
+static const samplecnt_t test_length = 300007;
+
+static SF_INFO
+test_format ()
+{
+	SF_INFO info = SF_INFO ();
+	info.channels   = 1;
+	info.samplerate = 48000;
+	info.format     = SF_FORMAT_WAV | SF_FORMAT_FLOAT;
+	return info;
+}
+
+static inline Sample
+test_sample (samplepos_t pos)
+{
+	return (pos % 1000) / 1000.f - .5f;
+}
+
+void
+DirectFileWriterTest::setUp ()
+{
+	_path = Glib::build_filename (new_test_output_dir ("direct_file_writer"), "test.wav");
+	g_unlink (_path.c_str ());
+}
+
+void
+DirectFileWriterTest::tearDown ()
+{
+	g_unlink (_path.c_str ());
+}
+
+void
+DirectFileWriterTest::write_and_check (bool rf64, bool bwf)
+{
+	if (!DirectFileWriter::supported (test_format ())) {
+		return;
+	}
+
+	BroadcastInfo bi;
+	bi.set_description ("DirectFileWriterTest");
+
+	{
+		DirectFileWriter writer (_path, test_format (), rf64, bwf ? &bi : 0);
+
+		vector<Sample> buf (10007);
+		samplepos_t    pos = 0;
+
+		while (pos < test_length) {
+			samplecnt_t const n = min<samplecnt_t> (buf.size (), test_length - pos);
+			for (samplecnt_t i = 0; i < n; ++i) {
+				buf[i] = test_sample (pos + i);
+			}
+			CPPUNIT_ASSERT_EQUAL (n, writer.write (&buf[0], n));
+			pos += n;
+		}
+
+		CPPUNIT_ASSERT_EQUAL (test_length, writer.length ());
+
+		/* read back both written and buffered data */
+		vector<Sample> back (test_length);
+		CPPUNIT_ASSERT_EQUAL (test_length, writer.read (&back[0], 0, test_length));
+		for (samplepos_t i = 0; i < test_length; ++i) {
+			CPPUNIT_ASSERT_EQUAL (test_sample (i), back[i]);
+		}
+
+		CPPUNIT_ASSERT_EQUAL (0, writer.finish ());
+	}
+
+	SF_INFO  info = SF_INFO ();
+	SNDFILE* sf   = sf_open (_path.c_str (), SFM_READ, &info);
+	CPPUNIT_ASSERT (sf);
+
+	CPPUNIT_ASSERT_EQUAL ((sf_count_t) test_length, info.frames);
+	CPPUNIT_ASSERT_EQUAL (1, info.channels);
+	CPPUNIT_ASSERT_EQUAL (48000, info.samplerate);
+	CPPUNIT_ASSERT_EQUAL (rf64 ? SF_FORMAT_RF64 : SF_FORMAT_WAV, info.format & SF_FORMAT_TYPEMASK);
+	CPPUNIT_ASSERT_EQUAL ((int) SF_FORMAT_FLOAT, info.format & SF_FORMAT_SUBMASK);
+
+	vector<Sample> data (test_length);
+	CPPUNIT_ASSERT_EQUAL ((sf_count_t) test_length, sf_readf_float (sf, &data[0], test_length));
+	for (samplepos_t i = 0; i < test_length; ++i) {
+		CPPUNIT_ASSERT_EQUAL (test_sample (i), data[i]);
+	}
+
+	AudioGrapher::BroadcastInfo loaded;
+	CPPUNIT_ASSERT_EQUAL (bwf, loaded.load_from_file (sf));
+	if (bwf) {
+		CPPUNIT_ASSERT_EQUAL (string ("DirectFileWriterTest"), loaded.get_description ());
+	}
+
+	sf_close (sf);
+}
+
+void
+DirectFileWriterTest::wavTest ()
+{
+	write_and_check (false, false);
+}
+
+void
+DirectFileWriterTest::rf64Test ()
+{
+	write_and_check (true, false);
+}
+
+void
+DirectFileWriterTest::bwfTest ()
+{
+	write_and_check (false, true);
+}
+
+void
+DirectFileWriterTest::writeErrorTest ()
+{
+#ifndef PLATFORM_WINDOWS
+	if (!DirectFileWriter::supported (test_format ())) {
+		return;
+	}
+
+	/* let writes fail after the first two buffers of 1 MB */
+	struct rlimit old_limit;
+	getrlimit (RLIMIT_FSIZE, &old_limit);
+	struct rlimit limit (old_limit);
+	limit.rlim_cur = 2560 * 1024;
+	void (*old_handler) (int) = signal (SIGXFSZ, SIG_IGN);
+	setrlimit (RLIMIT_FSIZE, &limit);
+
+	samplecnt_t written = 0;
+	int         failed  = 0;
+
+	{
+		DirectFileWriter writer (_path, test_format (), false, 0);
+
+		vector<Sample> buf (65536);
+		for (size_t i = 0; i < buf.size (); ++i) {
+			buf[i] = test_sample (i);
+		}
+
+		for (int i = 0; i < 20; ++i) {
+			if (writer.write (&buf[0], buf.size ()) == (samplecnt_t) buf.size ()) {
+				written += buf.size ();
+			} else {
+				++failed;
+			}
+		}
+
+		/* once a write failed, the writer stays failed */
+		CPPUNIT_ASSERT_EQUAL ((samplecnt_t) 0, writer.write (&buf[0], 1));
+		CPPUNIT_ASSERT (writer.finish () != 0);
+	}
+
+	setrlimit (RLIMIT_FSIZE, &old_limit);
+	signal (SIGXFSZ, old_handler);
+
+	CPPUNIT_ASSERT (failed > 0);
+	CPPUNIT_ASSERT_EQUAL ((samplecnt_t) 20 * 65536, written + (samplecnt_t) failed * 65536);
+
+	/* the file holds the data that was written before the error */
+	SF_INFO  info = SF_INFO ();
+	SNDFILE* sf   = sf_open (_path.c_str (), SFM_READ, &info);
+	CPPUNIT_ASSERT (sf);
+	CPPUNIT_ASSERT_EQUAL ((sf_count_t) (2 * 1024 * 1024 - 4096) / (sf_count_t) sizeof (Sample), info.frames);
+
+	vector<Sample> data (info.frames);
+	CPPUNIT_ASSERT_EQUAL (info.frames, sf_readf_float (sf, &data[0], info.frames));
+	for (sf_count_t i = 0; i < info.frames; ++i) {
+		CPPUNIT_ASSERT_EQUAL (test_sample (i % 65536), data[i]);
+	}
+
+	sf_close (sf);
+#endif
+}
@@ -0,0 +1,44 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string>
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+class DirectFileWriterTest : public CppUnit::TestFixture
+{
+	CPPUNIT_TEST_SUITE (DirectFileWriterTest);
+	CPPUNIT_TEST (wavTest);
+	CPPUNIT_TEST (rf64Test);
+	CPPUNIT_TEST (bwfTest);
+	CPPUNIT_TEST (writeErrorTest);
+	CPPUNIT_TEST_SUITE_END ();
+
+public:
+	void setUp ();
+	void tearDown ();
+
+	void wavTest ();
+	void rf64Test ();
+	void bwfTest ();
+	void writeErrorTest ();
+
+private:
+	std::string _path;
+
+	void write_and_check (bool rf64, bool bwf);
+};
@@ -0,0 +1,206 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <glibmm/miscutils.h>
+
+#include "pbd/xml++.h"
+
+#include "ardour/midi_model.h"
+#include "ardour/midi_source.h"
+#include "ardour/session.h"
+#include "ardour/source_factory.h"
+
+#include "midi_diff_test.h"
+#include "test_util.h"
+
+using namespace std;
+using namespace ARDOUR;
+
+CPPUNIT_TEST_SUITE_REGISTRATION (MidiDiffTest);
+
+typedef MidiModel::DiffCommand::PackedChange  PackedChange;
+typedef MidiModel::DiffCommand::PackedChanges PackedChanges;
+typedef MidiModel::NoteDiffCommand            NoteDiffCommand;
+typedef MidiModel::TimeType                   TimeType;
+typedef boost::shared_ptr<Evoral::Note<TimeType> > NotePtr;
+
+void
+MidiDiffTest::setUp ()
+{
+	TestNeedingSession::setUp ();
+
+	std::string const path = Glib::build_filename (new_test_output_dir (), "diff.mid");
+	_source = boost::dynamic_pointer_cast<MidiSource> (SourceFactory::createWritable (DataType::MIDI, *_session, path, _session->sample_rate ()));
+	CPPUNIT_ASSERT (_source);
+	_model = _source->ensure_model ();
+	CPPUNIT_ASSERT (_model);
+}
+
+void
+MidiDiffTest::tearDown ()
+{
+	_model.reset ();
+	_source.reset ();
+	TestNeedingSession::tearDown ();
+}
+
+static NotePtr
+find_note (boost::shared_ptr<MidiModel> model, Evoral::event_id_t id)
+{
+	for (MidiModel::Notes::const_iterator i = model->notes ().begin (); i != model->notes ().end (); ++i) {
+		if ((*i)->id () == id) {
+			return *i;
+		}
+	}
+	return NotePtr ();
+}
+
+void
+MidiDiffTest::packTest ()
+{
+	PackedChanges changes;
+
+	for (int i = 0; i < 1000; ++i) {
+		const PackedChange c = {
+			i * 7, (uint8_t) (i % 5), -1920 * (int64_t) i, (int64_t) i << 33
+		};
+		changes.push_back (c);
+	}
+
+	XMLNode node ("ChangedNotes");
+	MidiModel::DiffCommand::pack_changes (node, changes);
+
+	/* round-trip through a document, as when saving history */
+	XMLTree tree;
+	tree.set_root (new XMLNode (node));
+	XMLTree loaded;
+	CPPUNIT_ASSERT (loaded.read_buffer (tree.write_buffer ().c_str ()));
+
+	PackedChanges unpacked;
+	CPPUNIT_ASSERT (MidiModel::DiffCommand::unpack_changes (*loaded.root (), unpacked));
+	CPPUNIT_ASSERT_EQUAL (changes.size (), unpacked.size ());
+
+	for (size_t i = 0; i < changes.size (); ++i) {
+		CPPUNIT_ASSERT_EQUAL (changes[i].id, unpacked[i].id);
+		CPPUNIT_ASSERT_EQUAL (changes[i].property, unpacked[i].property);
+		CPPUNIT_ASSERT_EQUAL (changes[i].old_value, unpacked[i].old_value);
+		CPPUNIT_ASSERT_EQUAL (changes[i].new_value, unpacked[i].new_value);
+	}
+}
+
+void
+MidiDiffTest::emptyTest ()
+{
+	PackedChanges changes;
+
+	XMLNode node ("ChangedNotes");
+	MidiModel::DiffCommand::pack_changes (node, changes);
+	CPPUNIT_ASSERT (MidiModel::DiffCommand::unpack_changes (node, changes));
+	CPPUNIT_ASSERT (changes.empty ());
+
+	/* history written by older versions has one node per change */
+	XMLNode legacy ("ChangedNotes");
+	legacy.add_child ("Change");
+	CPPUNIT_ASSERT (!MidiModel::DiffCommand::unpack_changes (legacy, changes));
+}
+
+void
+MidiDiffTest::undoRedoTest ()
+{
+	NotePtr a (new Evoral::Note<TimeType> (0, TimeType (0), TimeType (1), 60, 100));
+	NotePtr b (new Evoral::Note<TimeType> (1, TimeType (2), TimeType (1), 64, 90));
+
+	NoteDiffCommand* add = _model->new_note_diff_command ("add");
+	add->add (a);
+	add->add (b);
+	(*add) ();
+	CPPUNIT_ASSERT_EQUAL ((size_t) 2, _model->notes ().size ());
+
+	NoteDiffCommand* edit = _model->new_note_diff_command ("edit");
+	edit->change (a, NoteDiffCommand::NoteNumber, (uint8_t) 62);
+	edit->change (a, NoteDiffCommand::StartTime, TimeType (4));
+	edit->change (b, NoteDiffCommand::Velocity, (uint8_t) 30);
+	edit->change (b, NoteDiffCommand::Length, TimeType (3));
+	CPPUNIT_ASSERT_EQUAL ((size_t) 4, edit->changes ().size ());
+
+	/* do */
+	(*edit) ();
+	CPPUNIT_ASSERT_EQUAL ((size_t) 2, _model->notes ().size ());
+	CPPUNIT_ASSERT_EQUAL ((uint8_t) 62, find_note (_model, a->id ())->note ());
+	CPPUNIT_ASSERT_EQUAL (TimeType (4), find_note (_model, a->id ())->time ());
+	CPPUNIT_ASSERT_EQUAL ((uint8_t) 30, find_note (_model, b->id ())->velocity ());
+	CPPUNIT_ASSERT_EQUAL (TimeType (3), find_note (_model, b->id ())->length ());
+
+	/* undo */
+	edit->undo ();
+	CPPUNIT_ASSERT_EQUAL ((size_t) 2, _model->notes ().size ());
+	CPPUNIT_ASSERT_EQUAL ((uint8_t) 60, find_note (_model, a->id ())->note ());
+	CPPUNIT_ASSERT_EQUAL (TimeType (0), find_note (_model, a->id ())->time ());
+	CPPUNIT_ASSERT_EQUAL ((uint8_t) 90, find_note (_model, b->id ())->velocity ());
+	CPPUNIT_ASSERT_EQUAL (TimeType (1), find_note (_model, b->id ())->length ());
+
+	/* redo, with the command as loaded from the history */
+	XMLNode& state (edit->get_state ());
+	NoteDiffCommand* loaded = new NoteDiffCommand (_model, state);
+	delete &state;
+	CPPUNIT_ASSERT_EQUAL ((size_t) 4, loaded->changes ().size ());
+
+	(*loaded) ();
+	CPPUNIT_ASSERT_EQUAL ((uint8_t) 62, find_note (_model, a->id ())->note ());
+	CPPUNIT_ASSERT_EQUAL (TimeType (4), find_note (_model, a->id ())->time ());
+	CPPUNIT_ASSERT_EQUAL ((uint8_t) 30, find_note (_model, b->id ())->velocity ());
+	CPPUNIT_ASSERT_EQUAL (TimeType (3), find_note (_model, b->id ())->length ());
+
+	loaded->undo ();
+	CPPUNIT_ASSERT_EQUAL ((uint8_t) 60, find_note (_model, a->id ())->note ());
+	CPPUNIT_ASSERT_EQUAL (TimeType (0), find_note (_model, a->id ())->time ());
+
+	add->undo ();
+	CPPUNIT_ASSERT (_model->notes ().empty ());
+
+	delete loaded;
+	delete edit;
+	delete add;
+}
+
+void
+MidiDiffTest::missingNoteTest ()
+{
+	NotePtr a (new Evoral::Note<TimeType> (0, TimeType (0), TimeType (1), 60, 100));
+	NotePtr gone (new Evoral::Note<TimeType> (0, TimeType (1), TimeType (1), 72, 100));
+
+	NoteDiffCommand* add = _model->new_note_diff_command ("add");
+	add->add (a);
+	(*add) ();
+
+	/* a change of a note which is not in the model is reported and
+	 * skipped, the other changes are still applied.
+	 */
+	NoteDiffCommand* edit = _model->new_note_diff_command ("edit");
+	edit->change (gone, NoteDiffCommand::NoteNumber, (uint8_t) 74);
+	edit->change (a, NoteDiffCommand::Velocity, (uint8_t) 50);
+
+	(*edit) ();
+	CPPUNIT_ASSERT_EQUAL ((size_t) 1, _model->notes ().size ());
+	CPPUNIT_ASSERT_EQUAL ((uint8_t) 50, find_note (_model, a->id ())->velocity ());
+	CPPUNIT_ASSERT_EQUAL ((uint8_t) 72, gone->note ());
+
+	edit->undo ();
+	CPPUNIT_ASSERT_EQUAL ((uint8_t) 100, find_note (_model, a->id ())->velocity ());
+
+	delete edit;
+	delete add;
+}
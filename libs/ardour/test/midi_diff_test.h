@@ -0,0 +1,50 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <boost/shared_ptr.hpp>
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "test_needing_session.h"
+
+namespace ARDOUR {
+	class MidiModel;
+	class MidiSource;
+}
+
+class MidiDiffTest : public TestNeedingSession
+{
+	CPPUNIT_TEST_SUITE (MidiDiffTest);
+	CPPUNIT_TEST (packTest);
+	CPPUNIT_TEST (emptyTest);
+	CPPUNIT_TEST (undoRedoTest);
+	CPPUNIT_TEST (missingNoteTest);
+	CPPUNIT_TEST_SUITE_END ();
+
+public:
+	void setUp ();
+	void tearDown ();
+
+	void packTest ();
+	void emptyTest ();
+	void undoRedoTest ();
+	void missingNoteTest ();
+
+private:
+	boost::shared_ptr<ARDOUR::MidiSource> _source;
+	boost::shared_ptr<ARDOUR::MidiModel>  _model;
+};
@@ -0,0 +1,88 @@
+#include "test_ui.h"
+#include "test_util.h"
+#include "pbd/failed_constructor.h"
+#include "pbd/timing.h"
+#include "pbd/xml++.h"
+#include "ardour/ardour.h"
+#include "ardour/audioengine.h"
+#include "ardour/session.h"
+#include <glibmm/miscutils.h>
+#include <iostream>
+#include <cstdlib>
+
+using namespace std;
+using namespace ARDOUR;
+
+static const char* localedir = LOCALEDIR;
+
+int main (int argc, char* argv[])
+{
+	if (argc < 3 || argc > 4) {
+		cerr << "Syntax: " << argv[0] << " <dir> <snapshot-name> [<iterations>]\n";
+		exit (EXIT_FAILURE);
+	}
+
+	int const iterations = argc == 4 ? atoi (argv[3]) : 10;
+
+	ARDOUR::init (true, localedir);
+	TestUI* test_ui = new TestUI();
+	create_and_start_dummy_backend ();
+
+	Session* s = 0;
+
+	try {
+		s = load_session (argv[1], argv[2]);
+	} catch (failed_constructor& e) {
+		cerr << "failed_constructor: " << e.what() << "\n";
+		exit (EXIT_FAILURE);
+	} catch (AudioEngine::PortRegistrationFailure& e) {
+		cerr << "PortRegistrationFailure: " << e.what() << "\n";
+		exit (EXIT_FAILURE);
+	} catch (exception& e) {
+		cerr << "exception: " << e.what() << "\n";
+		exit (EXIT_FAILURE);
+	} catch (...) {
+		cerr << "unknown exception.\n";
+		exit (EXIT_FAILURE);
+	}
+
+	/* complete snapshot save (streaming routes) */
+
+	PBD::TimingData save_timing;
+
+	for (int i = 0; i < iterations; ++i) {
+		save_timing.start_timing ();
+		s->save_state ("save-session-profile");
+		save_timing.add_elapsed ();
+	}
+
+	/* for comparison: build the complete tree and write it */
+
+	PBD::TimingData state_timing;
+	PBD::TimingData write_timing;
+
+	std::string const tree_path = Glib::build_filename (s->path(), "save-session-profile.tree");
+
+	for (int i = 0; i < iterations; ++i) {
+		XMLTree tree;
+		state_timing.start_timing ();
+		tree.set_root (&s->get_state ());
+		state_timing.add_elapsed ();
+
+		write_timing.start_timing ();
+		tree.write (tree_path);
+		write_timing.add_elapsed ();
+	}
+
+	cout << "save_state:      " << save_timing.summary ();
+	cout << "get_state:       " << state_timing.summary ();
+	cout << "XMLTree::write:  " << write_timing.summary ();
+
+	AudioEngine::instance()->remove_session ();
+	delete s;
+	AudioEngine::instance()->stop ();
+	AudioEngine::destroy ();
+	delete test_ui;
+	ARDOUR::cleanup ();
+	return 0;
+}
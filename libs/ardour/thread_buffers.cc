@@ -21,6 +21,8 @@
 #include <algorithm>
 #include <iostream>
 
+#include "pbd/memory_account.h"
+
 #include "ardour/audioengine.h"
 #include "ardour/buffer_set.h"
 #include "ardour/thread_buffers.h"
@@ -40,6 +42,7 @@ ThreadBuffers::ThreadBuffers ()
 	, scratch_automation_buffer (0)
 	, pan_automation_buffer (0)
 	, npan_buffers (0)
+	, _memory_used (0)
 {
 }
 
@@ -56,6 +59,7 @@ ThreadBuffers::ensure_buffers (ChanCount howmany, size_t custom)
 	}
 
 	AudioEngine* _engine = AudioEngine::instance ();
+	size_t       bytes   = 0;
 
 	for (DataType::iterator t = DataType::begin (); t != DataType::end (); ++t) {
 		size_t count = std::max (scratch_buffers->available ().get (*t), howmany.get (*t));
@@ -73,6 +77,9 @@ ThreadBuffers::ensure_buffers (ChanCount howmany, size_t custom)
 		mix_buffers->ensure_buffers (*t, count, size);
 		silent_buffers->ensure_buffers (*t, count, size);
 		route_buffers->ensure_buffers (*t, count, size);
+
+		/* 5 buffer sets, MIDI buffer sizes are in bytes */
+		bytes += 5 * count * size * (*t == DataType::MIDI ? 1 : sizeof (Sample));
 	}
 
 	size_t audio_buffer_size = custom > 0 ? custom : _engine->raw_buffer_size (DataType::AUDIO) / sizeof (Sample);
@@ -87,6 +94,12 @@ ThreadBuffers::ensure_buffers (ChanCount howmany, size_t custom)
 	scratch_automation_buffer = new gain_t[audio_buffer_size];
 
 	allocate_pan_automation_buffers (audio_buffer_size, howmany.n_audio (), false);
+
+	bytes += (4 * sizeof (gain_t) + npan_buffers * sizeof (pan_t)) * audio_buffer_size;
+
+	static PBD::MemoryAccount& account (PBD::MemoryAccount::get ("process-buffers"));
+	account.change (_memory_used, bytes);
+	_memory_used = bytes;
 }
 
 void
@@ -505,6 +505,24 @@ Track::capture_buffer_load () const
 	return _disk_writer->buffer_load ();
 }
 
+CaptureWriteStats
+Track::capture_write_stats () const
+{
+	return _disk_writer->capture_write_stats ();
+}
+
+samplecnt_t
+Track::capture_headroom_samples () const
+{
+	return _disk_writer->headroom_samples ();
+}
+
+samplecnt_t
+Track::capture_pending_write () const
+{
+	return _disk_writer->pending_write ();
+}
+
 int
 Track::do_refill ()
 {
@@ -512,9 +530,9 @@ Track::do_refill ()
 }
 
 int
-Track::do_flush (RunContext c, bool force)
+Track::do_flush (RunContext c, bool force, uint32_t max_chunks)
 {
-	return _disk_writer->do_flush (c, force);
+	return _disk_writer->do_flush (c, force, max_chunks);
 }
 
 void
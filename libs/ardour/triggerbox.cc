@@ -1658,7 +1658,7 @@ MIDITrigger::set_region_in_worker_thread (boost::shared_ptr<Region> r)
 	set_name (mr->name());
 	data_length = mr->length().beats();
 	set_length (mr->length());
-	model = mr->model ();
+	model = mr->midi_source ()->ensure_model ();
 
 	DEBUG_TRACE (DEBUG::Triggers, string_compose ("%1 loaded midi region, span is %2\n", name(), data_length));
 
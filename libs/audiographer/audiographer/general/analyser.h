@@ -19,14 +19,20 @@
 #ifndef AUDIOGRAPHER_ANALYSER_H
 #define AUDIOGRAPHER_ANALYSER_H
 
+#include <atomic>
+#include <vector>
+
 #include <fftw3.h>
 #include "loudness_reader.h"
+#include "threader_pool.h"
 #include "ardour/export_analysis.h"
 
 namespace AudioGrapher
 {
 
-class LIBAUDIOGRAPHER_API Analyser : public LoudnessReader
+class LIBAUDIOGRAPHER_API Analyser
+	: public LoudnessReader
+	, private ThreaderPool::Job
 {
   public:
 	Analyser (float sample_rate, unsigned int channels, samplecnt_t bufsize, samplecnt_t n_samples, size_t width = 800, size_t bins = 200);
@@ -36,6 +42,13 @@ class LIBAUDIOGRAPHER_API Analyser : public LoudnessReader
 
 	void set_duration (samplecnt_t n_samples);
 
+	/** Analyse in the workers of \a pool instead of the calling thread.
+	  * Processed audio is queued and passed on right away, so the analysis
+	  * runs in parallel with the following stages (e.g. encoding).
+	  * Must be called before processing starts.
+	  */
+	void set_thread_pool (ThreaderPool& pool);
+
 	void set_normalization_gain (float gain) {
 		_result.normalized = true;
 		_result.norm_gain_factor = gain;
@@ -46,7 +59,22 @@ class LIBAUDIOGRAPHER_API Analyser : public LoudnessReader
 	using Sink<float>::process;
 
 	private:
-	float fft_power_at_bin (const uint32_t b, const float norm) const;
+	void analyse (float const* data, samplecnt_t n_samples, samplecnt_t pos);
+	void analyse_spectrum (samplecnt_t n_samples, samplecnt_t pos);
+
+	/* ThreaderPool::Job */
+	void run_job ();
+	/// analyse all queued chunks, @return false if there were none, or another thread is at it
+	bool analyse_queued ();
+
+	/* bounded queue of chunks waiting for analysis, only used with a thread pool */
+	static const uint32_t n_chunks = 4;
+
+	struct Chunk {
+		float*      data;
+		samplecnt_t n_samples; // per channel
+		samplecnt_t pos;
+	};
 
 	ARDOUR::ExportAnalysisPtr _rp;
 	ARDOUR::ExportAnalysis& _result;
@@ -56,13 +84,26 @@ class LIBAUDIOGRAPHER_API Analyser : public LoudnessReader
 	samplecnt_t   _spp;
 	samplecnt_t   _fpp;
 
-	float*     _hann_window;
-	uint32_t   _fft_data_size;
-	double     _fft_freq_per_bin;
-	float*     _fft_data_in;
-	float*     _fft_data_out;
-	float*     _fft_power;
-	fftwf_plan _fft_plan;
+	float const* _hann_window; // shared, see fft_plan ()
+	uint32_t     _fft_data_size;
+	double       _fft_freq_per_bin;
+	float*       _fft_data_in;
+	float*       _fft_data_out;
+	float*       _fft_power;
+	fftwf_plan   _fft_plan;    // shared, see fft_plan ()
+
+	/* spectrum rows [y0, y1) covered by each FFT bin, and the levels of one chunk */
+	std::vector<uint32_t> _bin_y0;
+	std::vector<uint32_t> _bin_y1;
+	std::vector<float>    _column;
+
+	ThreaderPool*         _pool;
+	float*                _chunk_data;
+	Chunk                 _chunks[n_chunks];
+	std::atomic<uint32_t> _chunk_read;
+	std::atomic<uint32_t> _chunk_write;
+	std::atomic<bool>     _analysing;
+	std::atomic<bool>     _scheduled; // a job is queued, that did not start yet
 };
 
 } // namespace
@@ -31,6 +31,30 @@
 namespace AudioGrapher
 {
 
+/** Loudness and true-peak of some material, as measured by a LoudnessReader.
+  * This is plain data, which can be kept to normalize the same material
+  * later on without analysing it again.
+  */
+struct LIBAUDIOGRAPHER_API LoudnessMeasurement
+{
+	LoudnessMeasurement ()
+		: have_lufs (false)
+		, integrated (-200)
+		, short_term (-200)
+		, have_dbtp (false)
+		, true_peak (0)
+	{}
+
+	/// \return gain coefficient, see LoudnessReader::calc_peak()
+	float calc_peak (float target_lufs = -23, float target_dbtp = -1) const;
+
+	bool  have_lufs;
+	float integrated; ///< LUFS
+	float short_term; ///< LUFS
+	bool  have_dbtp;
+	float true_peak;  ///< max over all channels, coefficient
+};
+
 class LIBAUDIOGRAPHER_API LoudnessReader : public ListedSource<float>, public Sink<float>
 {
   public:
@@ -42,6 +66,9 @@ class LIBAUDIOGRAPHER_API LoudnessReader : public ListedSource<float>, public Si
 	float calc_peak (float target_lufs = -23, float target_dbtp = -1) const;
 	bool  get_loudness (float* integrated, float* short_term = NULL, float* momentary = NULL) const;
 
+	/// \return the result of the analysis so far
+	LoudnessMeasurement measurement () const;
+
 	virtual void process (ProcessContext<float> const & c);
 
 	using Sink<float>::process;
@@ -0,0 +1,130 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef AUDIOGRAPHER_PARALLEL_SRC_H
+#define AUDIOGRAPHER_PARALLEL_SRC_H
+
+#include <atomic>
+
+#include <boost/noncopyable.hpp>
+#include <samplerate.h>
+
+#include "audiographer/visibility.h"
+#include "audiographer/types.h"
+#include "audiographer/general/threader_pool.h"
+
+namespace ArdourZita {
+	class Resampler;
+}
+
+namespace AudioGrapher
+{
+
+/** Sample rate conversion of interleaved audio, with one converter per channel.
+  *
+  * This is a drop-in for libsamplerate's src_process(): the channels are
+  * converted independently, optionally in parallel by the workers of a
+  * ThreaderPool, and the converter can also be zita-resampler's polyphase
+  * filter, which is a lot faster than libsamplerate's sinc converters.
+  */
+class LIBAUDIOGRAPHER_API ParallelSRC
+	: public boost::noncopyable
+	, private ThreaderPool::Job
+{
+  public:
+	/** Converter types, in addition to libsamplerate's SRC_SINC_BEST_QUALITY
+	  * .. SRC_LINEAR: zita-resampler with a long or a short filter.
+	  * zita-resampler needs a simple ratio of integer rates (e.g. 96k to 48k,
+	  * 44.1k to 48k), otherwise libsamplerate's best or medium sinc converter
+	  * is used instead.
+	  */
+	enum {
+		ZitaBest = 100,
+		ZitaGood = 101
+	};
+
+	/// Constructor. \n RT safe
+	ParallelSRC (uint32_t channels);
+	~ParallelSRC ();
+
+	/** Set up conversion from \a in_rate to \a out_rate \n Not RT safe
+	  * \return 0 on success, or a libsamplerate error code, see strerror()
+	  */
+	int setup (samplecnt_t in_rate, samplecnt_t out_rate, int quality);
+
+	/** Allocate buffers for up to \a max_frames input frames per call.
+	  * process() consumes at most this much of larger input. \n Not RT safe
+	  */
+	void allocate (samplecnt_t max_frames);
+
+	/// Convert channels in the workers of \a pool, 0 for the calling thread
+	void set_thread_pool (ThreaderPool* pool) { _pool = pool; }
+
+	/// Start over, as if no audio had been processed yet \n RT safe
+	void reset ();
+
+	/// @return true if zita-resampler is used
+	bool zita () const { return _use_zita; }
+
+	/** Convert audio like src_process(), \a data holds interleaved buffers
+	  * for all channels. For libsamplerate data.src_ratio is used, zita
+	  * uses the rates given to setup(). \n RT safe
+	  * \return 0 on success, or a libsamplerate error code, see strerror()
+	  */
+	int process (SRC_DATA& data);
+
+	static char const* strerror (int err) { return src_strerror (err); }
+
+  private:
+	struct Channel {
+		Channel () : src (0), zita (0), in (0), out (0), err (0) {}
+
+		SRC_STATE*             src;
+		ArdourZita::Resampler* zita;
+		float*                 in;
+		float*                 out;
+		SRC_DATA               data;
+		int                    err;
+	};
+
+	/* ThreaderPool::Job */
+	void run_job ();
+	void process_channel (uint32_t c);
+
+	void clear ();
+
+	uint32_t      _n_channels;
+	Channel*      _channels;
+	ThreaderPool* _pool;
+
+	bool          _use_zita;
+	double        _ratio;      // out_rate / in_rate
+	samplecnt_t   _max_frames; // per channel, input
+	samplecnt_t   _max_out;    // per channel, output
+
+	/* zita-resampler does not keep track of the length, the output is
+	 * padded up to the expected length at the end of input.
+	 */
+	samplecnt_t   _in_total;
+	samplecnt_t   _out_total;
+
+	SRC_DATA*             _job;
+	std::atomic<uint32_t> _next_channel;
+};
+
+} // namespace
+
+#endif // AUDIOGRAPHER_PARALLEL_SRC_H
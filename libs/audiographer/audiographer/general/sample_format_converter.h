@@ -4,6 +4,7 @@
 #include "audiographer/visibility.h"
 #include "audiographer/sink.h"
 #include "audiographer/utils/listed_source.h"
+#include "private/dither_noise.h"
 #include "private/gdither/gdither_types.h"
 
 namespace AudioGrapher
@@ -20,6 +21,9 @@ enum /*LIBAUDIOGRAPHER_API*/ DitherType
 
 /** Sample format converter that does dithering.
   * This class can only convert floats to either \a float, \a int32_t, \a int16_t, or \a uint8_t
+  *
+  * Full width integer formats (8, 16 and 24 bit) without noise shaping are
+  * converted using vector instructions, all other cases use gdither.
   */
 template <typename TOut>
 class LIBAUDIOGRAPHER_API SampleFormatConverter
@@ -57,6 +61,10 @@ class LIBAUDIOGRAPHER_API SampleFormatConverter
 	void init_common (samplecnt_t max_samples); // not-template-specialized part of init
 	void check_sample_and_channel_count (samplecnt_t samples, ChannelCount channels_);
 
+	/// convert all channels at once, used instead of gdither if \a fast_convert is set
+	void convert (float const * data, samplecnt_t samples);
+	float const * dither_values (samplecnt_t samples);
+
 	ChannelCount channels;
 	GDither      dither;
 	samplecnt_t   data_out_size;
@@ -64,6 +72,13 @@ class LIBAUDIOGRAPHER_API SampleFormatConverter
 
 	bool         clip_floats;
 
+	bool         fast_convert;
+	int          dither_type;
+	DitherNoise  noise;
+	float *      noise_buf;  // [data_out_size]
+	float *      dither_buf; // [data_out_size]
+	float *      tri_state;  // [channels], last noise value of each channel
+
 };
 
 } // namespace
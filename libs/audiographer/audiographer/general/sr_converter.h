@@ -8,6 +8,7 @@
 #include "audiographer/sink.h"
 #include "audiographer/throwing.h"
 #include "audiographer/types.h"
+#include "audiographer/general/parallel_src.h"
 #include "audiographer/utils/listed_source.h"
 
 namespace AudioGrapher
@@ -25,9 +26,14 @@ class LIBAUDIOGRAPHER_API SampleRateConverter
 	SampleRateConverter (uint32_t channels);
 	~SampleRateConverter ();
 
-	/// Init converter \n Not RT safe
+	/** Init converter \n Not RT safe
+	  * \param quality libsamplerate converter type or ParallelSRC::ZitaBest, ParallelSRC::ZitaGood
+	  */
 	void init (samplecnt_t in_rate, samplecnt_t out_rate, int quality = 0);
 
+	/// Convert channels in parallel in the workers of \a pool
+	void set_thread_pool (ThreaderPool& pool);
+
 	/// Returns max amount of samples that will be output \n RT safe
 	samplecnt_t allocate_buffers (samplecnt_t max_samples);
 
@@ -56,7 +62,8 @@ class LIBAUDIOGRAPHER_API SampleRateConverter
 	samplecnt_t     data_out_size;
 
 	SRC_DATA       src_data;
-	SRC_STATE*     src_state;
+	ParallelSRC*   src;
+	ThreaderPool*  thread_pool;
 };
 
 } // namespace
@@ -1,21 +1,18 @@
 #ifndef AUDIOGRAPHER_THREADER_H
 #define AUDIOGRAPHER_THREADER_H
 
-#include <glibmm/threadpool.h>
-#include <glibmm/timeval.h>
-#include <sigc++/slot.h>
+#include <glibmm/threads.h>
 #include <boost/format.hpp>
 
-#include <glib.h>
+#include <atomic>
 #include <vector>
 #include <algorithm>
 
-#include "pbd/g_atomic_compat.h"
-
 #include "audiographer/visibility.h"
 #include "audiographer/source.h"
 #include "audiographer/sink.h"
 #include "audiographer/exception.h"
+#include "audiographer/general/threader_pool.h"
 
 namespace AudioGrapher
 {
@@ -33,9 +30,17 @@ class /*LIBAUDIOGRAPHER_API*/ ThreaderException : public Exception
 	{ }
 };
 
-/// Class for distributing processing across several threads
+/** Class for distributing processing across several threads
+  *
+  * Every output is run by one thread: the calling thread and idle workers
+  * of the ThreaderPool claim outputs using an atomic counter until none are
+  * left. Nothing is allocated or locked per processed chunk.
+  */
 template <typename T = DefaultSampleType>
-class /*LIBAUDIOGRAPHER_API*/ Threader : public Source<T>, public Sink<T>
+class /*LIBAUDIOGRAPHER_API*/ Threader
+  : public Source<T>
+  , public Sink<T>
+  , private ThreaderPool::Job
 {
   private:
 	typedef std::vector<typename Source<T>::SinkPtr> OutputVec;
@@ -44,14 +49,14 @@ class /*LIBAUDIOGRAPHER_API*/ Threader : public Source<T>, public Sink<T>
 
 	/** Constructor
 	  * \n RT safe
-	  * \param thread_pool a thread pool from which all tasks are scheduled
-	  * \param wait_timeout_milliseconds maximum time allowed for threads to use in processing
+	  * \param thread_pool the worker threads which help processing outputs
 	  */
-	Threader (Glib::ThreadPool & thread_pool, long wait_timeout_milliseconds = 500)
+	Threader (ThreaderPool & thread_pool)
 	  : thread_pool (thread_pool)
-	  , wait_timeout (wait_timeout_milliseconds)
+	  , context (0)
+	  , n_outputs (0)
+	  , next_output (0)
 	{
-		g_atomic_int_set (&readers, 0);
 	}
 
 	virtual ~Threader () {}
@@ -68,37 +73,44 @@ class /*LIBAUDIOGRAPHER_API*/ Threader : public Source<T>, public Sink<T>
 		outputs.erase (new_end, outputs.end());
 	}
 
-	/// Processes context concurrently by scheduling each output separately to the given thread pool
+	/// Processes context concurrently by sharing the outputs between the calling thread and the thread pool
 	void process (ProcessContext<T> const & c)
 	{
-		wait_mutex.lock();
-
 		exception.reset();
 
 		unsigned int outs = outputs.size();
-		g_atomic_int_add (&readers, outs);
-		for (unsigned int i = 0; i < outs; ++i) {
-			thread_pool.push (sigc::bind (sigc::mem_fun (this, &Threader::process_output), c, i));
+
+		context = &c;
+		n_outputs = outs;
+		next_output.store (0, std::memory_order_release);
+
+		/* The calling thread takes part, so only outs - 1 helpers are
+		 * needed. Waiting until every helper has let go of this job
+		 * (not just until all outputs are done) makes sure no stale
+		 * queue entry is left for the next chunk.
+		 */
+		if (outs > 1) {
+			thread_pool.schedule (*this, outs - 1);
 		}
+		run_job ();
+		thread_pool.wait (*this);
+
+		context = 0;
 
-		wait();
+		if (exception) {
+			throw *exception;
+		}
 	}
 
 	using Sink<T>::process;
 
   private:
 
-	void wait()
+	void run_job ()
 	{
-		while (g_atomic_int_get (&readers) != 0) {
-			gint64 end_time = g_get_monotonic_time () + (wait_timeout * G_TIME_SPAN_MILLISECOND);
-			wait_cond.wait_until(wait_mutex, end_time);
-		}
-
-		wait_mutex.unlock();
-
-		if (exception) {
-			throw *exception;
+		unsigned int output;
+		while ((output = next_output.fetch_add (1, std::memory_order_acq_rel)) < n_outputs) {
+			process_output (*context, output);
 		}
 	}
 
@@ -112,20 +124,15 @@ class /*LIBAUDIOGRAPHER_API*/ Threader : public Source<T>, public Sink<T>
 			if(!exception) { exception.reset (new ThreaderException (*this, e)); }
 			exception_mutex.unlock();
 		}
-
-		if (g_atomic_int_dec_and_test (&readers)) {
-			wait_cond.signal();
-		}
 	}
 
 	OutputVec outputs;
 
-	Glib::ThreadPool&    thread_pool;
-	Glib::Threads::Mutex wait_mutex;
-	Glib::Threads::Cond  wait_cond;
+	ThreaderPool& thread_pool;
 
-	GATOMIC_QUAL gint readers;
-	long         wait_timeout;
+	ProcessContext<T> const * context;
+	unsigned int              n_outputs;
+	std::atomic<unsigned int> next_output;
 
 	Glib::Threads::Mutex exception_mutex;
 	boost::shared_ptr<ThreaderException> exception;
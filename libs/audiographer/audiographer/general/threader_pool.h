@@ -0,0 +1,87 @@
+#ifndef AUDIOGRAPHER_THREADER_POOL_H
+#define AUDIOGRAPHER_THREADER_POOL_H
+
+#include <atomic>
+#include <vector>
+
+#include <pthread.h>
+
+#include <boost/noncopyable.hpp>
+
+#include "pbd/mpmc_queue.h"
+#include "pbd/semutils.h"
+
+#include "audiographer/visibility.h"
+
+namespace AudioGrapher
+{
+
+/** A set of persistent worker threads shared by all Threaders of a graph.
+  *
+  * Workers are started once and sleep on a semaphore while idle. Scheduling
+  * work only pushes a pointer to a lock-free queue and wakes up workers, so
+  * nothing is allocated or locked per processed chunk.
+  */
+class LIBAUDIOGRAPHER_API ThreaderPool : public boost::noncopyable
+{
+  public:
+	/** Something that can be run by several threads at the same time.
+	  * run_job() is called by every worker that picks up the job, and must
+	  * itself hand out the work, returning when nothing is left to do.
+	  */
+	class LIBAUDIOGRAPHER_API Job
+	{
+	  public:
+		Job () : _refs (0) {}
+		virtual ~Job () {}
+
+		virtual void run_job () = 0;
+
+		/// @return true while workers may still be running this job
+		bool busy () const { return _refs.load (std::memory_order_acquire) != 0; }
+
+	  private:
+		friend class ThreaderPool;
+		std::atomic<unsigned int> _refs;
+	};
+
+	/** Constructor, starts the worker threads
+	  * \param n_workers number of worker threads
+	  * \param pin_threads bind each worker to one CPU core (where supported)
+	  */
+	ThreaderPool (unsigned int n_workers, bool pin_threads = true);
+	~ThreaderPool ();
+
+	unsigned int n_workers () const { return _threads.size (); }
+
+	/** Ask up to \a n idle workers to help with \a job \n RT safe
+	  * The caller is expected to work on the job itself as well, and then
+	  * wait for it with wait().
+	  * @return number of workers asked, less than \a n if the queue is full
+	  */
+	unsigned int schedule (Job& job, unsigned int n);
+
+	/** Wait until no worker is running \a job anymore. While waiting, other
+	  * queued jobs are run by the calling thread, which makes it safe to
+	  * wait from within a worker (nested Threaders).
+	  */
+	void wait (Job const& job);
+
+  private:
+	static void* _thread_work (void*);
+	void thread_work ();
+
+	/// pop one job off the queue and run it, @return false if the queue was empty
+	bool run_one ();
+
+	std::vector<pthread_t>    _threads;
+	PBD::MPMCQueue<Job*>      _queue;
+	unsigned int              _queue_size;
+	std::atomic<unsigned int> _queued; // never more than _queue_size
+	PBD::Semaphore            _sem;
+	std::atomic<bool>         _quit;
+};
+
+} // namespace
+
+#endif // AUDIOGRAPHER_THREADER_POOL_H
@@ -0,0 +1,180 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef AUDIOGRAPHER_TMP_FILE_MEM_H
+#define AUDIOGRAPHER_TMP_FILE_MEM_H
+
+#include <cstring>
+#include <vector>
+
+#include "pbd/memory_account.h"
+
+#include "sndfile_writer.h"
+#include "sndfile_reader.h"
+#include "tmp_file.h"
+
+namespace AudioGrapher
+{
+
+/** A temporary "file" kept in memory.
+  *
+  * The expected size is allocated up front, writing does not allocate
+  * unless more data than expected arrives. Memory use is accounted
+  * as "export-tmp", create() uses that to share one limit between all
+  * temporary files.
+  */
+template<typename T = DefaultSampleType>
+class TmpFileMem
+	: public TmpFile<T>
+{
+  public:
+
+	/// \a reserve_samples is the expected number of samples (all channels) to be written
+	TmpFileMem (int format, ChannelCount channels, samplecnt_t samplerate, samplecnt_t reserve_samples)
+		: _size (0)
+		, _pos (0)
+	{
+		account ().add (reserve_samples * sizeof (T));
+		init (format, channels, samplerate, reserve_samples);
+	}
+
+	/** Create a temporary file in memory, if it fits into what is left of
+	  * \a limit bytes, shared by all TmpFileMem.
+	  * \return the new file, or 0 if it does not fit
+	  */
+	static TmpFileMem* create (int format, ChannelCount channels, samplecnt_t samplerate, samplecnt_t reserve_samples, int64_t limit)
+	{
+		if (!account ().try_add (reserve_samples * sizeof (T), limit)) {
+			return 0;
+		}
+		return new TmpFileMem (format, channels, samplerate, reserve_samples, Reserved ());
+	}
+
+	~TmpFileMem ()
+	{
+		SndfileBase::close ();
+		account ().remove (_data.size ());
+	}
+
+	void process (ProcessContext<T> const & c)
+	{
+		SndfileWriter<T>::process (c);
+
+		if (c.has_flag(ProcessContext<T>::EndOfInput)) {
+			TmpFile<T>::FileFlushed ();
+		}
+	}
+
+	using Sink<T>::process;
+
+	static PBD::MemoryAccount& account ()
+	{
+		static PBD::MemoryAccount& a (PBD::MemoryAccount::get ("export-tmp"));
+		return a;
+	}
+
+  private:
+	TmpFileMem (TmpFileMem const & other);
+
+	struct Reserved {};
+
+	/* the reserved bytes have already been added to the account */
+	TmpFileMem (int format, ChannelCount channels, samplecnt_t samplerate, samplecnt_t reserve_samples, Reserved)
+		: _size (0)
+		, _pos (0)
+	{
+		init (format, channels, samplerate, reserve_samples);
+	}
+
+	void init (int format, ChannelCount channels, samplecnt_t samplerate, samplecnt_t reserve_samples)
+	{
+		_data.resize (reserve_samples * sizeof (T));
+
+		_vio.get_filelen = &vio_get_filelen;
+		_vio.seek        = &vio_seek;
+		_vio.read        = &vio_read;
+		_vio.write       = &vio_write;
+		_vio.tell        = &vio_tell;
+
+		SndfileHandle::operator= (SndfileHandle (_vio, this, SndfileBase::ReadWrite, format, channels, samplerate));
+	}
+
+	static sf_count_t vio_get_filelen (void* user_data)
+	{
+		return static_cast<TmpFileMem*> (user_data)->_size;
+	}
+
+	static sf_count_t vio_seek (sf_count_t offset, int whence, void* user_data)
+	{
+		TmpFileMem* self = static_cast<TmpFileMem*> (user_data);
+		switch (whence) {
+			case SEEK_SET:
+				break;
+			case SEEK_CUR:
+				offset += self->_pos;
+				break;
+			case SEEK_END:
+				offset += self->_size;
+				break;
+			default:
+				return -1;
+		}
+		if (offset < 0) {
+			return -1;
+		}
+		self->_pos = offset;
+		return offset;
+	}
+
+	static sf_count_t vio_read (void* ptr, sf_count_t count, void* user_data)
+	{
+		TmpFileMem* self = static_cast<TmpFileMem*> (user_data);
+		count = std::max<sf_count_t> (0, std::min (count, self->_size - self->_pos));
+		memcpy (ptr, self->_data.data () + self->_pos, count);
+		self->_pos += count;
+		return count;
+	}
+
+	static sf_count_t vio_write (void const* ptr, sf_count_t count, void* user_data)
+	{
+		TmpFileMem* self = static_cast<TmpFileMem*> (user_data);
+		sf_count_t const end = self->_pos + count;
+		if (end > (sf_count_t) self->_data.size ()) {
+			/* more than expected, grow */
+			size_t const old_size = self->_data.size ();
+			self->_data.resize (std::max<size_t> (end, 2 * old_size));
+			account ().change (old_size, self->_data.size ());
+		}
+		memcpy (self->_data.data () + self->_pos, ptr, count);
+		self->_pos  = end;
+		self->_size = std::max (self->_size, end);
+		return count;
+	}
+
+	static sf_count_t vio_tell (void* user_data)
+	{
+		return static_cast<TmpFileMem*> (user_data)->_pos;
+	}
+
+	SF_VIRTUAL_IO     _vio;
+	std::vector<char> _data;
+	sf_count_t        _size;
+	sf_count_t        _pos;
+};
+
+} // namespace
+
+#endif // AUDIOGRAPHER_TMP_FILE_MEM_H
@@ -0,0 +1,83 @@
+/* Measure how long AudioGrapher::Analyser holds up the export graph,
+ * analysing in the calling thread and in a ThreaderPool, in seconds of
+ * audio per second.
+ *
+ * Usage: analyser [<seconds> [<channels> [<workers>]]]
+ */
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+#include <glib.h>
+
+#include "pbd/cpus.h"
+
+#include "audiographer/general/analyser.h"
+
+using namespace std;
+using namespace AudioGrapher;
+
+class NullSink : public Sink<float>
+{
+  public:
+	void process (ProcessContext<float> const &) {}
+	using Sink<float>::process;
+};
+
+static void
+run (char const* name, ThreaderPool* pool, int seconds, ChannelCount channels, float* data)
+{
+	samplecnt_t const sample_rate = 48000;
+	samplecnt_t const chunk_size  = 8192 * channels;
+	samplecnt_t const n_samples   = seconds * sample_rate;
+
+	Analyser analyser (sample_rate, channels, chunk_size, n_samples);
+	if (pool) {
+		analyser.set_thread_pool (*pool);
+	}
+	analyser.add_output (boost::shared_ptr<NullSink> (new NullSink));
+
+	gint64 const start = g_get_monotonic_time ();
+	for (samplecnt_t pos = 0; pos < n_samples; pos += chunk_size / channels) {
+		ProcessContext<float> c (data, min (chunk_size, (n_samples - pos) * channels), channels);
+		analyser.process (c);
+	}
+	double const processed = (g_get_monotonic_time () - start) / 1e6;
+
+	analyser.result ();
+	double const finished = (g_get_monotonic_time () - start) / 1e6;
+
+	cout << setw (8) << name << ": "
+	     << fixed << setprecision (1) << seconds / processed << " sec/sec passed on, "
+	     << seconds / finished << " sec/sec analysed\n";
+}
+
+int main (int argc, char* argv[])
+{
+	int const          seconds  = argc > 1 ? atoi (argv[1]) : 60;
+	ChannelCount const channels = argc > 2 ? atoi (argv[2]) : 2;
+	unsigned int const workers  = argc > 3 ? atoi (argv[3]) : hardware_concurrency ();
+
+	if (seconds < 1 || channels < 1) {
+		cerr << "Syntax: analyser [<seconds> [<channels> [<workers>]]]\n";
+		return EXIT_FAILURE;
+	}
+
+	samplecnt_t const samples = 8192 * channels;
+
+	float* data = new float[samples];
+	for (samplecnt_t i = 0; i < samples; ++i) {
+		data[i] = g_random_double_range (-1.0, 1.0);
+	}
+
+	ThreaderPool pool (workers);
+
+	cout << "channels: " << (int) channels << ", workers: " << pool.n_workers () << "\n";
+
+	run ("inline", 0, seconds, channels, data);
+	run ("threaded", &pool, seconds, channels, data);
+
+	delete [] data;
+	return EXIT_SUCCESS;
+}
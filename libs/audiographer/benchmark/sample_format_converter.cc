@@ -0,0 +1,76 @@
+/* Measure the throughput of AudioGrapher::SampleFormatConverter
+ * for all integer formats and dither types, in million samples per second.
+ *
+ * Usage: sample_format_converter [<chunks> [<chunk-size> [<channels>]]]
+ */
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+#include <glib.h>
+
+#include "audiographer/general/sample_format_converter.h"
+
+using namespace std;
+using namespace AudioGrapher;
+
+template <typename T>
+class NullSink : public Sink<T>
+{
+  public:
+	void process (ProcessContext<T> const &) {}
+	using Sink<T>::process;
+};
+
+template <typename T>
+static void
+run (char const* name, int data_width, int chunks, samplecnt_t chunk_size, ChannelCount channels, float* data)
+{
+	static char const* dither_names[] = { "none", "rect", "tri", "shaped" };
+
+	for (int type = D_None; type <= D_Shaped; ++type) {
+		SampleFormatConverter<T> converter (channels);
+		converter.init (chunk_size, type, data_width);
+		converter.add_output (boost::shared_ptr<NullSink<T> > (new NullSink<T>));
+
+		ProcessContext<float> const c (data, chunk_size, channels);
+
+		gint64 const start = g_get_monotonic_time ();
+		for (int n = 0; n < chunks; ++n) {
+			converter.process (c);
+		}
+		double const elapsed = (g_get_monotonic_time () - start) / 1e6;
+
+		cout << setw (6) << name << " " << setw (6) << dither_names[type] << ": "
+		     << fixed << setprecision (1) << chunks * chunk_size / elapsed / 1e6 << " Msamples/sec\n";
+	}
+}
+
+int main (int argc, char* argv[])
+{
+	int const          chunks     = argc > 1 ? atoi (argv[1]) : 2000;
+	samplecnt_t const  chunk_size = argc > 2 ? atoi (argv[2]) : 8192;
+	ChannelCount const channels   = argc > 3 ? atoi (argv[3]) : 2;
+
+	if (chunks < 1 || channels < 1 || chunk_size < (samplecnt_t) channels) {
+		cerr << "Syntax: sample_format_converter [<chunks> [<chunk-size> [<channels>]]]\n";
+		return EXIT_FAILURE;
+	}
+
+	samplecnt_t const samples = chunk_size - (chunk_size % channels);
+
+	float* data = new float[samples];
+	for (samplecnt_t i = 0; i < samples; ++i) {
+		data[i] = g_random_double_range (-1.0, 1.0);
+	}
+
+	cout << "chunk size: " << samples << ", channels: " << (int) channels << "\n";
+
+	run<int32_t> ("int24", 24, chunks, samples, channels, data);
+	run<int16_t> ("int16", 16, chunks, samples, channels, data);
+	run<uint8_t> ("uint8", 8, chunks, samples, channels, data);
+
+	delete [] data;
+	return EXIT_SUCCESS;
+}
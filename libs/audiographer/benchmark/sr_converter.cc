@@ -0,0 +1,96 @@
+/* Measure the throughput of AudioGrapher::SampleRateConverter for
+ * libsamplerate and zita-resampler, converting channels in the calling
+ * thread and in parallel, in million input samples per second.
+ *
+ * Usage: sr_converter [<seconds> [<channels> [<in-rate> [<out-rate> [<workers>]]]]]
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+#include <glib.h>
+
+#include "pbd/cpus.h"
+
+#include "audiographer/general/sr_converter.h"
+
+using namespace std;
+using namespace AudioGrapher;
+
+class NullSink : public Sink<float>
+{
+  public:
+	void process (ProcessContext<float> const &) {}
+	using Sink<float>::process;
+};
+
+static void
+run (char const* name, int quality, ThreaderPool* pool, int seconds, unsigned int channels, samplecnt_t in_rate, samplecnt_t out_rate, float* data)
+{
+	samplecnt_t const chunk_size = 8192 * channels;
+	samplecnt_t const n_samples  = seconds * in_rate * channels;
+
+	SampleRateConverter converter (channels);
+	if (pool) {
+		converter.set_thread_pool (*pool);
+	}
+	converter.init (in_rate, out_rate, quality);
+	converter.allocate_buffers (chunk_size);
+	converter.add_output (boost::shared_ptr<NullSink> (new NullSink));
+
+	gint64 const start = g_get_monotonic_time ();
+	for (samplecnt_t pos = 0; pos < n_samples; pos += chunk_size) {
+		ProcessContext<float> c (data, min (chunk_size, n_samples - pos), channels);
+		if (pos + chunk_size >= n_samples) {
+			c.set_flag (ProcessContext<float>::EndOfInput);
+		}
+		converter.process (c);
+	}
+	double const elapsed = (g_get_monotonic_time () - start) / 1e6;
+
+	cout << setw (14) << name << (pool ? " parallel" : "   serial") << ": "
+	     << fixed << setprecision (1) << n_samples / elapsed / 1e6 << " Msamples/sec\n";
+}
+
+int main (int argc, char* argv[])
+{
+	int const          seconds  = argc > 1 ? atoi (argv[1]) : 10;
+	unsigned int const channels = argc > 2 ? atoi (argv[2]) : 8;
+	samplecnt_t const  in_rate  = argc > 3 ? atoi (argv[3]) : 96000;
+	samplecnt_t const  out_rate = argc > 4 ? atoi (argv[4]) : 48000;
+	unsigned int const workers  = std::max<int> (0, argc > 5 ? atoi (argv[5]) : (int) hardware_concurrency () - 1);
+
+	if (seconds < 1 || channels < 1 || in_rate < 1 || out_rate < 1) {
+		cerr << "Syntax: sr_converter [<seconds> [<channels> [<in-rate> [<out-rate> [<workers>]]]]]\n";
+		return EXIT_FAILURE;
+	}
+
+	samplecnt_t const samples = 8192 * channels;
+
+	float* data = new float[samples];
+	for (samplecnt_t i = 0; i < samples; ++i) {
+		data[i] = g_random_double_range (-1.0, 1.0);
+	}
+
+	ThreaderPool pool (workers);
+
+	cout << in_rate << " -> " << out_rate << ", channels: " << channels << ", workers: " << pool.n_workers () << "\n";
+
+	struct { char const* name; int quality; } const engines[] = {
+		{ "sinc best",     SRC_SINC_BEST_QUALITY },
+		{ "sinc medium",   SRC_SINC_MEDIUM_QUALITY },
+		{ "sinc fastest",  SRC_SINC_FASTEST },
+		{ "zita best",     ParallelSRC::ZitaBest },
+		{ "zita good",     ParallelSRC::ZitaGood },
+	};
+
+	for (size_t e = 0; e < sizeof (engines) / sizeof (engines[0]); ++e) {
+		run (engines[e].name, engines[e].quality, 0, seconds, channels, in_rate, out_rate, data);
+		run (engines[e].name, engines[e].quality, &pool, seconds, channels, in_rate, out_rate, data);
+	}
+
+	delete [] data;
+	return EXIT_SUCCESS;
+}
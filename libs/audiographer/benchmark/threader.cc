@@ -0,0 +1,80 @@
+/* Measure the dispatch throughput of AudioGrapher::Threader:
+ * processed chunks per second, for 1 to 64 outputs.
+ *
+ * Usage: threader [<chunks> [<chunk-size> [<workers>]]]
+ */
+
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+#include <glib.h>
+
+#include "pbd/cpus.h"
+
+#include "audiographer/general/threader.h"
+
+using namespace std;
+using namespace AudioGrapher;
+
+/** A cheap sink, similar to a peak reader */
+class PeakSink : public Sink<float>
+{
+  public:
+	PeakSink () : peak (0) {}
+
+	void process (ProcessContext<float> const & c)
+	{
+		float const* d = c.data ();
+		for (samplecnt_t i = 0; i < c.samples (); ++i) {
+			peak = max (peak, fabsf (d[i]));
+		}
+	}
+	using Sink<float>::process;
+
+	float peak;
+};
+
+int main (int argc, char* argv[])
+{
+	int const         chunks     = argc > 1 ? atoi (argv[1]) : 20000;
+	samplecnt_t const chunk_size = argc > 2 ? atoi (argv[2]) : 1024;
+	unsigned int const workers   = argc > 3 ? atoi (argv[3]) : hardware_concurrency ();
+
+	if (chunks < 1 || chunk_size < 1) {
+		cerr << "Syntax: threader [<chunks> [<chunk-size> [<workers>]]]\n";
+		return EXIT_FAILURE;
+	}
+
+	float* data = new float[chunk_size];
+	for (samplecnt_t i = 0; i < chunk_size; ++i) {
+		data[i] = g_random_double_range (-1.0, 1.0);
+	}
+
+	ThreaderPool pool (workers);
+
+	cout << "workers: " << pool.n_workers () << ", chunk size: " << chunk_size << "\n";
+
+	for (unsigned int outputs = 1; outputs <= 64; outputs *= 2) {
+		Threader<float> threader (pool);
+		for (unsigned int o = 0; o < outputs; ++o) {
+			threader.add_output (boost::shared_ptr<PeakSink> (new PeakSink));
+		}
+
+		ProcessContext<float> c (data, chunk_size, 1);
+
+		gint64 const start = g_get_monotonic_time ();
+		for (int n = 0; n < chunks; ++n) {
+			threader.process (c);
+		}
+		double const elapsed = (g_get_monotonic_time () - start) / 1e6;
+
+		cout << setw (2) << outputs << " outputs: "
+		     << fixed << setprecision (0) << chunks / elapsed << " chunks/sec, "
+		     << setprecision (2) << 1e6 * elapsed / chunks << " usec/chunk\n";
+	}
+
+	delete [] data;
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,71 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef AUDIOGRAPHER_DITHER_NOISE_H
+#define AUDIOGRAPHER_DITHER_NOISE_H
+
+#include <stdint.h>
+
+#include "audiographer/types.h"
+
+namespace AudioGrapher
+{
+
+/** White noise in the range [0, 1) for dithering.
+  *
+  * Same generator as gdither_noise(), but every instance has its own state
+  * (converters run concurrently) and there are several independent lanes,
+  * so that a block of noise is computed with vector instructions.
+  */
+class DitherNoise
+{
+  public:
+	DitherNoise (uint32_t seed = 23232323)
+	{
+		for (int l = 0; l < lanes; ++l) {
+			_state[l] = seed + l * 0x9e3779b9;
+		}
+	}
+
+	void generate (float* dst, samplecnt_t n)
+	{
+		samplecnt_t i = 0;
+		for (; i + lanes <= n; i += lanes) {
+			for (int l = 0; l < lanes; ++l) {
+				dst[i + l] = step (_state[l]);
+			}
+		}
+		for (int l = 0; i < n; ++i, ++l) {
+			dst[i] = step (_state[l]);
+		}
+	}
+
+  private:
+	static const int lanes = 8;
+
+	static inline float step (uint32_t& rnd)
+	{
+		rnd = (rnd * 196314165) + 907633515;
+		/* use the upper 24 bits, they convert to float exactly */
+		return (int32_t)(rnd >> 8) * (1.f / 16777216.f);
+	}
+
+	uint32_t _state[lanes];
+};
+
+} // namespace
+
+#endif // AUDIOGRAPHER_DITHER_NOISE_H
@@ -16,6 +16,13 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include <algorithm>
+#include <cstring>
+#include <map>
+
+#include <boost/smart_ptr/detail/yield_k.hpp>
+#include <glibmm/threads.h>
+
 #include "audiographer/general/analyser.h"
 #include "pbd/fastlog.h"
 
@@ -23,12 +30,69 @@ using namespace AudioGrapher;
 
 const float Analyser::fft_range_db (120); // dB
 
+namespace {
+
+/* A plan only depends on the FFT size, and can be executed on any (equally
+ * aligned) arrays by several threads at the same time. Planning on the
+ * other hand is slow with FFTW_MEASURE and not thread-safe. So plan every
+ * size only once and share it by all analysers, along with the window.
+ */
+struct FFTPlan {
+	fftwf_plan plan;
+	float*     hann_window;
+};
+
+static Glib::Threads::Mutex        fft_plan_lock;
+static std::map<uint32_t, FFTPlan> fft_plans;
+
+static FFTPlan const&
+fft_plan (uint32_t size)
+{
+	Glib::Threads::Mutex::Lock lm (fft_plan_lock);
+
+	std::map<uint32_t, FFTPlan>::const_iterator i = fft_plans.find (size);
+	if (i != fft_plans.end ()) {
+		return i->second;
+	}
+
+	FFTPlan p;
+
+	/* measuring overwrites the arrays, plan on scratch buffers */
+	float* in  = (float *) fftwf_malloc (sizeof (float) * size);
+	float* out = (float *) fftwf_malloc (sizeof (float) * size);
+	p.plan = fftwf_plan_r2r_1d (size, in, out, FFTW_R2HC, FFTW_MEASURE);
+	fftwf_free (in);
+	fftwf_free (out);
+
+	p.hann_window = (float *) malloc (sizeof (float) * size);
+	double sum = 0.0;
+
+	for (uint32_t i = 0; i < size; ++i) {
+		p.hann_window[i] = 0.5f - (0.5f * (float) cos (2.0f * M_PI * (float)i / (float)(size)));
+		sum += p.hann_window[i];
+	}
+	const double isum = 2.0 / sum;
+	for (uint32_t i = 0; i < size; ++i) {
+		p.hann_window[i] *= isum;
+	}
+
+	return fft_plans.insert (std::make_pair (size, p)).first->second;
+}
+
+} // anon namespace
+
 Analyser::Analyser (float sample_rate, unsigned int channels, samplecnt_t bufsize, samplecnt_t n_samples, size_t width, size_t bins)
 	: LoudnessReader (sample_rate, channels, bufsize)
 	, _rp (ARDOUR::ExportAnalysisPtr (new ARDOUR::ExportAnalysis (width, bins)))
 	, _result (*_rp)
 	, _n_samples (n_samples)
 	, _pos (0)
+	, _pool (0)
+	, _chunk_data (0)
+	, _chunk_read (0)
+	, _chunk_write (0)
+	, _analysing (false)
+	, _scheduled (false)
 {
 
 	//printf ("NEW ANALYSER %p r:%.1f c:%d f:%ld l%ld\n", this, sample_rate, channels, bufsize, n_samples);
@@ -67,18 +131,28 @@ Analyser::Analyser (float sample_rate, unsigned int channels, samplecnt_t bufsiz
 	_result.freq[4] = YPOS (5000);
 	_result.freq[5] = YPOS (10000);
 
-	_fft_plan = fftwf_plan_r2r_1d (_bufsize, _fft_data_in, _fft_data_out, FFTW_R2HC, FFTW_MEASURE);
+	FFTPlan const& plan = fft_plan (_bufsize);
+	_fft_plan    = plan.plan;
+	_hann_window = plan.hann_window;
 
-	_hann_window = (float *) malloc (sizeof (float) * _bufsize);
-	double sum = 0.0;
+	/* spectrum rows of each bin, the last bin is not displayed */
+	_bin_y0.resize (_fft_data_size - 1);
+	_bin_y1.resize (_fft_data_size - 1);
+	_column.resize (height);
 
-	for (uint32_t i = 0; i < _bufsize; ++i) {
-		_hann_window[i] = 0.5f - (0.5f * (float) cos (2.0f * M_PI * (float)i / (float)(_bufsize)));
-		sum += _hann_window[i];
-	}
-	const double isum = 2.0 / sum;
-	for (uint32_t i = 0; i < _bufsize; ++i) {
-		_hann_window[i] *= isum;
+	for (uint32_t i = 0; i < _fft_data_size - 1; ++i) {
+#if 0 // linear
+		const uint32_t y0 = floor (i * (float) height / _fft_data_size);
+		uint32_t y1 = ceil ((i + 1.0) * (float) height / _fft_data_size);
+#else // logscale
+		const uint32_t y0 = floor (height * logf (1.f + .1f * i) / logf (1.f + .1f * _fft_data_size));
+		uint32_t y1 = ceilf (height * logf (1.f + .1f * (i + 1.f)) / logf (1.f + .1f * _fft_data_size));
+#endif
+		assert (y0 < height);
+		assert (y1 > 0 && y1 <= height);
+		if (y0 == y1) y1 = y0 + 1;
+		_bin_y0[i] = y0;
+		_bin_y1[i] = std::min<uint32_t> (y1, height);
 	}
 
 	if (channels == 2) {
@@ -90,11 +164,31 @@ Analyser::Analyser (float sample_rate, unsigned int channels, samplecnt_t bufsiz
 
 Analyser::~Analyser ()
 {
-	fftwf_destroy_plan (_fft_plan);
+	if (_pool) {
+		_pool->wait (*this);
+	}
 	fftwf_free (_fft_data_in);
 	fftwf_free (_fft_data_out);
 	free (_fft_power);
-	free (_hann_window);
+	free (_chunk_data);
+}
+
+void
+Analyser::set_thread_pool (ThreaderPool& pool)
+{
+	assert (_pos == 0 && !_pool);
+
+	if (pool.n_workers () == 0) {
+		return;
+	}
+
+	_pool = &pool;
+
+	const samplecnt_t chunk_size = _bufsize * _channels;
+	_chunk_data = (float *) malloc (sizeof (float) * chunk_size * n_chunks);
+	for (uint32_t i = 0; i < n_chunks; ++i) {
+		_chunks[i].data = &_chunk_data[i * chunk_size];
+	}
 }
 
 void
@@ -126,12 +220,84 @@ Analyser::process (ProcessContext<float> const & ctx)
 		return;
 	}
 
-	float const * d = ctx.data ();
+	if (!_pool) {
+		analyse (ctx.data (), n_samples, _pos);
+	} else {
+		/* queue a copy, when the queue is full help with the analysis */
+		const uint32_t w = _chunk_write.load (std::memory_order_relaxed);
+		for (unsigned int i = 0; w - _chunk_read.load (std::memory_order_acquire) >= n_chunks; ) {
+			if (analyse_queued ()) {
+				i = 0;
+			} else {
+				boost::detail::yield (i++);
+			}
+		}
+
+		Chunk& chunk = _chunks[w % n_chunks];
+		memcpy (chunk.data, ctx.data (), sizeof (float) * ctx.samples ());
+		chunk.n_samples = n_samples;
+		chunk.pos       = _pos;
+		_chunk_write.store (w + 1);
+
+		/* one queued job at a time is enough, see run_job () */
+		if (!_scheduled.exchange (true) && _pool->schedule (*this, 1) == 0) {
+			_scheduled.store (false);
+		}
+	}
+
+	_pos += n_samples;
+
+	/* pass audio audio through */
+	ListedSource<float>::output (ctx);
+}
+
+void
+Analyser::run_job ()
+{
+	/* chunks queued before this (sequentially consistent) store are
+	 * seen below, later ones schedule another job.
+	 */
+	_scheduled.store (false);
+	analyse_queued ();
+}
+
+bool
+Analyser::analyse_queued ()
+{
+	bool rv = false;
+
+	/* chunks must be analysed in order, one thread at a time. Re-check
+	 * after letting go, a job scheduled meanwhile may have given up.
+	 */
+	while (_chunk_read.load (std::memory_order_acquire) != _chunk_write.load (std::memory_order_acquire)) {
+		bool idle = false;
+		if (!_analysing.compare_exchange_strong (idle, true, std::memory_order_acquire)) {
+			break;
+		}
+
+		uint32_t r = _chunk_read.load (std::memory_order_relaxed);
+		while (r != _chunk_write.load (std::memory_order_acquire)) {
+			Chunk const& chunk = _chunks[r % n_chunks];
+			analyse (chunk.data, chunk.n_samples, chunk.pos);
+			_chunk_read.store (++r, std::memory_order_release);
+			rv = true;
+		}
+
+		_analysing.store (false, std::memory_order_release);
+	}
+
+	return rv;
+}
+
+void
+Analyser::analyse (float const* data, samplecnt_t n_samples, samplecnt_t pos)
+{
+	float const * d = data;
 	samplecnt_t s;
 	const unsigned cmask = _result.n_channels - 1; // [0, 1]
 	for (s = 0; s < n_samples; ++s) {
 		_fft_data_in[s] = 0;
-		const samplecnt_t pbin = (_pos + s) / _spp;
+		const samplecnt_t pbin = (pos + s) / _spp;
 		assert (pbin >= 0 && pbin < _result.width);
 		for (unsigned int c = 0; c < _channels; ++c) {
 			const float v = *d;
@@ -155,10 +321,10 @@ Analyser::process (ProcessContext<float> const & ctx)
 	}
 
 	if (_ebur_plugin) {
-		Vamp::Plugin::FeatureSet features = _ebur_plugin->process (_bufs, Vamp::RealTime::fromSeconds ((double) _pos / _sample_rate));
+		Vamp::Plugin::FeatureSet features = _ebur_plugin->process (_bufs, Vamp::RealTime::fromSeconds ((double) pos / _sample_rate));
 		if (!features.empty ()) {
-			const samplecnt_t p0 = _pos / _spp;
-			const samplecnt_t p1 = (_pos + n_samples -1) / _spp;
+			const samplecnt_t p0 = pos / _spp;
+			const samplecnt_t p1 = (pos + n_samples -1) / _spp;
 			for (samplecnt_t p = p0; p <= p1; ++p) {
 				assert (p >= 0 && p < _result.width);
 				_result.lgraph_i[p] = features[0][0].values[0];
@@ -169,56 +335,70 @@ Analyser::process (ProcessContext<float> const & ctx)
 		}
 	}
 
-	float const * const data = ctx.data ();
 	for (unsigned int c = 0; c < _channels && c < _dbtp_plugins.size (); ++c) {
 		for (s = 0; s < n_samples; ++s) {
 			_bufs[0][s] = data[s * _channels + c];
 		}
-		_dbtp_plugins.at(c)->process (_bufs, Vamp::RealTime::fromSeconds ((double) _pos / _sample_rate));
+		_dbtp_plugins.at(c)->process (_bufs, Vamp::RealTime::fromSeconds ((double) pos / _sample_rate));
 	}
 
-	fftwf_execute (_fft_plan);
+	analyse_spectrum (n_samples, pos);
+}
+
+void
+Analyser::analyse_spectrum (samplecnt_t n_samples, samplecnt_t pos)
+{
+	fftwf_execute_r2r (_fft_plan, _fft_data_in, _fft_data_out);
+
+	/* the loops below are free of branches and function calls,
+	 * so that the compiler can vectorize them.
+	 */
+	const uint32_t n_bins = _fft_data_size - 1;
+	float* const   power  = _fft_power;
 
-	_fft_power[0] = _fft_data_out[0] * _fft_data_out[0];
+	power[0] = _fft_data_out[0] * _fft_data_out[0];
 #define FRe (_fft_data_out[i])
 #define FIm (_fft_data_out[_bufsize - i])
-	for (uint32_t i = 1; i < _fft_data_size - 1; ++i) {
-		_fft_power[i] = (FRe * FRe) + (FIm * FIm);
+	for (uint32_t i = 1; i < n_bins; ++i) {
+		power[i] = (FRe * FRe) + (FIm * FIm);
 	}
 #undef FRe
 #undef FIm
 
-	const size_t height = _result.spectrum[0].size ();
-	const samplecnt_t x0 = _pos / _fpp;
-	samplecnt_t x1 = (_pos + n_samples) / _fpp;
-	if (x0 == x1) x1 = x0 + 1;
+	/* weigh by bin index (pink), map [-fft_range_db, 0] dB to [0, 1].
+	 * Levels below the range end up <= 0, which never raise the spectrum.
+	 */
+	for (uint32_t i = 0; i < n_bins; ++i) {
+		const float a     = power[i] * i;
+		const float level = 10.f * fast_log10 (a > 1e-12f ? a : 1e-12f);
+		const float pk    = (fft_range_db + level) / fft_range_db;
+		power[i] = pk < 1.f ? pk : 1.f;
+	}
 
-	for (uint32_t i = 0; i < _fft_data_size - 1; ++i) {
-		const float level = fft_power_at_bin (i, i);
-		if (level < -fft_range_db) continue;
-		const float pk = level > 0.0 ? 1.0 : (fft_range_db + level) / fft_range_db;
-#if 0 // linear
-		const uint32_t y0 = floor (i * (float) height / _fft_data_size);
-		uint32_t y1 = ceil ((i + 1.0) * (float) height / _fft_data_size);
-#else // logscale
-		const uint32_t y0 = floor (height * logf (1.f + .1f * i) / logf (1.f + .1f * _fft_data_size));
-		uint32_t y1 = ceilf (height * logf (1.f + .1f * (i + 1.f)) / logf (1.f + .1f * _fft_data_size));
-#endif
-		assert (y0 < height);
-		assert (y1 > 0 && y1 <= height);
-		if (y0 == y1) y1 = y0 + 1;
-		for (int x = x0; x < x1; ++x) {
-			for (uint32_t y = y0; y < y1 && y < height; ++y) {
-				uint32_t yy = height - 1 - y;
-				if (_result.spectrum[x][yy] < pk) { _result.spectrum[x][yy] = pk; }
-			}
+	/* bins to rows of this chunk */
+	const size_t height = _column.size ();
+	float* const column = &_column[0];
+	std::fill (_column.begin (), _column.end (), 0.f);
+
+	for (uint32_t i = 0; i < n_bins; ++i) {
+		const float pk = power[i];
+		for (uint32_t y = _bin_y0[i]; y < _bin_y1[i]; ++y) {
+			float& v = column[height - 1 - y];
+			v = v > pk ? v : pk;
 		}
 	}
 
-	_pos += n_samples;
+	/* and rows to the columns of the spectrum covered by this chunk */
+	const samplecnt_t x0 = pos / _fpp;
+	samplecnt_t x1 = (pos + n_samples) / _fpp;
+	if (x0 == x1) x1 = x0 + 1;
 
-	/* pass audio audio through */
-	ListedSource<float>::output (ctx);
+	for (samplecnt_t x = x0; x < x1; ++x) {
+		float* const spectrum = &_result.spectrum[x][0];
+		for (size_t y = 0; y < height; ++y) {
+			spectrum[y] = spectrum[y] > column[y] ? spectrum[y] : column[y];
+		}
+	}
 }
 
 ARDOUR::ExportAnalysisPtr
@@ -228,6 +408,11 @@ Analyser::result (bool ptr_only)
 		return _rp;
 	}
 
+	if (_pool) {
+		_pool->wait (*this);
+		analyse_queued ();
+	}
+
 	//printf ("PROCESSED %ld / %ld samples\n", _pos, _n_samples);
 	if (_pos == 0 || _pos > _n_samples + 1) {
 		return ARDOUR::ExportAnalysisPtr ();
@@ -303,10 +488,3 @@ Analyser::result (bool ptr_only)
 
 	return _rp;
 }
-
-float
-Analyser::fft_power_at_bin (const uint32_t b, const float norm) const
-{
-	const float a = _fft_power[b] * norm;
-	return a > 1e-12 ? 10.0 * fast_log10 (a) : -INFINITY;
-}
@@ -164,38 +164,47 @@ LoudnessReader::get_loudness (float* integrated, float* short_term, float* momen
 	return false;
 }
 
-float
-LoudnessReader::calc_peak (float target_lufs, float target_dbtp) const
+LoudnessMeasurement
+LoudnessReader::measurement () const
 {
-	float    LUFSi = 0;
-	float    LUFSs = 0;
-	uint32_t have_dbtp = 0;
-	float    tp_coeff  = 0;
+	LoudnessMeasurement m;
 
-	bool have_lufs = get_loudness (&LUFSi, &LUFSs);
+	m.have_lufs = get_loudness (&m.integrated, &m.short_term);
 
 	for (unsigned int c = 0; c < _channels && c < _dbtp_plugins.size(); ++c) {
 		Vamp::Plugin::FeatureSet features = _dbtp_plugins.at(c)->getRemainingFeatures ();
 		if (!features.empty () && features.size () == 2) {
 			const float tp = features[0][0].values[0];
-			tp_coeff = std::max (tp_coeff, tp);
-			++have_dbtp;
+			m.true_peak = std::max (m.true_peak, tp);
+			m.have_dbtp = true;
 		}
 	}
 
+	return m;
+}
+
+float
+LoudnessReader::calc_peak (float target_lufs, float target_dbtp) const
+{
+	return measurement ().calc_peak (target_lufs, target_dbtp);
+}
+
+float
+LoudnessMeasurement::calc_peak (float target_lufs, float target_dbtp) const
+{
 	float g = 1.f;
 	bool set = false;
 
-	if (have_lufs && LUFSi > -180.0f && target_lufs <= 0.f) {
-		g = powf (10.f, .05f * (LUFSi - target_lufs));
+	if (have_lufs && integrated > -180.0f && target_lufs <= 0.f) {
+		g = powf (10.f, .05f * (integrated - target_lufs));
 		set = true;
-	} else if (have_lufs && LUFSs > -180.0f && target_lufs <= 0.f) {
-		g = powf (10.f, .05f * (LUFSs - target_lufs));
+	} else if (have_lufs && short_term > -180.0f && target_lufs <= 0.f) {
+		g = powf (10.f, .05f * (short_term - target_lufs));
 		set = true;
 	}
 
-	if (have_dbtp && tp_coeff > 0.f && target_dbtp <= 0.f) {
-		const float ge = tp_coeff / powf (10.f, .05f * target_dbtp);
+	if (have_dbtp && true_peak > 0.f && target_dbtp <= 0.f) {
+		const float ge = true_peak / powf (10.f, .05f * target_dbtp);
 		if (set) {
 			g = std::max (g, ge);
 		} else {
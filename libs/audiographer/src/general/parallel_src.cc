@@ -0,0 +1,268 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include "zita-resampler/resampler.h"
+
+#include "audiographer/general/parallel_src.h"
+
+namespace AudioGrapher
+{
+
+ParallelSRC::ParallelSRC (uint32_t channels)
+	: _n_channels (channels)
+	, _channels (new Channel[channels])
+	, _pool (0)
+	, _use_zita (false)
+	, _ratio (1.0)
+	, _max_frames (0)
+	, _max_out (0)
+	, _in_total (0)
+	, _out_total (0)
+	, _job (0)
+	, _next_channel (0)
+{
+	assert (channels > 0);
+}
+
+ParallelSRC::~ParallelSRC ()
+{
+	clear ();
+	for (uint32_t c = 0; c < _n_channels; ++c) {
+		delete [] _channels[c].in;
+		delete [] _channels[c].out;
+	}
+	delete [] _channels;
+}
+
+void
+ParallelSRC::clear ()
+{
+	for (uint32_t c = 0; c < _n_channels; ++c) {
+		Channel& ch = _channels[c];
+		if (ch.src) {
+			src_delete (ch.src);
+			ch.src = 0;
+		}
+		delete ch.zita;
+		ch.zita = 0;
+	}
+	_use_zita = false;
+}
+
+int
+ParallelSRC::setup (samplecnt_t in_rate, samplecnt_t out_rate, int quality)
+{
+	clear ();
+
+	_ratio = (double) out_rate / (double) in_rate;
+
+	if (quality == ZitaBest || quality == ZitaGood) {
+		unsigned int const hlen = quality == ZitaBest ? 96 : 32;
+
+		_use_zita = true;
+		for (uint32_t c = 0; c < _n_channels && _use_zita; ++c) {
+			_channels[c].zita = new ArdourZita::Resampler ();
+			_use_zita = _channels[c].zita->setup (in_rate, out_rate, 1, hlen) == 0;
+		}
+
+		if (!_use_zita) {
+			/* ratio not supported */
+			clear ();
+			quality = quality == ZitaBest ? SRC_SINC_BEST_QUALITY : SRC_SINC_MEDIUM_QUALITY;
+		}
+	}
+
+	if (!_use_zita) {
+		int err = 0;
+		for (uint32_t c = 0; c < _n_channels; ++c) {
+			if (!(_channels[c].src = src_new (quality, 1, &err))) {
+				clear ();
+				return err;
+			}
+		}
+	}
+
+	allocate (std::max<samplecnt_t> (_max_frames, 8192));
+	reset ();
+	return 0;
+}
+
+void
+ParallelSRC::allocate (samplecnt_t max_frames)
+{
+	if (_n_channels == 1) {
+		/* converted in place, see process_channel() */
+		return;
+	}
+
+	samplecnt_t const max_out = (samplecnt_t) ceil (max_frames * _ratio) + 1;
+
+	if (max_frames == _max_frames && max_out == _max_out) {
+		return;
+	}
+
+	_max_frames = max_frames;
+	_max_out    = max_out;
+
+	for (uint32_t c = 0; c < _n_channels; ++c) {
+		Channel& ch = _channels[c];
+		delete [] ch.in;
+		delete [] ch.out;
+		ch.in  = new float[_max_frames];
+		ch.out = new float[_max_out];
+	}
+}
+
+void
+ParallelSRC::reset ()
+{
+	for (uint32_t c = 0; c < _n_channels; ++c) {
+		Channel& ch = _channels[c];
+		if (ch.src) {
+			src_reset (ch.src);
+		}
+		if (ch.zita) {
+			ArdourZita::Resampler& z (*ch.zita);
+			z.reset ();
+			/* align output with input: prime with half the filter length */
+			z.inp_data  = 0;
+			z.inp_count = z.inpsize () / 2 - 1;
+			z.out_data  = 0;
+			z.out_count = 1;
+			z.process ();
+		}
+	}
+	_in_total  = 0;
+	_out_total = 0;
+}
+
+int
+ParallelSRC::process (SRC_DATA& data)
+{
+	if (!_channels[0].src && !_channels[0].zita) {
+		return SRC_ERR_BAD_STATE;
+	}
+
+	SRC_DATA job (data);
+	if (_n_channels > 1) {
+		job.input_frames  = std::min<samplecnt_t> (job.input_frames, _max_frames);
+		job.output_frames = std::min<samplecnt_t> (job.output_frames, _max_out);
+	}
+
+	_job = &job;
+	_next_channel.store (0, std::memory_order_relaxed);
+
+	if (_pool && _n_channels > 1) {
+		_pool->schedule (*this, _n_channels - 1);
+		run_job ();
+		_pool->wait (*this);
+	} else {
+		run_job ();
+	}
+
+	/* consumption only depends on the ratio and the position,
+	 * so all channels are at the same position.
+	 */
+	Channel const& first (_channels[0]);
+	for (uint32_t c = 0; c < _n_channels; ++c) {
+		Channel const& ch (_channels[c]);
+		if (ch.err) {
+			return ch.err;
+		}
+		if (ch.data.input_frames_used != first.data.input_frames_used
+		    || ch.data.output_frames_gen != first.data.output_frames_gen) {
+			return SRC_ERR_BAD_STATE;
+		}
+	}
+
+	data.input_frames_used = first.data.input_frames_used;
+	data.output_frames_gen = first.data.output_frames_gen;
+
+	_in_total  += data.input_frames_used;
+	_out_total += data.output_frames_gen;
+	return 0;
+}
+
+void
+ParallelSRC::run_job ()
+{
+	for (uint32_t c = _next_channel.fetch_add (1); c < _n_channels; c = _next_channel.fetch_add (1)) {
+		process_channel (c);
+	}
+}
+
+void
+ParallelSRC::process_channel (uint32_t c)
+{
+	Channel&  ch (_channels[c]);
+	SRC_DATA& d (ch.data);
+	uint32_t const n = _n_channels;
+
+	d = *_job;
+
+	if (n > 1) {
+		float const* in = &_job->data_in[c];
+		for (long i = 0; i < d.input_frames; ++i, in += n) {
+			ch.in[i] = *in;
+		}
+		d.data_in  = ch.in;
+		d.data_out = ch.out;
+	}
+
+	if (ch.zita) {
+		ArdourZita::Resampler& z (*ch.zita);
+
+		z.inp_data  = const_cast<float*> (d.data_in);
+		z.inp_count = d.input_frames;
+		z.out_data  = d.data_out;
+		z.out_count = d.output_frames;
+		z.process ();
+
+		d.input_frames_used = d.input_frames - z.inp_count;
+		d.output_frames_gen = d.output_frames - z.out_count;
+
+		if (d.end_of_input && z.inp_count == 0) {
+			/* flush the filter with silence, up to the expected length */
+			samplecnt_t const expected = llrint ((_in_total + d.input_frames_used) * _ratio);
+			samplecnt_t const flush    = std::min<samplecnt_t> (d.output_frames - d.output_frames_gen,
+			                                                     expected - _out_total - d.output_frames_gen);
+			if (flush > 0) {
+				z.inp_data  = 0;
+				z.inp_count = z.inpsize ();
+				z.out_data  = d.data_out + d.output_frames_gen;
+				z.out_count = flush;
+				z.process ();
+				d.output_frames_gen += flush - z.out_count;
+			}
+		}
+		ch.err = 0;
+	} else {
+		ch.err = src_process (ch.src, &d);
+	}
+
+	if (n > 1) {
+		float* out = &_job->data_out[c];
+		for (long i = 0; i < d.output_frames_gen; ++i, out += n) {
+			*out = ch.out[i];
+		}
+	}
+}
+
+} // namespace
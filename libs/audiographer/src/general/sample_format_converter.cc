@@ -25,18 +25,162 @@
 #include "audiographer/type_utils.h"
 #include "private/gdither/gdither.h"
 
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
 #include <boost/format.hpp>
 
+#if defined __SSE2__
+# include <emmintrin.h>
+#elif defined __aarch64__
+# include <arm_neon.h>
+#endif
+
 namespace AudioGrapher
 {
 
+/* Conversion kernels for full width integer formats, the same arithmetic
+ * as gdither's common cases: out = clamp (round (in * scale + bias - dither)) << shift
+ */
+struct ConvertParams {
+	float scale;
+	float bias;
+	float lower;
+	float upper;
+};
+
+static const ConvertParams u8_params  = {      128.f,  128.f,        0.f,      255.f };
+static const ConvertParams s16_params = {    32768.f,    0.f,   -32768.f,    32767.f };
+static const ConvertParams s24_params = {  8388608.f,    0.f, -8388608.f,  8388607.f };
+
+static inline int32_t
+convert_sample (float x, float d, ConvertParams const & p)
+{
+	float const tmp = std::max (p.lower, std::min (p.upper, x * p.scale + p.bias - d));
+	return (int32_t) lrintf (tmp);
+}
+
+static inline void store (uint8_t * dst, int32_t v) { *dst = (uint8_t) v; }
+static inline void store (int16_t * dst, int32_t v) { *dst = (int16_t) v; }
+static inline void store (int32_t * dst, int32_t v) { *dst = v * 256; }
+
+#if defined __SSE2__
+
+typedef __m128  v4f;
+typedef __m128i v4i;
+
+static inline v4f v_load (float const * p) { return _mm_loadu_ps (p); }
+static inline v4f v_set (float f) { return _mm_set1_ps (f); }
+
+static inline v4i
+v_convert (v4f x, v4f d, v4f scale, v4f bias, v4f lower, v4f upper)
+{
+	v4f tmp = _mm_sub_ps (_mm_add_ps (_mm_mul_ps (x, scale), bias), d);
+	tmp = _mm_max_ps (_mm_min_ps (tmp, upper), lower);
+	return _mm_cvtps_epi32 (tmp); // round to nearest, like lrintf()
+}
+
+static inline void
+v_store (uint8_t * dst, v4i a, v4i b)
+{
+	v4i const s16 = _mm_packs_epi32 (a, b);
+	_mm_storel_epi64 ((v4i*) dst, _mm_packus_epi16 (s16, s16));
+}
+
+static inline void
+v_store (int16_t * dst, v4i a, v4i b)
+{
+	_mm_storeu_si128 ((v4i*) dst, _mm_packs_epi32 (a, b));
+}
+
+static inline void
+v_store (int32_t * dst, v4i a, v4i b)
+{
+	_mm_storeu_si128 ((v4i*) dst, _mm_slli_epi32 (a, 8));
+	_mm_storeu_si128 ((v4i*) (dst + 4), _mm_slli_epi32 (b, 8));
+}
+
+# define AG_VECTOR_CONVERT
+
+#elif defined __aarch64__
+
+typedef float32x4_t v4f;
+typedef int32x4_t   v4i;
+
+static inline v4f v_load (float const * p) { return vld1q_f32 (p); }
+static inline v4f v_set (float f) { return vdupq_n_f32 (f); }
+
+static inline v4i
+v_convert (v4f x, v4f d, v4f scale, v4f bias, v4f lower, v4f upper)
+{
+	v4f tmp = vsubq_f32 (vaddq_f32 (vmulq_f32 (x, scale), bias), d);
+	tmp = vmaxq_f32 (vminq_f32 (tmp, upper), lower);
+	return vcvtnq_s32_f32 (tmp); // round to nearest, like lrintf()
+}
+
+static inline void
+v_store (uint8_t * dst, v4i a, v4i b)
+{
+	vst1_u8 (dst, vqmovun_s16 (vcombine_s16 (vqmovn_s32 (a), vqmovn_s32 (b))));
+}
+
+static inline void
+v_store (int16_t * dst, v4i a, v4i b)
+{
+	vst1q_s16 (dst, vcombine_s16 (vqmovn_s32 (a), vqmovn_s32 (b)));
+}
+
+static inline void
+v_store (int32_t * dst, v4i a, v4i b)
+{
+	vst1q_s32 (dst, vshlq_n_s32 (a, 8));
+	vst1q_s32 (dst + 4, vshlq_n_s32 (b, 8));
+}
+
+# define AG_VECTOR_CONVERT
+
+#endif
+
+/** Convert \a n interleaved samples, \a d is the dither value of each sample, or null */
+template <typename TOut>
+static void
+convert_block (TOut * dst, float const * src, float const * d, samplecnt_t n, ConvertParams const & p)
+{
+	samplecnt_t i = 0;
+
+#ifdef AG_VECTOR_CONVERT
+	v4f const scale = v_set (p.scale);
+	v4f const bias  = v_set (p.bias);
+	v4f const lower = v_set (p.lower);
+	v4f const upper = v_set (p.upper);
+	v4f const zero  = v_set (0.f);
+
+	for (; i + 8 <= n; i += 8) {
+		v4i const a = v_convert (v_load (src + i),     d ? v_load (d + i)     : zero, scale, bias, lower, upper);
+		v4i const b = v_convert (v_load (src + i + 4), d ? v_load (d + i + 4) : zero, scale, bias, lower, upper);
+		v_store (dst + i, a, b);
+	}
+#endif
+
+	for (; i < n; ++i) {
+		store (dst + i, convert_sample (src[i], d ? d[i] : 0.f, p));
+	}
+}
+
 template <typename TOut>
 SampleFormatConverter<TOut>::SampleFormatConverter (ChannelCount channels) :
   channels (channels),
   dither (0),
   data_out_size (0),
   data_out (0),
-  clip_floats (false)
+  clip_floats (false),
+  fast_convert (false),
+  dither_type (D_None),
+  noise_buf (0),
+  dither_buf (0),
+  tri_state (0)
 {
 }
 
@@ -65,6 +209,8 @@ SampleFormatConverter<int32_t>::init (samplecnt_t max_samples, int type, int dat
 
 	init_common (max_samples);
 	dither = gdither_new ((GDitherType) type, channels, GDither32bit, data_width);
+	fast_convert = data_width == 24 && type != D_Shaped;
+	dither_type = type;
 }
 
 template <>
@@ -78,6 +224,8 @@ SampleFormatConverter<int16_t>::init (samplecnt_t max_samples, int type, int dat
 	}
 	init_common (max_samples);
 	dither = gdither_new ((GDitherType) type, channels, GDither16bit, data_width);
+	fast_convert = data_width == 16 && type != D_Shaped;
+	dither_type = type;
 }
 
 template <>
@@ -91,6 +239,8 @@ SampleFormatConverter<uint8_t>::init (samplecnt_t max_samples, int type, int dat
 	}
 	init_common (max_samples);
 	dither = gdither_new ((GDitherType) type, channels, GDither8bit, data_width);
+	fast_convert = data_width == 8 && type != D_Shaped;
+	dither_type = type;
 }
 
 template <typename TOut>
@@ -101,10 +251,17 @@ SampleFormatConverter<TOut>::init_common (samplecnt_t max_samples)
 	if (max_samples  > data_out_size) {
 
 		delete[] data_out;
+		delete[] noise_buf;
+		delete[] dither_buf;
 
 		data_out = new TOut[max_samples];
+		noise_buf = new float[max_samples];
+		dither_buf = new float[max_samples];
 		data_out_size = max_samples;
 	}
+
+	tri_state = new float[channels];
+	std::fill_n (tri_state, channels, 0.f);
 }
 
 template <typename TOut>
@@ -123,10 +280,18 @@ SampleFormatConverter<TOut>::reset()
 	}
 
 	delete[] data_out;
+	delete[] noise_buf;
+	delete[] dither_buf;
+	delete[] tri_state;
 	data_out_size = 0;
 	data_out = 0;
+	noise_buf = 0;
+	dither_buf = 0;
+	tri_state = 0;
 
 	clip_floats = false;
+	fast_convert = false;
+	dither_type = D_None;
 }
 
 /* Basic const version of process() */
@@ -140,8 +305,12 @@ SampleFormatConverter<TOut>::process (ProcessContext<float> const & c_in)
 
 	/* Do conversion */
 
-	for (uint32_t chn = 0; chn < c_in.channels(); ++chn) {
-		gdither_runf (dither, chn, c_in.samples_per_channel (), data, data_out);
+	if (fast_convert) {
+		convert (data, c_in.samples ());
+	} else {
+		for (uint32_t chn = 0; chn < c_in.channels(); ++chn) {
+			gdither_runf (dither, chn, c_in.samples_per_channel (), data, data_out);
+		}
 	}
 
 	/* Write forward */
@@ -167,12 +336,9 @@ SampleFormatConverter<float>::process (ProcessContext<float> & c_in)
 	float * data = c_in.data();
 
 	if (clip_floats) {
+		/* branch-free, so that it is vectorized */
 		for (samplecnt_t x = 0; x < samples; ++x) {
-			if (data[x] > 1.0f) {
-				data[x] = 1.0f;
-			} else if (data[x] < -1.0f) {
-				data[x] = -1.0f;
-			}
+			data[x] = std::max (-1.0f, std::min (1.0f, data[x]));
 		}
 	}
 
@@ -192,6 +358,56 @@ SampleFormatConverter<float>::process (ProcessContext<float> const & c_in)
 	process (c);
 }
 
+/** @return the value to subtract from each scaled sample, or null without dither */
+template <typename TOut>
+float const *
+SampleFormatConverter<TOut>::dither_values (samplecnt_t samples)
+{
+	switch (dither_type) {
+	case D_Rect:
+		noise.generate (dither_buf, samples);
+		return dither_buf;
+
+	case D_Tri:
+		/* difference of this and the previous noise value of the same channel,
+		 * gdither subtracts 0.5 from both, which cancels out.
+		 */
+		if (samples < (samplecnt_t) channels) {
+			return 0;
+		}
+		noise.generate (noise_buf, samples);
+		for (ChannelCount c = 0; c < channels; ++c) {
+			dither_buf[c] = noise_buf[c] - 0.5f - tri_state[c];
+		}
+		for (samplecnt_t i = channels; i < samples; ++i) {
+			dither_buf[i] = noise_buf[i] - noise_buf[i - channels];
+		}
+		for (ChannelCount c = 0; c < channels; ++c) {
+			tri_state[c] = noise_buf[samples - channels + c] - 0.5f;
+		}
+		return dither_buf;
+
+	default:
+		return 0;
+	}
+}
+
+template <typename TOut>
+void
+SampleFormatConverter<TOut>::convert (float const * data, samplecnt_t samples)
+{
+	ConvertParams const & p = sizeof (TOut) == 1 ? u8_params : (sizeof (TOut) == 2 ? s16_params : s24_params);
+	convert_block (data_out, data, dither_values (samples), samples, p);
+}
+
+template <>
+void
+SampleFormatConverter<float>::convert (float const *, samplecnt_t)
+{
+	/* floats are never dithered */
+	assert (0);
+}
+
 template<typename TOut>
 void
 SampleFormatConverter<TOut>::check_sample_and_channel_count (samplecnt_t samples, ChannelCount channels_)
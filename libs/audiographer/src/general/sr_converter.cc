@@ -40,7 +40,8 @@ SampleRateConverter::SampleRateConverter (uint32_t channels)
   , max_leftover_samples (0)
   , data_out (0)
   , data_out_size (0)
-  , src_state (0)
+  , src (0)
+  , thread_pool (0)
 {
 	add_supported_flag (ProcessContext<>::EndOfInput);
 }
@@ -56,12 +57,13 @@ SampleRateConverter::init (samplecnt_t in_rate, samplecnt_t out_rate, int qualit
 	}
 
 	active = true;
-	int err;
-	src_state = src_new (quality, channels, &err);
-	if (throw_level (ThrowObject) && !src_state) {
+	src = new ParallelSRC (channels);
+	src->set_thread_pool (thread_pool);
+	int err = src->setup (in_rate, out_rate, quality);
+	if (throw_level (ThrowObject) && err) {
 		throw Exception (*this, str (format
 			("Cannot initialize sample rate converter: %1%")
-			% src_strerror (err)));
+			% ParallelSRC::strerror (err)));
 	}
 
 	src_data.src_ratio = (double) out_rate / (double) in_rate;
@@ -72,6 +74,15 @@ SampleRateConverter::~SampleRateConverter ()
 	reset();
 }
 
+void
+SampleRateConverter::set_thread_pool (ThreaderPool& pool)
+{
+	thread_pool = &pool;
+	if (src) {
+		src->set_thread_pool (thread_pool);
+	}
+}
+
 samplecnt_t
 SampleRateConverter::allocate_buffers (samplecnt_t max_samples)
 {
@@ -94,6 +105,9 @@ SampleRateConverter::allocate_buffers (samplecnt_t max_samples)
 
 		max_samples_in = max_samples;
 		data_out_size = max_samples_out;
+
+		/* room for leftover and new input */
+		src->allocate (2 * max_samples / channels);
 	}
 
 	return max_samples_out;
@@ -161,11 +175,11 @@ SampleRateConverter::process (ProcessContext<float> const & c)
 				", output_frames: " << src_data.output_frames << std::endl;
 		}
 
-		err = src_process (src_state, &src_data);
+		err = src->process (src_data);
 		if (throw_level (ThrowProcess) && err) {
 			throw Exception (*this, str (format
 			("An error occurred during sample rate conversion: %1%")
-			% src_strerror (err)));
+			% ParallelSRC::strerror (err)));
 		}
 
 		leftover_samples = src_data.input_frames - src_data.input_frames_used;
@@ -227,14 +241,14 @@ void SampleRateConverter::reset ()
 	max_samples_in = 0;
 	src_data.end_of_input = false;
 
-	if (src_state) {
-		src_delete (src_state);
-	}
+	delete src;
+	src = 0;
 
 	leftover_samples = 0;
 	max_leftover_samples = 0;
 	if (leftover_data) {
 		free (leftover_data);
+		leftover_data = 0;
 	}
 
 	data_out_size = 0;
@@ -0,0 +1,156 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef __linux__
+# ifndef _GNU_SOURCE
+#  define _GNU_SOURCE
+# endif
+# include <sched.h>
+#endif
+
+#include <algorithm>
+
+#include <boost/smart_ptr/detail/yield_k.hpp>
+
+#include "pbd/cpus.h"
+#include "pbd/pthread_utils.h"
+
+#include "audiographer/general/threader_pool.h"
+
+namespace AudioGrapher
+{
+
+/* after running a job, workers poll the queue for a little while before
+ * going back to sleep: the next chunk usually follows immediately.
+ */
+static const unsigned int spin_before_sleep = 32;
+
+ThreaderPool::ThreaderPool (unsigned int n_workers, bool pin_threads)
+	: _queue (std::max (2U, 4 * n_workers))
+	, _queue_size (std::max (2U, 4 * n_workers))
+	, _queued (0)
+	, _sem ("audiographer-threader", 0)
+	, _quit (false)
+{
+	uint32_t const n_cpus = std::max<uint32_t> (1, hardware_concurrency ());
+
+	for (unsigned int i = 0; i < n_workers; ++i) {
+		pthread_t thread;
+		if (pbd_pthread_create (0x20000 /* 128kB */, &thread, _thread_work, this)) {
+			break;
+		}
+		_threads.push_back (thread);
+
+#if defined __linux__ && !defined PLATFORM_WINDOWS
+		if (pin_threads && n_cpus > 1) {
+			cpu_set_t cpuset;
+			CPU_ZERO (&cpuset);
+			CPU_SET (i % n_cpus, &cpuset);
+			pthread_setaffinity_np (thread, sizeof (cpu_set_t), &cpuset);
+		}
+#else
+		(void) pin_threads;
+		(void) n_cpus;
+#endif
+	}
+}
+
+ThreaderPool::~ThreaderPool ()
+{
+	_quit.store (true);
+	for (size_t i = 0; i < _threads.size (); ++i) {
+		_sem.signal ();
+	}
+	for (std::vector<pthread_t>::const_iterator i = _threads.begin (); i != _threads.end (); ++i) {
+		pthread_join (*i, NULL);
+	}
+}
+
+unsigned int
+ThreaderPool::schedule (Job& job, unsigned int n)
+{
+	n = std::min<unsigned int> (n, _threads.size ());
+
+	for (unsigned int i = 0; i < n; ++i) {
+		if (_queued.fetch_add (1, std::memory_order_relaxed) >= _queue_size) {
+			/* queue is full, all workers are busy anyway */
+			_queued.fetch_sub (1, std::memory_order_relaxed);
+			return i;
+		}
+		job._refs.fetch_add (1, std::memory_order_relaxed);
+		_queue.push_back (&job);
+		_sem.signal ();
+	}
+	return n;
+}
+
+bool
+ThreaderPool::run_one ()
+{
+	Job* job;
+	if (!_queue.pop_front (job)) {
+		return false;
+	}
+	_queued.fetch_sub (1, std::memory_order_relaxed);
+	job->run_job ();
+	job->_refs.fetch_sub (1, std::memory_order_release);
+	return true;
+}
+
+void
+ThreaderPool::wait (Job const& job)
+{
+	for (unsigned int i = 0; job.busy (); ) {
+		if (run_one ()) {
+			i = 0;
+		} else {
+			boost::detail::yield (i++);
+		}
+	}
+}
+
+void*
+ThreaderPool::_thread_work (void* arg)
+{
+	pthread_set_name ("ExportWorker");
+	static_cast<ThreaderPool*> (arg)->thread_work ();
+	return 0;
+}
+
+void
+ThreaderPool::thread_work ()
+{
+	while (true) {
+		_sem.wait ();
+
+		if (_quit.load ()) {
+			break;
+		}
+
+		/* a job picked up while spinning leaves its semaphore count
+		 * behind, the next wait() then just finds the queue empty.
+		 */
+		for (unsigned int i = 0; i < spin_before_sleep; ) {
+			if (run_one ()) {
+				i = 0;
+			} else {
+				boost::detail::yield (i++);
+			}
+		}
+	}
+}
+
+} // namespace
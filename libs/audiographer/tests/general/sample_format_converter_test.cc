@@ -1,5 +1,7 @@
 #include "tests/utils.h"
 
+#include <cmath>
+
 #include "audiographer/general/sample_format_converter.h"
 
 using namespace AudioGrapher;
@@ -15,6 +17,8 @@ class SampleFormatConverterTest : public CppUnit::TestFixture
   CPPUNIT_TEST (testInt16);
   CPPUNIT_TEST (testUint8);
   CPPUNIT_TEST (testChannelCount);
+  CPPUNIT_TEST (testInt16Values);
+  CPPUNIT_TEST (testDitherRange);
   CPPUNIT_TEST_SUITE_END ();
 
   public:
@@ -204,6 +208,54 @@ class SampleFormatConverterTest : public CppUnit::TestFixture
 		CPPUNIT_ASSERT (TestUtils::array_filled(sink->get_array(), pc.samples()));
 	}
 
+	void testInt16Values()
+	{
+		boost::shared_ptr<SampleFormatConverter<int16_t> > converter (new SampleFormatConverter<int16_t>(2));
+		boost::shared_ptr<VectorSink<int16_t> > sink (new VectorSink<int16_t>());
+
+		converter->init (samples, D_None, 16);
+		converter->add_output (sink);
+
+		/* more than one vector, and a remainder */
+		float data[22] = {
+			0.f, 1.f, -1.f, 1.5f, -1.5f, 0.5f, -0.5f,
+			0.5f / 32768.f, 1.5f / 32768.f, -0.5f / 32768.f, -1.5f / 32768.f,
+			0.f, 1.f, -1.f, 1.5f, -1.5f, 0.5f, -0.5f,
+			0.5f / 32768.f, 1.5f / 32768.f, -0.5f / 32768.f, -1.5f / 32768.f
+		};
+		int16_t expected[11] = { 0, 32767, -32768, 32767, -32768, 16384, -16384, 0, 2, 0, -2 };
+
+		converter->process (ProcessContext<float> (data, 22, 2));
+		CPPUNIT_ASSERT_EQUAL ((size_t) 22, sink->get_data().size());
+		for (int i = 0; i < 22; ++i) {
+			CPPUNIT_ASSERT_EQUAL (expected[i % 11], sink->get_data()[i]);
+		}
+	}
+
+	void testDitherRange()
+	{
+		/* dither must not add more than 2 LSB, for all channels */
+		boost::shared_ptr<SampleFormatConverter<int16_t> > converter (new SampleFormatConverter<int16_t>(3));
+		boost::shared_ptr<VectorSink<int16_t> > sink (new VectorSink<int16_t>());
+
+		samplecnt_t const n = samples - (samples % 3);
+		for (samplecnt_t i = 0; i < n; ++i) {
+			random_data[i] = 0.5f * random_data[i];
+		}
+
+		for (int type = D_Rect; type <= D_Tri; ++type) {
+			converter->init (n, type, 16);
+			converter->add_output (sink);
+			for (int cycle = 0; cycle < 4; ++cycle) {
+				converter->process (ProcessContext<float> (random_data, n, 3));
+				for (samplecnt_t i = 0; i < n; ++i) {
+					CPPUNIT_ASSERT (fabsf (sink->get_data()[i] - random_data[i] * 32768.f) <= 3.f);
+				}
+			}
+			converter->clear_outputs ();
+		}
+	}
+
   private:
 
 	float * random_data;
@@ -1,3 +1,5 @@
+#include <cmath>
+
 #include "tests/utils.h"
 
 #include "audiographer/general/sr_converter.h"
@@ -11,6 +13,9 @@ class SampleRateConverterTest : public CppUnit::TestFixture
   CPPUNIT_TEST (testUpsampleLength);
   CPPUNIT_TEST (testDownsampleLength);
   CPPUNIT_TEST (testRespectsEndOfInput);
+  CPPUNIT_TEST (testZitaLength);
+  CPPUNIT_TEST (testZitaAlignment);
+  CPPUNIT_TEST (testParallelChannels);
   CPPUNIT_TEST_SUITE_END ();
 
   public:
@@ -116,6 +121,93 @@ class SampleRateConverterTest : public CppUnit::TestFixture
 		}
 	}
 
+	void testZitaLength()
+	{
+		assert (samples % 2 == 0);
+		samplecnt_t const half_samples = samples / 2;
+		samplecnt_t samples_output = 0;
+
+		converter->init (96000, 48000, ParallelSRC::ZitaBest);
+		converter->allocate_buffers (half_samples);
+		converter->add_output (sink);
+
+		ProcessContext<float> c (random_data, half_samples, 1);
+		converter->process (c);
+		ProcessContext<float> c2 (&random_data[half_samples], half_samples, 1);
+		c2.set_flag (ProcessContext<float>::EndOfInput);
+		converter->process (c2);
+
+		samples_output = sink->get_data().size();
+		CPPUNIT_ASSERT_EQUAL (half_samples, samples_output);
+	}
+
+	void testZitaAlignment()
+	{
+		/* 441Hz at 44.1kHz, the output has to be the same sine at 48kHz, without delay */
+		samplecnt_t const n_in = 4410;
+		samplecnt_t const chunk = 441;
+		float* sine = new float[n_in];
+		for (samplecnt_t i = 0; i < n_in; ++i) {
+			sine[i] = .5f * sinf (2.f * M_PI * 441.f * i / 44100.f);
+		}
+
+		converter->init (44100, 48000, ParallelSRC::ZitaGood);
+		converter->allocate_buffers (chunk);
+		converter->add_output (sink);
+
+		for (samplecnt_t i = 0; i < n_in; i += chunk) {
+			ProcessContext<float> c (&sine[i], chunk, 1);
+			if (i + chunk == n_in) {
+				c.set_flag (ProcessContext<float>::EndOfInput);
+			}
+			converter->process (c);
+		}
+
+		CPPUNIT_ASSERT_EQUAL ((samplecnt_t) 4800, (samplecnt_t) sink->get_data().size());
+
+		float const* out = sink->get_array ();
+		for (samplecnt_t i = 100; i < 4700; ++i) {
+			CPPUNIT_ASSERT (fabsf (out[i] - .5f * sinf (2.f * M_PI * 441.f * i / 48000.f)) < 1e-3f);
+		}
+		delete [] sine;
+	}
+
+	void testParallelChannels()
+	{
+		unsigned int const channels = 4;
+		samplecnt_t const chunk = 64 * channels;
+		float* data = TestUtils::init_random_data (8 * chunk);
+
+		ThreaderPool pool (2);
+		boost::shared_ptr<AppendingVectorSink<float> > serial_sink (new AppendingVectorSink<float>());
+		boost::shared_ptr<AppendingVectorSink<float> > parallel_sink (new AppendingVectorSink<float>());
+		SampleRateConverter serial (channels);
+		SampleRateConverter parallel (channels);
+
+		serial.init (48000, 44100, ParallelSRC::ZitaBest);
+		serial.allocate_buffers (chunk);
+		serial.add_output (serial_sink);
+
+		parallel.set_thread_pool (pool);
+		parallel.init (48000, 44100, ParallelSRC::ZitaBest);
+		parallel.allocate_buffers (chunk);
+		parallel.add_output (parallel_sink);
+
+		for (samplecnt_t i = 0; i < 8 * chunk; i += chunk) {
+			ProcessContext<float> c (&data[i], chunk, channels);
+			if (i + chunk == 8 * chunk) {
+				c.set_flag (ProcessContext<float>::EndOfInput);
+			}
+			serial.process (c);
+			parallel.process (c);
+		}
+
+		samplecnt_t const n = serial_sink->get_data().size();
+		CPPUNIT_ASSERT_EQUAL ((samplecnt_t) (8 * 64 * 441 / 480 * channels), n);
+		CPPUNIT_ASSERT_EQUAL (n, (samplecnt_t) parallel_sink->get_data().size());
+		CPPUNIT_ASSERT (TestUtils::array_equals (serial_sink->get_array(), parallel_sink->get_array(), n));
+		delete [] data;
+	}
 
   private:
 	boost::shared_ptr<SampleRateConverter > converter;
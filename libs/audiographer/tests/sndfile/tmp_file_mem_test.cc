@@ -0,0 +1,98 @@
+#include "tests/utils.h"
+#include "audiographer/sndfile/tmp_file_mem.h"
+
+using namespace AudioGrapher;
+
+class TmpFileMemTest : public CppUnit::TestFixture
+{
+  CPPUNIT_TEST_SUITE (TmpFileMemTest);
+  CPPUNIT_TEST (testProcess);
+  CPPUNIT_TEST (testGrow);
+  CPPUNIT_TEST (testLimit);
+  CPPUNIT_TEST_SUITE_END ();
+
+  public:
+	void setUp()
+	{
+		samples = 128;
+		random_data = TestUtils::init_random_data(samples);
+	}
+
+	void tearDown()
+	{
+		delete [] random_data;
+	}
+
+	void testProcess()
+	{
+		uint32_t channels = 2;
+		file.reset (new TmpFileMem<float>(SF_FORMAT_RAW | SF_FORMAT_FLOAT, channels, 44100, samples));
+		AllocatingProcessContext<float> c (random_data, samples, channels);
+		c.set_flag (ProcessContext<float>::EndOfInput);
+		file->process (c);
+
+		CPPUNIT_ASSERT_EQUAL (samples, file->get_samples_written ());
+
+		TypeUtils<float>::zero_fill (c.data (), c.samples());
+
+		file->seek (0, SEEK_SET);
+		file->read (c);
+		CPPUNIT_ASSERT (TestUtils::array_equals (random_data, c.data(), c.samples()));
+	}
+
+	void testGrow()
+	{
+		uint32_t channels = 2;
+		int64_t const used = TmpFileMem<float>::account ().used ();
+
+		/* reserve less than what is written */
+		file.reset (new TmpFileMem<float>(SF_FORMAT_RAW | SF_FORMAT_FLOAT, channels, 44100, samples / 4));
+		ProcessContext<float> c (random_data, samples / 2, channels);
+		file->process (c);
+		ProcessContext<float> c2 (random_data + samples / 2, samples / 2, channels);
+		c2.set_flag (ProcessContext<float>::EndOfInput);
+		file->process (c2);
+
+		CPPUNIT_ASSERT (TmpFileMem<float>::account ().used () >= used + (int64_t) (samples * sizeof (float)));
+
+		AllocatingProcessContext<float> r (samples, channels);
+		file->seek (0, SEEK_SET);
+		CPPUNIT_ASSERT_EQUAL (samples, file->read (r));
+		CPPUNIT_ASSERT (TestUtils::array_equals (random_data, r.data(), r.samples()));
+
+		file.reset ();
+		CPPUNIT_ASSERT_EQUAL (used, TmpFileMem<float>::account ().used ());
+	}
+
+	void testLimit()
+	{
+		uint32_t channels = 2;
+		int64_t const used  = TmpFileMem<float>::account ().used ();
+		int64_t const limit = used + samples * sizeof (float);
+
+		/* the limit is shared by all files */
+		file.reset (TmpFileMem<float>::create (SF_FORMAT_RAW | SF_FORMAT_FLOAT, channels, 44100, samples / 2, limit));
+		CPPUNIT_ASSERT (file);
+		boost::shared_ptr<TmpFileMem<float> > second (TmpFileMem<float>::create (SF_FORMAT_RAW | SF_FORMAT_FLOAT, channels, 44100, samples / 2, limit));
+		CPPUNIT_ASSERT (second);
+		boost::shared_ptr<TmpFileMem<float> > third (TmpFileMem<float>::create (SF_FORMAT_RAW | SF_FORMAT_FLOAT, channels, 44100, 1, limit));
+		CPPUNIT_ASSERT (!third);
+		CPPUNIT_ASSERT_EQUAL (limit, TmpFileMem<float>::account ().used ());
+
+		second.reset ();
+		third.reset (TmpFileMem<float>::create (SF_FORMAT_RAW | SF_FORMAT_FLOAT, channels, 44100, 1, limit));
+		CPPUNIT_ASSERT (third);
+
+		file.reset ();
+		third.reset ();
+		CPPUNIT_ASSERT_EQUAL (used, TmpFileMem<float>::account ().used ());
+	}
+
+  private:
+	boost::shared_ptr<TmpFileMem<float> > file;
+
+	float * random_data;
+	samplecnt_t samples;
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION (TmpFileMemTest);
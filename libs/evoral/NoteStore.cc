@@ -0,0 +1,265 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <algorithm>
+#include <cassert>
+
+#include "temporal/beats.h"
+
+#include "evoral/Event.h"
+#include "evoral/NoteStore.h"
+
+using namespace std;
+
+namespace Evoral {
+
+/* Do not bother compacting small stores, and otherwise only when at least
+ * this fraction (1/N) of all slots are tombstones.
+ */
+static const size_t compaction_min_slots = 1024;
+static const size_t compaction_ratio     = 4;
+
+template<typename Time>
+struct IDLess {
+	bool operator() (std::pair<event_id_t,Time> const & a, event_id_t b) const { return a.first < b; }
+};
+
+template<typename Time>
+NoteStore<Time>::NoteStore ()
+	: _n_dead (0)
+{
+}
+
+template<typename Time>
+void
+NoteStore<Time>::reserve (size_t n)
+{
+	_time.reserve (n);
+	_length.reserve (n);
+	_id.reserve (n);
+	_channel.reserve (n);
+	_note.reserve (n);
+	_velocity.reserve (n);
+	_off_velocity.reserve (n);
+	_dead.reserve (n);
+	_ids.reserve (n);
+}
+
+template<typename Time>
+void
+NoteStore<Time>::clear ()
+{
+	_time.clear ();
+	_length.clear ();
+	_id.clear ();
+	_channel.clear ();
+	_note.clear ();
+	_velocity.clear ();
+	_off_velocity.clear ();
+	_dead.clear ();
+	_ids.clear ();
+	_n_dead = 0;
+}
+
+template<typename Time>
+event_id_t
+NoteStore<Time>::add (Note<Time> const & n)
+{
+	return add (n.channel(), n.time(), n.length(), n.note(), n.velocity(), n.off_velocity(), n.id());
+}
+
+template<typename Time>
+event_id_t
+NoteStore<Time>::add (uint8_t chan, Time time, Time length, uint8_t note, uint8_t velocity, uint8_t off_velocity, event_id_t id)
+{
+	assert (chan < 16);
+
+	if (id < 0) {
+		id = next_event_id ();
+	} else {
+		/* re-adding a note (e.g. undo of a removal) replaces it */
+		remove (id);
+	}
+
+	size_t pos = _time.size ();
+
+	if (!_time.empty() && time < _time.back()) {
+		/* insert after any notes at the same time, so that notes
+		 * keep the order in which they were added.
+		 */
+		pos = upper_bound (_time.begin(), _time.end(), time) - _time.begin();
+	}
+
+	_time.insert (_time.begin() + pos, time);
+	_length.insert (_length.begin() + pos, length);
+	_id.insert (_id.begin() + pos, id);
+	_channel.insert (_channel.begin() + pos, chan);
+	_note.insert (_note.begin() + pos, std::min (note, (uint8_t) 127));
+	_velocity.insert (_velocity.begin() + pos, std::min (velocity, (uint8_t) 127));
+	_off_velocity.insert (_off_velocity.begin() + pos, std::min (off_velocity, (uint8_t) 127));
+	_dead.insert (_dead.begin() + pos, 0);
+
+	index_id (id, time);
+
+	return id;
+}
+
+template<typename Time>
+void
+NoteStore<Time>::index_id (event_id_t id, Time t)
+{
+	if (_ids.empty() || _ids.back().first < id) {
+		/* common case: IDs are handed out in increasing order */
+		_ids.push_back (make_pair (id, t));
+		return;
+	}
+
+	typename IDIndex::iterator i = std::lower_bound (_ids.begin(), _ids.end(), id, IDLess<Time>());
+
+	if (i != _ids.end() && i->first == id) {
+		i->second = t;
+	} else {
+		_ids.insert (i, make_pair (id, t));
+	}
+}
+
+template<typename Time>
+size_t
+NoteStore<Time>::find (event_id_t id) const
+{
+	typename IDIndex::const_iterator i = std::lower_bound (_ids.begin(), _ids.end(), id, IDLess<Time>());
+
+	if (i == _ids.end() || i->first != id) {
+		return npos;
+	}
+
+	for (size_t n = lower_bound (i->second); n < _time.size() && _time[n] == i->second; ++n) {
+		if (_id[n] == id && !_dead[n]) {
+			return n;
+		}
+	}
+
+	return npos;
+}
+
+template<typename Time>
+size_t
+NoteStore<Time>::lower_bound (Time t) const
+{
+	return std::lower_bound (_time.begin(), _time.end(), t) - _time.begin();
+}
+
+template<typename Time>
+bool
+NoteStore<Time>::remove (event_id_t id)
+{
+	size_t const n = find (id);
+
+	if (n == npos) {
+		return false;
+	}
+
+	_dead[n] = 1;
+	++_n_dead;
+
+	maybe_compact ();
+
+	return true;
+}
+
+template<typename Time>
+void
+NoteStore<Time>::maybe_compact ()
+{
+	if (_time.size() < compaction_min_slots) {
+		return;
+	}
+
+	if (_n_dead * compaction_ratio >= _time.size()) {
+		compact ();
+	}
+}
+
+template<typename Time>
+void
+NoteStore<Time>::compact ()
+{
+	size_t out = 0;
+
+	for (size_t n = 0; n < _time.size(); ++n) {
+		if (_dead[n]) {
+			continue;
+		}
+		if (out != n) {
+			_time[out]         = _time[n];
+			_length[out]       = _length[n];
+			_id[out]           = _id[n];
+			_channel[out]      = _channel[n];
+			_note[out]         = _note[n];
+			_velocity[out]     = _velocity[n];
+			_off_velocity[out] = _off_velocity[n];
+			_dead[out]         = 0;
+		}
+		++out;
+	}
+
+	_time.resize (out);
+	_length.resize (out);
+	_id.resize (out);
+	_channel.resize (out);
+	_note.resize (out);
+	_velocity.resize (out);
+	_off_velocity.resize (out);
+	_dead.resize (out);
+	_n_dead = 0;
+
+	/* rebuild the ID index from the surviving notes */
+	_ids.clear ();
+	_ids.reserve (out);
+	for (size_t n = 0; n < out; ++n) {
+		_ids.push_back (make_pair (_id[n], _time[n]));
+	}
+	std::sort (_ids.begin(), _ids.end());
+}
+
+template<typename Time>
+boost::shared_ptr<Note<Time> >
+NoteStore<Time>::make_note (size_t i) const
+{
+	boost::shared_ptr<Note<Time> > n (new Note<Time> (_channel[i], _time[i], _length[i], _note[i], _velocity[i]));
+	n->set_off_velocity (_off_velocity[i]);
+	n->set_id (_id[i]);
+	return n;
+}
+
+template<typename Time>
+size_t
+NoteStore<Time>::memory_used () const
+{
+	return _time.capacity() * sizeof (Time)
+		+ _length.capacity() * sizeof (Time)
+		+ _id.capacity() * sizeof (event_id_t)
+		+ _channel.capacity()
+		+ _note.capacity()
+		+ _velocity.capacity()
+		+ _off_velocity.capacity()
+		+ _dead.capacity()
+		+ _ids.capacity() * sizeof (typename IDIndex::value_type);
+}
+
+template class NoteStore<Temporal::Beats>;
+
+} // namespace Evoral
@@ -0,0 +1,319 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <cstring>
+
+#include <glib.h>
+
+#include "pbd/memory_account.h"
+
+#include "evoral/SMFParser.h"
+#include "evoral/midi_util.h"
+
+using namespace std;
+
+namespace Evoral {
+
+static inline uint32_t
+read_be32 (uint8_t const * p)
+{
+	return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | (uint32_t) p[3];
+}
+
+static inline uint16_t
+read_be16 (uint8_t const * p)
+{
+	return ((uint16_t) p[0] << 8) | (uint16_t) p[1];
+}
+
+/** Read a variable length quantity of at most 32 bits. That takes up to
+ * 5 bytes, as used for event IDs by SMF::append_event_delta().
+ * @return number of bytes consumed, or 0 on error
+ */
+static inline size_t
+read_vlq (uint8_t const * p, uint8_t const * end, uint32_t& val)
+{
+	val = 0;
+	for (size_t n = 0; n < 5 && p + n < end; ++n) {
+		if (val >> 25) {
+			/* does not fit into 32 bits */
+			return 0;
+		}
+		val = (val << 7) | (p[n] & 0x7f);
+		if (!(p[n] & 0x80)) {
+			return n + 1;
+		}
+	}
+	return 0;
+}
+
+static bool
+event_time_less (SMFParser::Event const & a, SMFParser::Event const & b)
+{
+	return a.time < b.time;
+}
+
+SMFParser::SMFParser ()
+	: _format (0)
+	, _num_tracks (0)
+	, _ppqn (0)
+	, _accounted (0)
+{
+}
+
+SMFParser::~SMFParser ()
+{
+	PBD::MemoryAccount::get ("midi").remove (_accounted);
+}
+
+void
+SMFParser::clear ()
+{
+	_data.clear ();
+	_events.clear ();
+	_format = 0;
+	_num_tracks = 0;
+	_ppqn = 0;
+	update_account ();
+}
+
+size_t
+SMFParser::memory_used () const
+{
+	return _data.capacity() + _events.capacity() * sizeof (Event);
+}
+
+void
+SMFParser::update_account ()
+{
+	size_t const bytes = memory_used ();
+	PBD::MemoryAccount::get ("midi").change (_accounted, bytes);
+	_accounted = bytes;
+}
+
+int
+SMFParser::load (std::string const & path)
+{
+	clear ();
+
+	GMappedFile* mf = g_mapped_file_new (path.c_str(), FALSE, NULL);
+
+	if (!mf) {
+		return -1;
+	}
+
+	uint8_t const * const data = (uint8_t const *) g_mapped_file_get_contents (mf);
+	size_t const          size = g_mapped_file_get_length (mf);
+	int                   ret  = -2;
+
+	if (size < 14 || memcmp (data, "MThd", 4) || read_be32 (data + 4) < 6) {
+		goto out;
+	}
+
+	_format     = read_be16 (data + 8);
+	_num_tracks = read_be16 (data + 10);
+	_ppqn       = read_be16 (data + 12);
+
+	if (_ppqn & 0x8000) {
+		/* SMPTE time division is not supported (same as SMF) */
+		goto out;
+	}
+
+	/* Decoded messages are never larger than the file: running status
+	 * adds at most one byte per event, while every event costs at least
+	 * one byte of delta-time in the file. A channel event takes at least
+	 * 2 bytes in the file, which bounds the number of events.
+	 */
+	_data.reserve (size);
+	_events.reserve (size / 4);
+
+	{
+		uint8_t const * p   = data + 8 + read_be32 (data + 4);
+		uint8_t const * end = data + size;
+
+		for (uint16_t t = 0; t < _num_tracks && p + 8 <= end; ) {
+
+			uint32_t const len = read_be32 (p + 4);
+
+			if (p + 8 + len > end) {
+				cerr << "WARNING: SMF track extends past end of file " << path << endl;
+				break;
+			}
+
+			if (!memcmp (p, "MTrk", 4)) {
+				/* tracks are decoded one after another and then
+				 * merged with a stable sort, so events at the
+				 * same time keep track order.
+				 */
+				if (parse_track (p + 8, len)) {
+					cerr << "WARNING: SMF track " << t << " cannot be decoded in " << path << endl;
+					clear ();
+					goto out;
+				}
+				++t;
+			}
+
+			p += 8 + len;
+		}
+	}
+
+	stable_sort (_events.begin(), _events.end(), event_time_less);
+	ret = 0;
+
+  out:
+	g_mapped_file_unref (mf);
+	update_account ();
+	return ret;
+}
+
+int
+SMFParser::parse_track (uint8_t const * p, size_t len)
+{
+	uint8_t const * const end = p + len;
+
+	uint64_t   time = 0;
+	uint8_t    running_status = 0;
+	event_id_t note_id = -1;
+	uint32_t   val;
+	size_t     n;
+
+	while (p < end) {
+
+		if ((n = read_vlq (p, end, val)) == 0) {
+			return -1;
+		}
+
+		p    += n;
+		time += val;
+
+		if (p >= end) {
+			return -1;
+		}
+
+		uint8_t const status = *p;
+
+		if (status == 0xff) {
+			/* meta-event: type, length, data */
+			if (p + 2 >= end || (n = read_vlq (p + 2, end, val)) == 0 || p + 2 + n + val > end) {
+				return -1;
+			}
+
+			uint8_t const * md = p + 2 + n;
+
+			if (p[1] == 0x2f) {
+				/* end of track */
+				return 0;
+			}
+
+			if (p[1] == 0x7f && val >= 3 && md[0] == 0x99 && md[1] == 0x01) {
+				/* Evoral note ID, see SMF::append_event_delta() */
+				uint32_t id;
+				if (read_vlq (md + 2, md + val, id)) {
+					note_id = id;
+				}
+			}
+
+			p = md + val;
+			continue;
+		}
+
+		if (status == 0xf0 || status == 0xf7) {
+			/* sysex (0xf0) or escaped event (0xf7): length, data */
+			if ((n = read_vlq (p + 1, end, val)) == 0 || p + 1 + n + val > end) {
+				return -1;
+			}
+
+			uint8_t const * sd = p + 1 + n;
+
+			Event ev;
+			ev.time   = time;
+			ev.offset = _data.size();
+			ev.id     = note_id;
+
+			if (status == 0xf0) {
+				_data.push_back (0xf0);
+				ev.size = val + 1;
+			} else {
+				ev.size = val;
+			}
+
+			_data.insert (_data.end(), sd, sd + val);
+
+			if (ev.size > 1 && _data.back() == 0xf7 && midi_event_is_valid (&_data[ev.offset], ev.size)) {
+				_events.push_back (ev);
+			} else {
+				_data.resize (ev.offset);
+			}
+
+			note_id = -1;
+			running_status = 0;
+			p = sd + val;
+			continue;
+		}
+
+		uint8_t msg[3];
+
+		if (status & 0x80) {
+			running_status = status;
+			++p;
+		} else if (!running_status) {
+			cerr << "WARNING: SMF data byte without running status" << endl;
+			return -1;
+		}
+
+		msg[0] = running_status;
+
+		int const size = midi_event_size (running_status);
+
+		if (size < 1 || size > 3 || p + size - 1 > end) {
+			return -1;
+		}
+
+		for (int i = 1; i < size; ++i) {
+			msg[i] = *p++;
+		}
+
+		if ((msg[0] & 0xf0) == 0x90 && msg[2] == 0) {
+			/* normalize note on with velocity 0 to proper note off */
+			msg[0] = 0x80 | (msg[0] & 0x0f);
+			msg[2] = 0x40;
+		}
+
+		if (!midi_event_is_valid (msg, size)) {
+			cerr << "WARNING: SMF ignoring illegal MIDI event" << endl;
+			note_id = -1;
+			continue;
+		}
+
+		Event ev;
+		ev.time   = time;
+		ev.offset = _data.size();
+		ev.size   = size;
+		ev.id     = note_id;
+
+		_data.insert (_data.end(), msg, msg + size);
+		_events.push_back (ev);
+
+		/* event IDs must immediately precede the event they are for */
+		note_id = -1;
+	}
+
+	return 0;
+}
+
+} // namespace Evoral
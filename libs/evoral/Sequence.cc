@@ -41,6 +41,7 @@
 #include "evoral/ControlList.h"
 #include "evoral/ControlSet.h"
 #include "evoral/EventSink.h"
+#include "evoral/NoteStore.h"
 #include "evoral/ParameterDescriptor.h"
 #include "evoral/Sequence.h"
 #include "evoral/TypeMap.h"
@@ -479,6 +480,7 @@ Sequence<Time>::Sequence(const TypeMap& type_map)
 	, _overlap_pitch_resolution (FirstOnFirstOff)
 	, _writing(false)
 	, _type_map(type_map)
+	, _sysex_bytes(0)
 	, _end_iter(*this, std::numeric_limits<Time>::max(), false, std::set<Evoral::Parameter> ())
 	, _percussive(false)
 	, _lowest_note(127)
@@ -501,6 +503,7 @@ Sequence<Time>::Sequence(const Sequence<Time>& other)
 	, _overlap_pitch_resolution (other._overlap_pitch_resolution)
 	, _writing(false)
 	, _type_map(other._type_map)
+	, _sysex_bytes(0)
 	, _end_iter(*this, std::numeric_limits<Time>::max(), false, std::set<Evoral::Parameter> ())
 	, _percussive(other._percussive)
 	, _lowest_note(other._lowest_note)
@@ -514,6 +517,7 @@ Sequence<Time>::Sequence(const Sequence<Time>& other)
 	for (typename SysExes::const_iterator i = other._sysexes.begin(); i != other._sysexes.end(); ++i) {
 		boost::shared_ptr<Event<Time> > n (new Event<Time> (**i, true));
 		_sysexes.insert (n);
+		_sysex_bytes += n->size ();
 	}
 
 	for (typename PatchChanges::const_iterator i = other._patch_changes.begin(); i != other._patch_changes.end(); ++i) {
@@ -630,23 +634,39 @@ Sequence<Time>::clear()
 		li->second->list()->clear();
 }
 
+template<typename Time>
+struct Sequence<Time>::LoadState {
+	NoteStore<Time> notes;
+	/** IDs of notes without a note off yet, per channel and pitch, earliest first */
+	std::vector<event_id_t> pending[16][128];
+};
+
 /** Begin a write of events to the model.
  *
  * If \a mode is Sustained, complete notes with length are constructed as note
  * on/off events are received.  Otherwise (Percussive), only note on events are
  * stored; note off events are discarded entirely and all contained notes will
  * have length 0.
+ *
+ * If \a load is true, the events are a complete set (e.g. read from a file).
+ * Notes are then collected in a flat NoteStore, which makes pairing note on
+ * and off events cheap, and only added to the model by end_write().
  */
 template<typename Time>
 void
-Sequence<Time>::start_write()
+Sequence<Time>::start_write (bool load)
 {
-	DEBUG_TRACE (DEBUG::Sequence, string_compose ("%1 : start_write (percussive = %2)\n", this, _percussive));
+	DEBUG_TRACE (DEBUG::Sequence, string_compose ("%1 : start_write (percussive = %2 load = %3)\n", this, _percussive, load));
 	WriteLock lock(write_lock());
 	_writing = true;
 	for (int i = 0; i < 16; ++i) {
 		_write_notes[i].clear();
 	}
+	if (load) {
+		_load.reset (new LoadState);
+	} else {
+		_load.reset ();
+	}
 }
 
 /** Finish a write of events to the model.
@@ -665,6 +685,12 @@ Sequence<Time>::end_write (StuckNoteOption option, Time when)
 		return;
 	}
 
+	if (_load) {
+		/* notes without a note off are handled below */
+		insert_notes_unlocked (_load->notes);
+		_load.reset ();
+	}
+
 	DEBUG_TRACE (DEBUG::Sequence, string_compose ("%1 : end_write (%2 notes) delete stuck option %3 @ %4\n", this, _notes.size(), option, when));
 
 	for (typename Notes::iterator n = _notes.begin(); n != _notes.end() ;) {
@@ -900,6 +926,7 @@ Sequence<Time>::remove_sysex_unlocked (const SysExPtr sysex)
 		++tmp;
 
 		if (*i == sysex) {
+			_sysex_bytes -= (*i)->size ();
 			_sysexes.erase (i);
 		}
 
@@ -1007,6 +1034,12 @@ Sequence<Time>::append_note_on_unlocked (const Event<Time>& ev, event_id_t evid)
 	/* nascent (incoming notes without a note-off ...yet) have a duration
 	   that extends to Beats::max()
 	*/
+	if (_load) {
+		event_id_t const id = _load->notes.add (ev.channel(), ev.time(), std::numeric_limits<Temporal::Beats>::max() - ev.time(), ev.note(), ev.velocity(), 0x40, evid);
+		_load->pending[ev.channel()][ev.note()].push_back (id);
+		return;
+	}
+
 	NotePtr note(new Note<Time>(ev.channel(), ev.time(), std::numeric_limits<Temporal::Beats>::max() - ev.time(), ev.note(), ev.velocity()));
 	assert (note->end_time() == std::numeric_limits<Temporal::Beats>::max());
 	note->set_id (evid);
@@ -1048,6 +1081,23 @@ Sequence<Time>::append_note_off_unlocked (const Event<Time>& ev)
 
 	/* XXX use _overlap_pitch_resolution to determine FIFO/LIFO ... */
 
+	if (_load) {
+		/* nothing in _write_notes while loading */
+		std::vector<event_id_t>& pending (_load->pending[ev.channel()][ev.note()]);
+
+		while (!resolved && !pending.empty()) {
+			size_t const i = _load->notes.find (pending.front());
+			pending.erase (pending.begin());
+
+			if (i != NoteStore<Time>::npos) {
+				assert(ev.time() >= _load->notes.time (i));
+				_load->notes.set_length (i, ev.time() - _load->notes.time (i));
+				_load->notes.set_off_velocity (i, ev.velocity());
+				resolved = true;
+			}
+		}
+	}
+
 	for (typename WriteNotes::iterator n = _write_notes[ev.channel()].begin(); n != _write_notes[ev.channel()].end(); ) {
 
 		typename WriteNotes::iterator tmp = n;
@@ -1100,6 +1150,7 @@ Sequence<Time>::append_sysex_unlocked(const Event<Time>& ev, event_id_t /* evid
 	boost::shared_ptr< Event<Time> > event(new Event<Time>(ev, true));
 	/* XXX sysex events should use IDs */
 	_sysexes.insert(event);
+	_sysex_bytes += event->size();
 }
 
 template<typename Time>
@@ -1135,6 +1186,7 @@ Sequence<Time>::add_sysex_unlocked (SysExPtr s)
 	}
 
 	_sysexes.insert (s);
+	_sysex_bytes += s->size ();
 }
 
 template<typename Time>
@@ -1209,6 +1261,58 @@ Sequence<Time>::set_notes (const typename Sequence<Time>::Notes& n)
 	_notes = n;
 }
 
+template<typename Time>
+void
+Sequence<Time>::set_notes (const NoteStore<Time>& store)
+{
+	_notes.clear ();
+	for (int c = 0; c < 16; ++c) {
+		_pitches[c].clear ();
+		_write_notes[c].clear ();
+	}
+	_load.reset ();
+
+	_lowest_note = 127;
+	_highest_note = 0;
+
+	insert_notes_unlocked (store);
+}
+
+template<typename Time>
+void
+Sequence<Time>::insert_notes_unlocked (const NoteStore<Time>& store)
+{
+	/* the store is sorted by time, so inserting with a hint at the end
+	 * is (amortized) constant time, unless there were notes already.
+	 */
+	for (typename NoteStore<Time>::const_iterator i = store.begin(); i != store.end(); ++i) {
+		NotePtr note (store.make_note (*i));
+
+		if (note->note() < _lowest_note) {
+			_lowest_note = note->note();
+		}
+		if (note->note() > _highest_note) {
+			_highest_note = note->note();
+		}
+
+		_notes.insert (_notes.end(), note);
+		_pitches[note->channel()].insert (note);
+	}
+
+	_edited = true;
+}
+
+template<typename Time>
+void
+Sequence<Time>::get_notes (NoteStore<Time>& store) const
+{
+	store.reserve (store.size() + _notes.size());
+
+	for (typename Notes::const_iterator i = _notes.begin(); i != _notes.end(); ++i) {
+		store.add (**i);
+	}
+}
+
 // CONST iterator implementations (x3)
 
 /** Return the earliest note with time >= t */
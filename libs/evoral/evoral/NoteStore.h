@@ -0,0 +1,182 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef EVORAL_NOTE_STORE_HPP
+#define EVORAL_NOTE_STORE_HPP
+
+#include <algorithm>
+#include <vector>
+#include <utility>
+#include <stdint.h>
+
+#include <boost/shared_ptr.hpp>
+
+#include "evoral/visibility.h"
+#include "evoral/types.h"
+#include "evoral/Note.h"
+
+namespace Evoral {
+
+/** A flat, columnar container of notes, sorted by time.
+ *
+ * Sequence keeps every note as a separately allocated, reference counted
+ * Note (two Events, each with its own heap buffer) indexed by a time-sorted
+ * multiset plus one multiset per channel. That is convenient for editing but
+ * costs several allocations and well over 100 bytes of pointer chasing per
+ * note, which becomes the dominant cost when loading or iterating over very
+ * large MIDI files.
+ *
+ * NoteStore keeps the same information in parallel vectors (one per note
+ * property), sorted by start time. Removal leaves a tombstone which is
+ * skipped by iteration; tombstones are squeezed out by compact(), which is
+ * run automatically once they make up a significant part of the store.
+ *
+ * Notes are identified by their (stable) event ID, not by their position,
+ * since positions change whenever notes are added, removed or compacted.
+ *
+ * A NoteStore is not thread-safe; users are expected to hold the lock of
+ * the object that owns it (usually a Sequence).
+ */
+template<typename Time>
+class LIBEVORAL_TEMPLATE_API NoteStore {
+public:
+	NoteStore ();
+
+	/** Number of live (not removed) notes */
+	size_t size () const { return _time.size() - _n_dead; }
+	bool   empty () const { return size() == 0; }
+
+	/** Number of slots, including tombstones */
+	size_t slots () const { return _time.size(); }
+
+	void reserve (size_t n);
+	void clear ();
+
+	/** Add a note. If @param id is negative a new ID is assigned.
+	 *
+	 * Adding notes in time order (as when reading a file) only appends to
+	 * the columns, anything else is inserted at its sorted position.
+	 *
+	 * @return the ID of the note.
+	 */
+	event_id_t add (uint8_t chan, Time time, Time length, uint8_t note, uint8_t velocity, uint8_t off_velocity = 0x40, event_id_t id = -1);
+	event_id_t add (Note<Time> const &);
+
+	/** Mark the note with the given ID as removed.
+	 * @return true if a live note was found.
+	 */
+	bool remove (event_id_t id);
+	bool contains (event_id_t id) const { return find (id) != npos; }
+
+	/** Drop all tombstones */
+	void compact ();
+
+	static const size_t npos = ~((size_t) 0);
+
+	/** @return slot index of the live note with the given ID, or npos */
+	size_t find (event_id_t id) const;
+
+	/** @return index of the first slot with time >= @param t */
+	size_t lower_bound (Time t) const;
+
+	/* per-slot accessors. These do not check for tombstones */
+
+	bool       alive (size_t i)        const { return !_dead[i]; }
+	event_id_t id (size_t i)           const { return _id[i]; }
+	Time       time (size_t i)         const { return _time[i]; }
+	Time       length (size_t i)       const { return _length[i]; }
+	Time       end_time (size_t i)     const { return _time[i] + _length[i]; }
+	uint8_t    channel (size_t i)      const { return _channel[i]; }
+	uint8_t    note (size_t i)         const { return _note[i]; }
+	uint8_t    velocity (size_t i)     const { return _velocity[i]; }
+	uint8_t    off_velocity (size_t i) const { return _off_velocity[i]; }
+
+	void set_velocity (size_t i, uint8_t v)     { _velocity[i] = std::min (v, (uint8_t) 127); }
+	void set_off_velocity (size_t i, uint8_t v) { _off_velocity[i] = std::min (v, (uint8_t) 127); }
+	void set_length (size_t i, Time l)          { _length[i] = l; }
+
+	/** Create a (heap allocated) Note from slot @param i */
+	boost::shared_ptr<Note<Time> > make_note (size_t i) const;
+
+	/** Iterator over live notes in time order, yielding slot indices */
+	class const_iterator {
+	public:
+		const_iterator () : _store (0), _index (0) {}
+
+		size_t operator* () const { return _index; }
+
+		const_iterator& operator++ () {
+			++_index;
+			skip_dead ();
+			return *this;
+		}
+
+		bool operator== (const_iterator const & other) const { return _index == other._index; }
+		bool operator!= (const_iterator const & other) const { return _index != other._index; }
+
+	private:
+		friend class NoteStore<Time>;
+
+		const_iterator (NoteStore<Time> const & s, size_t i) : _store (&s), _index (i) {
+			skip_dead ();
+		}
+
+		void skip_dead () {
+			while (_index < _store->slots() && !_store->alive (_index)) {
+				++_index;
+			}
+		}
+
+		NoteStore<Time> const * _store;
+		size_t                  _index;
+	};
+
+	const_iterator begin () const { return const_iterator (*this, 0); }
+	const_iterator end ()   const { return const_iterator (*this, slots()); }
+
+	/** Return an iterator to the first live note with time >= @param t */
+	const_iterator begin_at (Time t) const { return const_iterator (*this, lower_bound (t)); }
+
+	/** Approximate number of bytes of heap memory used by the store */
+	size_t memory_used () const;
+
+private:
+	/* columns, all of identical size, sorted by _time */
+	std::vector<Time>       _time;
+	std::vector<Time>       _length;
+	std::vector<event_id_t> _id;
+	std::vector<uint8_t>    _channel;
+	std::vector<uint8_t>    _note;
+	std::vector<uint8_t>    _velocity;
+	std::vector<uint8_t>    _off_velocity;
+	std::vector<uint8_t>    _dead;
+
+	size_t _n_dead;
+
+	/** (id, time) pairs sorted by ID. The time is used to locate the slot
+	 * with a binary search; entries of removed notes are dropped lazily in
+	 * compact().
+	 */
+	typedef std::vector<std::pair<event_id_t, Time> > IDIndex;
+	IDIndex _ids;
+
+	void   index_id (event_id_t id, Time t);
+	void   maybe_compact ();
+};
+
+} // namespace Evoral
+
+#endif // EVORAL_NOTE_STORE_HPP
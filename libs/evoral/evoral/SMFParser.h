@@ -0,0 +1,97 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef EVORAL_SMF_PARSER_HPP
+#define EVORAL_SMF_PARSER_HPP
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "evoral/visibility.h"
+#include "evoral/types.h"
+
+namespace Evoral {
+
+/** Read-only, single pass Standard MIDI File decoder.
+ *
+ * SMF (via libsmf) allocates one smf_event_t plus one message buffer per
+ * event when a file is opened, and read_event() then copies each event once
+ * more, one at a time, under a mutex.
+ *
+ * SMFParser instead maps the file into memory and decodes all tracks in one
+ * go into a single, pre-sized byte buffer plus an index of events sorted by
+ * (absolute) time. Running status is expanded, note-on with velocity 0 is
+ * normalized to note-off, Evoral note IDs (stored as sequencer-specific
+ * meta-events) are attached to the event they precede, and all other
+ * meta-events are dropped.
+ *
+ * A parser holds no shared state, so many files can be decoded concurrently
+ * by different threads.
+ */
+class LIBEVORAL_API SMFParser {
+public:
+	struct Event {
+		uint64_t   time;   ///< absolute time in SMF ticks
+		uint32_t   offset; ///< start of the message in the data buffer
+		uint32_t   size;   ///< size of the message, including status byte
+		event_id_t id;     ///< Evoral event ID, or -1 if the file has none
+	};
+
+	typedef std::vector<Event> Events;
+
+	SMFParser ();
+	~SMFParser ();
+
+	/** Decode all tracks of the file at @param path
+	 * @return 0 on success, -1 if the file cannot be mapped, -2 if it is not
+	 * a (supported) SMF or a track cannot be decoded.
+	 */
+	int load (std::string const & path);
+
+	void clear ();
+
+	uint16_t format ()     const { return _format; }
+	uint16_t num_tracks () const { return _num_tracks; }
+	uint16_t ppqn ()       const { return _ppqn; }
+
+	Events const &  events () const { return _events; }
+	uint8_t const * buffer (Event const & ev) const { return &_data[ev.offset]; }
+
+	/** Time of the last event, in SMF ticks */
+	uint64_t duration () const { return _events.empty() ? 0 : _events.back().time; }
+
+	/** Number of bytes used by decoded events.
+	 * This is also accounted for in the "midi" PBD::MemoryAccount.
+	 */
+	size_t memory_used () const;
+
+private:
+	uint16_t _format;
+	uint16_t _num_tracks;
+	uint16_t _ppqn;
+
+	std::vector<uint8_t> _data;
+	Events               _events;
+	size_t               _accounted;
+
+	int  parse_track (uint8_t const * p, size_t len);
+	void update_account ();
+};
+
+} // namespace Evoral
+
+#endif // EVORAL_SMF_PARSER_HPP
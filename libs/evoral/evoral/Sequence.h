@@ -44,6 +44,7 @@ class TypeMap;
 template<typename Time> class EventSink;
 template<typename Time> class Note;
 template<typename Time> class Event;
+template<typename Time> class NoteStore;
 
 /** An iterator over (the x axis of) a 2-d double coordinate space.
  */
@@ -100,7 +101,7 @@ public:
 	bool percussive() const     { return _percussive; }
 	void set_percussive(bool p) { _percussive = p; }
 
-	void start_write();
+	void start_write (bool load = false);
 	bool writing() const { return _writing; }
 
 	enum StuckNoteOption {
@@ -190,6 +191,11 @@ public:
 
 	void set_notes (const typename Sequence<Time>::Notes& n);
 
+	/** Replace all notes with those in @param store (IDs are preserved) */
+	void set_notes (const NoteStore<Time>& store);
+	/** Append a flat copy of all notes to @param store */
+	void get_notes (NoteStore<Time>& store) const;
+
 	typedef boost::shared_ptr< Event<Time> > SysExPtr;
 	typedef boost::shared_ptr<const Event<Time> > constSysExPtr;
 
@@ -203,6 +209,9 @@ public:
 	inline       SysExes& sysexes()       { return _sysexes; }
 	inline const SysExes& sysexes() const { return _sysexes; }
 
+	/** @return total size of the data of all sysex events */
+	size_t sysex_bytes() const { return _sysex_bytes; }
+
 	typedef boost::shared_ptr<PatchChange<Time> > PatchChangePtr;
 	typedef boost::shared_ptr<const PatchChange<Time> > constPatchChangePtr;
 
@@ -355,11 +364,18 @@ private:
 	Notes        _notes;       // notes indexed by time
 	Pitches      _pitches[16]; // notes indexed by channel+pitch
 	SysExes      _sysexes;
+	size_t       _sysex_bytes; // sum of the sizes of _sysexes
 	PatchChanges _patch_changes;
 
 	typedef std::multiset<NotePtr, EarlierNoteComparator> WriteNotes;
 	WriteNotes _write_notes[16];
 
+	/** Notes appended while loading, see start_write() */
+	struct LoadState;
+	boost::shared_ptr<LoadState> _load;
+
+	void insert_notes_unlocked (const NoteStore<Time>&);
+
 	/** Current bank number on each channel so that we know what
 	 *  to put in PatchChange events when program changes are
 	 *  seen.
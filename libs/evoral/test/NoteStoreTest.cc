@@ -0,0 +1,100 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "NoteStoreTest.h"
+#include "temporal/beats.h"
+#include "evoral/NoteStore.h"
+
+CPPUNIT_TEST_SUITE_REGISTRATION (NoteStoreTest);
+
+using namespace std;
+using namespace Evoral;
+
+typedef Temporal::Beats Time;
+
+void
+NoteStoreTest::orderTest ()
+{
+	NoteStore<Time> s;
+
+	s.add (0, Time::ticks (30), Time::ticks (10), 60, 100);
+	s.add (0, Time::ticks (10), Time::ticks (10), 61, 100);
+	s.add (1, Time::ticks (20), Time::ticks (10), 62, 100);
+	s.add (0, Time::ticks (10), Time::ticks (10), 63, 100);
+
+	CPPUNIT_ASSERT_EQUAL (size_t (4), s.size ());
+
+	Time last;
+	for (NoteStore<Time>::const_iterator i = s.begin (); i != s.end (); ++i) {
+		CPPUNIT_ASSERT (s.time (*i) >= last);
+		last = s.time (*i);
+	}
+
+	/* notes at the same time keep insertion order */
+	CPPUNIT_ASSERT_EQUAL (uint8_t (61), s.note (0));
+	CPPUNIT_ASSERT_EQUAL (uint8_t (63), s.note (1));
+	CPPUNIT_ASSERT_EQUAL (size_t (2), s.lower_bound (Time::ticks (15)));
+}
+
+void
+NoteStoreTest::removeTest ()
+{
+	NoteStore<Time> s;
+
+	event_id_t a = s.add (0, Time::ticks (10), Time::ticks (10), 60, 100);
+	event_id_t b = s.add (0, Time::ticks (10), Time::ticks (10), 61, 100);
+
+	CPPUNIT_ASSERT (s.remove (a));
+	CPPUNIT_ASSERT (!s.remove (a));
+	CPPUNIT_ASSERT (!s.contains (a));
+	CPPUNIT_ASSERT (s.contains (b));
+	CPPUNIT_ASSERT_EQUAL (size_t (1), s.size ());
+	CPPUNIT_ASSERT_EQUAL (size_t (2), s.slots ());
+	CPPUNIT_ASSERT_EQUAL (size_t (1), *s.begin ());
+
+	/* re-adding with the same ID (undo) brings it back, at a new time */
+	s.add (0, Time::ticks (5), Time::ticks (10), 60, 100, 0x40, a);
+	CPPUNIT_ASSERT_EQUAL (size_t (0), s.find (a));
+	CPPUNIT_ASSERT_EQUAL (size_t (2), s.size ());
+}
+
+void
+NoteStoreTest::compactTest ()
+{
+	NoteStore<Time> s;
+	vector<event_id_t> ids;
+
+	for (int n = 0; n < 4096; ++n) {
+		ids.push_back (s.add (n % 16, Time::ticks (n * 10), Time::ticks (5), n % 128, 100));
+	}
+
+	for (size_t n = 0; n < ids.size (); n += 2) {
+		s.remove (ids[n]);
+	}
+
+	/* automatic compaction must have kicked in */
+	CPPUNIT_ASSERT (s.slots () < ids.size ());
+	CPPUNIT_ASSERT_EQUAL (size_t (2048), s.size ());
+
+	s.compact ();
+	CPPUNIT_ASSERT_EQUAL (s.size (), s.slots ());
+
+	for (size_t n = 1; n < ids.size (); n += 2) {
+		size_t const i = s.find (ids[n]);
+		CPPUNIT_ASSERT (i != NoteStore<Time>::npos);
+		CPPUNIT_ASSERT (s.time (i) == Time::ticks (n * 10));
+	}
+}
@@ -117,3 +117,88 @@ SMFTest::writeTest ()
 
 	// TODO: Check files are actually equivalent
 }
+
+void
+SMFTest::parserTest ()
+{
+	string testdata_path;
+	CPPUNIT_ASSERT (find_file (test_search_path (), "TakeFive.mid", testdata_path));
+
+	SMFParser parser;
+	CPPUNIT_ASSERT_EQUAL (0, parser.load (testdata_path));
+	CPPUNIT_ASSERT_EQUAL ((uint16_t)1, parser.num_tracks());
+	CPPUNIT_ASSERT_EQUAL ((uint16_t)1920, parser.ppqn());
+
+	seq->start_write();
+
+	Evoral::Event<Time> ev;
+	uint64_t last = 0;
+
+	for (SMFParser::Events::const_iterator i = parser.events().begin(); i != parser.events().end(); ++i) {
+		CPPUNIT_ASSERT (i->time >= last);
+		last = i->time;
+		ev.set (parser.buffer (*i), i->size, Temporal::Beats::ticks_at_rate (i->time, parser.ppqn()));
+		ev.set_event_type (Evoral::MIDI_EVENT);
+		seq->append (ev, next_event_id ());
+	}
+
+	seq->end_write (Sequence<Time>::Relax, Temporal::Beats::ticks_at_rate (last, parser.ppqn()));
+
+	/* same result as reading through libsmf, see takeFiveTest() */
+	CPPUNIT_ASSERT_EQUAL (size_t(3833), seq->notes().size());
+	CPPUNIT_ASSERT_EQUAL (size_t(232), seq->sysexes().size());
+
+	CPPUNIT_ASSERT_EQUAL (-1, parser.load ("/nonexistent/file.mid"));
+}
+
+static string
+write_smf (string const & name, uint8_t const * track, size_t len)
+{
+	const string dir  = PBD::tmp_writable_directory (PACKAGE, "parserTrackTest");
+	const string path = Glib::build_filename (dir, name);
+
+	uint8_t const hdr[] = { 'M', 'T', 'h', 'd', 0, 0, 0, 6, 0, 0, 0, 1, 0, 96,
+	                        'M', 'T', 'r', 'k', 0, 0, 0, (uint8_t) len };
+
+	string data ((char const*) hdr, sizeof (hdr));
+	data.append ((char const*) track, len);
+	Glib::file_set_contents (path, data);
+	return path;
+}
+
+void
+SMFTest::parserTrackTest ()
+{
+	SMFParser parser;
+
+	/* an event ID which needs a 5 byte VLQ, as written by SMF::append_event_delta() */
+	uint8_t const ids[] = {
+		0x00, 0xff, 0x7f, 0x07, 0x99, 0x01, 0x81, 0x80, 0x80, 0x80, 0x00,
+		0x00, 0x90, 0x3c, 0x64,
+		0x60, 0x80, 0x3c, 0x40,
+		0x00, 0xff, 0x2f, 0x00
+	};
+
+	CPPUNIT_ASSERT_EQUAL (0, parser.load (write_smf ("ids.mid", ids, sizeof (ids))));
+	CPPUNIT_ASSERT_EQUAL (size_t (2), parser.events().size());
+	CPPUNIT_ASSERT_EQUAL ((event_id_t) 0x10000000, parser.events()[0].id);
+	CPPUNIT_ASSERT_EQUAL ((event_id_t) -1, parser.events()[1].id);
+	CPPUNIT_ASSERT_EQUAL ((uint64_t) 96, parser.events()[1].time);
+
+	/* a data byte without running status fails the whole file */
+	uint8_t const bad[] = {
+		0x00, 0x3c, 0x40,
+		0x00, 0xff, 0x2f, 0x00
+	};
+
+	CPPUNIT_ASSERT_EQUAL (-2, parser.load (write_smf ("bad.mid", bad, sizeof (bad))));
+	CPPUNIT_ASSERT (parser.events().empty());
+
+	/* more than 32 bits */
+	uint8_t const overflow[] = {
+		0xff, 0xff, 0xff, 0xff, 0x7f, 0x90, 0x3c, 0x64,
+		0x00, 0xff, 0x2f, 0x00
+	};
+
+	CPPUNIT_ASSERT_EQUAL (-2, parser.load (write_smf ("overflow.mid", overflow, sizeof (overflow))));
+}
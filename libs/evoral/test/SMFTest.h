@@ -25,6 +25,7 @@
 #include <cppunit/extensions/HelperMacros.h>
 #include "temporal/beats.h"
 #include "evoral/SMF.h"
+#include "evoral/SMFParser.h"
 #include "SequenceTest.h"
 
 using namespace Evoral;
@@ -57,6 +58,8 @@ class SMFTest : public CppUnit::TestFixture
 	CPPUNIT_TEST(createNewFileTest);
 	CPPUNIT_TEST(takeFiveTest);
 	CPPUNIT_TEST(writeTest);
+	CPPUNIT_TEST(parserTest);
+	CPPUNIT_TEST(parserTrackTest);
 	CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -77,6 +80,8 @@ public:
 	void createNewFileTest();
 	void takeFiveTest();
 	void writeTest();
+	void parserTest();
+	void parserTrackTest();
 
 private:
 	DummyTypeMap*     type_map;
@@ -10,6 +10,7 @@ void
 SequenceTest::createTest ()
 {
 	CPPUNIT_ASSERT_EQUAL(size_t(0), seq->sysexes().size());
+	CPPUNIT_ASSERT_EQUAL(size_t(0), seq->sysex_bytes());
 	CPPUNIT_ASSERT_EQUAL(size_t(0), seq->notes().size());
 	CPPUNIT_ASSERT(seq->notes().begin() == seq->notes().end());
 }
@@ -194,3 +195,65 @@ SequenceTest::controlInterpolationTest ()
 		last_value = i->second;
 	}
 }
+
+static void
+append_note_events (Sequence<Temporal::Beats>& seq, bool load)
+{
+	typedef Temporal::Beats Time;
+
+	/* (time, note, velocity), velocity 0 is a note off */
+	static const int events[][3] = {
+		{ 0,   60, 100 },
+		{ 0,   64, 90 },
+		{ 10,  60, 80 },  /* second note on 60, before the first one ended */
+		{ 20,  60, 0 },   /* ends the first one (FIFO) */
+		{ 30,  64, 0 },
+		{ 40,  60, 0 },
+		{ 50,  67, 70 },  /* stuck */
+		{ 60,  48, 0 },   /* spurious */
+	};
+
+	seq.start_write (load);
+
+	for (size_t n = 0; n < sizeof (events) / sizeof (events[0]); ++n) {
+		uint8_t buf[3];
+		buf[0] = events[n][2] ? MIDI_CMD_NOTE_ON : MIDI_CMD_NOTE_OFF;
+		buf[1] = events[n][1];
+		buf[2] = events[n][2] ? events[n][2] : 0x30;
+		Event<Time> ev ((Evoral::EventType)DummyTypeMap::NOTE, Time::ticks (events[n][0]), 3, buf, false);
+		seq.append (ev, 100 + n);
+	}
+
+	seq.end_write (Sequence<Time>::ResolveStuckNotes, Time::ticks (100));
+}
+
+void
+SequenceTest::loadTest ()
+{
+	DummyTypeMap map;
+	MySequence<Time> loaded (map);
+
+	append_note_events (*seq, false);
+	append_note_events (loaded, true);
+
+	CPPUNIT_ASSERT_EQUAL (size_t (4), seq->notes().size());
+	CPPUNIT_ASSERT_EQUAL (seq->notes().size(), loaded.notes().size());
+	CPPUNIT_ASSERT_EQUAL (seq->lowest_note(), loaded.lowest_note());
+	CPPUNIT_ASSERT_EQUAL (seq->highest_note(), loaded.highest_note());
+	CPPUNIT_ASSERT (!loaded.writing());
+
+	MySequence<Time>::Notes::const_iterator a = seq->notes().begin();
+	MySequence<Time>::Notes::const_iterator b = loaded.notes().begin();
+
+	for (; a != seq->notes().end(); ++a, ++b) {
+		CPPUNIT_ASSERT_EQUAL ((*a)->id(), (*b)->id());
+		CPPUNIT_ASSERT ((*a)->time() == (*b)->time());
+		CPPUNIT_ASSERT ((*a)->length() == (*b)->length());
+		CPPUNIT_ASSERT_EQUAL ((*a)->note(), (*b)->note());
+		CPPUNIT_ASSERT_EQUAL ((*a)->velocity(), (*b)->velocity());
+		CPPUNIT_ASSERT_EQUAL ((*a)->off_velocity(), (*b)->off_velocity());
+	}
+
+	/* the stuck note was resolved at the end */
+	CPPUNIT_ASSERT ((*loaded.notes().rbegin())->end_time() == Time::ticks (100));
+}
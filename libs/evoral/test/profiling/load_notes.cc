@@ -0,0 +1,151 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* Compare loading notes into a Sequence note by note with loading them
+ * through a NoteStore (Sequence::start_write (true)), and iterating and
+ * storing notes in a Sequence::Notes multiset with a NoteStore.
+ *
+ * usage: load-notes [number of notes]
+ */
+
+#include <cstdlib>
+#include <iostream>
+
+#include "pbd/timing.h"
+
+#include "temporal/beats.h"
+
+#include "evoral/Control.h"
+#include "evoral/NoteStore.h"
+#include "evoral/Sequence.h"
+#include "evoral/TypeMap.h"
+#include "evoral/midi_events.h"
+
+using namespace std;
+using namespace Evoral;
+
+typedef Temporal::Beats Time;
+
+class NoteTypeMap : public TypeMap {
+public:
+	bool type_is_midi (uint32_t) const { return true; }
+	uint8_t parameter_midi_type (const Parameter&) const { return 0; }
+	ParameterType midi_parameter_type (const uint8_t*, uint32_t) const { return 0; }
+	ParameterDescriptor descriptor (const Parameter&) const { return ParameterDescriptor (); }
+	std::string to_symbol (const Parameter&) const { return "note"; }
+};
+
+/* only notes are appended, there are no controls */
+class NoteSequence : public Sequence<Time> {
+public:
+	NoteSequence (NoteTypeMap& map) : Sequence<Time> (map) {}
+
+	boost::shared_ptr<Control> control_factory (const Parameter&) {
+		return boost::shared_ptr<Control> ();
+	}
+};
+
+/* overlapping notes on all channels, as in a dense orchestral file */
+static int64_t
+load (Sequence<Time>& seq, int n_notes, bool flat)
+{
+	PBD::Timing t;
+	uint8_t buf[3];
+	Event<Time> ev (MIDI_EVENT, Time (), 3, buf, false);
+
+	t.start ();
+	seq.start_write (flat);
+
+	for (int n = 0; n < n_notes + 16; ++n) {
+		if (n >= 16) {
+			int const o = n - 16;
+			buf[0] = MIDI_CMD_NOTE_OFF | (o % 16);
+			buf[1] = o % 128;
+			buf[2] = 0x40;
+			ev.set_time (Time::ticks (n * 10));
+			seq.append (ev, -1);
+		}
+		if (n < n_notes) {
+			buf[0] = MIDI_CMD_NOTE_ON | (n % 16);
+			buf[1] = n % 128;
+			buf[2] = 100;
+			ev.set_time (Time::ticks (n * 10));
+			seq.append (ev, next_event_id ());
+		}
+	}
+
+	seq.end_write (Sequence<Time>::ResolveStuckNotes, Time::ticks ((n_notes + 16) * 10));
+	t.update ();
+
+	return t.elapsed ();
+}
+
+int
+main (int argc, char* argv[])
+{
+	int const n_notes = argc > 1 ? atoi (argv[1]) : 500000;
+
+	NoteTypeMap  map;
+	NoteSequence a (map);
+	NoteSequence b (map);
+
+	int64_t const load_notes = load (a, n_notes, false);
+	int64_t const load_flat  = load (b, n_notes, true);
+
+	if (a.notes ().size () != b.notes ().size ()) {
+		cerr << "note count mismatch: " << a.notes ().size () << " != " << b.notes ().size () << endl;
+		return 1;
+	}
+
+	NoteStore<Time> s;
+	b.get_notes (s);
+
+	PBD::Timing t;
+	uint64_t sum = 0;
+
+	t.start ();
+	for (Sequence<Time>::Notes::const_iterator i = a.notes ().begin (); i != a.notes ().end (); ++i) {
+		sum += (*i)->note ();
+	}
+	t.update ();
+	int64_t const set_iter = t.elapsed ();
+
+	uint64_t store_sum = 0;
+	t.start ();
+	for (NoteStore<Time>::const_iterator i = s.begin (); i != s.end (); ++i) {
+		store_sum += s.note (*i);
+	}
+	t.update ();
+	int64_t const store_iter = t.elapsed ();
+
+	if (sum != store_sum) {
+		cerr << "note mismatch" << endl;
+		return 1;
+	}
+
+	/* a Note holds two Events, each with a separately allocated 3 byte
+	 * buffer; add the shared_ptr control block and one node in each of
+	 * the time and pitch indices.
+	 */
+	size_t const set_bytes = a.notes ().size () * (sizeof (Note<Time>) + 2 * 16 + 32 + 2 * 48);
+
+	cout << n_notes << " notes" << endl
+	     << "  load:    per note " << load_notes << " us, flat " << load_flat << " us" << endl
+	     << "  iterate: multiset " << set_iter << " us, store " << store_iter << " us" << endl
+	     << "  memory:  multiset ~" << set_bytes / 1024 << " kB, store " << s.memory_used () / 1024 << " kB" << endl;
+
+	return 0;
+}
@@ -0,0 +1,198 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <atomic>
+#include <vector>
+
+#include <stdint.h>
+
+#include <glibmm/threads.h>
+
+#include "pbd/epoch.h"
+
+using namespace PBD;
+
+/* Every thread which enters a guard gets a record. Records are never
+ * deleted, when a thread exits its record is released and may be taken
+ * over by another thread.
+ */
+struct Epoch::Record {
+	Record () : active (0), depth (0), in_use (true), next (0) {}
+
+	std::atomic<uint64_t> active; ///< epoch when the outermost guard was entered, 0 if none
+	unsigned int          depth;  ///< only used by the owning thread
+	std::atomic<bool>     in_use;
+	Record*               next;
+};
+
+namespace {
+
+struct Retired {
+	Retired (void* o, void (*d) (void*), uint64_t e) : obj (o), deleter (d), epoch (e) {}
+
+	void*    obj;
+	void   (*deleter) (void*);
+	uint64_t epoch;
+};
+
+/* epochs start at 1, 0 marks an idle record */
+std::atomic<uint64_t>      global_epoch (1);
+std::atomic<Epoch::Record*> records (0);
+std::atomic<size_t>        n_pending (0);
+
+Glib::Threads::Mutex&
+retired_lock ()
+{
+	static Glib::Threads::Mutex lock;
+	return lock;
+}
+
+std::vector<Retired>&
+retired ()
+{
+	static std::vector<Retired> r;
+	return r;
+}
+
+}
+
+static void
+release_record (void* ptr)
+{
+	Epoch::Record* r = static_cast<Epoch::Record*> (ptr);
+	r->active.store (0);
+	r->depth = 0;
+	r->in_use.store (false);
+}
+
+static Glib::Threads::Private<Epoch::Record>&
+thread_record ()
+{
+	static Glib::Threads::Private<Epoch::Record> r (release_record);
+	return r;
+}
+
+static Epoch::Record*
+acquire_record ()
+{
+	Epoch::Record* r;
+
+	for (r = records.load (); r; r = r->next) {
+		bool expected = false;
+		if (!r->in_use.load (std::memory_order_relaxed) && r->in_use.compare_exchange_strong (expected, true)) {
+			return r;
+		}
+	}
+
+	r = new Epoch::Record;
+
+	Epoch::Record* head = records.load ();
+	do {
+		r->next = head;
+	} while (!records.compare_exchange_weak (head, r));
+
+	return r;
+}
+
+Epoch::Guard::Guard ()
+{
+	_record = thread_record ().get ();
+
+	if (!_record) {
+		_record = acquire_record ();
+		thread_record ().set (_record);
+	}
+
+	if (_record->depth++ == 0) {
+		_record->active.store (global_epoch.load ());
+	}
+}
+
+Epoch::Guard::~Guard ()
+{
+	if (--_record->depth == 0) {
+		/* nothing else, leaving must not take the lock or run
+		 * deleters; retired data is reclaimed by the writers.
+		 */
+		_record->active.store (0);
+	}
+}
+
+void
+Epoch::retire (void* obj, void (*deleter) (void*))
+{
+	/* readers that may still see obj entered their guard before it was
+	 * unpublished, so their epoch is at most the one obj is tagged with.
+	 */
+	uint64_t const epoch = global_epoch.fetch_add (1);
+
+	{
+		Glib::Threads::Mutex::Lock lm (retired_lock ());
+		retired ().push_back (Retired (obj, deleter, epoch));
+		n_pending.store (retired ().size ());
+	}
+}
+
+void
+Epoch::reclaim ()
+{
+	if (n_pending.load () == 0) {
+		return;
+	}
+
+	std::vector<Retired> dead;
+
+	{
+		Glib::Threads::Mutex::Lock lm (retired_lock ());
+
+		/* scan the records only after everything in the list was
+		 * retired, a reader that may still use an object is then
+		 * guaranteed to be found.
+		 */
+		uint64_t oldest = UINT64_MAX;
+
+		for (Record* r = records.load (); r; r = r->next) {
+			uint64_t const a = r->active.load ();
+			if (a && a < oldest) {
+				oldest = a;
+			}
+		}
+
+		std::vector<Retired>& rl (retired ());
+
+		for (std::vector<Retired>::iterator i = rl.begin (); i != rl.end (); ) {
+			if (i->epoch < oldest) {
+				dead.push_back (*i);
+				i = rl.erase (i);
+			} else {
+				++i;
+			}
+		}
+
+		n_pending.store (rl.size ());
+	}
+
+	/* deleters may retire more objects, or disconnect signals */
+	for (std::vector<Retired>::const_iterator i = dead.begin (); i != dead.end (); ++i) {
+		i->deleter (i->obj);
+	}
+}
+
+size_t
+Epoch::n_retired ()
+{
+	return n_pending.load ();
+}
@@ -0,0 +1,257 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+#include <sstream>
+
+#include <glibmm/threads.h>
+
+#include "pbd/memory_account.h"
+#include "pbd/strsplit.h"
+#include "pbd/whitespace.h"
+
+using namespace PBD;
+using std::string;
+
+typedef std::map<string, MemoryAccount*> Accounts;
+
+/* function-local statics, accounts may be used during static
+ * initialization of other translation units.
+ */
+
+static Glib::Threads::Mutex&
+registry_lock ()
+{
+	static Glib::Threads::Mutex lock;
+	return lock;
+}
+
+static Accounts&
+registry ()
+{
+	static Accounts accounts;
+	return accounts;
+}
+
+MemoryAccount&
+MemoryAccount::get (string const& name)
+{
+	Glib::Threads::Mutex::Lock lm (registry_lock ());
+	Accounts::iterator i = registry ().find (name);
+	if (i != registry ().end ()) {
+		return *i->second;
+	}
+	/* never deleted, references to it may be cached */
+	MemoryAccount* a = new MemoryAccount (name);
+	registry ().insert (std::make_pair (name, a));
+	return *a;
+}
+
+std::vector<MemoryAccount*>
+MemoryAccount::accounts ()
+{
+	Glib::Threads::Mutex::Lock lm (registry_lock ());
+	std::vector<MemoryAccount*> rv;
+	for (Accounts::const_iterator i = registry ().begin (); i != registry ().end (); ++i) {
+		rv.push_back (i->second);
+	}
+	return rv;
+}
+
+const unsigned int MemoryAccount::max_backoff;
+
+MemoryAccount::MemoryAccount (string const& name)
+	: _name (name)
+	, _used (0)
+	, _peak (0)
+	, _budget (0)
+	, _backoff (0)
+	, _skip (0)
+	, _calm (0)
+{
+}
+
+void
+MemoryAccount::add (int64_t bytes)
+{
+	int64_t const now = _used.fetch_add (bytes, std::memory_order_relaxed) + bytes;
+	int64_t       peak = _peak.load (std::memory_order_relaxed);
+	while (now > peak && !_peak.compare_exchange_weak (peak, now, std::memory_order_relaxed)) {
+		;
+	}
+}
+
+bool
+MemoryAccount::try_add (int64_t bytes, int64_t limit)
+{
+	int64_t now = _used.load (std::memory_order_relaxed);
+	do {
+		if (now + bytes > limit) {
+			return false;
+		}
+	} while (!_used.compare_exchange_weak (now, now + bytes, std::memory_order_relaxed));
+
+	now += bytes;
+	int64_t peak = _peak.load (std::memory_order_relaxed);
+	while (now > peak && !_peak.compare_exchange_weak (peak, now, std::memory_order_relaxed)) {
+		;
+	}
+	return true;
+}
+
+void
+MemoryAccount::set_budget (int64_t bytes)
+{
+	_budget.store (bytes > 0 ? bytes : 0, std::memory_order_relaxed);
+	_backoff = _skip = _calm = 0;
+}
+
+bool
+MemoryAccount::over_budget () const
+{
+	return excess () > 0;
+}
+
+int64_t
+MemoryAccount::excess () const
+{
+	int64_t const b = budget ();
+	if (b == 0) {
+		return 0;
+	}
+	return std::max<int64_t> (0, used () - b);
+}
+
+void
+MemoryAccount::check_budgets ()
+{
+	std::vector<MemoryAccount*> a (accounts ());
+	for (std::vector<MemoryAccount*>::const_iterator i = a.begin (); i != a.end (); ++i) {
+		MemoryAccount& m (**i);
+
+		if (!m.over_budget ()) {
+			if (m._backoff && ++m._calm >= max_backoff) {
+				m._backoff = m._skip = 0;
+			}
+			continue;
+		}
+
+		m._calm = 0;
+
+		if (m._skip > 0) {
+			--m._skip;
+			continue;
+		}
+
+		m.OverBudget (); /* EMIT SIGNAL */
+
+		/* back off, in case this does not help for long */
+		m._skip    = m._backoff;
+		m._backoff = std::min<unsigned int> (max_backoff, m._backoff ? 2 * m._backoff : 1);
+	}
+}
+
+static bool
+parse_size (string s, int64_t& bytes)
+{
+	strip_whitespace_edges (s);
+	if (s.empty ()) {
+		return false;
+	}
+
+	int64_t mult = 1;
+	switch (s[s.size () - 1]) {
+		case 'k':
+		case 'K':
+			mult = 1 << 10;
+			break;
+		case 'm':
+		case 'M':
+			mult = 1 << 20;
+			break;
+		case 'g':
+		case 'G':
+			mult = 1 << 30;
+			break;
+		default:
+			break;
+	}
+	if (mult != 1) {
+		s.erase (s.size () - 1);
+	}
+
+	char* end;
+	long long const val = strtoll (s.c_str (), &end, 10);
+	if (end == s.c_str () || *end != '\0' || val < 0) {
+		return false;
+	}
+	bytes = val * mult;
+	return true;
+}
+
+bool
+MemoryAccount::set_budgets (string const& spec)
+{
+	std::map<string, int64_t> budgets;
+	std::vector<string>       items;
+
+	split (spec, items, ',');
+
+	for (std::vector<string>::const_iterator i = items.begin (); i != items.end (); ++i) {
+		string::size_type const eq = i->find ('=');
+		if (eq == string::npos) {
+			return false;
+		}
+		string  name = i->substr (0, eq);
+		int64_t bytes;
+		strip_whitespace_edges (name);
+		if (name.empty () || !parse_size (i->substr (eq + 1), bytes)) {
+			return false;
+		}
+		budgets[name] = bytes;
+	}
+
+	for (std::map<string, int64_t>::const_iterator i = budgets.begin (); i != budgets.end (); ++i) {
+		get (i->first).set_budget (i->second);
+	}
+
+	std::vector<MemoryAccount*> a (accounts ());
+	for (std::vector<MemoryAccount*>::const_iterator i = a.begin (); i != a.end (); ++i) {
+		if (budgets.find ((*i)->name ()) == budgets.end ()) {
+			(*i)->set_budget (0);
+		}
+	}
+	return true;
+}
+
+string
+MemoryAccount::report ()
+{
+	std::stringstream ss;
+	std::vector<MemoryAccount*> a (accounts ());
+	for (std::vector<MemoryAccount*>::const_iterator i = a.begin (); i != a.end (); ++i) {
+		ss << (*i)->name ()
+		   << ": used " << (*i)->used () / 1024 << " kB"
+		   << ", peak " << (*i)->peak () / 1024 << " kB";
+		if ((*i)->budget () > 0) {
+			ss << ", budget " << (*i)->budget () / 1024 << " kB";
+		}
+		ss << "\n";
+	}
+	return ss.str ();
+}
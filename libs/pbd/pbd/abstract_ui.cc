@@ -24,6 +24,7 @@
 #include <unistd.h>
 #include <iostream>
 #include <algorithm>
+#include <utility>
 
 #include "pbd/abstract_ui.h"
 #include "pbd/pthread_utils.h"
@@ -69,6 +70,8 @@ template <typename RequestObject>
 AbstractUI<RequestObject>::AbstractUI (const string& name)
 	: BaseUI (name)
 {
+	reset_request_counters ();
+
 	void (AbstractUI<RequestObject>::*pmf)(pthread_t,string,uint32_t) = &AbstractUI<RequestObject>::register_thread;
 
 	/* better to make this connect a handler that runs in the UI event loop but the syntax seems hard, and
@@ -177,6 +180,8 @@ AbstractUI<RequestObject>::get_request (RequestType rt)
 
 		if (vec.len[0] == 0) {
 			DEBUG_TRACE (PBD::DEBUG::AbstractUI, string_compose ("%1: no space in per thread pool for request of type %2\n", event_loop_name(), rt));
+			/* only on failure, successful requests are counted by the UI thread */
+			g_atomic_int_inc (&rbuf->dropped);
 			return 0;
 		}
 
@@ -205,6 +210,11 @@ AbstractUI<RequestObject>::handle_ui_requests ()
 	RequestBufferMapIterator i;
 	RequestBufferVector vec;
 
+	/* local, a request may run a recursive main loop which
+	 * handles requests of the next batch
+	 */
+	std::vector<bool> superseded;
+
 	/* check all registered per-thread buffers first */
 	Glib::Threads::Mutex::Lock rbml (request_buffer_map_lock);
 
@@ -234,16 +244,19 @@ AbstractUI<RequestObject>::handle_ui_requests ()
 
 	for (i = request_buffers.begin(); i != request_buffers.end(); ++i) {
 
-		while (!(*i).second->dead) {
+		bool more = true;
+
+		guint const dropped = g_atomic_int_get (&i->second->dropped);
+		if (dropped) {
+			g_atomic_int_add (&i->second->dropped, -(gint) dropped);
+			_counters.dropped += dropped;
+		}
 
-			/* we must process requests 1 by 1 because
-			 * the request may run a recursive main
-			 * event loop that will itself call
-			 * handle_ui_requests. when we return
-			 * from the request handler, we cannot
-			 * expect that the state of queued requests
-			 * is even remotely consistent with
-			 * the condition before we called it.
+		while (more && !(*i).second->dead) {
+
+			/* handle all requests that are queued now as a batch,
+			 * so that requests which are superseded by a later
+			 * one with the same key can be skipped.
 			 */
 
 			i->second->get_read_vector (&vec);
@@ -251,19 +264,54 @@ AbstractUI<RequestObject>::handle_ui_requests ()
 			DEBUG_TRACE (PBD::DEBUG::AbstractUI, string_compose ("%1 reading requests from RB[%2] @ %5, requests = %3 + %4\n",
 						event_loop_name(), std::distance (request_buffers.begin(), i), vec.len[0], vec.len[1], i->second));
 
-			if (vec.len[0] == 0) {
+			size_t const n = vec.len[0] + vec.len[1];
+
+			if (n == 0) {
 				break;
-			} else {
-				if (vec.buf[0]->invalidation && !vec.buf[0]->invalidation->valid ()) {
+			}
+
+			mark_superseded (vec, superseded);
+
+			for (size_t k = 0; k < n; ++k) {
+
+				RequestObject* req = k < vec.len[0] ? &vec.buf[0][k] : &vec.buf[1][k - vec.len[0]];
+
+				/* we must process requests 1 by 1 because
+				 * the request may run a recursive main
+				 * event loop that will itself call
+				 * handle_ui_requests. when we return
+				 * from the request handler, we cannot
+				 * expect that the state of queued requests
+				 * is even remotely consistent with
+				 * the condition before we called it.
+				 *
+				 * So check that the next request is still
+				 * the expected one, and start over with a
+				 * new batch if it is not.
+				 */
+
+				RequestBufferVector now;
+				i->second->get_read_vector (&now);
+
+				if (i->second->dead || now.len[0] == 0 || now.buf[0] != req) {
+					more = !i->second->dead && now.len[0] > 0;
+					break;
+				}
+
+				if (req->invalidation && !req->invalidation->valid ()) {
 					DEBUG_TRACE (PBD::DEBUG::AbstractUI, string_compose ("%1: skipping invalidated request\n", event_loop_name()));
 					rbml.release ();
+				} else if (superseded[k]) {
+					DEBUG_TRACE (PBD::DEBUG::AbstractUI, string_compose ("%1: skipping superseded request\n", event_loop_name()));
+					++_counters.coalesced;
+					rbml.release ();
 				} else {
 
 					DEBUG_TRACE (PBD::DEBUG::AbstractUI, string_compose ("%1: valid request, unlocking before calling\n", event_loop_name()));
 					rbml.release ();
 
 					DEBUG_TRACE (PBD::DEBUG::AbstractUI, string_compose ("%1: valid request, calling ::do_request()\n", event_loop_name()));
-					do_request (vec.buf[0]);
+					do_request (req);
 				}
 
 				/* if the request was CallSlot, then we need to ensure that we reset the functor in the request, in case it
@@ -274,16 +322,18 @@ AbstractUI<RequestObject>::handle_ui_requests ()
 				 * do_request() returns and we no longer need the functor for any reason.
 				 */
 
-				if (vec.buf[0]->type == CallSlot) {
-					vec.buf[0]->the_slot = 0;
+				if (req->type == CallSlot) {
+					req->the_slot = 0;
 				}
 
 				rbml.acquire ();
-				if (vec.buf[0]->invalidation) {
-					vec.buf[0]->invalidation->unref ();
+				if (req->invalidation) {
+					req->invalidation->unref ();
 				}
-				vec.buf[0]->invalidation = NULL;
+				req->invalidation = NULL;
+				req->coalesce_key = 0;
 				i->second->increment_read_ptr (1);
+				++_counters.queued;
 			}
 		}
 	}
@@ -313,10 +363,13 @@ AbstractUI<RequestObject>::handle_ui_requests ()
 
 	/* and now, the generic request buffer. same rules as above apply */
 
+	remove_superseded ();
+
 	while (!request_list.empty()) {
 		assert (rbml.locked ());
 		RequestObject* req = request_list.front ();
 		request_list.pop_front ();
+		++_counters.queued;
 
 		/* we're about to execute this request, so its
 		 * too late for any invalidation. mark
@@ -427,6 +480,12 @@ AbstractUI<RequestObject>::send_request (RequestObject *req)
 
 template<typename RequestObject> void
 AbstractUI<RequestObject>::call_slot (InvalidationRecord* invalidation, const boost::function<void()>& f)
+{
+	call_slot_coalesced (invalidation, f, 0);
+}
+
+template<typename RequestObject> void
+AbstractUI<RequestObject>::call_slot_coalesced (InvalidationRecord* invalidation, const boost::function<void()>& f, void const* key)
 {
 	if (caller_is_self()) {
 		DEBUG_TRACE (PBD::DEBUG::AbstractUI, string_compose ("%1/%2 direct dispatch of call slot via functor @ %3, invalidation %4\n", event_loop_name(), pthread_name(), &f, invalidation));
@@ -467,6 +526,7 @@ AbstractUI<RequestObject>::call_slot (InvalidationRecord* invalidation, const bo
 	/* copy semantics: copy the functor into the request object */
 
 	req->the_slot = f;
+	req->coalesce_key = key;
 
 	/* the invalidation record is an object which will carry out
 	 * invalidation of any requests associated with it when it is
@@ -488,3 +548,92 @@ AbstractUI<RequestObject>::request_buffer_factory (uint32_t num_requests)
 	per_thread_request_buffer.set (mcr);
 	return mcr;
 }
+
+template<typename RequestObject> void
+AbstractUI<RequestObject>::mark_superseded (RequestBufferVector const& vec, std::vector<bool>& superseded)
+{
+	/* a request is superseded if a later one in @param vec has the same key */
+
+	size_t const n = vec.len[0] + vec.len[1];
+	std::vector<std::pair<void const*, size_t> > keys;
+
+	superseded.assign (n, false);
+
+	for (size_t k = 0; k < n; ++k) {
+		RequestObject const* req = k < vec.len[0] ? &vec.buf[0][k] : &vec.buf[1][k - vec.len[0]];
+		if (req->coalesce_key) {
+			keys.push_back (std::make_pair (req->coalesce_key, k));
+		}
+	}
+
+	if (keys.size () < 2) {
+		return;
+	}
+
+	/* sorted by key, then position */
+	std::sort (keys.begin (), keys.end ());
+
+	for (size_t k = 0; k + 1 < keys.size (); ++k) {
+		if (keys[k].first == keys[k + 1].first) {
+			superseded[keys[k].second] = true;
+		}
+	}
+}
+
+template<typename RequestObject> void
+AbstractUI<RequestObject>::remove_superseded ()
+{
+	/* called with request_buffer_map_lock held. Of all requests in the
+	 * list with the same key, only the last one is kept.
+	 */
+
+	std::vector<std::pair<void const*, size_t> > keys;
+
+	size_t k = 0;
+	for (typename std::list<RequestObject*>::const_iterator r = request_list.begin (); r != request_list.end (); ++r, ++k) {
+		if ((*r)->coalesce_key) {
+			keys.push_back (std::make_pair ((*r)->coalesce_key, k));
+		}
+	}
+
+	if (keys.size () < 2) {
+		return;
+	}
+
+	std::sort (keys.begin (), keys.end ());
+
+	std::vector<bool> superseded (request_list.size (), false);
+
+	bool any = false;
+	for (k = 0; k + 1 < keys.size (); ++k) {
+		if (keys[k].first == keys[k + 1].first) {
+			superseded[keys[k].second] = true;
+			any = true;
+		}
+	}
+
+	if (!any) {
+		return;
+	}
+
+	k = 0;
+	for (typename std::list<RequestObject*>::iterator r = request_list.begin (); r != request_list.end (); ++k) {
+		if (superseded[k]) {
+			DEBUG_TRACE (PBD::DEBUG::AbstractUI, string_compose ("%1/%2 dropping superseded heap request\n", event_loop_name(), pthread_name()));
+			++_counters.queued;
+			++_counters.coalesced;
+			delete *r;
+			r = request_list.erase (r);
+		} else {
+			++r;
+		}
+	}
+}
+
+template<typename RequestObject> void
+AbstractUI<RequestObject>::reset_request_counters ()
+{
+	_counters.queued    = 0;
+	_counters.coalesced = 0;
+	_counters.dropped   = 0;
+}
@@ -23,11 +23,13 @@
 
 #include <map>
 #include <string>
+#include <vector>
 #include <pthread.h>
 
 #include <glibmm/threads.h>
 
 #include "pbd/libpbd_visibility.h"
+#include "pbd/g_atomic_compat.h"
 #include "pbd/receiver.h"
 #include "pbd/ringbufferNPT.h"
 #include "pbd/signals.h"
@@ -61,8 +63,21 @@ public:
 
 	void register_thread (pthread_t, std::string, uint32_t num_requests);
 	void call_slot (EventLoop::InvalidationRecord*, const boost::function<void()>&);
+	void call_slot_coalesced (EventLoop::InvalidationRecord*, const boost::function<void()>&, void const* key);
 	Glib::Threads::Mutex& slot_invalidation_mutex() { return request_buffer_map_lock; }
 
+	struct RequestCounters {
+		uint32_t queued;    ///< requests queued by other threads
+		uint32_t coalesced; ///< requests skipped because a newer one with the same key was queued
+		uint32_t dropped;   ///< requests lost because a per-thread request buffer was full
+	};
+
+	/* counters are updated by handle_ui_requests(), these must only be
+	 * called from the UI's own thread.
+	 */
+	RequestCounters request_counters () const { return _counters; }
+	void reset_request_counters ();
+
 	Glib::Threads::Mutex request_buffer_map_lock;
 
 	static void* request_buffer_factory (uint32_t num_requests);
@@ -70,9 +85,13 @@ public:
 protected:
 	struct RequestBuffer : public PBD::RingBufferNPT<RequestObject> {
 		bool dead;
+		GATOMIC_QUAL guint dropped; ///< failed requests, collected by handle_ui_requests()
 		RequestBuffer (uint32_t size)
 			: PBD::RingBufferNPT<RequestObject> (size)
-			, dead (false) {}
+			, dead (false)
+		{
+			g_atomic_int_set (&dropped, 0);
+		}
 	};
 	typedef typename RequestBuffer::rw_vector RequestBufferVector;
 
@@ -102,6 +121,12 @@ protected:
 
 	virtual void do_request (RequestObject *) = 0;
 	PBD::ScopedConnection new_thread_connection;
+
+private:
+	void mark_superseded (RequestBufferVector const&, std::vector<bool>&);
+	void remove_superseded ();
+
+	RequestCounters _counters;
 };
 
 #endif /* __pbd_abstract_ui_h__ */
@@ -50,6 +50,14 @@ public:
 		return false;
 	}
 
+	/** Approximate number of bytes of memory used by the command.
+	 * This is queried once, when the command is added to an
+	 * UndoTransaction, so it must be complete by then.
+	 */
+	virtual size_t memory_used () const {
+		return sizeof (Command) + _name.capacity ();
+	}
+
 protected:
 	Command() {}
 	Command(const std::string& name) : _name(name) {}
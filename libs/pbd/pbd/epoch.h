@@ -0,0 +1,85 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __libpbd_epoch_h__
+#define __libpbd_epoch_h__
+
+#include <boost/noncopyable.hpp>
+
+#include "pbd/libpbd_visibility.h"
+
+namespace PBD {
+
+/** Epoch based reclamation of data which is read without a lock.
+ *
+ * Data that is published through an atomic pointer cannot be deleted as
+ * soon as a writer replaces it, other threads may still be reading it.
+ * Readers hold an Epoch::Guard while they use such data, writers unpublish
+ * it and pass it to retire(). It is deleted once every guard which may
+ * have seen it has gone away.
+ *
+ * Entering and leaving a guard only writes to a record owned by the
+ * calling thread, readers never modify memory shared with other threads.
+ * Guards nest, and a thread may retire data while it holds one.
+ *
+ * Retired data is only deleted by reclaim(), which must be called by the
+ * writers. Readers never run deleters.
+ */
+class LIBPBD_API Epoch
+{
+public:
+	struct Record; /* per-thread, opaque */
+
+	class LIBPBD_API Guard : public boost::noncopyable
+	{
+	public:
+		Guard ();
+		~Guard ();
+
+	private:
+		Record* _record;
+	};
+
+	/** Queue \p obj to be deleted by reclaim() once no reader can use
+	 * it any more. \p obj must already be unreachable for new readers.
+	 */
+	template<typename T>
+	static void retire (T const* obj) {
+		if (obj) {
+			retire (const_cast<T*> (obj), &delete_object<T>);
+		}
+	}
+
+	static void retire (void* obj, void (*deleter) (void*));
+
+	/** Delete all retired data which is no longer in use. Does not lock
+	 * if nothing was retired.
+	 */
+	static void reclaim ();
+
+	/** @return number of retired objects which have not been deleted yet */
+	static size_t n_retired ();
+
+private:
+	template<typename T>
+	static void delete_object (void* obj) {
+		delete static_cast<T*> (obj);
+	}
+};
+
+} /* namespace */
+
+#endif /* __libpbd_epoch_h__ */
@@ -80,7 +80,13 @@ public:
 		InvalidationRecord*     invalidation;
 		boost::function<void()> the_slot;
 
-		BaseRequestObject() : invalidation (0) {}
+		/* requests with the same (non-null) key supersede each other:
+		 * of those that are queued when requests are handled, only the
+		 * most recent one is executed.
+		 */
+		void const*             coalesce_key;
+
+		BaseRequestObject() : invalidation (0), coalesce_key (0) {}
 		~BaseRequestObject() {
 			if (invalidation) {
 				invalidation->unref ();
@@ -89,6 +95,15 @@ public:
 	};
 
 	virtual void call_slot (InvalidationRecord*, const boost::function<void()>&) = 0;
+
+	/** Like call_slot(), but if another call with the same @param key is
+	 * queued before this one is handled, only the later one is executed.
+	 * Event loops that do not queue requests simply call the slot.
+	 */
+	virtual void call_slot_coalesced (InvalidationRecord* ir, const boost::function<void()>& f, void const* key) {
+		call_slot (ir, f);
+	}
+
 	virtual Glib::Threads::Mutex& slot_invalidation_mutex() = 0;
 
 	std::string event_loop_name() const { return _name; }
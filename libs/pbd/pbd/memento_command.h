@@ -141,6 +141,12 @@ public:
 		}
 	}
 
+	virtual size_t memory_used () const {
+		return Command::memory_used ()
+			+ (before ? before->memory_used () : 0)
+			+ (after ? after->memory_used () : 0);
+	}
+
 	virtual XMLNode &get_state() {
 		std::string name;
 		if (before && after) {
@@ -0,0 +1,126 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __libpbd_memory_account_h__
+#define __libpbd_memory_account_h__
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+#include <boost/noncopyable.hpp>
+
+#include "pbd/libpbd_visibility.h"
+#include "pbd/signals.h"
+
+namespace PBD {
+
+/** A named counter of the memory held by one subsystem.
+ *
+ * Accounts are created on first use and live until the process exits,
+ * so a reference returned by get() may be cached (e.g. in a function-local
+ * static). add() and remove() are lock-free and may be used from any
+ * thread, including realtime threads; they only do bookkeeping, the memory
+ * itself is allocated by the caller as usual.
+ *
+ * An account can have a budget. Nothing is enforced while memory is
+ * allocated: check_budgets() is called periodically (from the GUI thread)
+ * and emits OverBudget for every account that exceeds its budget. The
+ * owner of a cache connects to that signal and evicts whatever it can.
+ * If an account keeps exceeding its budget anyway, OverBudget is emitted
+ * less and less often.
+ */
+class LIBPBD_API MemoryAccount : public boost::noncopyable
+{
+public:
+	/** @return the account with the given name, created if needed */
+	static MemoryAccount& get (std::string const& name);
+
+	/** @return all accounts, sorted by name */
+	static std::vector<MemoryAccount*> accounts ();
+
+	std::string const& name () const { return _name; }
+
+	void add (int64_t bytes);
+	void remove (int64_t bytes) { add (-bytes); }
+
+	/** Replace a previously accounted size @param old_bytes by @param new_bytes */
+	void change (int64_t old_bytes, int64_t new_bytes) { add (new_bytes - old_bytes); }
+
+	/** Add @param bytes unless that takes the account above @param limit.
+	 * Unlike the budget, this is a hard limit which is checked atomically,
+	 * for callers which share an allocation limit.
+	 * @return true if the bytes were added
+	 */
+	bool try_add (int64_t bytes, int64_t limit);
+
+	int64_t used () const { return _used.load (std::memory_order_relaxed); }
+	int64_t peak () const { return _peak.load (std::memory_order_relaxed); }
+
+	/** budget in bytes, 0 for unlimited */
+	int64_t budget () const { return _budget.load (std::memory_order_relaxed); }
+	void set_budget (int64_t bytes);
+
+	bool over_budget () const;
+
+	/** Number of bytes that should be freed to get back within budget */
+	int64_t excess () const;
+
+	/** Emitted by check_budgets() when the account exceeds its budget */
+	PBD::Signal0<void> OverBudget;
+
+	/** Emit OverBudget for every account that exceeds its budget, unless
+	 * it is backing off. An account backs off when it exceeds its budget
+	 * again soon after OverBudget was emitted, i.e. when nothing could be
+	 * released or the released data was needed again right away. The
+	 * back-off doubles every time, up to max_backoff checks, and ends once
+	 * the account has stayed within its budget for max_backoff checks, or
+	 * when the budget is changed.
+	 */
+	static void check_budgets ();
+
+	static const unsigned int max_backoff = 64;
+
+	/** Apply budgets given as a comma separated list of "name=size" pairs.
+	 * Sizes are in bytes, with an optional K, M or G suffix. Accounts that
+	 * are not listed have their budget removed.
+	 *
+	 * @return false if the list could not be parsed (budgets are unchanged)
+	 */
+	static bool set_budgets (std::string const& spec);
+
+	/** One line per account: name, current and peak size and budget */
+	static std::string report ();
+
+private:
+	MemoryAccount (std::string const& name);
+
+	std::string          _name;
+	std::atomic<int64_t> _used;
+	std::atomic<int64_t> _peak;
+	std::atomic<int64_t> _budget;
+
+	/* only used by check_budgets() and set_budget(), in the GUI thread */
+	unsigned int _backoff; ///< checks to skip after the next OverBudget
+	unsigned int _skip;    ///< checks left to skip
+	unsigned int _calm;    ///< checks within budget since the last OverBudget
+};
+
+} /* namespace */
+
+#endif /* __libpbd_memory_account_h__ */
@@ -25,8 +25,10 @@
 #include "glibmm/threads.h"
 
 #include <list>
+#include <vector>
 
 #include "pbd/libpbd_visibility.h"
+#include "pbd/epoch.h"
 #include "pbd/g_atomic_compat.h"
 
 /** @file rcu.h
@@ -266,6 +268,220 @@ private:
 	std::list<boost::shared_ptr<T> > _dead_wood;
 };
 
+/** EpochRCUManager implements the same interface as SerializedRCUManager
+ * (writers are serialized by a mutex and may be slow) but additionally
+ * offers readers a way to access the managed object without touching its
+ * reference count: a ReadGuard.
+ *
+ * reader() has to copy a shared_ptr, which means an atomic increment and
+ * decrement of a reference count that is shared by all threads, and writers
+ * must wait for that copy to complete. With many concurrent readers (e.g. the
+ * process threads all iterating over the same route list) the cache line
+ * holding the count bounces between CPUs on every cycle.
+ *
+ * A ReadGuard instead holds a PBD::Epoch::Guard, which only writes to a
+ * record owned by the calling thread, and uses a plain pointer to the
+ * current value until it goes out of scope. It is wait-free and does not
+ * allocate or free memory, so it may be used in realtime context. A guard
+ * must not be kept beyond the current (process) cycle, and the pointer
+ * obtained from it must not be used once the guard is gone.
+ *
+ * update() does not free the previous value, it is passed to
+ * PBD::Epoch::retire() and released once no ReadGuard can use it any more.
+ * Writers reclaim retired values, readers never do. flush() waits until all
+ * values retired by this manager are released and then drops the dead wood,
+ * just like SerializedRCUManager::flush().
+ *
+ * Old values are always kept on the dead wood list until they are unique,
+ * so that they are destroyed by a writer of this manager, as in
+ * SerializedRCUManager.
+ */
+template <class T>
+class /*LIBPBD_API*/ EpochRCUManager : public RCUManager<T>
+{
+public:
+	EpochRCUManager (T* new_rcu_value)
+		: RCUManager<T> (new_rcu_value)
+		, _current_write_old (0)
+	{
+		g_atomic_int_set (&_n_retired, 0);
+	}
+
+	~EpochRCUManager ()
+	{
+		/* there can be no readers left at this point, but retired
+		 * values refer to this manager until they are released.
+		 */
+		wait_for_retired ();
+	}
+
+	/** Realtime-safe, scoped read access to the current value.
+	 *
+	 * @code
+	 * {
+	 *      EpochRCUManager<T>::ReadGuard rg (object_manager);
+	 *      for (T::const_iterator i = rg->begin (); i != rg->end (); ++i) { ... }
+	 * }
+	 * @endcode
+	 */
+	class ReadGuard
+	{
+	public:
+		ReadGuard (EpochRCUManager<T> const& manager)
+			: _value (manager.read_value ())
+		{
+		}
+
+		T* get () const { return _value; }
+		T* operator-> () const { return _value; }
+		T& operator* () const { return *_value; }
+
+	private:
+		ReadGuard (ReadGuard const&);
+		ReadGuard& operator= (ReadGuard const&);
+
+		PBD::Epoch::Guard _guard; // entered before the value is read
+		T*                _value;
+	};
+
+	void init (boost::shared_ptr<T> new_rcu_value) {
+		assert (*RCUManager<T>::x.rcu_value == boost::shared_ptr<T> ());
+
+		boost::shared_ptr<T>* new_spp = new boost::shared_ptr<T> (new_rcu_value);
+		boost::shared_ptr<T>* old_spp = (boost::shared_ptr<T>*) g_atomic_pointer_get (&RCUManager<T>::x.gptr);
+
+		g_atomic_pointer_set (&RCUManager<T>::x.gptr, new_spp);
+
+		Glib::Threads::Mutex::Lock lm (_lock);
+		retire (old_spp);
+	}
+
+	boost::shared_ptr<T> write_copy ()
+	{
+		_lock.lock ();
+
+		reclaim ();
+
+		_current_write_old = RCUManager<T>::x.rcu_value;
+
+		boost::shared_ptr<T> new_copy (new T (**_current_write_old));
+
+		return new_copy;
+
+		/* the write lock is still held: update(), no_update() or abort()
+		 * MUST be called.
+		 */
+	}
+
+	void abort () {
+		_lock.unlock ();
+	}
+
+	bool update (boost::shared_ptr<T> new_value)
+	{
+		/* we still hold the write lock - other writers are locked out */
+
+		boost::shared_ptr<T>* new_spp = new boost::shared_ptr<T> (new_value);
+
+		bool ret = g_atomic_pointer_compare_and_exchange (&RCUManager<T>::x.gptr,
+		                                                  (gpointer)_current_write_old,
+		                                                  (gpointer)new_spp);
+
+		if (ret) {
+			/* wait for reader() calls to finish copying the old value,
+			 * see SerializedRCUManager::update(). ReadGuards are taken
+			 * care of by the epoch.
+			 */
+			for (unsigned i = 0; RCUManager<T>::active_read (); ++i) {
+				boost::detail::yield (i);
+			}
+
+			_dead_wood.push_back (*_current_write_old);
+			retire (_current_write_old);
+			reclaim ();
+		} else {
+			delete new_spp;
+		}
+
+		_lock.unlock ();
+
+		return ret;
+	}
+
+	void no_update () {
+		_lock.unlock ();
+	}
+
+	void flush ()
+	{
+		Glib::Threads::Mutex::Lock lm (_lock);
+		wait_for_retired ();
+		_dead_wood.clear ();
+	}
+
+private:
+	struct Retired {
+		Retired (EpochRCUManager<T>* m, boost::shared_ptr<T>* v) : manager (m), value (v) {}
+
+		EpochRCUManager<T>*   manager;
+		boost::shared_ptr<T>* value;
+	};
+
+	static void release (void* ptr)
+	{
+		Retired* r = static_cast<Retired*> (ptr);
+		delete r->value;
+		g_atomic_int_add (&r->manager->_n_retired, -1);
+		delete r;
+	}
+
+	void retire (boost::shared_ptr<T>* spp)
+	{
+		g_atomic_int_inc (&_n_retired);
+		PBD::Epoch::retire (new Retired (this, spp), &release);
+	}
+
+	T* read_value () const
+	{
+		return ((boost::shared_ptr<T>*)g_atomic_pointer_get (&RCUManager<T>::x.gptr))->get ();
+	}
+
+	/** Release retired values which are no longer in use, and old values
+	 * nobody else refers to. Must be called with the write lock held.
+	 */
+	void reclaim ()
+	{
+		PBD::Epoch::reclaim ();
+
+		typename std::list<boost::shared_ptr<T> >::iterator i;
+
+		for (i = _dead_wood.begin (); i != _dead_wood.end ();) {
+			if ((*i).unique ()) {
+				i = _dead_wood.erase (i);
+			} else {
+				++i;
+			}
+		}
+	}
+
+	void wait_for_retired ()
+	{
+		for (unsigned i = 0; ; ++i) {
+			PBD::Epoch::reclaim ();
+			if (g_atomic_int_get (&_n_retired) == 0) {
+				break;
+			}
+			boost::detail::yield (i);
+		}
+	}
+
+	Glib::Threads::Mutex             _lock;
+	boost::shared_ptr<T>*            _current_write_old;
+	std::list<boost::shared_ptr<T> > _dead_wood;
+
+	mutable GATOMIC_QUAL gint _n_retired; ///< retired values which were not released yet
+};
+
 /** RCUWriter is a convenience object that implements write_copy/update via
  * lifetime management. Creating the object obtains a writable copy, which can
  * be obtained via the get_copy() method; deleting the object will update
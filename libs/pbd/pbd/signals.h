@@ -26,6 +26,7 @@
 
 #include <list>
 #include <map>
+#include <vector>
 
 #ifdef nil
 #undef nil
@@ -43,6 +44,7 @@
 #include <boost/optional.hpp>
 
 #include "pbd/libpbd_visibility.h"
+#include "pbd/epoch.h"
 #include "pbd/event_loop.h"
 
 #ifndef NDEBUG
@@ -63,6 +65,7 @@ class LIBPBD_API SignalBase
 public:
 	SignalBase ()
 	: _in_dtor (false)
+	, _dirty (false)
 #ifdef DEBUG_PBD_SIGNAL_CONNECTIONS
 	, _debug_connection (false)
 #endif
@@ -76,6 +79,7 @@ public:
 protected:
 	mutable Glib::Threads::Mutex _mutex;
 	std::atomic<bool>            _in_dtor;
+	std::atomic<bool>            _dirty; ///< slots changed since they were last published
 #ifdef DEBUG_PBD_SIGNAL_CONNECTIONS
 	bool _debug_connection;
 #endif
@@ -109,6 +113,12 @@ public:
 		}
 	}
 
+	/* false once disconnect() has been called, or the signal is going away */
+	bool connected () const
+	{
+		return _signal.load (std::memory_order_acquire) != 0;
+	}
+
 	void disconnected ()
 	{
 		if (_invalidation_record) {
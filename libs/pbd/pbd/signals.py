@@ -101,22 +101,45 @@ def signal(f, n, v):
     print("private:", file=f)
 
     print("""
-\t/** The slots that this signal will call on emission */
-\ttypedef std::map<boost::shared_ptr<Connection>, slot_function_type> Slots;
-\tSlots _slots;
-""", file=f)
+\t/** The slots that this signal will call on emission, in the order in
+\t * which they were connected, indexed by their connection. Both are
+\t * protected by _mutex.
+\t */
+\ttypedef std::pair<boost::shared_ptr<Connection>, slot_function_type> Slot;
+\ttypedef std::list<Slot> Slots;
+\ttypedef std::map<Connection const*, %sSlots::iterator> SlotIndex;
+
+\tSlots     _slots;
+\tSlotIndex _slot_index;
+
+\t/** A copy of _slots which emission uses without locking. A published
+\t * copy is never modified. Connecting only marks it as out of date, it
+\t * is replaced by the next emission; disconnecting unpublishes it. The
+\t * copy is deleted via PBD::Epoch once no emission uses it any more.
+\t */
+\ttypedef std::vector<Slot> Snapshot;
+
+\tstd::atomic<Snapshot const*> _snapshot;
+""" % typename, file=f)
 
     print("public:", file=f)
     print("", file=f)
+    print("\tSignal%d () : _snapshot (0) {}" % n, file=f)
+    print("", file=f)
     print("\t~Signal%d () {" % n, file=f)
 
     print("\t\t_in_dtor.store (true, std::memory_order_release);", file=f)
-    print("\t\tGlib::Threads::Mutex::Lock lm (_mutex);", file=f)
-    print("\t\t/* Tell our connection objects that we are going away, so they don't try to call us */", file=f)
-    print("\t\tfor (%sSlots::const_iterator i = _slots.begin(); i != _slots.end(); ++i) {" % typename, file=f)
-
-    print("\t\t\ti->first->signal_going_away ();", file=f)
+    print("\t\tSnapshot const* s;", file=f)
+    print("\t\t{", file=f)
+    print("\t\t\tGlib::Threads::Mutex::Lock lm (_mutex);", file=f)
+    print("\t\t\t/* Tell our connection objects that we are going away, so they don't try to call us */", file=f)
+    print("\t\t\tfor (%sSlots::const_iterator i = _slots.begin(); i != _slots.end(); ++i) {" % typename, file=f)
+    print("\t\t\t\ti->first->signal_going_away ();", file=f)
+    print("\t\t\t}", file=f)
+    print("\t\t\ts = _snapshot.exchange (0);", file=f)
     print("\t\t}", file=f)
+    print("\t\tEpoch::retire (s);", file=f)
+    print("\t\tEpoch::reclaim ();", file=f)
     print("\t}", file=f)
     print("", file=f)
 
@@ -130,6 +153,10 @@ def signal(f, n, v):
     print("\tstatic void compositor (%sboost::function<void(%s)> f, EventLoop* event_loop, EventLoop::InvalidationRecord* ir%s) {" % (typename, comma_separated(An), p), file=f)
     print("\t\tevent_loop->call_slot (ir, boost::bind (f%s));" % q, file=f)
     print("\t}", file=f)
+    print("", file=f)
+    print("\tstatic void coalescing_compositor (%sboost::function<void(%s)> f, EventLoop* event_loop, EventLoop::InvalidationRecord* ir, Connection const* key%s) {" % (typename, comma_separated(An), p), file=f)
+    print("\t\tevent_loop->call_slot_coalesced (ir, boost::bind (f%s), key);" % q, file=f)
+    print("\t}", file=f)
 
     print("""
 \t/** Arrange for @a slot to be executed whenever this signal is emitted.
@@ -219,6 +246,40 @@ def signal(f, n, v):
     print("\t\tc = _connect (ir, boost::bind (&compositor, slot, event_loop, ir%s));" % p, file=f)
     print("\t}", file=f)
 
+    print("""
+\t/** Like connect(), but if the signal is emitted again before @a event_loop
+\t *  got around to executing @a slot, only the most recent call is executed
+\t *  (with the most recent arguments). Use this for slots which only
+\t *  need the latest state, like GUI updates of frequently changing values.
+\t */
+
+\tvoid connect_coalesced (ScopedConnectionList& clist,
+\t                        PBD::EventLoop::InvalidationRecord* ir,
+\t                        const slot_function_type& slot,
+\t                        PBD::EventLoop* event_loop) {
+
+\t\tif (ir) {
+\t\t\tir->event_loop = event_loop;
+\t\t}
+\t\tboost::shared_ptr<Connection> c (new Connection (this, ir));""", file=f)
+    print("\t\t_connect (c, boost::bind (&coalescing_compositor, slot, event_loop, ir, c.get()%s));" % p, file=f)
+    print("\t\tclist.add_connection (c);", file=f)
+    print("\t}", file=f)
+
+    print("""
+\tvoid connect_coalesced (ScopedConnection& c,
+\t                        PBD::EventLoop::InvalidationRecord* ir,
+\t                        const slot_function_type& slot,
+\t                        PBD::EventLoop* event_loop) {
+
+\t\tif (ir) {
+\t\t\tir->event_loop = event_loop;
+\t\t}
+\t\tboost::shared_ptr<Connection> cc (new Connection (this, ir));""", file=f)
+    print("\t\t_connect (cc, boost::bind (&coalescing_compositor, slot, event_loop, ir, cc.get()%s));" % p, file=f)
+    print("\t\tc = cc;", file=f)
+    print("\t}", file=f)
+
     print("""
 \t/** Emit this signal. This will cause all slots connected to it be executed
 \t  * in the order that they were connected (cross-thread issues may alter
@@ -231,30 +292,33 @@ def signal(f, n, v):
     else:
         print("\ttypename C::result_type operator() (%s)" % comma_separated(Anan), file=f)
     print("\t{", file=f)
-    print("\t\t/* First, take a copy of our list of slots as it is now */", file=f)
+    print("\t\t/* First, get hold of our list of slots as it is now. The guard keeps", file=f)
+    print("\t\t * it alive until we are done, even if slots are disconnected meanwhile.", file=f)
+    print("\t\t */", file=f)
     print("", file=f)
-    print("\t\tSlots s;", file=f)
-    print("\t\t{", file=f)
-    print("\t\t\tGlib::Threads::Mutex::Lock lm (_mutex);", file=f)
-    print("\t\t\ts = _slots;", file=f)
-    print("\t\t}", file=f)
+    print("\t\tEpoch::Guard g;", file=f)
+    print("\t\tSnapshot const* s = snapshot ();", file=f)
     print("", file=f)
-    if not v:
+    if v:
+        print("\t\tif (!s) {", file=f)
+        print("\t\t\treturn;", file=f)
+        print("\t\t}", file=f)
+        print("", file=f)
+    else:
         print("\t\tstd::list<R> r;", file=f)
-    print("\t\tfor (%sSlots::const_iterator i = s.begin(); i != s.end(); ++i) {" % typename, file=f)
+        print("\t\tif (!s) {", file=f)
+        print("\t\t\tC c;", file=f)
+        print("\t\t\treturn c (r.begin(), r.end());", file=f)
+        print("\t\t}", file=f)
+        print("", file=f)
+    print("\t\tfor (%sSnapshot::const_iterator i = s->begin(); i != s->end(); ++i) {" % typename, file=f)
     print("""
 \t\t\t/* We may have just called a slot, and this may have resulted in
-\t\t\t * disconnection of other slots from us.  The list copy means that
-\t\t\t * this won't cause any problems with invalidated iterators, but we
-\t\t\t * must check to see if the slot we are about to call is still on the list.
+\t\t\t * disconnection of other slots from us. The list we hold is not
+\t\t\t * affected by that, but we must check to see if the slot we are
+\t\t\t * about to call is still connected.
 \t\t\t */
-\t\t\tbool still_there = false;
-\t\t\t{
-\t\t\t\tGlib::Threads::Mutex::Lock lm (_mutex);
-\t\t\t\tstill_there = _slots.find (i->first) != _slots.end ();
-\t\t\t}
-
-\t\t\tif (still_there) {""", file=f)
+\t\t\tif (i->first->connected ()) {""", file=f)
     if v:
         print("\t\t\t\t(i->second)(%s);" % comma_separated(an), file=f)
     else:
@@ -291,18 +355,70 @@ def signal(f, n, v):
     print("\tfriend class Connection;", file=f)
 
     print("""
+\t/** @return the slots to call on emission (or a null pointer), without
+\t * locking unless they changed. Must be called with an Epoch::Guard.
+\t */
+\tSnapshot const* snapshot ()
+\t{
+\t\tif (_dirty.load ()) {
+\t\t\tpublish ();
+\t\t}
+
+\t\tSnapshot const* s;
+
+\t\twhile (!(s = _snapshot.load ()) && _dirty.load ()) {
+\t\t\t/* a slot was disconnected meanwhile */
+\t\t\tpublish ();
+\t\t}
+
+\t\treturn s;
+\t}
+
+\t/** Publish a copy of _slots, unless the published copy is up to date */
+\tvoid publish ()
+\t{
+\t\tSnapshot const* o;
+
+\t\t{
+\t\t\tGlib::Threads::Mutex::Lock lm (_mutex);
+\t\t\tif (!_dirty.load ()) {
+\t\t\t\treturn;
+\t\t\t}
+\t\t\to = _snapshot.exchange (_slots.empty () ? 0 : new Snapshot (_slots.begin (), _slots.end ()));
+\t\t\t_dirty.store (false);
+\t\t}
+
+\t\t/* deleted by the next connect or disconnect, never while emitting */
+\t\tEpoch::retire (o);
+\t}
+
 \tboost::shared_ptr<Connection> _connect (PBD::EventLoop::InvalidationRecord* ir, slot_function_type f)
 \t{
 \t\tboost::shared_ptr<Connection> c (new Connection (this, ir));
-\t\tGlib::Threads::Mutex::Lock lm (_mutex);
-\t\t_slots[c] = f;
+\t\t_connect (c, f);
+\t\treturn c;
+\t}
+
+\tvoid _connect (boost::shared_ptr<Connection> c, slot_function_type f)
+\t{
+\t\t{
+\t\t\tGlib::Threads::Mutex::Lock lm (_mutex);
+\t\t\t_slot_index[c.get ()] = _slots.insert (_slots.end (), Slot (c, f));
+\t\t\t_dirty.store (true);
+\t\t}
+
+\t\t/* publish here rather than on the next emission, and delete
+\t\t * what emissions retired. Not while holding _mutex, deleting
+\t\t * slots may disconnect others.
+\t\t */
+\t\tpublish ();
+\t\tEpoch::reclaim ();
 #ifdef DEBUG_PBD_SIGNAL_CONNECTIONS
 \t\tif (_debug_connection) {
-\t\t\tstd::cerr << "+++++++ CONNECT " << this << " size now " << _slots.size() << std::endl;
+\t\t\tstd::cerr << "+++++++ CONNECT " << this << " size now " << size () << std::endl;
 \t\t\tPBD::stacktrace (std::cerr, 10);
 \t\t}
 #endif
-\t\treturn c;
 \t}""", file=f)
 
     print("""
@@ -318,20 +434,32 @@ def signal(f, n, v):
 \t\t\t/* Spin */
 \t\t\tlm.try_acquire ();
 \t\t}
-\t\t_slots.erase (c);
+\t\tSnapshot const* s = 0;
+\t\t%sSlotIndex::iterator i = _slot_index.find (c.get ());
+\t\tif (i != _slot_index.end ()) {
+\t\t\t_slots.erase (i->second);
+\t\t\t_slot_index.erase (i);
+\t\t\t/* Unpublish the copy, so that the slot is released as soon as
+\t\t\t * no emission is using it. The next emission makes a new one.
+\t\t\t */
+\t\t\t_dirty.store (true);
+\t\t\ts = _snapshot.exchange (0);
+\t\t}
 \t\tlm.release ();
 
 \t\tc->disconnected ();
+\t\tEpoch::retire (s);
+\t\tEpoch::reclaim ();
 #ifdef DEBUG_PBD_SIGNAL_CONNECTIONS
 \t\tif (_debug_connection) {
-\t\t\tstd::cerr << "------- DISCCONNECT " << this << " size now " << _slots.size() << std::endl;
+\t\t\tstd::cerr << "------- DISCCONNECT " << this << " size now " << size () << std::endl;
 \t\t\tPBD::stacktrace (std::cerr, 10);
 \t\t}
 #endif
 \t}
 
 };
-""", file=f)
+""" % typename, file=f)
 
 for i in range(0, 6):
     signal(f, i, False)
@@ -54,6 +54,12 @@ class LIBPBD_API Stateful {
 	virtual XMLNode& get_state (void) = 0;
 	virtual int set_state (const XMLNode&, int version) = 0;
 
+	/** Write the state to @param writer. The default writes (and then
+	 * discards) the node returned by get_state(); objects with a large
+	 * state may override this to write it without building a tree.
+	 */
+	virtual void write_state (XMLStreamWriter& writer);
+
 	virtual bool apply_change (PropertyBase const &);
 	PropertyChange apply_changes (PropertyList const &);
 
@@ -47,6 +47,7 @@ public:
 	XMLNode& get_state ();
 
 	bool empty () const;
+	size_t memory_used () const;
 
 private:
 	boost::weak_ptr<Stateful> _object;  ///< the object in question
@@ -26,6 +26,10 @@
 #include <list>
 #include <map>
 #include <string>
+#include <vector>
+#include <stdint.h>
+
+#include <boost/function.hpp>
 
 #include <sigc++/bind.h>
 #include <sigc++/slot.h>
@@ -74,10 +78,30 @@ public:
 		return _timestamp;
 	}
 
+	/** @return memory used by the transaction and its commands */
+	size_t memory_used () const
+	{
+		return _memory;
+	}
+
+	/** Unique number, used to track which transactions have been saved */
+	uint32_t serial () const
+	{
+		return _serial;
+	}
+
 private:
+	friend class UndoHistory;
+
 	std::list<Command*> actions;
 	struct timeval      _timestamp;
 	bool                _clearing;
+	uint32_t            _serial;
+	int64_t             _memory;
+
+	static uint32_t next_serial (uint32_t n = 1);
+
+	void account (int64_t bytes);
 
 	void about_to_explicitly_delete ();
 };
@@ -94,7 +118,7 @@ public:
 
 	unsigned long undo_depth () const
 	{
-		return UndoList.size ();
+		return UndoList.size () + _n_deferred;
 	}
 	unsigned long redo_depth () const
 	{
@@ -103,7 +127,10 @@ public:
 
 	std::string next_undo () const
 	{
-		return (UndoList.empty () ? std::string () : UndoList.back ()->name ());
+		if (UndoList.empty ()) {
+			return _n_deferred > 0 ? _deferred_next : std::string ();
+		}
+		return UndoList.back ()->name ();
 	}
 	std::string next_redo () const
 	{
@@ -126,6 +153,38 @@ public:
 	void     save_state ();
 
 	void set_depth (uint32_t);
+	void reduce_memory (size_t bytes);
+
+	/* Incremental saving.
+	 *
+	 * The history remembers which transactions it held when it was last
+	 * saved (see mark_saved()). changes_since_save() describes how that
+	 * saved list has to be edited to match the most recent @param depth
+	 * transactions now: drop the first @param drop entries, keep the
+	 * following @param keep entries and append @param added.
+	 */
+	void changes_since_save (uint32_t depth, uint32_t& drop, uint32_t& keep, std::list<UndoTransaction*>& added);
+	void mark_saved (uint32_t depth);
+	uint32_t saved_size () const { return _saved.size (); }
+
+	/* Deferred loading.
+	 *
+	 * set_deferred() adds @param n saved transactions, the most recent one
+	 * being named @param next, without creating them. @param loader is
+	 * only called once they are actually needed, e.g. to undo beyond all
+	 * transactions added since. It must return all @param n transactions
+	 * in order, with NULL for any that could not be created.
+	 *
+	 * The deferred transactions are considered to be saved.
+	 *
+	 * load_deferred() returns false if the loader returned fewer than
+	 * @param n transactions, the history is then left unchanged.
+	 */
+	typedef boost::function<std::vector<UndoTransaction*> ()> DeferredLoader;
+
+	void set_deferred (uint32_t n, std::string const& next, DeferredLoader loader);
+	bool deferred () const { return _n_deferred > 0; }
+	bool load_deferred ();
 
 	PBD::Signal0<void> Changed;
 	PBD::Signal0<void> BeginUndoRedo;
@@ -137,7 +196,19 @@ private:
 	std::list<UndoTransaction*> UndoList;
 	std::list<UndoTransaction*> RedoList;
 
+	std::vector<uint32_t> _saved;
+
+	/* deferred transactions precede UndoList, and use the serials
+	 * [_deferred_end - _n_deferred, _deferred_end)
+	 */
+	uint32_t       _n_deferred;
+	uint32_t       _deferred_end;
+	std::string    _deferred_next;
+	DeferredLoader _deferred_loader;
+
 	void remove (UndoTransaction*);
+	void drop_oldest (uint32_t n);
+	void recent_serials (uint32_t depth, std::vector<std::pair<uint32_t, UndoTransaction*> >&) const;
 };
 
 #endif /* __lib_pbd_undo_h__ */
@@ -39,6 +39,7 @@
 
 #include <libxml/parser.h>
 #include <libxml/tree.h>
+#include <boost/function.hpp>
 #include <boost/shared_ptr.hpp>
 
 #include <glibmm/ustring.h>
@@ -93,6 +94,14 @@ public:
 	bool read_and_validate(const std::string& fn) { set_filename(fn); return read_internal(true); }
 	bool read_buffer(char const*, bool to_tree_doc = false);
 
+	/** Read @param fn with a streaming (SAX) parser, which creates the
+	 * XMLNodes directly instead of copying them from a libxml2 document.
+	 * This is considerably faster and needs less memory for large files.
+	 * The tree is the same as that created by read(), but find() has to
+	 * recreate the document for each query.
+	 */
+	bool read_streaming(const std::string& fn);
+
 	bool write() const;
 	bool write(const std::string& fn) { set_filename(fn); return write(); }
 
@@ -194,6 +203,9 @@ public:
 
 	void dump (std::ostream &, std::string p = "") const;
 
+	/** Approximate number of bytes of memory used by the node, its properties and children */
+	size_t memory_used () const;
+
 private:
 	std::string         _name;
 	bool                _is_content;
@@ -205,6 +217,103 @@ private:
 	void clear_lists ();
 };
 
+/** Write an XML document to a file sequentially, without building a tree.
+ *
+ * XMLTree::write() has to hold the complete document as XMLNodes and used to
+ * copy all of it into a libxml2 document before writing. XMLStreamWriter
+ * instead appends each element to an output buffer which is written to
+ * the file in large blocks, so only the element currently being written
+ * needs to exist in memory.
+ *
+ * Elements are either emitted one at a time (start_element(), attribute(),
+ * content(), end_element()) or, for code that only knows how to produce an
+ * XMLNode, as a complete subtree using node(). The output is formatted
+ * exactly like libxml2 formats XMLTree::write() output.
+ */
+class LIBPBD_API XMLStreamWriter {
+public:
+	XMLStreamWriter (const std::string& path);
+	~XMLStreamWriter ();
+
+	/** @return false if the file could not be opened or written */
+	bool ok () const { return _file && !_error; }
+
+	void start_element (const char* name);
+	void end_element ();
+
+	/** Add an attribute to the element started last. Must be called
+	 * before any content or child element of that element is written.
+	 */
+	bool attribute (const char* name, const std::string& value);
+
+	bool attribute (const char* name, const char* cstr) {
+		return attribute (name, std::string (cstr));
+	}
+
+	template<class T>
+	bool attribute (const char* name, const T& value)
+	{
+		std::string str;
+		if (!PBD::to_string<T> (value, str)) {
+			return false;
+		}
+		return attribute (name, str);
+	}
+
+	/** Add text to the current element. Like libxml2, elements with text
+	 * are not indented; this should come before any child element.
+	 */
+	void content (const std::string&);
+
+	/** Write @param node including all its children */
+	void node (const XMLNode& node);
+
+	typedef boost::function<void (XMLStreamWriter&)> Filler;
+
+	/** Call @param filler to write more children of @param node, after
+	 * its own children, when node() writes it. This allows objects with
+	 * a large state to stream it without first adding it to a tree.
+	 */
+	void add_filler (const XMLNode* node, Filler filler);
+
+	/** Call @param filler instead of writing @param placeholder, the next
+	 * time node() comes across it. This allows objects to stream part of
+	 * their state at its place among other children.
+	 */
+	void replace (const XMLNode* placeholder, Filler filler);
+
+	/** Close all open elements, flush and close the file.
+	 * @return true if the complete document was written
+	 */
+	bool close ();
+
+	/** @return number of bytes of the document written so far */
+	size_t size () const { return _written + _buf.size (); }
+
+private:
+	struct Element {
+		Element (const std::string& n, bool i) : name (n), has_children (false), no_format (i) {}
+		std::string name;
+		bool        has_children;
+		bool        no_format;
+	};
+
+	FILE*                _file;
+	bool                 _error;
+	bool                 _tag_open;
+	size_t               _written;
+	std::string          _buf;
+	std::vector<Element> _stack;
+
+	typedef std::vector<std::pair<const XMLNode*, Filler> > Fillers;
+	Fillers _fillers;
+	Fillers _replacements;
+
+	void begin_child (bool element);
+	void escape (const std::string&, bool attribute);
+	void flush ();
+};
+
 class LIBPBD_API XMLException: public std::exception {
 public:
 	explicit XMLException(const std::string msg) : _message(msg) {}
@@ -24,6 +24,7 @@
 #include <sys/mman.h>
 #endif
 
+#include "pbd/memory_account.h"
 #include "pbd/reallocpool.h"
 
 #ifdef RAP_WITH_SEGMENT_STATS
@@ -85,6 +86,7 @@ ReallocPool::ReallocPool (std::string name, size_t bytes)
 #ifndef PLATFORM_WINDOWS
 	mlock (_pool, bytes);
 #endif
+	MemoryAccount::get ("lua").add (bytes);
 
 	poolsize_t *in = (poolsize_t*) _pool;
 	*in = - (bytes - sizeof (poolsize_t));
@@ -101,6 +103,7 @@ ReallocPool::~ReallocPool ()
 {
 	STATS_segment;
 	printstats ();
+	MemoryAccount::get ("lua").remove (_poolsize);
 	::free (_pool);
 	_pool = NULL;
 }
@@ -68,6 +68,14 @@ Stateful::~Stateful ()
 	delete _instant_xml;
 }
 
+void
+Stateful::write_state (XMLStreamWriter& writer)
+{
+	XMLNode& node (get_state ());
+	writer.node (node);
+	delete &node;
+}
+
 void
 Stateful::add_extra_xml (XMLNode& node)
 {
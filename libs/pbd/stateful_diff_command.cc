@@ -122,3 +122,10 @@ StatefulDiffCommand::empty () const
 {
 	return _changes->empty ();
 }
+
+size_t
+StatefulDiffCommand::memory_used () const
+{
+	/* each change is a map node holding a property with old and new value */
+	return Command::memory_used () + sizeof (PropertyList) + _changes->size () * 128;
+}
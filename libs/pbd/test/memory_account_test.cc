@@ -0,0 +1,133 @@
+#include "memory_account_test.h"
+#include "pbd/memory_account.h"
+
+CPPUNIT_TEST_SUITE_REGISTRATION (MemoryAccountTest);
+
+using namespace PBD;
+
+static int over_budget_calls = 0;
+
+static void
+over_budget ()
+{
+	++over_budget_calls;
+}
+
+void
+MemoryAccountTest::testCounters ()
+{
+	MemoryAccount& a (MemoryAccount::get ("test-counters"));
+
+	CPPUNIT_ASSERT (&a == &MemoryAccount::get ("test-counters"));
+	CPPUNIT_ASSERT_EQUAL ((int64_t) 0, a.used ());
+
+	a.add (1000);
+	a.add (500);
+	a.remove (1200);
+	CPPUNIT_ASSERT_EQUAL ((int64_t) 300, a.used ());
+	CPPUNIT_ASSERT_EQUAL ((int64_t) 1500, a.peak ());
+
+	a.change (300, 100);
+	CPPUNIT_ASSERT_EQUAL ((int64_t) 100, a.used ());
+	CPPUNIT_ASSERT_EQUAL ((int64_t) 1500, a.peak ());
+
+	a.remove (100);
+}
+
+void
+MemoryAccountTest::testBudgets ()
+{
+	MemoryAccount& a (MemoryAccount::get ("test-budget-a"));
+	MemoryAccount& b (MemoryAccount::get ("test-budget-b"));
+
+	ScopedConnection c;
+	a.OverBudget.connect_same_thread (c, &over_budget);
+
+	CPPUNIT_ASSERT (MemoryAccount::set_budgets ("test-budget-a=2K, test-budget-b = 1M"));
+	CPPUNIT_ASSERT_EQUAL ((int64_t) 2048, a.budget ());
+	CPPUNIT_ASSERT_EQUAL ((int64_t) 1048576, b.budget ());
+
+	/* invalid specs leave budgets alone */
+	CPPUNIT_ASSERT (!MemoryAccount::set_budgets ("test-budget-a"));
+	CPPUNIT_ASSERT (!MemoryAccount::set_budgets ("test-budget-a=12X"));
+	CPPUNIT_ASSERT_EQUAL ((int64_t) 2048, a.budget ());
+
+	a.add (2048);
+	CPPUNIT_ASSERT (!a.over_budget ());
+	MemoryAccount::check_budgets ();
+	CPPUNIT_ASSERT_EQUAL (0, over_budget_calls);
+
+	a.add (100);
+	CPPUNIT_ASSERT (a.over_budget ());
+	CPPUNIT_ASSERT_EQUAL ((int64_t) 100, a.excess ());
+	MemoryAccount::check_budgets ();
+	CPPUNIT_ASSERT_EQUAL (1, over_budget_calls);
+
+	/* unlisted accounts are unlimited */
+	CPPUNIT_ASSERT (MemoryAccount::set_budgets ("test-budget-b=1M"));
+	CPPUNIT_ASSERT_EQUAL ((int64_t) 0, a.budget ());
+	CPPUNIT_ASSERT (!a.over_budget ());
+	MemoryAccount::check_budgets ();
+	CPPUNIT_ASSERT_EQUAL (1, over_budget_calls);
+
+	CPPUNIT_ASSERT (MemoryAccount::set_budgets (""));
+	CPPUNIT_ASSERT_EQUAL ((int64_t) 0, b.budget ());
+
+	a.remove (2148);
+}
+
+void
+MemoryAccountTest::testLimit ()
+{
+	MemoryAccount& a (MemoryAccount::get ("test-limit"));
+
+	CPPUNIT_ASSERT (a.try_add (600, 1000));
+	CPPUNIT_ASSERT (a.try_add (400, 1000));
+	CPPUNIT_ASSERT (!a.try_add (1, 1000));
+	CPPUNIT_ASSERT_EQUAL ((int64_t) 1000, a.used ());
+
+	a.remove (500);
+	CPPUNIT_ASSERT (!a.try_add (600, 1000));
+	CPPUNIT_ASSERT (a.try_add (500, 1000));
+	CPPUNIT_ASSERT_EQUAL ((int64_t) 1000, a.used ());
+	CPPUNIT_ASSERT_EQUAL ((int64_t) 1000, a.peak ());
+
+	a.remove (1000);
+}
+
+void
+MemoryAccountTest::testBackoff ()
+{
+	MemoryAccount& a (MemoryAccount::get ("test-backoff"));
+
+	ScopedConnection c;
+	a.OverBudget.connect_same_thread (c, &over_budget);
+
+	a.set_budget (1000);
+	a.add (2000);
+
+	/* nothing is released, OverBudget is emitted less and less often */
+	over_budget_calls = 0;
+	for (int i = 0; i < 8; ++i) {
+		MemoryAccount::check_budgets ();
+	}
+	/* checks 1, 2, 4 and 7 */
+	CPPUNIT_ASSERT_EQUAL (4, over_budget_calls);
+
+	/* a new budget starts over */
+	a.set_budget (1500);
+	MemoryAccount::check_budgets ();
+	CPPUNIT_ASSERT_EQUAL (5, over_budget_calls);
+
+	/* so does staying within budget for long enough */
+	a.remove (1000);
+	for (unsigned int i = 0; i < MemoryAccount::max_backoff; ++i) {
+		MemoryAccount::check_budgets ();
+	}
+	a.add (1000);
+	MemoryAccount::check_budgets ();
+	CPPUNIT_ASSERT_EQUAL (6, over_budget_calls);
+
+	a.set_budget (0);
+	a.remove (2000);
+}
@@ -0,0 +1,19 @@
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+class MemoryAccountTest : public CppUnit::TestFixture
+{
+	CPPUNIT_TEST_SUITE (MemoryAccountTest);
+	CPPUNIT_TEST (testCounters);
+	CPPUNIT_TEST (testBudgets);
+	CPPUNIT_TEST (testLimit);
+	CPPUNIT_TEST (testBackoff);
+	CPPUNIT_TEST_SUITE_END ();
+
+public:
+	MemoryAccountTest () { }
+	void testCounters ();
+	void testBudgets ();
+	void testLimit ();
+	void testBackoff ();
+};
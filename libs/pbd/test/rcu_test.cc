@@ -7,6 +7,7 @@ using namespace std;
 RCUTest::RCUTest ()
 	: CppUnit::TestFixture ()
 	, _values (new Values)
+	, _epoch_values (new Values)
 {
 }
 
@@ -36,8 +37,41 @@ launch_writer(void* self)
 	return NULL;
 }
 
+static void*
+launch_epoch_reader(void* self)
+{
+	RCUTest* r = static_cast<RCUTest *>(self);
+	r->epoch_read_thread ();
+	return NULL;
+}
+
+static void*
+launch_epoch_writer(void* self)
+{
+	RCUTest* r = static_cast<RCUTest *>(self);
+	r->epoch_write_thread ();
+	return NULL;
+}
+
 void
 RCUTest::race ()
+{
+	run (launch_reader, launch_writer);
+}
+
+void
+RCUTest::epoch_race ()
+{
+	run (launch_epoch_reader, launch_epoch_writer);
+
+	/* all values but the current one have been reclaimed */
+	EpochRCUManager<Values>::ReadGuard rg (_epoch_values);
+	CPPUNIT_ASSERT (rg->empty ());
+	CPPUNIT_ASSERT (_epoch_values.reader ().use_count () == 2);
+}
+
+void
+RCUTest::run (void* (*reader) (void*), void* (*writer) (void*))
 {
 #ifdef __APPLE__
 	pthread_mutex_init (&_mutex, NULL);
@@ -50,8 +84,8 @@ RCUTest::race ()
 	pthread_t reader_thread;
 	pthread_t writer_thread;
 
-	CPPUNIT_ASSERT (pthread_create (&writer_thread, NULL, launch_writer, this) == 0);
-	CPPUNIT_ASSERT (pthread_create (&reader_thread, NULL, launch_reader, this) == 0);
+	CPPUNIT_ASSERT (pthread_create (&writer_thread, NULL, writer, this) == 0);
+	CPPUNIT_ASSERT (pthread_create (&reader_thread, NULL, reader, this) == 0);
 
 	void* return_value;
 	CPPUNIT_ASSERT (pthread_join (writer_thread, &return_value) == 0);
@@ -65,10 +99,8 @@ RCUTest::race ()
 #endif
 }
 
-/* ****************************************************************************/
-
 void
-RCUTest::read_thread ()
+RCUTest::sync ()
 {
 #ifdef __APPLE__
 	pthread_mutex_lock (&_mutex);
@@ -82,6 +114,14 @@ RCUTest::read_thread ()
 #else
 	pthread_barrier_wait (&_barrier);
 #endif
+}
+
+/* ****************************************************************************/
+
+void
+RCUTest::read_thread ()
+{
+	sync ();
 
 	for (int i = 0; i < 15000; ++i) {
 		boost::shared_ptr<Values> reader  = _values.reader ();
@@ -94,21 +134,43 @@ RCUTest::read_thread ()
 void
 RCUTest::write_thread ()
 {
-#ifdef __APPLE__
-	pthread_mutex_lock (&_mutex);
-	if (++_cnt == 2) {
-		pthread_cond_broadcast (&_cond);
-		pthread_mutex_unlock (&_mutex);
-	} else {
-		pthread_cond_wait (&_cond, &_mutex);
+	sync ();
+	write_values (_values);
+}
+
+void
+RCUTest::epoch_read_thread ()
+{
+	sync ();
+
+	for (int i = 0; i < 15000; ++i) {
+		if (i % 8) {
+			EpochRCUManager<Values>::ReadGuard rg (_epoch_values);
+			for (Values::const_iterator i = rg->begin (); i != rg->end(); ++i) {
+				CPPUNIT_ASSERT (i->first == i->second->val);
+			}
+		} else {
+			/* mix in shared_ptr readers, which end up on the dead wood list */
+			boost::shared_ptr<Values> reader  = _epoch_values.reader ();
+			for (Values::const_iterator i = reader->begin (); i != reader->end(); ++i) {
+				CPPUNIT_ASSERT (i->first == i->second->val);
+			}
+		}
 	}
-	pthread_mutex_unlock (&_mutex);
-#else
-	pthread_barrier_wait (&_barrier);
-#endif
+}
+
+void
+RCUTest::epoch_write_thread ()
+{
+	sync ();
+	write_values (_epoch_values);
+}
 
+template <class M> void
+RCUTest::write_values (M& values)
+{
 	for (int i = 0; i < 10000; ++i) {
-		RCUWriter<Values> writer (_values);
+		RCUWriter<Values> writer (values);
 		boost::shared_ptr<Values> w = writer.get_copy ();
 		char tmp [64];
 		sprintf (tmp, "foo %d", i);
@@ -117,7 +179,7 @@ RCUTest::write_thread ()
 
 	/* replace */
 	for (int i = 0; i < 2500; ++i) {
-		RCUWriter<Values> writer (_values);
+		RCUWriter<Values> writer (values);
 		boost::shared_ptr<Values> w = writer.get_copy ();
 
 		char tmp [64];
@@ -133,9 +195,9 @@ RCUTest::write_thread ()
 
 	/* clear */
 	{
-		RCUWriter<Values> writer (_values);
+		RCUWriter<Values> writer (values);
 		boost::shared_ptr<Values> w = writer.get_copy ();
 		w->clear ();
 	}
-	_values.flush ();
+	values.flush ();
 }
@@ -9,15 +9,19 @@ class RCUTest : public CppUnit::TestFixture
 {
 	CPPUNIT_TEST_SUITE (RCUTest);
 	CPPUNIT_TEST (race);
+	CPPUNIT_TEST (epoch_race);
 	CPPUNIT_TEST_SUITE_END ();
 
 public:
 	RCUTest ();
 	void setUp ();
 	void race ();
+	void epoch_race ();
 
 	void read_thread ();
 	void write_thread ();
+	void epoch_read_thread ();
+	void epoch_write_thread ();
 
 private:
 	class Value {
@@ -31,6 +35,12 @@ private:
 	typedef std::map<std::string, boost::shared_ptr<Value> > Values;
 
 	SerializedRCUManager<Values> _values;
+	EpochRCUManager<Values>      _epoch_values;
+
+	void run (void* (*reader) (void*), void* (*writer) (void*));
+	void sync ();
+
+	template <class M> void write_values (M&);
 
 #ifdef __APPLE__
 	pthread_mutex_t _mutex;
@@ -89,3 +89,101 @@ SignalsTest::testScopedConnectionList ()
 
 	CPPUNIT_ASSERT_EQUAL (1, N);
 }
+
+static PBD::ScopedConnection* victim = 0;
+
+static void
+disconnect_victim ()
+{
+	++N;
+	victim->disconnect ();
+}
+
+void
+SignalsTest::testDisconnectDuringEmission ()
+{
+	Emitter* e = new Emitter;
+	PBD::ScopedConnection c;
+	PBD::ScopedConnection d;
+
+	/* slots are called in the order they were connected */
+	e->Fred.connect_same_thread (c, boost::bind (&disconnect_victim));
+	e->Fred.connect_same_thread (d, boost::bind (&receiver));
+	victim = &d;
+
+	/* the second slot is disconnected by the first one, and must not be
+	 * called, even though it was connected when emission started.
+	 */
+	N = 0;
+	e->emit ();
+	CPPUNIT_ASSERT_EQUAL (1, N);
+	CPPUNIT_ASSERT (!e->Fred.empty ());
+
+	c.disconnect ();
+	CPPUNIT_ASSERT (e->Fred.empty ());
+
+	N = 0;
+	e->emit ();
+	CPPUNIT_ASSERT_EQUAL (0, N);
+
+	delete e;
+}
+
+/** Counts its live copies, to check when a signal releases a slot */
+class Tracked {
+public:
+	Tracked () { ++alive; }
+	Tracked (Tracked const&) { ++alive; }
+	~Tracked () { --alive; }
+
+	void operator() () const {
+		++N;
+	}
+
+	static int alive;
+};
+
+int Tracked::alive = 0;
+
+static void
+disconnect_tracked ()
+{
+	victim->disconnect ();
+	/* still in use by this emission */
+	CPPUNIT_ASSERT (Tracked::alive > 0);
+}
+
+void
+SignalsTest::testSlotRelease ()
+{
+	Emitter* e = new Emitter;
+	PBD::ScopedConnection c;
+	PBD::ScopedConnection d;
+
+	/* without an emission in progress, the slot is released on disconnect */
+	e->Fred.connect_same_thread (c, Tracked ());
+	N = 0;
+	e->emit ();
+	CPPUNIT_ASSERT_EQUAL (1, N);
+	CPPUNIT_ASSERT (Tracked::alive > 0);
+
+	c.disconnect ();
+	CPPUNIT_ASSERT_EQUAL (0, Tracked::alive);
+
+	/* during emission, it is released by the next reclaim after the
+	 * emission has finished, never by the emitting thread itself.
+	 */
+	e->Fred.connect_same_thread (d, boost::bind (&disconnect_tracked));
+	e->Fred.connect_same_thread (c, Tracked ());
+	victim = &c;
+
+	N = 0;
+	e->emit ();
+	CPPUNIT_ASSERT_EQUAL (0, N);
+	CPPUNIT_ASSERT (Tracked::alive > 0);
+
+	PBD::Epoch::reclaim ();
+	CPPUNIT_ASSERT_EQUAL (0, Tracked::alive);
+
+	delete e;
+}
@@ -7,6 +7,8 @@ class SignalsTest : public CppUnit::TestFixture
 	CPPUNIT_TEST (testEmission);
 	CPPUNIT_TEST (testDestruction);
 	CPPUNIT_TEST (testScopedConnectionList);
+	CPPUNIT_TEST (testDisconnectDuringEmission);
+	CPPUNIT_TEST (testSlotRelease);
 	CPPUNIT_TEST_SUITE_END ();
 
 public:
@@ -14,4 +16,6 @@ public:
 	void testEmission ();
 	void testDestruction ();
 	void testScopedConnectionList ();
+	void testDisconnectDuringEmission ();
+	void testSlotRelease ();
 };
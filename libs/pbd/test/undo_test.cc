@@ -0,0 +1,250 @@
+#include "undo_test.h"
+#include "pbd/memory_account.h"
+#include "pbd/undo.h"
+
+CPPUNIT_TEST_SUITE_REGISTRATION (UndoTest);
+
+using namespace std;
+
+static UndoTransaction*
+transaction (std::string const& name)
+{
+	UndoTransaction* ut = new UndoTransaction ();
+	ut->set_name (name);
+	return ut;
+}
+
+class SizedCommand : public Command
+{
+public:
+	SizedCommand (size_t bytes) : _bytes (bytes) {}
+	~SizedCommand () { drop_references (); }
+
+	void operator() () {}
+	void undo () {}
+
+	size_t memory_used () const { return _bytes; }
+
+private:
+	size_t _bytes;
+};
+
+static std::vector<std::string>
+names (std::list<UndoTransaction*> const& l)
+{
+	std::vector<std::string> rv;
+	for (std::list<UndoTransaction*>::const_iterator i = l.begin (); i != l.end (); ++i) {
+		rv.push_back ((*i)->name ());
+	}
+	return rv;
+}
+
+void
+UndoTest::testChangesSinceSave ()
+{
+	UndoHistory h;
+	uint32_t drop;
+	uint32_t keep;
+	std::list<UndoTransaction*> added;
+
+	h.add (transaction ("a"));
+	h.add (transaction ("b"));
+	h.add (transaction ("c"));
+
+	/* nothing saved yet */
+	h.changes_since_save (10, drop, keep, added);
+	CPPUNIT_ASSERT_EQUAL ((uint32_t) 0, drop);
+	CPPUNIT_ASSERT_EQUAL ((uint32_t) 0, keep);
+	CPPUNIT_ASSERT_EQUAL ((size_t) 3, added.size ());
+
+	h.mark_saved (10);
+	CPPUNIT_ASSERT_EQUAL ((uint32_t) 3, h.saved_size ());
+
+	h.changes_since_save (10, drop, keep, added);
+	CPPUNIT_ASSERT_EQUAL ((uint32_t) 0, drop);
+	CPPUNIT_ASSERT_EQUAL ((uint32_t) 3, keep);
+	CPPUNIT_ASSERT (added.empty ());
+
+	/* undo one, then add two */
+	h.undo (1);
+	h.add (transaction ("d"));
+	h.add (transaction ("e"));
+
+	h.changes_since_save (10, drop, keep, added);
+	CPPUNIT_ASSERT_EQUAL ((uint32_t) 0, drop);
+	CPPUNIT_ASSERT_EQUAL ((uint32_t) 2, keep);
+	CPPUNIT_ASSERT_EQUAL (string ("d"), names (added)[0]);
+	CPPUNIT_ASSERT_EQUAL (string ("e"), names (added)[1]);
+
+	h.mark_saved (10);
+
+	/* only the most recent 2 are saved */
+	h.changes_since_save (2, drop, keep, added);
+	CPPUNIT_ASSERT_EQUAL ((uint32_t) 2, drop);
+	CPPUNIT_ASSERT_EQUAL ((uint32_t) 2, keep);
+	CPPUNIT_ASSERT (added.empty ());
+
+	/* depth limit */
+	h.set_depth (3);
+	h.add (transaction ("f"));
+
+	h.changes_since_save (10, drop, keep, added);
+	CPPUNIT_ASSERT_EQUAL ((uint32_t) 2, drop);
+	CPPUNIT_ASSERT_EQUAL ((uint32_t) 2, keep);
+	CPPUNIT_ASSERT_EQUAL ((size_t) 1, added.size ());
+	CPPUNIT_ASSERT_EQUAL (string ("f"), names (added)[0]);
+
+	h.clear ();
+}
+
+static int loads = 0;
+
+static std::vector<UndoTransaction*>
+load_abc ()
+{
+	++loads;
+	std::vector<UndoTransaction*> rv;
+	rv.push_back (transaction ("a"));
+	rv.push_back (0); /* failed to load */
+	rv.push_back (transaction ("c"));
+	return rv;
+}
+
+void
+UndoTest::testDeferred ()
+{
+	UndoHistory h;
+	uint32_t drop;
+	uint32_t keep;
+	std::list<UndoTransaction*> added;
+
+	loads = 0;
+
+	h.set_deferred (3, "c", &load_abc);
+
+	CPPUNIT_ASSERT (h.deferred ());
+	CPPUNIT_ASSERT_EQUAL ((unsigned long) 3, h.undo_depth ());
+	CPPUNIT_ASSERT_EQUAL (string ("c"), h.next_undo ());
+
+	/* deferred transactions are saved */
+	h.changes_since_save (10, drop, keep, added);
+	CPPUNIT_ASSERT_EQUAL ((uint32_t) 0, drop);
+	CPPUNIT_ASSERT_EQUAL ((uint32_t) 3, keep);
+	CPPUNIT_ASSERT (added.empty ());
+
+	/* adding and undoing recent transactions does not load */
+	h.add (transaction ("d"));
+	h.add (transaction ("e"));
+	h.undo (1);
+	CPPUNIT_ASSERT_EQUAL ((unsigned long) 4, h.undo_depth ());
+	CPPUNIT_ASSERT_EQUAL (string ("d"), h.next_undo ());
+
+	h.changes_since_save (10, drop, keep, added);
+	CPPUNIT_ASSERT_EQUAL ((uint32_t) 0, drop);
+	CPPUNIT_ASSERT_EQUAL ((uint32_t) 3, keep);
+	CPPUNIT_ASSERT_EQUAL ((size_t) 1, added.size ());
+	h.mark_saved (10);
+
+	CPPUNIT_ASSERT_EQUAL (0, loads);
+
+	/* undoing beyond them does */
+	h.undo (2);
+	CPPUNIT_ASSERT_EQUAL (1, loads);
+	CPPUNIT_ASSERT (!h.deferred ());
+	CPPUNIT_ASSERT_EQUAL ((unsigned long) 1, h.undo_depth ());
+	CPPUNIT_ASSERT_EQUAL (string ("a"), h.next_undo ());
+
+	/* "b" failed to load and is gone */
+	h.changes_since_save (10, drop, keep, added);
+	CPPUNIT_ASSERT_EQUAL ((uint32_t) 0, drop);
+	CPPUNIT_ASSERT_EQUAL ((uint32_t) 1, keep);
+	CPPUNIT_ASSERT (added.empty ());
+
+	h.redo (2);
+	h.changes_since_save (10, drop, keep, added);
+	CPPUNIT_ASSERT_EQUAL ((uint32_t) 0, drop);
+	CPPUNIT_ASSERT_EQUAL ((uint32_t) 1, keep);
+	CPPUNIT_ASSERT_EQUAL ((size_t) 2, added.size ());
+	CPPUNIT_ASSERT_EQUAL (string ("c"), names (added)[0]);
+	CPPUNIT_ASSERT_EQUAL (string ("d"), names (added)[1]);
+
+	/* dropped by the depth limit before being loaded */
+	h.set_deferred (3, "c", &load_abc);
+	h.set_depth (2);
+	CPPUNIT_ASSERT_EQUAL ((unsigned long) 2, h.undo_depth ());
+	h.undo (2);
+	CPPUNIT_ASSERT_EQUAL (2, loads);
+	CPPUNIT_ASSERT_EQUAL ((unsigned long) 0, h.undo_depth ());
+	CPPUNIT_ASSERT_EQUAL ((unsigned long) 1, h.redo_depth ());
+
+	h.clear ();
+}
+
+static std::vector<UndoTransaction*>
+load_nothing ()
+{
+	++loads;
+	return std::vector<UndoTransaction*> ();
+}
+
+void
+UndoTest::testDeferredFailure ()
+{
+	UndoHistory h;
+
+	loads = 0;
+
+	/* a loader that fails leaves the transactions deferred */
+	h.set_deferred (3, "c", &load_nothing);
+	CPPUNIT_ASSERT (!h.load_deferred ());
+	CPPUNIT_ASSERT_EQUAL (1, loads);
+	CPPUNIT_ASSERT (h.deferred ());
+	CPPUNIT_ASSERT_EQUAL ((unsigned long) 3, h.undo_depth ());
+
+	/* they use no memory, so they are only dropped when loaded
+	 * transactions have to go.
+	 */
+	h.add (transaction ("d"));
+	h.reduce_memory (1000);
+	CPPUNIT_ASSERT (h.deferred ());
+	CPPUNIT_ASSERT_EQUAL ((unsigned long) 4, h.undo_depth ());
+
+	h.add (transaction ("e"));
+	h.reduce_memory (1);
+	CPPUNIT_ASSERT (!h.deferred ());
+	CPPUNIT_ASSERT_EQUAL ((unsigned long) 1, h.undo_depth ());
+	CPPUNIT_ASSERT_EQUAL (string ("e"), h.next_undo ());
+
+	h.clear ();
+}
+
+void
+UndoTest::testMemory ()
+{
+	PBD::MemoryAccount& account (PBD::MemoryAccount::get ("undo-history"));
+	int64_t const       base = account.used ();
+	int64_t const       one  = sizeof (UndoTransaction) + 1000;
+
+	UndoHistory h;
+
+	for (int i = 0; i < 4; ++i) {
+		UndoTransaction* ut = transaction ("m");
+		ut->add_command (new SizedCommand (1000));
+		h.add (ut);
+	}
+
+	CPPUNIT_ASSERT_EQUAL (base + 4 * one, account.used ());
+
+	/* oldest transactions go first, until enough was released */
+	h.reduce_memory (one + 1);
+	CPPUNIT_ASSERT_EQUAL ((unsigned long) 2, h.undo_depth ());
+	CPPUNIT_ASSERT_EQUAL (base + 2 * one, account.used ());
+
+	/* the most recent transaction is always kept */
+	h.reduce_memory (100 * one);
+	CPPUNIT_ASSERT_EQUAL ((unsigned long) 1, h.undo_depth ());
+	CPPUNIT_ASSERT_EQUAL (base + one, account.used ());
+
+	h.clear ();
+	CPPUNIT_ASSERT_EQUAL (base, account.used ());
+}
@@ -0,0 +1,19 @@
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+class UndoTest : public CppUnit::TestFixture
+{
+	CPPUNIT_TEST_SUITE (UndoTest);
+	CPPUNIT_TEST (testChangesSinceSave);
+	CPPUNIT_TEST (testDeferred);
+	CPPUNIT_TEST (testDeferredFailure);
+	CPPUNIT_TEST (testMemory);
+	CPPUNIT_TEST_SUITE_END ();
+
+public:
+	UndoTest () { }
+	void testChangesSinceSave ();
+	void testDeferred ();
+	void testDeferredFailure ();
+	void testMemory ();
+};
@@ -14,6 +14,8 @@
 
 #include <sstream>
 
+#include <boost/bind.hpp>
+
 #include <glibmm/miscutils.h>
 #include <glibmm/fileutils.h>
 #include <glibmm/convert.h>
@@ -304,3 +306,166 @@ XMLTest::testPerfLargeXMLDocument ()
 
 	test_xml_document ("testPerfLargeXMLDocument", node_options);
 }
+
+static void
+write_test_children (XMLStreamWriter& writer, int count)
+{
+	for (int i = 0; i < count; ++i) {
+		writer.start_element ("Streamed");
+		writer.attribute ("index", i);
+		writer.end_element ();
+	}
+}
+
+void
+XMLTest::testStreamWriterFormat ()
+{
+	std::string session_file;
+	CPPUNIT_ASSERT (find_file (test_search_path (), "TestSession.ardour", session_file));
+
+	const string output_dir = test_output_directory ("StreamWriterFormat");
+	const string libxml_path = Glib::build_filename (output_dir, "libxml.xml");
+	const string stream_path = Glib::build_filename (output_dir, "stream.xml");
+
+	/* reference: what libxml2 writes for the same document */
+	xmlKeepBlanksDefault(0);
+	xmlDocPtr doc = xmlParseFile (session_file.c_str ());
+	CPPUNIT_ASSERT (doc);
+	CPPUNIT_ASSERT (xmlSaveFormatFileEnc (libxml_path.c_str (), doc, "UTF-8", 1) != -1);
+	xmlFreeDoc (doc);
+
+	XMLTree tree (session_file);
+	CPPUNIT_ASSERT (tree.root ());
+
+	XMLStreamWriter writer (stream_path);
+	CPPUNIT_ASSERT (writer.ok ());
+	writer.node (*tree.root ());
+	CPPUNIT_ASSERT (writer.close ());
+
+	CPPUNIT_ASSERT (Glib::file_get_contents (stream_path) == Glib::file_get_contents (libxml_path));
+}
+
+void
+XMLTest::testStreamWriterElements ()
+{
+	const string output_dir = test_output_directory ("StreamWriterElements");
+	const string path = Glib::build_filename (output_dir, "elements.xml");
+
+	const string special ("a<b>c&d\"e'f\ng\rh\ti");
+
+	XMLNode list ("List");
+	list.add_child ("First");
+	XMLNode* placeholder = list.add_child ("Placeholder");
+	list.add_child ("Last");
+
+	{
+		XMLStreamWriter writer (path);
+		writer.start_element ("Root");
+		writer.attribute ("name", special);
+		writer.add_filler (&list, boost::bind (&write_test_children, _1, 3));
+		writer.replace (placeholder, boost::bind (&write_test_children, _1, 2));
+		writer.node (list);
+		writer.start_element ("Text");
+		writer.attribute ("value", 1.5);
+		writer.content (special);
+		/* close() ends Text and Root */
+		CPPUNIT_ASSERT (writer.close ());
+	}
+
+	XMLTree tree (path);
+	XMLNode* root = tree.root ();
+	CPPUNIT_ASSERT (root);
+
+	std::string value;
+	CPPUNIT_ASSERT (root->get_property ("name", value));
+	CPPUNIT_ASSERT_EQUAL (special, value);
+
+	XMLNode* l = root->child ("List");
+	CPPUNIT_ASSERT (l);
+	CPPUNIT_ASSERT_EQUAL ((size_t) 7, l->children ().size ());
+	CPPUNIT_ASSERT_EQUAL (std::string ("First"), l->children ().front ()->name ());
+
+	/* the placeholder is replaced in place, the filler comes last */
+	XMLNodeConstIterator c = l->children ().begin ();
+	std::advance (c, 2);
+	int index = -1;
+	CPPUNIT_ASSERT_EQUAL (std::string ("Streamed"), (*c)->name ());
+	CPPUNIT_ASSERT ((*c)->get_property ("index", index));
+	CPPUNIT_ASSERT_EQUAL (1, index);
+	++c;
+	CPPUNIT_ASSERT_EQUAL (std::string ("Last"), (*c)->name ());
+
+	CPPUNIT_ASSERT (l->children ().back ()->get_property ("index", index));
+	CPPUNIT_ASSERT_EQUAL (2, index);
+
+	XMLNode* text = root->child ("Text");
+	CPPUNIT_ASSERT (text);
+	double v = 0;
+	CPPUNIT_ASSERT (text->get_property ("value", v));
+	CPPUNIT_ASSERT_EQUAL (1.5, v);
+	CPPUNIT_ASSERT (!text->children ().empty ());
+	CPPUNIT_ASSERT_EQUAL (special, text->children ().front ()->content ());
+}
+
+void
+XMLTest::testStreamingRead ()
+{
+	std::string session_file;
+	CPPUNIT_ASSERT (find_file (test_search_path (), "TestSession.ardour", session_file));
+
+	TimingData dom_timing, sax_timing;
+
+	for (uint32_t iter = 0; iter < test_iterations; ++iter) {
+		XMLTree dom;
+		XMLTree sax;
+
+		dom_timing.start_timing ();
+		CPPUNIT_ASSERT (dom.read (session_file));
+		dom_timing.add_elapsed ();
+
+		sax_timing.start_timing ();
+		CPPUNIT_ASSERT (sax.read_streaming (session_file));
+		sax_timing.add_elapsed ();
+
+		CPPUNIT_ASSERT (*dom.root () == *sax.root ());
+	}
+
+	std::cerr << std::endl;
+	std::cerr << "   read : " << dom_timing.summary ();
+	std::cerr << "   read_streaming : " << sax_timing.summary ();
+
+	/* whitespace, entities, mixed content, comments and CDATA */
+	const string path = Glib::build_filename (test_output_directory ("StreamingRead"), "mixed.xml");
+
+	Glib::file_set_contents (path,
+		"<?xml version=\"1.0\"?>\n"
+		"<Root a=\"x &amp; y &lt; &#38; &amp;#38; &quot;q&quot;\" b='&#10;z'>\n"
+		"  <Empty/>\n"
+		"  <Blank>   </Blank>\n"
+		"  <Text>hello &amp; bye</Text>\n"
+		"  <Mixed>text <b>bold</b>  <i/> tail </Mixed>\n"
+		"  <Mixed2><b/>  mid  <i/>  </Mixed2>\n"
+		"  <!-- comment -->\n"
+		"  <C><![CDATA[x<y]]><![CDATA[z]]>after</C>\n"
+		"  <Lead>\n\n    <x/>\n  </Lead>\n"
+		"</Root>\n");
+
+	XMLTree dom;
+	XMLTree sax;
+
+	CPPUNIT_ASSERT (dom.read (path));
+	CPPUNIT_ASSERT (sax.read_streaming (path));
+	CPPUNIT_ASSERT (*dom.root () == *sax.root ());
+
+	std::string value;
+	CPPUNIT_ASSERT (sax.root ()->get_property ("a", value));
+	CPPUNIT_ASSERT_EQUAL (std::string ("x & y < & &#38; \"q\""), value);
+
+	/* find() works without the libxml2 document */
+	CPPUNIT_ASSERT_EQUAL ((size_t) 2, sax.find ("//b")->size ());
+
+	/* malformed files are rejected */
+	Glib::file_set_contents (path, "<Root><Child></Root>");
+	CPPUNIT_ASSERT (!sax.read_streaming (path));
+	CPPUNIT_ASSERT (!sax.root ());
+}
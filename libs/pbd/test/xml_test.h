@@ -8,6 +8,9 @@ class XMLTest : public CppUnit::TestFixture
 	CPPUNIT_TEST (testPerfSmallXMLDocument);
 	CPPUNIT_TEST (testPerfMediumXMLDocument);
 	CPPUNIT_TEST (testPerfLargeXMLDocument);
+	CPPUNIT_TEST (testStreamWriterFormat);
+	CPPUNIT_TEST (testStreamWriterElements);
+	CPPUNIT_TEST (testStreamingRead);
 	CPPUNIT_TEST_SUITE_END ();
 
 public:
@@ -15,4 +18,7 @@ public:
 	void testPerfSmallXMLDocument ();
 	void testPerfMediumXMLDocument ();
 	void testPerfLargeXMLDocument ();
+	void testStreamWriterFormat ();
+	void testStreamWriterElements ();
+	void testStreamingRead ();
 };
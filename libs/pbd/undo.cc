@@ -21,35 +21,73 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include <algorithm>
 #include <sstream>
 #include <string>
 #include <time.h>
 
+#include <glib.h>
+
+#include "pbd/g_atomic_compat.h"
+#include "pbd/memory_account.h"
 #include "pbd/undo.h"
 #include "pbd/xml++.h"
 
 using namespace std;
 using namespace sigc;
 
+static GATOMIC_QUAL gint undo_transaction_serial = 0;
+
+static PBD::MemoryAccount&
+undo_account ()
+{
+	static PBD::MemoryAccount& account (PBD::MemoryAccount::get ("undo-history"));
+	return account;
+}
+
+/** Reserve @param n serials.
+ * @return the last one
+ */
+uint32_t
+UndoTransaction::next_serial (uint32_t n)
+{
+	return (uint32_t) g_atomic_int_add (&undo_transaction_serial, (gint) n) + n;
+}
+
 UndoTransaction::UndoTransaction ()
 	: _clearing (false)
+	, _serial (next_serial ())
+	, _memory (0)
 {
 	gettimeofday (&_timestamp, 0);
+	account (sizeof (UndoTransaction));
 }
 
 UndoTransaction::UndoTransaction (const UndoTransaction& rhs)
 	: Command (rhs._name)
 	, _clearing (false)
+	, _serial (next_serial ())
+	, _memory (0)
 {
 	_timestamp = rhs._timestamp;
+	account (sizeof (UndoTransaction));
 	clear ();
 	actions.insert (actions.end (), rhs.actions.begin (), rhs.actions.end ());
+	account (rhs._memory - (int64_t) sizeof (UndoTransaction));
 }
 
 UndoTransaction::~UndoTransaction ()
 {
 	drop_references ();
 	clear ();
+	account (-_memory);
+}
+
+void
+UndoTransaction::account (int64_t bytes)
+{
+	_memory += bytes;
+	undo_account ().add (bytes);
 }
 
 static void
@@ -75,6 +113,7 @@ UndoTransaction::operator= (const UndoTransaction& rhs)
 	_name = rhs._name;
 	clear ();
 	actions.insert (actions.end (), rhs.actions.begin (), rhs.actions.end ());
+	account (rhs._memory - (int64_t) sizeof (UndoTransaction));
 	return *this;
 }
 
@@ -88,6 +127,7 @@ UndoTransaction::add_command (Command* const cmd)
 
 	cmd->DropReferences.connect_same_thread (*this, boost::bind (&command_death, this, cmd));
 	actions.push_back (cmd);
+	account (cmd->memory_used ());
 }
 
 void
@@ -98,6 +138,7 @@ UndoTransaction::remove_command (Command* const action)
 		return;
 	}
 	actions.erase (i);
+	account (-std::min<int64_t> (action->memory_used (), _memory - (int64_t) sizeof (UndoTransaction)));
 	delete action;
 }
 
@@ -115,6 +156,7 @@ UndoTransaction::clear ()
 		delete *i;
 	}
 	actions.clear ();
+	account ((int64_t) sizeof (UndoTransaction) - _memory);
 	_clearing = false;
 }
 
@@ -176,14 +218,66 @@ private:
 
 UndoHistory::UndoHistory ()
 {
-	_clearing = false;
-	_depth    = 0;
+	_clearing     = false;
+	_depth        = 0;
+	_n_deferred   = 0;
+	_deferred_end = 0;
+}
+
+void
+UndoHistory::drop_oldest (uint32_t n)
+{
+	/* deferred transactions are the oldest ones, they are simply
+	 * not going to be loaded.
+	 */
+	uint32_t const d = std::min (n, _n_deferred);
+
+	_n_deferred -= d;
+	n -= d;
+
+	if (_n_deferred == 0) {
+		_deferred_loader.clear ();
+	}
+
+	while (n-- && !UndoList.empty ()) {
+		UndoTransaction* ut = UndoList.front ();
+		UndoList.pop_front ();
+		delete ut;
+	}
+}
+
+/** Drop the oldest transactions until at least @param bytes of memory
+ * are released. The most recent transaction is always kept.
+ */
+void
+UndoHistory::reduce_memory (size_t bytes)
+{
+	if (bytes == 0 || UndoList.size () < 2) {
+		/* nothing can be released */
+		return;
+	}
+
+	/* deferred transactions are not loaded, so they use no memory,
+	 * but they precede all transactions in UndoList.
+	 */
+	drop_oldest (_n_deferred);
+
+	size_t freed = 0;
+
+	while (freed < bytes && UndoList.size () > 1) {
+		UndoTransaction* ut = UndoList.front ();
+		freed += ut->memory_used ();
+		UndoList.pop_front ();
+		delete ut;
+	}
+
+	Changed (); /* EMIT SIGNAL */
 }
 
 void
 UndoHistory::set_depth (uint32_t d)
 {
-	uint32_t current_depth = UndoList.size ();
+	uint32_t current_depth = undo_depth ();
 
 	_depth = d;
 
@@ -193,20 +287,14 @@ UndoHistory::set_depth (uint32_t d)
 	}
 
 	if (_depth > 0) {
-		uint32_t cnt = current_depth - d;
-
-		while (cnt--) {
-			UndoTransaction* ut = UndoList.front ();
-			UndoList.pop_front ();
-			delete ut;
-		}
+		drop_oldest (current_depth - d);
 	}
 }
 
 void
 UndoHistory::add (UndoTransaction* const ut)
 {
-	uint32_t current_depth = UndoList.size ();
+	uint32_t current_depth = undo_depth ();
 
 	ut->DropReferences.connect_same_thread (*this, boost::bind (&UndoHistory::remove, this, ut));
 
@@ -216,14 +304,7 @@ UndoHistory::add (UndoTransaction* const ut)
 		 */
 
 	if ((_depth > 0) && current_depth && (current_depth >= _depth)) {
-		uint32_t cnt = 1 + (current_depth - _depth);
-
-		while (cnt--) {
-			UndoTransaction* ut;
-			ut = UndoList.front ();
-			UndoList.pop_front ();
-			delete ut;
-		}
+		drop_oldest (1 + (current_depth - _depth));
 	}
 
 	UndoList.push_back (ut);
@@ -267,6 +348,9 @@ UndoHistory::undo (unsigned int n)
 		UndoRedoSignaller exception_safe_signaller (*this);
 
 		while (n--) {
+			if (UndoList.size () == 0) {
+				load_deferred ();
+			}
 			if (UndoList.size () == 0) {
 				return;
 			}
@@ -327,6 +411,9 @@ UndoHistory::clear_undo ()
 	UndoList.clear ();
 	_clearing = false;
 
+	_n_deferred = 0;
+	_deferred_loader.clear ();
+
 	Changed (); /* EMIT SIGNAL */
 }
 
@@ -344,6 +431,10 @@ UndoHistory::get_state (int32_t depth)
 {
 	XMLNode* node = new XMLNode ("UndoHistory");
 
+	if (depth < 0 || (uint32_t) depth > UndoList.size ()) {
+		load_deferred ();
+	}
+
 	if (depth == 0) {
 		return (*node);
 
@@ -370,3 +461,175 @@ UndoHistory::get_state (int32_t depth)
 
 	return *node;
 }
+
+void
+UndoHistory::recent_serials (uint32_t depth, std::vector<std::pair<uint32_t, UndoTransaction*> >& serials) const
+{
+	/* the most recent @param depth transactions, oldest first. Deferred
+	 * transactions have no UndoTransaction (yet).
+	 */
+	uint32_t const n = std::min ((unsigned long) depth, undo_depth ());
+
+	serials.clear ();
+	serials.reserve (n);
+
+	uint32_t skip = undo_depth () - n;
+
+	for (uint32_t s = _deferred_end - _n_deferred; s != _deferred_end; ++s) {
+		if (skip) {
+			--skip;
+			continue;
+		}
+		serials.push_back (std::make_pair (s, (UndoTransaction*) 0));
+	}
+
+	for (list<UndoTransaction*>::const_iterator it = UndoList.begin (); it != UndoList.end (); ++it) {
+		if (skip) {
+			--skip;
+			continue;
+		}
+		serials.push_back (std::make_pair ((*it)->serial (), *it));
+	}
+}
+
+void
+UndoHistory::changes_since_save (uint32_t depth, uint32_t& drop, uint32_t& keep, std::list<UndoTransaction*>& added)
+{
+	std::vector<std::pair<uint32_t, UndoTransaction*> > now;
+	recent_serials (depth, now);
+
+	/* transactions only ever leave the front of the saved list
+	 * (depth limit) or its back (undo), and new ones are added at
+	 * the back, so the saved list is edited by removing a prefix,
+	 * truncating and appending.
+	 */
+
+	drop = _saved.size ();
+	keep = 0;
+
+	if (!now.empty ()) {
+		std::vector<uint32_t>::const_iterator i = std::find (_saved.begin (), _saved.end (), now.front ().first);
+		if (i != _saved.end ()) {
+			drop = i - _saved.begin ();
+			while (i != _saved.end () && keep < now.size () && *i == now[keep].first) {
+				++i;
+				++keep;
+			}
+		}
+	}
+
+	added.clear ();
+
+	for (size_t n = keep; n < now.size (); ++n) {
+		if (!now[n].second) {
+			/* a deferred transaction that is not part of the saved
+			 * list; cannot happen unless the saved list was changed
+			 * behind our back.
+			 */
+			if (load_deferred ()) {
+				changes_since_save (depth, drop, keep, added);
+				return;
+			}
+			continue;
+		}
+		added.push_back (now[n].second);
+	}
+}
+
+void
+UndoHistory::mark_saved (uint32_t depth)
+{
+	std::vector<std::pair<uint32_t, UndoTransaction*> > now;
+	recent_serials (depth, now);
+
+	_saved.clear ();
+	_saved.reserve (now.size ());
+
+	for (size_t n = 0; n < now.size (); ++n) {
+		_saved.push_back (now[n].first);
+	}
+}
+
+void
+UndoHistory::set_deferred (uint32_t n, std::string const& next, DeferredLoader loader)
+{
+	clear ();
+
+	if (n == 0) {
+		return;
+	}
+
+	/* reserve serials for the deferred transactions, they are handed
+	 * over to the transactions once these are loaded.
+	 */
+	_deferred_end = UndoTransaction::next_serial (n) + 1;
+
+	_n_deferred      = n;
+	_deferred_next   = next;
+	_deferred_loader = loader;
+
+	_saved.clear ();
+	for (uint32_t s = _deferred_end - n; s != _deferred_end; ++s) {
+		_saved.push_back (s);
+	}
+
+	if (_depth > 0 && _n_deferred > _depth) {
+		drop_oldest (_n_deferred - _depth);
+	}
+
+	Changed (); /* EMIT SIGNAL */
+}
+
+bool
+UndoHistory::load_deferred ()
+{
+	if (_n_deferred == 0) {
+		return true;
+	}
+
+	DeferredLoader loader;
+	loader.swap (_deferred_loader);
+
+	uint32_t const n = _n_deferred;
+	_n_deferred = 0;
+
+	std::vector<UndoTransaction*> loaded (loader ());
+
+	if (loaded.size () < n) {
+		/* e.g. the file could not be read, keep them deferred */
+		for (size_t i = 0; i < loaded.size (); ++i) {
+			delete loaded[i];
+		}
+		_n_deferred = n;
+		_deferred_loader.swap (loader);
+		return false;
+	}
+
+	/* only the most recent n of them are still part of the history,
+	 * the others have been dropped because of the depth limit.
+	 */
+	size_t const first = loaded.size () > n ? loaded.size () - n : 0;
+
+	for (size_t i = 0; i < first; ++i) {
+		delete loaded[i];
+	}
+
+	list<UndoTransaction*> older;
+	uint32_t               serial = _deferred_end - (loaded.size () - first);
+
+	for (size_t i = first; i < loaded.size (); ++i, ++serial) {
+		UndoTransaction* ut = loaded[i];
+		if (!ut) {
+			continue;
+		}
+		ut->_serial = serial;
+		ut->DropReferences.connect_same_thread (*this, boost::bind (&UndoHistory::remove, this, ut));
+		older.push_back (ut);
+	}
+
+	UndoList.splice (UndoList.begin (), older);
+
+	Changed (); /* EMIT SIGNAL */
+
+	return true;
+}
@@ -6,10 +6,14 @@
  */
 
 #include <string.h>
+#include <algorithm>
 #include <iostream>
 
+#include <glib/gstdio.h>
+
 #include "pbd/xml++.h"
 
+#include <libxml/SAX2.h>
 #include <libxml/debugXML.h>
 #include <libxml/xpath.h>
 #include <libxml/xpathInternals.h>
@@ -123,6 +127,332 @@ XMLTree::read_internal(bool validate)
 	return true;
 }
 
+/* Streaming reader.
+ *
+ * read_internal() has libxml2 build a complete document, which is then
+ * copied into XMLNodes and freed. For large files (sessions with a lot of
+ * automation easily reach tens of MB) most of the time is spent allocating
+ * and freeing the intermediate libxml2 nodes, attributes and text nodes.
+ *
+ * read_streaming() instead runs the SAX2 parser over the file and creates
+ * XMLNodes from the callbacks. The result is identical to readnode() on the
+ * libxml2 document (see flush_text() for whitespace).
+ */
+
+namespace {
+
+struct SAXReader
+{
+	SAXReader () : root (0), text_blank (true), cdata (false)
+	{
+		names.resize (name_cache_size);
+	}
+
+	~SAXReader ()
+	{
+		/* only set if parsing failed */
+		delete root;
+	}
+
+	XMLNode*              root;
+	std::vector<XMLNode*> stack;
+	std::vector<bool>     mixed; ///< per open element: has non-blank text
+
+	/* character data not yet added to the current element */
+	std::string text;
+	bool        text_blank;
+	bool        cdata;
+
+	/* element and attribute names are interned in the parser's dictionary,
+	 * so the same name always has the same address. Cache the std::string
+	 * for each of them instead of converting the same names over and over.
+	 */
+	static const size_t name_cache_size = 512;
+	std::vector<std::pair<const xmlChar*, std::string> > names;
+
+	const std::string& name (const xmlChar* n)
+	{
+		std::pair<const xmlChar*, std::string>& e (names[(((uintptr_t) n) >> 3) % name_cache_size]);
+		if (e.first != n) {
+			e.first = n;
+			e.second = (const char*) n;
+		}
+		return e.second;
+	}
+
+	void add_child (XMLNode* n)
+	{
+		if (stack.empty ()) {
+			/* outside of the root element */
+			delete n;
+		} else {
+			stack.back()->add_child_nocopy (*n);
+		}
+	}
+
+	void flush_text (bool at_end);
+};
+
+/** Add pending character data as a text node. With blanks disabled,
+ * libxml2 drops whitespace-only text unless it is all the content of an
+ * element, or the element has mixed content (its first child is text, or it
+ * had non-blank text before). This follows the same heuristic, which gives
+ * the same result for files written by XMLTree or XMLStreamWriter and for
+ * any regular hand-edited file.
+ */
+void
+SAXReader::flush_text (bool at_end)
+{
+	if (text.empty () || stack.empty ()) {
+		text.clear ();
+		text_blank = true;
+		return;
+	}
+
+	XMLNode* parent = stack.back ();
+	XMLNodeList const & children (parent->children ());
+
+	bool keep = !text_blank || mixed.back ();
+
+	if (!keep) {
+		if (children.empty ()) {
+			keep = at_end;
+		} else {
+			keep = children.front()->is_content () && children.front()->name () == "text";
+		}
+	}
+
+	if (!text_blank) {
+		mixed.back () = true;
+	}
+
+	if (keep) {
+		XMLNode* n = new XMLNode ("text");
+		n->set_content (text);
+		parent->add_child_nocopy (*n);
+	}
+
+	text.clear ();
+	text_blank = true;
+}
+
+static void
+sax_start_element (void* ctx, const xmlChar* localname, const xmlChar*, const xmlChar*,
+                   int, const xmlChar**, int nb_attributes, int, const xmlChar** attributes)
+{
+	xmlParserCtxtPtr ctxt = (xmlParserCtxtPtr) ctx;
+	SAXReader* r = (SAXReader*) ctxt->_private;
+
+	r->flush_text (false);
+	r->cdata = false;
+
+	XMLNode* n = new XMLNode (r->name (localname));
+
+	for (int i = 0; i < nb_attributes; ++i, attributes += 5) {
+		/* localname, prefix, URI, value, end */
+		string value ((const char*) attributes[3], attributes[4] - attributes[3]);
+
+		/* without entity substitution, the parser passes '&' as "&#38;"
+		 * for the document builder to decode.
+		 */
+		for (string::size_type p = value.find ("&#38;"); p != string::npos; p = value.find ("&#38;", p + 1)) {
+			value.replace (p, 5, 1, '&');
+		}
+
+		n->set_property (r->name (attributes[0]).c_str (), value);
+	}
+
+	if (r->stack.empty ()) {
+		if (r->root) {
+			/* no second root element */
+			delete n;
+			xmlStopParser (ctxt);
+			return;
+		}
+		r->root = n;
+	} else {
+		r->stack.back()->add_child_nocopy (*n);
+	}
+
+	r->stack.push_back (n);
+	r->mixed.push_back (false);
+}
+
+static void
+sax_end_element (void* ctx, const xmlChar*, const xmlChar*, const xmlChar*)
+{
+	SAXReader* r = (SAXReader*) ((xmlParserCtxtPtr) ctx)->_private;
+
+	r->flush_text (true);
+	r->cdata = false;
+
+	if (!r->stack.empty ()) {
+		r->stack.pop_back ();
+		r->mixed.pop_back ();
+	}
+}
+
+static void
+sax_characters (void* ctx, const xmlChar* ch, int len)
+{
+	SAXReader* r = (SAXReader*) ((xmlParserCtxtPtr) ctx)->_private;
+
+	if (r->stack.empty ()) {
+		return;
+	}
+
+	r->cdata = false;
+
+	for (int i = 0; i < len && r->text_blank; ++i) {
+		if (ch[i] != 0x20 && ch[i] != 0x09 && ch[i] != 0x0a && ch[i] != 0x0d) {
+			r->text_blank = false;
+		}
+	}
+
+	r->text.append ((const char*) ch, len);
+}
+
+static void
+sax_cdata (void* ctx, const xmlChar* ch, int len)
+{
+	SAXReader* r = (SAXReader*) ((xmlParserCtxtPtr) ctx)->_private;
+
+	if (r->stack.empty ()) {
+		return;
+	}
+
+	r->flush_text (false);
+
+	XMLNodeList const & children (r->stack.back()->children ());
+
+	if (r->cdata && !children.empty ()) {
+		/* consecutive CDATA sections are merged */
+		XMLNode* last = children.back ();
+		last->set_content (last->content () + string ((const char*) ch, len));
+	} else {
+		XMLNode* n = new XMLNode (string ());
+		n->set_content (string ((const char*) ch, len));
+		r->stack.back()->add_child_nocopy (*n);
+	}
+
+	r->cdata = true;
+}
+
+static void
+sax_comment (void* ctx, const xmlChar* value)
+{
+	SAXReader* r = (SAXReader*) ((xmlParserCtxtPtr) ctx)->_private;
+
+	r->flush_text (false);
+	r->cdata = false;
+
+	XMLNode* n = new XMLNode ("comment");
+	n->set_content ((const char*) value);
+	r->add_child (n);
+}
+
+static void
+sax_processing_instruction (void* ctx, const xmlChar* target, const xmlChar* data)
+{
+	SAXReader* r = (SAXReader*) ((xmlParserCtxtPtr) ctx)->_private;
+
+	r->flush_text (false);
+	r->cdata = false;
+
+	XMLNode* n = new XMLNode ((const char*) target);
+	n->set_content (data ? (const char*) data : "");
+	r->add_child (n);
+}
+
+} // anon namespace
+
+bool
+XMLTree::read_streaming (const string& fn)
+{
+	set_filename (fn);
+
+	delete _root;
+	_root = 0;
+
+	if (_doc) {
+		xmlFreeDoc (_doc);
+		_doc = 0;
+	}
+
+	FILE* f = g_fopen (_filename.c_str (), "rb");
+
+	if (!f) {
+		return false;
+	}
+
+	xmlSAXHandler defaults;
+	xmlSAXVersion (&defaults, 2);
+
+	/* only the callbacks needed to create XMLNodes, plus error reporting.
+	 * Whitespace is always passed to sax_characters(), which decides what
+	 * to keep.
+	 */
+	xmlSAXHandler sax;
+	memset (&sax, 0, sizeof (sax));
+
+	sax.initialized           = XML_SAX2_MAGIC;
+	sax.warning               = defaults.warning;
+	sax.error                 = defaults.error;
+	sax.fatalError            = defaults.fatalError;
+	sax.startElementNs        = sax_start_element;
+	sax.endElementNs          = sax_end_element;
+	sax.characters            = sax_characters;
+	sax.ignorableWhitespace   = sax_characters;
+	sax.cdataBlock            = sax_cdata;
+	sax.comment               = sax_comment;
+	sax.processingInstruction = sax_processing_instruction;
+
+	char buf[65536];
+	size_t n = fread (buf, 1, sizeof (buf), f);
+
+	if (n >= 2 && (unsigned char) buf[0] == 0x1f && (unsigned char) buf[1] == 0x8b) {
+		/* gzip compressed, which only libxml2's file reader handles */
+		fclose (f);
+		return read_internal (false);
+	}
+
+	xmlParserCtxtPtr ctxt = xmlCreatePushParserCtxt (&sax, 0, buf, n, _filename.c_str ());
+
+	if (!ctxt) {
+		fclose (f);
+		return false;
+	}
+
+	SAXReader reader;
+
+	ctxt->_private = &reader;
+	xmlCtxtUseOptions (ctxt, XML_PARSE_HUGE);
+
+	int err = 0;
+
+	while (err == 0 && (n = fread (buf, 1, sizeof (buf), f)) > 0) {
+		err = xmlParseChunk (ctxt, buf, n, 0);
+	}
+
+	if (err == 0) {
+		err = xmlParseChunk (ctxt, 0, 0, 1);
+	}
+
+	bool const ok = err == 0 && ctxt->wellFormed && !ferror (f) && reader.root && reader.stack.empty ();
+
+	xmlFreeParserCtxt (ctxt);
+	fclose (f);
+
+	if (!ok) {
+		return false;
+	}
+
+	_root = reader.root;
+	reader.root = 0;
+
+	return true;
+}
+
 bool
 XMLTree::read_buffer (char const* buffer, bool to_tree_doc)
 {
@@ -161,6 +491,13 @@ XMLTree::write() const
 	XMLNodeList children;
 	int result;
 
+	if (_compression == 0 && _root) {
+		/* no need to duplicate the whole tree for libxml */
+		XMLStreamWriter writer (_filename);
+		writer.node (*_root);
+		return writer.close ();
+	}
+
 	xmlKeepBlanksDefault(0);
 	doc = xmlNewDoc(xml_version);
 	xmlSetDocCompressMode(doc, _compression);
@@ -228,6 +565,262 @@ XMLTree::write_buffer() const
 	return retval;
 }
 
+/* XMLStreamWriter.
+ *
+ * The output mirrors what xmlSaveFormatFileEnc (..., "UTF-8", 1) produces
+ * for the same tree, so that files written either way are identical:
+ * elements are indented by two spaces per level (up to 30 levels), empty
+ * elements are closed with "/>", and elements with text content are written
+ * without any added whitespace, including all of their descendants.
+ */
+
+static const size_t stream_writer_block_size = 65536;
+static const size_t stream_writer_max_indent = 30;
+
+XMLStreamWriter::XMLStreamWriter (const string& path)
+	: _file (g_fopen (path.c_str (), "wb"))
+	, _error (false)
+	, _tag_open (false)
+	, _written (0)
+{
+	_buf.reserve (stream_writer_block_size * 2);
+	_buf = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+}
+
+XMLStreamWriter::~XMLStreamWriter ()
+{
+	if (_file) {
+		/* not closed explicitly: the document is incomplete */
+		fclose (_file);
+	}
+}
+
+void
+XMLStreamWriter::flush ()
+{
+	if (!_file || _buf.empty ()) {
+		return;
+	}
+
+	if (fwrite (_buf.data (), 1, _buf.size (), _file) != _buf.size ()) {
+		_error = true;
+	}
+
+	_written += _buf.size ();
+	_buf.clear ();
+}
+
+void
+XMLStreamWriter::escape (const string& str, bool attribute)
+{
+	const char* p = str.c_str ();
+	const char* end = p + str.size ();
+	const char* run = p;
+
+	for (; p != end; ++p) {
+		const char* entity;
+
+		switch (*p) {
+		case '<':  entity = "&lt;"; break;
+		case '>':  entity = "&gt;"; break;
+		case '&':  entity = "&amp;"; break;
+		case '\r': entity = "&#13;"; break;
+		case '"':  if (!attribute) continue; entity = "&quot;"; break;
+		case '\n': if (!attribute) continue; entity = "&#10;"; break;
+		case '\t': if (!attribute) continue; entity = "&#9;"; break;
+		default:
+			continue;
+		}
+
+		_buf.append (run, p - run);
+		_buf.append (entity);
+		run = p + 1;
+	}
+
+	_buf.append (run, end - run);
+}
+
+void
+XMLStreamWriter::begin_child (bool element)
+{
+	if (_stack.empty ()) {
+		return;
+	}
+
+	Element& parent (_stack.back ());
+
+	if (!parent.has_children) {
+		_buf += '>';
+		_tag_open = false;
+		parent.has_children = true;
+		if (!element) {
+			/* libxml2 does not format elements with text content */
+			parent.no_format = true;
+		}
+		if (!parent.no_format) {
+			_buf += '\n';
+		}
+	}
+
+	if (element && !parent.no_format) {
+		_buf.append (2 * std::min (_stack.size (), stream_writer_max_indent), ' ');
+	}
+}
+
+void
+XMLStreamWriter::start_element (const char* name)
+{
+	begin_child (true);
+
+	_buf += '<';
+	_buf += name;
+	_tag_open = true;
+
+	_stack.push_back (Element (name, !_stack.empty () && _stack.back ().no_format));
+}
+
+bool
+XMLStreamWriter::attribute (const char* name, const string& value)
+{
+	if (!_tag_open) {
+		return false;
+	}
+
+	_buf += ' ';
+	_buf += name;
+	_buf += "=\"";
+	escape (value, true);
+	_buf += '"';
+
+	return true;
+}
+
+void
+XMLStreamWriter::content (const string& str)
+{
+	if (_stack.empty ()) {
+		return;
+	}
+
+	begin_child (false);
+	escape (str, false);
+}
+
+void
+XMLStreamWriter::end_element ()
+{
+	if (_stack.empty ()) {
+		return;
+	}
+
+	Element& e (_stack.back ());
+
+	if (!e.has_children) {
+		_buf += "/>";
+	} else {
+		if (!e.no_format) {
+			_buf.append (2 * std::min (_stack.size () - 1, stream_writer_max_indent), ' ');
+		}
+		_buf += "</";
+		_buf += e.name;
+		_buf += '>';
+	}
+
+	_tag_open = false;
+	_stack.pop_back ();
+
+	if (_stack.empty () || !_stack.back ().no_format) {
+		_buf += '\n';
+	}
+
+	if (_buf.size () >= stream_writer_block_size) {
+		flush ();
+	}
+}
+
+void
+XMLStreamWriter::node (const XMLNode& n)
+{
+	for (Fillers::iterator r = _replacements.begin (); r != _replacements.end (); ++r) {
+		if (r->first == &n) {
+			/* once only, the address may be reused by another node */
+			Filler f (r->second);
+			_replacements.erase (r);
+			f (*this);
+			return;
+		}
+	}
+
+	if (n.is_content ()) {
+		content (n.content ());
+		return;
+	}
+
+	start_element (n.name ().c_str ());
+
+	const XMLPropertyList& props (n.properties ());
+
+	for (XMLPropertyConstIterator p = props.begin (); p != props.end (); ++p) {
+		attribute ((*p)->name ().c_str (), (*p)->value ());
+	}
+
+	const XMLNodeList& children (n.children ());
+
+	for (XMLNodeConstIterator c = children.begin (); c != children.end (); ++c) {
+		if ((*c)->is_content ()) {
+			/* text anywhere among the children disables formatting */
+			_stack.back ().no_format = true;
+			break;
+		}
+	}
+
+	for (XMLNodeConstIterator c = children.begin (); c != children.end (); ++c) {
+		node (**c);
+	}
+
+	for (Fillers::const_iterator f = _fillers.begin (); f != _fillers.end (); ++f) {
+		if (f->first == &n) {
+			f->second (*this);
+		}
+	}
+
+	end_element ();
+}
+
+void
+XMLStreamWriter::add_filler (const XMLNode* n, Filler filler)
+{
+	_fillers.push_back (make_pair (n, filler));
+}
+
+void
+XMLStreamWriter::replace (const XMLNode* n, Filler filler)
+{
+	_replacements.push_back (make_pair (n, filler));
+}
+
+bool
+XMLStreamWriter::close ()
+{
+	if (!_file) {
+		return false;
+	}
+
+	while (!_stack.empty ()) {
+		end_element ();
+	}
+
+	flush ();
+
+	if (fclose (_file)) {
+		_error = true;
+	}
+
+	_file = 0;
+
+	return !_error;
+}
+
 static const int PROPERTY_RESERVE_COUNT = 16;
 
 XMLNode::XMLNode(const string& n)
@@ -449,6 +1042,11 @@ XMLTree::find(const string xpath, XMLNode* node) const
 	xmlXPathContext* ctxt;
 	xmlDocPtr doc = 0;
 
+	if (!node && !_doc) {
+		/* read_streaming() does not keep the document */
+		node = _root;
+	}
+
 	if (node) {
 		doc = xmlNewDoc(xml_version);
 		writenode(doc, node, doc->children, 1);
@@ -802,6 +1400,23 @@ static XMLSharedNodeList* find_impl(xmlXPathContext* ctxt, const string& xpath)
 	return nodes;
 }
 
+size_t
+XMLNode::memory_used () const
+{
+	size_t bytes = sizeof (XMLNode) + _name.capacity() + _content.capacity();
+
+	for (XMLPropertyList::const_iterator i = _proplist.begin(); i != _proplist.end(); ++i) {
+		bytes += sizeof (XMLProperty) + sizeof (XMLProperty*) + (*i)->name().capacity() + (*i)->value().capacity();
+	}
+
+	for (XMLNodeList::const_iterator i = _children.begin(); i != _children.end(); ++i) {
+		/* list node: two pointers plus the payload */
+		bytes += 3 * sizeof (void*) + (*i)->memory_used ();
+	}
+
+	return bytes;
+}
+
 /** Dump a node, its properties and children to a stream */
 void
 XMLNode::dump (ostream& s, string p) const
@@ -166,8 +166,12 @@ WaveViewCacheGroup::clear_cache ()
 WaveViewCache::WaveViewCache ()
 	: image_cache_size (0)
 	, _image_cache_threshold (100 * 1048576) /* bytes */
+	, _account (PBD::MemoryAccount::get ("waveform-cache"))
 {
-
+	/* images in use by a WaveView are kept alive by the view itself,
+	 * so dropping all cached images is safe at any time.
+	 */
+	_account.OverBudget.connect_same_thread (_budget_connection, boost::bind (&WaveViewCache::clear_cache, this));
 }
 
 WaveViewCache::~WaveViewCache ()
@@ -185,6 +189,7 @@ void
 WaveViewCache::increase_size (uint64_t bytes)
 {
 	image_cache_size += bytes;
+	_account.add (bytes);
 }
 
 void
@@ -193,6 +198,7 @@ WaveViewCache::decrease_size (uint64_t bytes)
 	assert (bytes > 0);
 	assert (bytes <= image_cache_size);
 	image_cache_size -= bytes;
+	_account.remove (bytes);
 }
 
 boost::shared_ptr<WaveViewCacheGroup>
@@ -247,6 +253,12 @@ WaveViewCache::clear_cache ()
 	}
 }
 
+bool
+WaveViewCache::full () const
+{
+	return image_cache_size > _image_cache_threshold || _account.over_budget ();
+}
+
 void
 WaveViewCache::set_image_cache_threshold (uint64_t sz)
 {
@@ -21,6 +21,8 @@
 
 #include <deque>
 
+#include "pbd/memory_account.h"
+
 #include "waveview/wave_view.h"
 
 namespace ARDOUR {
@@ -278,13 +280,16 @@ private:
 	uint64_t image_cache_size;
 	uint64_t _image_cache_threshold;
 
+	PBD::MemoryAccount&   _account;
+	PBD::ScopedConnection _budget_connection;
+
 private:
 	friend class WaveViewCacheGroup;
 
 	void increase_size (uint64_t bytes);
 	void decrease_size (uint64_t bytes);
 
-	bool full () { return image_cache_size > _image_cache_threshold; }
+	bool full () const;
 };
 
 class WaveViewDrawingThread